@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "backupstore.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <sstream>
+
+#include "bufferpool.h"
+#include "runcontext.h"
+#include "sha256.h"
+#include "util.h"
+
+namespace gdfm {
+
+namespace {
+
+/* How much of a file is copied into the store at a time. */
+const size_t BACKUP_COPY_SIZE = 64 * 1024;
+} /* namespace */
+
+BackupStore::BackupStore(const std::string& directory) : directory(directory)
+{
+}
+
+BackupStore::~BackupStore()
+{
+    if (runRecordDescriptor != -1)
+        close(runRecordDescriptor);
+}
+
+const std::string&
+BackupStore::getDirectory() const
+{
+    return directory;
+}
+
+bool
+BackupStore::backUp(const std::string& path, bool removing)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return errno == ENOENT || errno == ENOTDIR;
+    if (S_ISDIR(info.st_mode))
+        return backUpDirectory(path, removing);
+    if (S_ISREG(info.st_mode))
+        return backUpRegularFile(path, info, removing);
+    /* Nothing else has contents to keep. */
+    return true;
+}
+
+bool
+BackupStore::backUpInstall(
+    const std::string& sourcePath, const std::string& destinationPath)
+{
+    struct stat info;
+    if (stat(sourcePath.c_str(), &info) != 0)
+        return false;
+    if (S_ISREG(info.st_mode))
+        return backUpInstalledFile(destinationPath);
+    if (!S_ISDIR(info.st_mode))
+        return true;
+    DIR* stream = opendir(sourcePath.c_str());
+    if (!stream)
+        return false;
+    bool status = true;
+    while (struct dirent* entry = readdir(stream)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        if (!backUpInstall(sourcePath + "/" + name,
+                destinationPath + "/" + name))
+            status = false;
+    }
+    closedir(stream);
+    return status;
+}
+
+std::vector<BackupStore::Record>
+BackupStore::getRecords() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+std::string
+BackupStore::getObjectPath(const std::string& digest) const
+{
+    return directory + "/objects/" + digest.substr(0, 2) + "/"
+        + digest.substr(2);
+}
+
+void
+BackupStore::startRunRecord(const std::string& runName)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->runName = runName;
+    runRecordFailed = false;
+}
+
+bool
+BackupStore::finishRunRecord()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (runRecordDescriptor != -1 && close(runRecordDescriptor) != 0)
+        runRecordFailed = true;
+    runRecordDescriptor = -1;
+    runName.clear();
+    return !runRecordFailed;
+}
+
+bool
+BackupStore::readRunRecord(
+    const std::string& runName, std::vector<Record>& records) const
+{
+    std::string contents;
+    if (!readFileContents(directory + "/runs/" + runName, contents))
+        return false;
+    records.clear();
+    std::istringstream lines(contents);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        Record record;
+        if (!(fields >> record.digest >> std::oct >> record.mode))
+            return false;
+        if (record.digest == "-")
+            record.digest.clear();
+        /* The path is the rest of the line, spaces and all. */
+        fields.get();
+        std::getline(fields, record.path);
+        if (record.path.empty())
+            return false;
+        records.push_back(record);
+    }
+    return true;
+}
+
+bool
+BackupStore::restore(const Record& record) const
+{
+    if (record.digest.empty()) {
+        struct stat info;
+        if (lstat(record.path.c_str(), &info) != 0)
+            return errno == ENOENT || errno == ENOTDIR;
+        /* Directories are left, since other files may have gone in them. */
+        if (S_ISDIR(info.st_mode))
+            return true;
+        return unlink(record.path.c_str()) == 0;
+    }
+    int source =
+        open(getObjectPath(record.digest).c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+        return false;
+    /*
+     * The contents go in a temporary file next to the old one and replace
+     * it in one step, so nothing ever sees half of them.
+     */
+    std::string temporaryPath = record.path + ".XXXXXX";
+    if (!ensureParentDirectoriesExist(record.path)) {
+        close(source);
+        return false;
+    }
+    int destination = mkostemp(&temporaryPath[0], O_CLOEXEC);
+    if (destination == -1) {
+        close(source);
+        return false;
+    }
+    struct stat objectInfo;
+    bool status = fstat(source, &objectInfo) == 0
+        && copyDescriptorContents(source, destination, objectInfo.st_size)
+        && fchmod(destination, record.mode) == 0;
+    close(source);
+    if (close(destination) != 0)
+        status = false;
+    if (status) {
+        /* A directory in the way was put there by the run. */
+        struct stat info;
+        if (lstat(record.path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)
+            && !deleteFile(record.path))
+            status = false;
+    }
+    if (status && rename(temporaryPath.c_str(), record.path.c_str()) != 0)
+        status = false;
+    if (!status)
+        unlink(temporaryPath.c_str());
+    return status;
+}
+
+uint64_t
+BackupStore::getObjectsStored() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return objectsStored;
+}
+
+uint64_t
+BackupStore::getObjectsReused() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return objectsReused;
+}
+
+uint64_t
+BackupStore::getBytesCopied() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesCopied;
+}
+
+std::string
+BackupStore::createRunName()
+{
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &local);
+    std::string name = std::string(buffer) + "-" + std::to_string(getpid());
+    /* Runs started in the same second by one process still get their own. */
+    static std::atomic<unsigned int> runCount(0);
+    unsigned int count = runCount++;
+    if (count > 0)
+        name += "." + std::to_string(count);
+    return name;
+}
+
+bool
+BackupStore::backUpDirectory(const std::string& path, bool removing)
+{
+    DIR* stream = opendir(path.c_str());
+    if (!stream)
+        return false;
+    bool status = true;
+    while (struct dirent* entry = readdir(stream)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string entryPath = path + "/" + name;
+        /* Links in the tree are copied as what they point to, if at all. */
+        struct stat info;
+        if (lstat(entryPath.c_str(), &info) != 0) {
+            status = false;
+            continue;
+        }
+        if (S_ISDIR(info.st_mode) && !backUpDirectory(entryPath, removing))
+            status = false;
+        else if (S_ISREG(info.st_mode)
+            && !backUpRegularFile(entryPath, info, removing))
+            status = false;
+    }
+    closedir(stream);
+    return status;
+}
+
+bool
+BackupStore::backUpInstalledFile(const std::string& destinationPath)
+{
+    struct stat info;
+    if (stat(destinationPath.c_str(), &info) == 0) {
+        if (S_ISREG(info.st_mode))
+            return backUpRegularFile(destinationPath, info, false);
+        /* Copying won't write over anything else. */
+        return true;
+    }
+    if (errno != ENOENT && errno != ENOTDIR)
+        return false;
+    Record record;
+    record.path = destinationPath;
+    record.mode = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    return addRecord(record);
+}
+
+bool
+BackupStore::backUpRegularFile(
+    const std::string& path, const struct stat& info, bool removing)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        /* Only what was there before the run started is worth keeping. */
+        if (backedUpPaths.count(path) > 0)
+            return true;
+    }
+    Record record;
+    record.path = path;
+    record.mode = info.st_mode & 07777;
+    /*
+     * Hash first, so contents that are already stored, which is the common
+     * case, don't get written again.
+     */
+    if (!Sha256::hashFile(path, record.digest))
+        return false;
+    if (access(getObjectPath(record.digest).c_str(), F_OK) == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        objectsReused++;
+        return addRecord(record);
+    }
+    std::string temporaryPath = createTemporaryPath();
+    if (temporaryPath.empty())
+        return false;
+    uint64_t size = 0;
+    /*
+     * The removal takes the file out of use, so it can go in the store as it
+     * is. Linking it instead would leave the object sharing its contents
+     * with the file if the removal then failed.
+     */
+    bool moved = removing && moveToTemporary(path, info, temporaryPath);
+    if (!moved
+        && !copyToTemporary(path, temporaryPath, record.digest, size))
+        return false;
+    if (!storeTemporary(temporaryPath, record.digest, moved ? path : ""))
+        return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    bytesCopied += size;
+    return addRecord(record);
+}
+
+bool
+BackupStore::copyToTemporary(const std::string& path,
+    const std::string& temporaryPath, std::string& digest, uint64_t& size)
+{
+    int source = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+        return false;
+    int destination = open(temporaryPath.c_str(),
+        O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IRGRP | S_IROTH);
+    if (destination == -1) {
+        close(source);
+        return false;
+    }
+    /* The file may have changed since it was hashed, so hash it again. */
+    Sha256 hash;
+    BufferPool::Lease buffer =
+        RunContext::getCurrentBufferPool().acquire(BACKUP_COPY_SIZE);
+    bool status = true;
+    size = 0;
+    while (true) {
+        ssize_t count = read(source, buffer.getData(), BACKUP_COPY_SIZE);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count <= 0) {
+            status = count == 0;
+            break;
+        }
+        hash.update(buffer.getData(), count);
+        if (!writeAll(destination, buffer.getData(), count)) {
+            status = false;
+            break;
+        }
+        size += count;
+    }
+    close(source);
+    if (close(destination) != 0)
+        status = false;
+    if (!status) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    digest = hash.finish();
+    return true;
+}
+
+bool
+BackupStore::moveToTemporary(const std::string& path,
+    const struct stat& info, const std::string& temporaryPath)
+{
+    /* A link to the file would see any later change to the object. */
+    struct stat linkInfo;
+    if (lstat(path.c_str(), &linkInfo) != 0 || !S_ISREG(linkInfo.st_mode)
+        || linkInfo.st_dev != info.st_dev || linkInfo.st_ino != info.st_ino
+        || linkInfo.st_nlink != 1)
+        return false;
+    /* Renaming doesn't work across file systems, so those are copied. */
+    if (rename(path.c_str(), temporaryPath.c_str()) != 0)
+        return false;
+    /* Objects are read only, like the ones that are copied. */
+    chmod(temporaryPath.c_str(), S_IRUSR | S_IRGRP | S_IROTH);
+    return true;
+}
+
+bool
+BackupStore::storeTemporary(const std::string& temporaryPath,
+    const std::string& digest, const std::string& movedFrom)
+{
+    std::string objectPath = getObjectPath(digest);
+    bool stored = access(objectPath.c_str(), F_OK) != 0;
+    if (stored) {
+        if (!ensureParentDirectoriesExist(objectPath)
+            || rename(temporaryPath.c_str(), objectPath.c_str()) != 0) {
+            /* A file that can't go back at least stays in tmp/. */
+            if (!movedFrom.empty())
+                rename(temporaryPath.c_str(), movedFrom.c_str());
+            else
+                unlink(temporaryPath.c_str());
+            return false;
+        }
+    } else
+        unlink(temporaryPath.c_str());
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stored)
+        objectsStored++;
+    else
+        objectsReused++;
+    return true;
+}
+
+std::string
+BackupStore::createTemporaryPath()
+{
+    std::string temporaryDirectory = directory + "/tmp";
+    if (!ensureDirectoriesExist(temporaryDirectory))
+        return "";
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        path = temporaryDirectory + "/" + std::to_string(getpid()) + "."
+            + std::to_string(nextTemporary++);
+    }
+    /* Whatever is left from an earlier process with the same id is junk. */
+    unlink(path.c_str());
+    return path;
+}
+
+bool
+BackupStore::addRecord(const Record& record)
+{
+    if (backedUpPaths.count(record.path) > 0)
+        return true;
+    if (!runName.empty()) {
+        if (runRecordDescriptor == -1) {
+            std::string runsDirectory = directory + "/runs";
+            if (ensureDirectoriesExist(runsDirectory)) {
+                runRecordDescriptor = open(
+                    (runsDirectory + "/" + runName).c_str(),
+                    O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+            }
+        }
+        std::ostringstream line;
+        line << (record.digest.empty() ? "-" : record.digest) << " "
+             << std::oct << record.mode << " " << record.path << "\n";
+        std::string text = line.str();
+        if (runRecordDescriptor == -1
+            || !writeAll(runRecordDescriptor, text.data(), text.size())) {
+            runRecordFailed = true;
+            return false;
+        }
+    }
+    backedUpPaths.insert(record.path);
+    records.push_back(record);
+    return true;
+}
+} /* namespace gdfm */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BACKUP_STORE_H
+#define BACKUP_STORE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace gdfm {
+
+/*
+ * Keeps the contents of every file a run writes over or removes, so they
+ * can be gotten back. Contents are stored once under their SHA-256 digest,
+ * however many times and from wherever they are replaced, so backing up the
+ * same files over and over, even from many home directories sharing one
+ * store, costs one copy of each version.
+ *
+ * The store is a directory with objects/ holding the contents, named like
+ * objects/ab/cdef... after the digest, and runs/ holding a record of what
+ * each run replaced and created. Files that are about to be removed are
+ * moved into the store when it is on the same file system, so backing them
+ * up copies nothing. Everything else is copied, since an object must never
+ * share its contents with a file that is still in use, which could be
+ * written over later.
+ *
+ * The record of a run is appended to as the run goes, after the contents
+ * it names are stored and before the file is touched, so a run that
+ * crashes halfway can still be rolled back. It isn't synced, though.
+ *
+ * Several modules of one run may back up files at the same time.
+ */
+class BackupStore {
+public:
+    /*
+     * A file that was replaced, and where its contents went. The digest is
+     * empty for a file that didn't exist before the run.
+     */
+    struct Record {
+        std::string path;
+        std::string digest;
+        mode_t mode;
+    };
+
+    BackupStore(const std::string& directory);
+    ~BackupStore();
+
+    const std::string& getDirectory() const;
+    /*
+     * Stores the contents of the file at path, or of every file under it if
+     * it is a directory, unless they were already stored for this run.
+     * Nothing is stored if there's no file at path. Set removing if the file
+     * is about to be removed rather than written over.
+     *
+     * Returns true on success, false if anything couldn't be stored.
+     */
+    bool backUp(const std::string& path, bool removing);
+    /*
+     * Stores the contents of every file that copying sourcePath to
+     * destinationPath would write over, and notes each one it would create.
+     *
+     * Returns true on success, false if anything couldn't be stored.
+     */
+    bool backUpInstall(
+        const std::string& sourcePath, const std::string& destinationPath);
+    /* Returns every file backed up so far, in the order they were. */
+    std::vector<Record> getRecords() const;
+    /* Returns where the contents with the given digest are stored. */
+    std::string getObjectPath(const std::string& digest) const;
+    /*
+     * Appends everything backed up from now on to runs/runName, one line for
+     * each file with its digest, or "-" if it was created, its mode in octal
+     * and its path. The file is only created once there is something to
+     * write.
+     */
+    void startRunRecord(const std::string& runName);
+    /*
+     * Closes the record started by startRunRecord().
+     *
+     * Returns true if the whole record was written, false otherwise.
+     */
+    bool finishRunRecord();
+    /*
+     * Reads the record of the run with the given name.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool readRunRecord(
+        const std::string& runName, std::vector<Record>& records) const;
+    /*
+     * Puts the file from record back the way it was before its run, or
+     * removes it if the run created it. The contents are cloned from the
+     * store where the file system allows it, and copied otherwise. They are
+     * never linked, since a later run writing over the file would change
+     * the stored copy too.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool restore(const Record& record) const;
+
+    /* How many files had contents that weren't in the store yet. */
+    uint64_t getObjectsStored() const;
+    /* How many files had contents that were already in the store. */
+    uint64_t getObjectsReused() const;
+    /* How many bytes were copied into the store. */
+    uint64_t getBytesCopied() const;
+
+    /*
+     * Returns a name for a run starting now, from the time, the process and
+     * how many runs it started before.
+     */
+    static std::string createRunName();
+
+private:
+    std::string directory;
+    mutable std::mutex mutex;
+    std::vector<Record> records;
+    std::unordered_set<std::string> backedUpPaths;
+    uint64_t objectsStored = 0;
+    uint64_t objectsReused = 0;
+    uint64_t bytesCopied = 0;
+    /* Makes the names of temporary files in the store unique. */
+    uint64_t nextTemporary = 0;
+    std::string runName;
+    int runRecordDescriptor = -1;
+    bool runRecordFailed = false;
+
+    bool backUpDirectory(const std::string& path, bool removing);
+    /* Backs up what copying a file to destinationPath would change. */
+    bool backUpInstalledFile(const std::string& destinationPath);
+    bool backUpRegularFile(
+        const std::string& path, const struct stat& info, bool removing);
+    /*
+     * Copies the file at path to temporaryPath, hashing it along the way.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool copyToTemporary(const std::string& path,
+        const std::string& temporaryPath, std::string& digest,
+        uint64_t& size);
+    /*
+     * Moves the file at path, which info is about, to temporaryPath if it is
+     * a regular file without other links on the same file system.
+     *
+     * Returns true if it was moved, false otherwise.
+     */
+    bool moveToTemporary(const std::string& path, const struct stat& info,
+        const std::string& temporaryPath);
+    /*
+     * Moves the temporary file to where the contents with digest go, unless
+     * they are already there, in which case it is removed. If it can't be
+     * stored, it is moved back to movedFrom if that isn't empty, and removed
+     * otherwise.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool storeTemporary(const std::string& temporaryPath,
+        const std::string& digest, const std::string& movedFrom);
+    /* Returns a path for a new temporary file, or "" on failure. */
+    std::string createTemporaryPath();
+    /*
+     * Keeps record unless its path has one already, and appends it to the
+     * record of the run if one was started. Needs the mutex.
+     *
+     * Returns true on success, false if it couldn't be written down.
+     */
+    bool addRecord(const Record& record);
+};
+} /* namespace gdfm */
+
+#endif /* BACKUP_STORE_H */
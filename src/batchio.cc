@@ -0,0 +1,689 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "batchio.h"
+#include "config.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "bufferpool.h"
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
+
+namespace gdfm {
+
+namespace {
+/* Returns true if the environment asks for batches. */
+bool
+isEnabledByEnvironment()
+{
+    const char* value = getenv(BATCH_IO_ENVIRONMENT_VARIABLE);
+    return value && strcmp(value, "1") == 0;
+}
+
+std::atomic<bool> batchIoEnabled(isEnabledByEnvironment());
+
+#ifdef HAVE_IO_URING
+/* How many entries the ring of each thread has room for. */
+const unsigned RING_ENTRIES = 4 * BATCH_FILE_COUNT;
+
+/*
+ * A bare io_uring, set up with the system calls directly so there is no
+ * library to depend on. Entries are queued with getEntry() and submitted
+ * together by complete(). Only the thread that created it may use it.
+ */
+class IoRing {
+public:
+    IoRing();
+    ~IoRing();
+
+    /*
+     * Creates a ring with room for entryCount entries.
+     *
+     * Returns true on success, false if the kernel won't create it.
+     */
+    bool initialize(unsigned entryCount);
+    /* Returns a cleared entry to fill in, or nullptr if the ring is full. */
+    struct io_uring_sqe* getEntry();
+    /*
+     * Submits every queued entry and waits for all of them, calling handler
+     * with the user data and result of each one as it completes.
+     *
+     * Returns true on success, false if submitting failed, in which case the
+     * ring can't be used again.
+     */
+    bool complete(const std::function<void(uint64_t, int)>& handler);
+
+private:
+    int descriptor = -1;
+    void* submissionRing = MAP_FAILED;
+    size_t submissionRingSize = 0;
+    void* completionRing = MAP_FAILED;
+    size_t completionRingSize = 0;
+    void* entries = MAP_FAILED;
+    size_t entriesSize = 0;
+
+    unsigned* submissionHead = nullptr;
+    unsigned* submissionTail = nullptr;
+    unsigned* submissionArray = nullptr;
+    unsigned submissionMask = 0;
+    unsigned submissionEntries = 0;
+    /* The tail including entries that were queued but not submitted. */
+    unsigned queuedTail = 0;
+    unsigned* completionHead = nullptr;
+    unsigned* completionTail = nullptr;
+    struct io_uring_cqe* completions = nullptr;
+    unsigned completionMask = 0;
+};
+
+IoRing::IoRing()
+{
+}
+
+IoRing::~IoRing()
+{
+    if (entries != MAP_FAILED)
+        munmap(entries, entriesSize);
+    if (completionRing != MAP_FAILED && completionRing != submissionRing)
+        munmap(completionRing, completionRingSize);
+    if (submissionRing != MAP_FAILED)
+        munmap(submissionRing, submissionRingSize);
+    if (descriptor != -1)
+        close(descriptor);
+}
+
+bool
+IoRing::initialize(unsigned entryCount)
+{
+    struct io_uring_params parameters;
+    memset(&parameters, 0, sizeof(parameters));
+    descriptor = syscall(__NR_io_uring_setup, entryCount, &parameters);
+    if (descriptor == -1)
+        return false;
+    submissionRingSize =
+        parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+    completionRingSize = parameters.cq_off.cqes
+        + parameters.cq_entries * sizeof(struct io_uring_cqe);
+    /* Newer kernels put both rings in one mapping. */
+    bool singleMapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping) {
+        submissionRingSize = std::max(submissionRingSize, completionRingSize);
+        completionRingSize = submissionRingSize;
+    }
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+    if (submissionRing == MAP_FAILED)
+        return false;
+    if (singleMapping) {
+        completionRing = submissionRing;
+    } else {
+        completionRing = mmap(nullptr, completionRingSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor,
+            IORING_OFF_CQ_RING);
+        if (completionRing == MAP_FAILED)
+            return false;
+    }
+    entriesSize = parameters.sq_entries * sizeof(struct io_uring_sqe);
+    entries = mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES);
+    if (entries == MAP_FAILED)
+        return false;
+
+    char* submission = static_cast<char*>(submissionRing);
+    submissionHead =
+        reinterpret_cast<unsigned*>(submission + parameters.sq_off.head);
+    submissionTail =
+        reinterpret_cast<unsigned*>(submission + parameters.sq_off.tail);
+    submissionArray =
+        reinterpret_cast<unsigned*>(submission + parameters.sq_off.array);
+    submissionMask = *reinterpret_cast<unsigned*>(
+        submission + parameters.sq_off.ring_mask);
+    submissionEntries = parameters.sq_entries;
+    queuedTail = *submissionTail;
+    char* completion = static_cast<char*>(completionRing);
+    completionHead =
+        reinterpret_cast<unsigned*>(completion + parameters.cq_off.head);
+    completionTail =
+        reinterpret_cast<unsigned*>(completion + parameters.cq_off.tail);
+    completions = reinterpret_cast<struct io_uring_cqe*>(
+        completion + parameters.cq_off.cqes);
+    completionMask = *reinterpret_cast<unsigned*>(
+        completion + parameters.cq_off.ring_mask);
+    return true;
+}
+
+struct io_uring_sqe*
+IoRing::getEntry()
+{
+    unsigned head = __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+    if (queuedTail - head >= submissionEntries)
+        return nullptr;
+    unsigned index = queuedTail & submissionMask;
+    struct io_uring_sqe* entry =
+        static_cast<struct io_uring_sqe*>(entries) + index;
+    memset(entry, 0, sizeof(*entry));
+    submissionArray[index] = index;
+    queuedTail++;
+    return entry;
+}
+
+bool
+IoRing::complete(const std::function<void(uint64_t, int)>& handler)
+{
+    unsigned unsubmitted = queuedTail - *submissionTail;
+    unsigned outstanding = unsubmitted;
+    __atomic_store_n(submissionTail, queuedTail, __ATOMIC_RELEASE);
+    while (outstanding > 0) {
+        long count = syscall(__NR_io_uring_enter, descriptor, unsubmitted, 1,
+            IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count == -1)
+            return false;
+        unsubmitted -= std::min<unsigned>(count, unsubmitted);
+        unsigned head = *completionHead;
+        unsigned tail = __atomic_load_n(completionTail, __ATOMIC_ACQUIRE);
+        for (; head != tail && outstanding > 0; head++, outstanding--) {
+            const struct io_uring_cqe& completion =
+                completions[head & completionMask];
+            handler(completion.user_data, completion.res);
+        }
+        __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+/* The ring of a thread, created the first time a batch runs on it. */
+struct ThreadRing {
+    std::unique_ptr<IoRing> ring;
+    bool failed = false;
+};
+
+thread_local ThreadRing threadRing;
+
+/*
+ * Returns the ring of the calling thread, or nullptr if batches are off or
+ * it can't have one.
+ */
+IoRing*
+getThreadRing()
+{
+    if (!batchIoEnabled || threadRing.failed)
+        return nullptr;
+    if (!threadRing.ring) {
+        threadRing.ring.reset(new IoRing());
+        if (!threadRing.ring->initialize(RING_ENTRIES)) {
+            threadRing.ring.reset();
+            threadRing.failed = true;
+        }
+    }
+    return threadRing.ring.get();
+}
+
+/* Gives up on the ring of the calling thread after it failed. */
+void
+discardThreadRing()
+{
+    threadRing.ring.reset();
+    threadRing.failed = true;
+}
+
+/*
+ * The operations done on each file of a batch. User data is the index of
+ * the file in the batch times OPERATION_COUNT plus one of these.
+ */
+enum Operation {
+    SOURCE_STAT_OPERATION,
+    DESTINATION_STAT_OPERATION,
+    SOURCE_OPEN_OPERATION,
+    DESTINATION_OPEN_OPERATION,
+    SOURCE_READ_OPERATION,
+    DESTINATION_READ_OPERATION,
+    WRITE_OPERATION,
+    SOURCE_CLOSE_OPERATION,
+    DESTINATION_CLOSE_OPERATION,
+    OPERATION_COUNT
+};
+
+/* What a batch knows about one of its files. */
+struct BatchFile {
+    int source = -1;
+    int destination = -1;
+    struct statx sourceInfo;
+    struct statx destinationInfo;
+    /* Where the batch's buffer holds each file's contents. */
+    char* sourceContents = nullptr;
+    char* destinationContents = nullptr;
+    /* Cleared when any step fails, leaving the file to the caller. */
+    bool succeeded = true;
+};
+
+uint64_t
+getUserData(size_t index, Operation operation)
+{
+    return index * OPERATION_COUNT + operation;
+}
+
+void
+prepareStat(struct io_uring_sqe* entry, const std::string& path,
+    struct statx* info, uint64_t userData)
+{
+    entry->opcode = IORING_OP_STATX;
+    entry->fd = AT_FDCWD;
+    entry->addr = reinterpret_cast<uintptr_t>(path.c_str());
+    entry->len = STATX_TYPE | STATX_MODE | STATX_SIZE;
+    entry->off = reinterpret_cast<uintptr_t>(info);
+    entry->user_data = userData;
+}
+
+void
+prepareOpen(struct io_uring_sqe* entry, const std::string& path, int flags,
+    uint64_t userData)
+{
+    entry->opcode = IORING_OP_OPENAT;
+    entry->fd = AT_FDCWD;
+    entry->addr = reinterpret_cast<uintptr_t>(path.c_str());
+    entry->len = 0600;
+    entry->open_flags = flags | O_CLOEXEC;
+    entry->user_data = userData;
+}
+
+void
+prepareTransfer(struct io_uring_sqe* entry, int opcode, int descriptor,
+    char* buffer, size_t size, uint64_t userData)
+{
+    entry->opcode = opcode;
+    entry->fd = descriptor;
+    entry->addr = reinterpret_cast<uintptr_t>(buffer);
+    entry->len = size;
+    entry->off = 0;
+    entry->user_data = userData;
+}
+
+void
+prepareClose(struct io_uring_sqe* entry, int descriptor, uint64_t userData)
+{
+    entry->opcode = IORING_OP_CLOSE;
+    entry->fd = descriptor;
+    entry->user_data = userData;
+}
+
+/*
+ * Records the result of one operation on files. Reads and writes must
+ * transfer the whole file.
+ */
+void
+handleResult(std::vector<BatchFile>& files, uint64_t userData, int result)
+{
+    BatchFile& file = files[userData / OPERATION_COUNT];
+    switch (userData % OPERATION_COUNT) {
+    case SOURCE_OPEN_OPERATION:
+        file.source = result;
+        break;
+    case DESTINATION_OPEN_OPERATION:
+        file.destination = result;
+        break;
+    case SOURCE_READ_OPERATION:
+    case WRITE_OPERATION:
+        if (result != static_cast<int>(file.sourceInfo.stx_size))
+            file.succeeded = false;
+        return;
+    case DESTINATION_READ_OPERATION:
+        if (result != static_cast<int>(file.destinationInfo.stx_size))
+            file.succeeded = false;
+        return;
+    }
+    if (result < 0)
+        file.succeeded = false;
+}
+
+/* Closes every descriptor files has open one at a time. */
+void
+closeDescriptors(std::vector<BatchFile>& files)
+{
+    for (auto& file : files) {
+        if (file.source >= 0)
+            close(file.source);
+        if (file.destination >= 0)
+            close(file.destination);
+        file.source = file.destination = -1;
+    }
+}
+
+/*
+ * Closes every descriptor files has open in one submission.
+ *
+ * Returns true on success, false if the ring failed.
+ */
+bool
+closeBatchFiles(IoRing& ring, std::vector<BatchFile>& files)
+{
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].source >= 0) {
+            prepareClose(ring.getEntry(), files[i].source,
+                getUserData(i, SOURCE_CLOSE_OPERATION));
+        }
+        if (files[i].destination >= 0) {
+            prepareClose(ring.getEntry(), files[i].destination,
+                getUserData(i, DESTINATION_CLOSE_OPERATION));
+        }
+    }
+    bool status = ring.complete([&](uint64_t userData, int result) {
+        /* A failed close of a written file may have lost the write. */
+        BatchFile& file = files[userData / OPERATION_COUNT];
+        if (userData % OPERATION_COUNT == DESTINATION_CLOSE_OPERATION
+            && result < 0)
+            file.succeeded = false;
+    });
+    if (!status)
+        closeDescriptors(files);
+    for (auto& file : files)
+        file.source = file.destination = -1;
+    return status;
+}
+
+/*
+ * Returns true if info is of a regular file small enough for a batch.
+ */
+bool
+isSmallRegularFile(const struct statx& info)
+{
+    return S_ISREG(info.stx_mode)
+        && info.stx_size <= static_cast<uint64_t>(BATCH_FILE_SIZE);
+}
+
+/*
+ * Finds how many of files fit in one buffer from the budget, when each
+ * one that succeeded needs sizeFactor times its size. Files too big for a
+ * buffer of their own are left to the usual way.
+ *
+ * Returns the number of files that fit, with their size in totalSize.
+ */
+size_t
+fitInBudget(std::vector<BatchFile>& files, size_t sizeFactor,
+    size_t& totalSize)
+{
+    size_t limit = RunContext::getCurrentBufferPool().getLargestBufferSize();
+    totalSize = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files[i].succeeded)
+            continue;
+        size_t size = sizeFactor * files[i].sourceInfo.stx_size;
+        if (size > limit) {
+            files[i].succeeded = false;
+            continue;
+        }
+        if (totalSize + size > limit) {
+            for (size_t j = i; j < files.size(); j++)
+                files[j].succeeded = false;
+            return i;
+        }
+        totalSize += size;
+    }
+    return files.size();
+}
+
+/*
+ * Copies the files from begin up to end, setting copied for those that
+ * were. Only as many as fit in the budget are copied, and end is moved
+ * back to the first that wasn't.
+ *
+ * Returns true on success, false if the ring failed.
+ */
+bool
+copyBatch(IoRing& ring, const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths, size_t begin,
+    size_t& end, std::vector<bool>& copied)
+{
+    std::vector<BatchFile> files(end - begin);
+    auto handler = [&](uint64_t userData, int result) {
+        handleResult(files, userData, result);
+    };
+    /* The destination is only truncated if the source could be opened. */
+    for (size_t i = 0; i < files.size(); i++) {
+        struct io_uring_sqe* entry = ring.getEntry();
+        prepareStat(entry, sourcePaths[begin + i], &files[i].sourceInfo,
+            getUserData(i, SOURCE_STAT_OPERATION));
+        entry->flags |= IOSQE_IO_LINK;
+        entry = ring.getEntry();
+        prepareOpen(entry, sourcePaths[begin + i], O_RDONLY,
+            getUserData(i, SOURCE_OPEN_OPERATION));
+        entry->flags |= IOSQE_IO_LINK;
+        prepareOpen(ring.getEntry(), destinationPaths[begin + i],
+            O_WRONLY | O_CREAT | O_TRUNC,
+            getUserData(i, DESTINATION_OPEN_OPERATION));
+    }
+    if (!ring.complete(handler)) {
+        closeDescriptors(files);
+        return false;
+    }
+
+    for (auto& file : files) {
+        if (!isSmallRegularFile(file.sourceInfo))
+            file.succeeded = false;
+    }
+    /*
+     * The whole batch goes through one buffer taken from the budget. The
+     * files that don't fit were truncated already, so the next batch has
+     * to copy them.
+     */
+    size_t totalSize;
+    size_t count = fitInBudget(files, 1, totalSize);
+    BufferPool::Lease buffer =
+        RunContext::getCurrentBufferPool().acquire(totalSize);
+    char* contents = buffer.getData();
+    /* A short read breaks the link, so the write never happens. */
+    for (size_t i = 0; i < files.size(); i++) {
+        BatchFile& file = files[i];
+        if (!file.succeeded || file.sourceInfo.stx_size == 0)
+            continue;
+        file.sourceContents = contents;
+        contents += file.sourceInfo.stx_size;
+        struct io_uring_sqe* entry = ring.getEntry();
+        prepareTransfer(entry, IORING_OP_READ, file.source,
+            file.sourceContents, file.sourceInfo.stx_size,
+            getUserData(i, SOURCE_READ_OPERATION));
+        entry->flags |= IOSQE_IO_LINK;
+        prepareTransfer(ring.getEntry(), IORING_OP_WRITE, file.destination,
+            file.sourceContents, file.sourceInfo.stx_size,
+            getUserData(i, WRITE_OPERATION));
+    }
+    if (!ring.complete(handler)) {
+        closeDescriptors(files);
+        return false;
+    }
+
+    /* There is no operation for this, so it's one call for each file. */
+    for (auto& file : files) {
+        if (file.succeeded
+            && fchmod(file.destination, file.sourceInfo.stx_mode & 07777) != 0)
+            file.succeeded = false;
+    }
+    if (!closeBatchFiles(ring, files))
+        return false;
+
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    end = begin + count;
+    for (size_t i = 0; i < count; i++) {
+        copied[begin + i] = files[i].succeeded;
+        if (files[i].succeeded && statistics)
+            statistics->addCopiedFile(files[i].sourceInfo.stx_size);
+    }
+    return true;
+}
+
+/*
+ * Compares the pairs of files from begin up to end, setting identical for
+ * those that are. Only as many as fit in the budget are compared, and end
+ * is moved back to the first that wasn't.
+ *
+ * Returns true on success, false if the ring failed.
+ */
+bool
+compareBatch(IoRing& ring, const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths, size_t begin,
+    size_t& end, std::vector<bool>& identical)
+{
+    std::vector<BatchFile> files(end - begin);
+    auto handler = [&](uint64_t userData, int result) {
+        handleResult(files, userData, result);
+    };
+    for (size_t i = 0; i < files.size(); i++) {
+        prepareStat(ring.getEntry(), sourcePaths[begin + i],
+            &files[i].sourceInfo, getUserData(i, SOURCE_STAT_OPERATION));
+        prepareStat(ring.getEntry(), destinationPaths[begin + i],
+            &files[i].destinationInfo,
+            getUserData(i, DESTINATION_STAT_OPERATION));
+        prepareOpen(ring.getEntry(), sourcePaths[begin + i], O_RDONLY,
+            getUserData(i, SOURCE_OPEN_OPERATION));
+        prepareOpen(ring.getEntry(), destinationPaths[begin + i], O_RDONLY,
+            getUserData(i, DESTINATION_OPEN_OPERATION));
+    }
+    if (!ring.complete(handler)) {
+        closeDescriptors(files);
+        return false;
+    }
+
+    for (auto& file : files) {
+        if (!isSmallRegularFile(file.sourceInfo)
+            || file.sourceInfo.stx_mode != file.destinationInfo.stx_mode
+            || file.sourceInfo.stx_size != file.destinationInfo.stx_size)
+            file.succeeded = false;
+    }
+    size_t totalSize;
+    size_t count = fitInBudget(files, 2, totalSize);
+    BufferPool::Lease buffer =
+        RunContext::getCurrentBufferPool().acquire(totalSize);
+    char* contents = buffer.getData();
+    for (size_t i = 0; i < files.size(); i++) {
+        BatchFile& file = files[i];
+        size_t size = file.sourceInfo.stx_size;
+        if (!file.succeeded || size == 0)
+            continue;
+        file.sourceContents = contents;
+        file.destinationContents = contents + size;
+        contents += 2 * size;
+        prepareTransfer(ring.getEntry(), IORING_OP_READ, file.source,
+            file.sourceContents, size, getUserData(i, SOURCE_READ_OPERATION));
+        prepareTransfer(ring.getEntry(), IORING_OP_READ, file.destination,
+            file.destinationContents, size,
+            getUserData(i, DESTINATION_READ_OPERATION));
+    }
+    if (!ring.complete(handler)) {
+        closeDescriptors(files);
+        return false;
+    }
+    if (!closeBatchFiles(ring, files))
+        return false;
+
+    end = begin + count;
+    for (size_t i = 0; i < count; i++) {
+        const BatchFile& file = files[i];
+        identical[begin + i] = file.succeeded
+            && (file.sourceInfo.stx_size == 0
+                || memcmp(file.sourceContents, file.destinationContents,
+                       file.sourceInfo.stx_size)
+                    == 0);
+    }
+    return true;
+}
+#endif
+} /* namespace */
+
+bool
+isBatchIoAvailable()
+{
+#ifdef HAVE_IO_URING
+    return getThreadRing() != nullptr;
+#else
+    return false;
+#endif
+}
+
+void
+setBatchIoEnabled(bool enabled)
+{
+    batchIoEnabled = enabled;
+}
+
+void
+copyFilesInBatches(const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied)
+{
+#ifdef HAVE_IO_URING
+    IoRing* ring = getThreadRing();
+    if (!ring || sourcePaths.empty())
+        return;
+    PhaseTimer timer(RunStatistics::COPY_PHASE);
+    TraceSpan span("io", "copyFilesInBatches", sourcePaths[0]);
+    for (size_t begin = 0; begin < sourcePaths.size();) {
+        size_t end = std::min(begin + BATCH_FILE_COUNT, sourcePaths.size());
+        if (!copyBatch(
+                *ring, sourcePaths, destinationPaths, begin, end, copied)) {
+            discardThreadRing();
+            return;
+        }
+        begin = end;
+    }
+#endif
+}
+
+void
+findIdenticalFilesInBatches(const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& identical)
+{
+#ifdef HAVE_IO_URING
+    IoRing* ring = getThreadRing();
+    if (!ring || sourcePaths.empty())
+        return;
+    PhaseTimer timer(RunStatistics::COMPARE_PHASE);
+    TraceSpan span("io", "findIdenticalFilesInBatches", sourcePaths[0]);
+    for (size_t begin = 0; begin < sourcePaths.size();) {
+        size_t end = std::min(begin + BATCH_FILE_COUNT, sourcePaths.size());
+        if (!compareBatch(
+                *ring, sourcePaths, destinationPaths, begin, end, identical)) {
+            discardThreadRing();
+            return;
+        }
+        begin = end;
+    }
+#endif
+}
+} /* namespace gdfm */
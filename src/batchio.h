@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+namespace gdfm {
+
+/* Regular files at most this big are copied and compared in batches. */
+const off_t BATCH_FILE_SIZE = 16 * 1024;
+/* How many files a batch works on at once. */
+const size_t BATCH_FILE_COUNT = 64;
+/* Setting this environment variable to 1 turns batches on. */
+const char BATCH_IO_ENVIRONMENT_VARIABLE[] = "GDFM_IO_URING";
+
+/*
+ * Copying and comparing many small files in batches, so a whole directory
+ * of dotfiles takes a handful of system calls instead of several for each
+ * file. Each batch is submitted to an io_uring of the calling thread, with
+ * the reads linked to the writes that depend on them, so the kernel does
+ * the work of all the files of the batch at once.
+ *
+ * Batches are only available on Linux when io_uring was found at configure
+ * time and the kernel lets the ring be created. Otherwise nothing is done
+ * and callers fall back to handling each file on its own, which they also
+ * do for files a batch couldn't handle, like large or missing ones.
+ *
+ * They are off unless BATCH_IO_ENVIRONMENT_VARIABLE says otherwise. The
+ * kernel hands opening, creating and stat'ing files to worker threads, so
+ * batches only pay off where system calls are expensive and there are cores
+ * to spare for the workers. gdfm-bench compares both ways.
+ */
+
+/*
+ * Returns true if batches can be used on the calling thread, which creates
+ * its ring the first time.
+ */
+bool isBatchIoAvailable();
+/* Turns batches on or off for the whole process. */
+void setBatchIoEnabled(bool enabled);
+/*
+ * Copies each regular file in sourcePaths of at most BATCH_FILE_SIZE bytes
+ * to the path at the same index in destinationPaths, whose directory must
+ * exist, giving it the permissions of the source. Sets copied for each one
+ * it copied and leaves the rest to the caller.
+ */
+void copyFilesInBatches(const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied);
+/*
+ * Sets identical for each pair of paths at the same index in sourcePaths
+ * and destinationPaths that are regular files of at most BATCH_FILE_SIZE
+ * bytes with the same mode and contents. Pairs it couldn't tell are left
+ * to the caller, so a pair that isn't marked may still be the same.
+ */
+void findIdenticalFilesInBatches(const std::vector<std::string>& sourcePaths,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& identical);
+} /* namespace gdfm */
+
+#endif /* BATCH_IO_H */
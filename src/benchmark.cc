@@ -0,0 +1,1074 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "benchmark.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+
+#include "batchio.h"
+#include "configfilereader.h"
+#include "configfilewriter.h"
+#include "filecheckaction.h"
+#include "filewatcher.h"
+#include "module.h"
+#include "modulelist.h"
+#include "modulerunner.h"
+#include "modulesearchindex.h"
+#include "util.h"
+
+namespace gdfm {
+
+namespace {
+
+/* How many generated files go in each directory of a generated tree. */
+const int FILES_PER_DIRECTORY = 64;
+
+/* The most modules or files gdfm-bench will generate. */
+const long MAX_GENERATED_COUNT = 10000000;
+
+/*
+ * The sparse image is mostly holes, with data of SPARSE_EXTENT_SIZE bytes
+ * every SPARSE_EXTENT_SPACING bytes, like a disk image or database file.
+ */
+const off_t SPARSE_IMAGE_SIZE = 256 * 1024 * 1024;
+const off_t SPARSE_EXTENT_SIZE = 1024 * 1024;
+const off_t SPARSE_EXTENT_SPACING = 16 * 1024 * 1024;
+
+/*
+ * Returns the size of the file at path in bytes, or zero if it can't be
+ * read.
+ */
+unsigned long long
+getFileSize(const std::string& path)
+{
+    struct stat pathInfo;
+    if (stat(path.c_str(), &pathInfo) != 0)
+        return 0;
+    return pathInfo.st_size;
+}
+
+/*
+ * Returns how many bytes of disk the file at path takes up, or zero if it
+ * can't be read.
+ */
+unsigned long long
+getDiskUsage(const std::string& path)
+{
+    struct stat pathInfo;
+    if (stat(path.c_str(), &pathInfo) != 0)
+        return 0;
+    return static_cast<unsigned long long>(pathInfo.st_blocks) * 512;
+}
+
+/*
+ * Creates a sparse file of SPARSE_IMAGE_SIZE bytes at path.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+generateSparseImage(const std::string& path)
+{
+    if (!ensureParentDirectoriesExist(path))
+        return false;
+    int descriptor =
+        open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (descriptor == -1) {
+        warn("Failed to create %s", path.c_str());
+        return false;
+    }
+    std::string contents(SPARSE_EXTENT_SIZE, 'x');
+    bool status = true;
+    for (off_t offset = 0; status && offset < SPARSE_IMAGE_SIZE;
+         offset += SPARSE_EXTENT_SPACING) {
+        status = pwrite(descriptor, contents.data(), contents.size(), offset)
+            == static_cast<ssize_t>(contents.size());
+    }
+    if (status)
+        status = ftruncate(descriptor, SPARSE_IMAGE_SIZE) == 0;
+    if (close(descriptor) != 0)
+        status = false;
+    if (!status)
+        warnx("Failed to write %s.", path.c_str());
+    return status;
+}
+
+/*
+ * Copies the file at sourcePath to destinationPath by reading and writing
+ * every byte, holes included, the way regular files used to be copied.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+copyEveryByte(
+    const std::string& sourcePath, const std::string& destinationPath)
+{
+    int source = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+        return false;
+    int destination = open(destinationPath.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (destination == -1) {
+        close(source);
+        return false;
+    }
+    std::string buffer(COPY_BUFFER_SIZE, '\0');
+    ssize_t count;
+    bool status = true;
+    while (status && (count = read(source, &buffer[0], buffer.size())) > 0)
+        status = writeAll(destination, buffer.data(), count);
+    if (count == -1)
+        status = false;
+    close(source);
+    if (close(destination) != 0)
+        status = false;
+    return status;
+}
+
+/*
+ * Parses text as a whole number between minimum and maximum and stores it
+ * in value.
+ *
+ * Returns true if text was a valid number in range, false otherwise.
+ */
+bool
+parseCount(const char* text, long minimum, long maximum, long& value)
+{
+    char* end = nullptr;
+    long result = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || result < minimum || result > maximum)
+        return false;
+    value = result;
+    return true;
+}
+
+void
+benchmarkUsage()
+{
+    std::cout << "usage: gdfm-bench [-Jl] [-m modules] [-f files] "
+                 "[-S file-size] [-w warmups] [-r repetitions] "
+                 "[-d directory] [BENCHMARKS]"
+              << std::endl;
+}
+
+class ParseBenchmark : public Benchmark {
+public:
+    ParseBenchmark()
+        : Benchmark("parse", "ConfigFileReader::readModules on a config file")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string directory = settings.directory + "/parse";
+        configPath = directory + "/" + CONFIG_FILE_NAME;
+        moduleCount = settings.moduleCount;
+        if (!ensureDirectoriesExist(directory)
+            || !generateConfigFile(configPath, moduleCount, directory))
+            return false;
+        result.items = moduleCount;
+        result.bytes = getFileSize(configPath);
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        ConfigFileReader reader(configPath);
+        std::vector<Module> modules;
+        if (!reader.readModules(std::back_inserter(modules)))
+            return false;
+        return static_cast<int>(modules.size()) == moduleCount;
+    }
+
+private:
+    std::string configPath;
+    int moduleCount = 0;
+};
+
+class WriteBenchmark : public Benchmark {
+public:
+    WriteBenchmark()
+        : Benchmark("write", "ConfigFileWriter::writeModules of every module")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string directory = settings.directory + "/write";
+        std::string inputPath = directory + "/" + CONFIG_FILE_NAME;
+        outputPath = directory + "/written.dfm";
+        if (!ensureDirectoriesExist(directory)
+            || !generateConfigFile(
+                   inputPath, settings.moduleCount, directory))
+            return false;
+        ConfigFileReader reader(inputPath);
+        modules.clear();
+        if (!reader.readModules(std::back_inserter(modules)))
+            return false;
+        if (!run())
+            return false;
+        result.items = modules.size();
+        result.bytes = getFileSize(outputPath);
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        ConfigFileWriter writer(outputPath);
+        return writer.writeModules(modules);
+    }
+
+private:
+    std::vector<Module> modules;
+    std::string outputPath;
+};
+
+class WriteChangedBenchmark : public Benchmark {
+public:
+    WriteChangedBenchmark()
+        : Benchmark("write-changed",
+              "ConfigFileWriter::writeChangedModules with one module changed")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string directory = settings.directory + "/write-changed";
+        configPath = directory + "/" + CONFIG_FILE_NAME;
+        if (!ensureDirectoriesExist(directory)
+            || !generateConfigFile(
+                   configPath, settings.moduleCount, directory))
+            return false;
+        ConfigFileReader reader(configPath);
+        std::vector<Module> modules;
+        if (!reader.readModules(std::back_inserter(modules))
+            || modules.empty())
+            return false;
+        moduleList.setModules(modules);
+        originalName = modules[modules.size() / 2].getName();
+        if (!createConfigFileLayout(configPath, reader.getModuleSpans(),
+                moduleList, layout))
+            return false;
+        if (!prepare() || !run())
+            return false;
+        result.items = 1;
+        result.bytes = getFileSize(configPath);
+        return true;
+    }
+
+    bool
+    prepare() override
+    {
+        /* Rename the module in the middle back and forth. */
+        size_t index = moduleList.getModuleCount() / 2;
+        Module module = moduleList.getModule(index);
+        if (module.getName() == originalName)
+            module.setName(originalName + "-edited");
+        else
+            module.setName(originalName);
+        moduleList.replaceModule(index, module);
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        ConfigFileWriter writer(configPath);
+        if (!writer.writeChangedModules(moduleList, layout))
+            return false;
+        moduleList.markSaved();
+        return true;
+    }
+
+private:
+    std::string configPath;
+    std::string originalName;
+    ModuleList moduleList;
+    ConfigFileLayout layout;
+};
+
+class SearchBenchmark : public Benchmark {
+public:
+    SearchBenchmark()
+        : Benchmark("search",
+              "ModuleSearchIndex::search for each keystroke of a file name")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string directory = settings.directory + "/search";
+        std::string configPath = directory + "/" + CONFIG_FILE_NAME;
+        if (!ensureDirectoriesExist(directory)
+            || !generateConfigFile(
+                   configPath, settings.moduleCount, directory))
+            return false;
+        ConfigFileReader reader(configPath);
+        std::vector<Module> modules;
+        if (!reader.readModules(std::back_inserter(modules))
+            || modules.empty())
+            return false;
+        moduleList = std::make_shared<ModuleList>();
+        moduleList->setModules(modules);
+        index.reset(new ModuleSearchIndex(moduleList));
+        /* Look for the file of the module in the middle. */
+        query = modules[modules.size() / 2].getName() + ".conf";
+        result.items = query.length();
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        /* Search as if the query was typed one character at a time. */
+        size_t matchCount = 0;
+        for (std::string::size_type i = 1; i <= query.length(); i++)
+            matchCount = index->search(query.substr(0, i)).size();
+        return matchCount == 1;
+    }
+
+private:
+    std::shared_ptr<ModuleList> moduleList;
+    std::unique_ptr<ModuleSearchIndex> index;
+    std::string query;
+};
+
+/*
+ * Copies a dotfile tree one file at a time or, for comparison, with small
+ * files copied in batches.
+ */
+class CopyBenchmark : public Benchmark {
+public:
+    CopyBenchmark(const std::string& name, const std::string& description,
+        bool batched)
+        : Benchmark(name, description), batched(batched)
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        sourcePath = settings.directory + "/" + getName() + "/source";
+        destinationPath =
+            settings.directory + "/" + getName() + "/destination";
+        if (!generateDotFileTree(
+                sourcePath, settings.fileCount, settings.fileSize))
+            return false;
+        result.items = settings.fileCount;
+        result.bytes = static_cast<unsigned long long>(settings.fileCount)
+            * settings.fileSize;
+        return deleteDirectory(destinationPath);
+    }
+
+    bool
+    prepare() override
+    {
+        setBatchIoEnabled(batched);
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        return copyFile(sourcePath, destinationPath);
+    }
+
+    bool
+    cleanUp() override
+    {
+        setBatchIoEnabled(false);
+        return deleteDirectory(destinationPath);
+    }
+
+private:
+    bool batched;
+    std::string sourcePath;
+    std::string destinationPath;
+};
+
+/* Compares identical dotfile trees, one file at a time or in batches. */
+class CompareBenchmark : public Benchmark {
+public:
+    CompareBenchmark(const std::string& name, const std::string& description,
+        bool batched)
+        : Benchmark(name, description), batched(batched)
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string sourcePath =
+            settings.directory + "/" + getName() + "/source";
+        std::string destinationPath =
+            settings.directory + "/" + getName() + "/destination";
+        if (!generateDotFileTree(
+                sourcePath, settings.fileCount, settings.fileSize)
+            || !copyFile(sourcePath, destinationPath))
+            return false;
+        action.setFiles(sourcePath, destinationPath);
+        result.items = settings.fileCount;
+        /* Both sides are read in full since nothing differs. */
+        result.bytes = 2ULL * settings.fileCount * settings.fileSize;
+        return true;
+    }
+
+    bool
+    prepare() override
+    {
+        setBatchIoEnabled(batched);
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        /* The trees are identical, so anything but false is a failure. */
+        return !action.shouldUpdate();
+    }
+
+    bool
+    cleanUp() override
+    {
+        setBatchIoEnabled(false);
+        return true;
+    }
+
+private:
+    bool batched;
+    FileCheckAction action;
+};
+
+class DeleteBenchmark : public Benchmark {
+public:
+    DeleteBenchmark()
+        : Benchmark("delete", "deleteDirectory of a dotfile tree")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        sourcePath = settings.directory + "/delete/source";
+        targetPath = settings.directory + "/delete/target";
+        if (!generateDotFileTree(
+                sourcePath, settings.fileCount, settings.fileSize))
+            return false;
+        result.items = settings.fileCount;
+        result.bytes = static_cast<unsigned long long>(settings.fileCount)
+            * settings.fileSize;
+        return true;
+    }
+
+    bool
+    prepare() override
+    {
+        return copyFile(sourcePath, targetPath);
+    }
+
+    bool
+    run() override
+    {
+        return deleteDirectory(targetPath);
+    }
+
+private:
+    std::string sourcePath;
+    std::string targetPath;
+};
+
+/*
+ * Copies a sparse image, either with copyFile or by writing every byte for
+ * comparison. Both measure how much disk the copy takes up.
+ */
+class SparseCopyBenchmark : public Benchmark {
+public:
+    SparseCopyBenchmark(const std::string& name,
+        const std::string& description, bool everyByte)
+        : Benchmark(name, description), everyByte(everyByte)
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        std::string directory = settings.directory + "/" + getName();
+        sourcePath = directory + "/source.img";
+        destinationPath = directory + "/destination.img";
+        if (!generateSparseImage(sourcePath) || !run())
+            return false;
+        result.items = 1;
+        result.bytes = SPARSE_IMAGE_SIZE;
+        result.diskBytes = getDiskUsage(destinationPath);
+        return cleanUp();
+    }
+
+    bool
+    run() override
+    {
+        if (everyByte)
+            return copyEveryByte(sourcePath, destinationPath);
+        return copyFile(sourcePath, destinationPath);
+    }
+
+    bool
+    cleanUp() override
+    {
+        return deleteFile(destinationPath);
+    }
+
+private:
+    bool everyByte;
+    std::string sourcePath;
+    std::string destinationPath;
+};
+
+class WatchBenchmark : public Benchmark {
+public:
+    WatchBenchmark()
+        : Benchmark("watch",
+              "FileWatcher from editing one source file to updating it")
+    {
+    }
+
+    bool
+    setUp(const BenchmarkSettings& settings, BenchmarkResult& result) override
+    {
+        sourcePath = settings.directory + "/watch/source";
+        std::string destinationPath =
+            settings.directory + "/watch/destination";
+        if (!generateDotFileTree(
+                sourcePath, settings.fileCount, settings.fileSize)
+            || !deleteDirectory(destinationPath)
+            || !copyFile(sourcePath, destinationPath))
+            return false;
+        /* One module for each file, installed where it was copied to. */
+        std::vector<Module> modules;
+        for (int i = 0; i < settings.fileCount; i++) {
+            char directory[32];
+            char name[32];
+            snprintf(directory, sizeof(directory), "dir%04d",
+                i / FILES_PER_DIRECTORY);
+            snprintf(name, sizeof(name), "file%06d", i);
+            Module module(name);
+            module.addFile(std::string(directory) + "/" + name,
+                destinationPath + "/" + directory, name);
+            modules.push_back(module);
+        }
+        editedPath = sourcePath + "/"
+            + modules[modules.size() / 2].getFiles()[0].getFilename();
+        if (!watcher.watch(modules, sourcePath))
+            return false;
+        result.items = 1;
+        result.bytes = settings.fileSize;
+        return true;
+    }
+
+    bool
+    run() override
+    {
+        std::ofstream file(editedPath, std::ios::binary);
+        file << "edit " << ++editCount << "\n";
+        file.close();
+        if (!file || !watcher.waitForChanges(0))
+            return false;
+        std::vector<Module> changed = watcher.takeChangedModules();
+        ModuleRunner runner(ModuleRunner::UPDATE_OPERATION, sourcePath);
+        return changed.size() == 1 && runner.run(changed);
+    }
+
+private:
+    std::string sourcePath;
+    std::string editedPath;
+    FileWatcher watcher;
+    unsigned long editCount = 0;
+};
+} /* namespace */
+
+double
+BenchmarkResult::getMinimum() const
+{
+    if (times.empty())
+        return 0;
+    return *std::min_element(times.begin(), times.end());
+}
+
+double
+BenchmarkResult::getMedian() const
+{
+    if (times.empty())
+        return 0;
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<double>::size_type middle = sorted.size() / 2;
+    if (sorted.size() % 2 == 0)
+        return (sorted[middle - 1] + sorted[middle]) / 2;
+    return sorted[middle];
+}
+
+double
+BenchmarkResult::getMean() const
+{
+    if (times.empty())
+        return 0;
+    double total = 0;
+    for (double time : times)
+        total += time;
+    return total / times.size();
+}
+
+double
+BenchmarkResult::getMaximum() const
+{
+    if (times.empty())
+        return 0;
+    return *std::max_element(times.begin(), times.end());
+}
+
+double
+BenchmarkResult::getItemsPerSecond() const
+{
+    double median = getMedian();
+    return (median > 0) ? items / median : 0;
+}
+
+double
+BenchmarkResult::getBytesPerSecond() const
+{
+    double median = getMedian();
+    return (median > 0) ? bytes / median : 0;
+}
+
+Benchmark::Benchmark(const std::string& name, const std::string& description)
+    : name(name), description(description)
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+const std::string&
+Benchmark::getName() const
+{
+    return name;
+}
+
+const std::string&
+Benchmark::getDescription() const
+{
+    return description;
+}
+
+bool
+Benchmark::prepare()
+{
+    return true;
+}
+
+bool
+Benchmark::cleanUp()
+{
+    return true;
+}
+
+bool
+Benchmark::measure(const BenchmarkSettings& settings, BenchmarkResult& result)
+{
+    result.name = name;
+    result.succeeded = false;
+    result.times.clear();
+    if (!setUp(settings, result)) {
+        warnx("Failed to set up the %s benchmark.", name.c_str());
+        return false;
+    }
+    int runCount = settings.warmups + settings.repetitions;
+    for (int i = 0; i < runCount; i++) {
+        if (!prepare()) {
+            warnx("Failed to prepare the %s benchmark.", name.c_str());
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool success = run();
+        auto stop = std::chrono::steady_clock::now();
+        if (!success) {
+            warnx("The %s benchmark failed.", name.c_str());
+            return false;
+        }
+        if (!cleanUp()) {
+            warnx("Failed to clean up after the %s benchmark.", name.c_str());
+            return false;
+        }
+        if (i >= settings.warmups)
+            result.times.push_back(
+                std::chrono::duration<double>(stop - start).count());
+    }
+    result.succeeded = true;
+    return true;
+}
+
+std::vector<std::unique_ptr<Benchmark>>
+createBenchmarks()
+{
+    std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new ParseBenchmark()));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new WriteBenchmark()));
+    benchmarks.push_back(
+        std::unique_ptr<Benchmark>(new WriteChangedBenchmark()));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new SearchBenchmark()));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(
+        new CopyBenchmark("copy", "copyFile of a dotfile tree", false)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new CopyBenchmark(
+        "copy-batched", "the same copy in io_uring batches", true)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new SparseCopyBenchmark(
+        "sparse", "copyFile of a sparse image", false)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new SparseCopyBenchmark(
+        "sparse-dense", "the same image copied byte by byte", true)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new CompareBenchmark(
+        "compare", "FileCheckAction::shouldUpdateFile on identical trees",
+        false)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new CompareBenchmark(
+        "compare-batched", "the same comparison in io_uring batches", true)));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new DeleteBenchmark()));
+    benchmarks.push_back(std::unique_ptr<Benchmark>(new WatchBenchmark()));
+    return benchmarks;
+}
+
+bool
+generateDotFileTree(
+    const std::string& directory, int fileCount, long fileSize)
+{
+    if (!deleteDirectory(directory))
+        return false;
+    std::string contents(fileSize, '\0');
+    /* A small linear congruential generator keeps the output repeatable. */
+    unsigned long state = 1;
+    for (int i = 0; i < fileCount; i++) {
+        for (long j = 0; j < fileSize; j++) {
+            state = state * 1103515245 + 12345;
+            unsigned int value = (state >> 16) % 64;
+            contents[j] = (value == 0) ? '\n' : ' ' + value;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "/dir%04d/file%06d",
+            i / FILES_PER_DIRECTORY, i);
+        std::string path = directory + name;
+        if (!ensureParentDirectoriesExist(path)) {
+            warnx("Failed to create parent directories for %s.",
+                path.c_str());
+            return false;
+        }
+        std::ofstream file(path, std::ios::binary);
+        file.write(contents.data(), contents.size());
+        if (!file) {
+            warnx("Failed to write %s.", path.c_str());
+            return false;
+        }
+    }
+    return ensureDirectoriesExist(directory);
+}
+
+bool
+generateConfigFile(const std::string& path, int moduleCount,
+    const std::string& installDirectory)
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        warnx("Failed to open %s for writing.", path.c_str());
+        return false;
+    }
+    file << "# Generated by gdfm-bench.\n";
+    file << "default-directory = " << installDirectory << "\n\n";
+    for (int i = 0; i < moduleCount; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "module%06d", i);
+        file << name << ":\n";
+        file << "\t" << name << "rc\n";
+        file << "\t" << name << ".conf " << installDirectory << "/.config\n";
+        file << "install:\n";
+        file << "\tmessage \"Installing " << name << "\"\n";
+        file << "\tsh\n";
+        file << "\t\techo " << name << "\n";
+        file << "\t\ttrue\n";
+        file << "uninstall:\n";
+        file << "\trm " << installDirectory << "/" << name << "rc\n";
+        file << "update:\n";
+        file << "\tmessage \"Updating " << name << "\"\n";
+        file << "\n";
+    }
+    file.close();
+    if (!file) {
+        warnx("Failed to write %s.", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void
+writeBenchmarkTable(
+    std::ostream& stream, const std::vector<BenchmarkResult>& results)
+{
+    std::ostream::fmtflags oldFlags = stream.flags();
+    std::streamsize oldPrecision = stream.precision();
+    stream.setf(std::ios::fixed, std::ios::floatfield);
+    stream.precision(3);
+
+    stream << std::left << std::setw(BENCHMARK_NAME_WIDTH) << "benchmark"
+           << std::right << std::setw(12) << "median ms" << std::setw(12)
+           << "min ms" << std::setw(12) << "max ms" << std::setw(14)
+           << "items/s" << std::setw(14) << "bytes/s" << std::setw(12)
+           << "disk" << std::endl;
+    for (const BenchmarkResult& result : results) {
+        stream << std::left << std::setw(BENCHMARK_NAME_WIDTH) << result.name
+               << std::right;
+        if (!result.succeeded) {
+            stream << std::setw(12) << "failed" << std::endl;
+            continue;
+        }
+        stream << std::setw(12) << result.getMedian() * 1000 << std::setw(12)
+               << result.getMinimum() * 1000 << std::setw(12)
+               << result.getMaximum() * 1000;
+        stream.precision(0);
+        stream << std::setw(14) << result.getItemsPerSecond() << std::setw(12)
+               << formatByteCount(result.getBytesPerSecond()) << "/s"
+               << std::setw(12)
+               << ((result.diskBytes > 0) ? formatByteCount(result.diskBytes)
+                                          : "-")
+               << std::endl;
+        stream.precision(3);
+    }
+
+    stream.flags(oldFlags);
+    stream.precision(oldPrecision);
+}
+
+void
+writeBenchmarkJson(std::ostream& stream, const BenchmarkSettings& settings,
+    const std::vector<BenchmarkResult>& results)
+{
+    std::ostream::fmtflags oldFlags = stream.flags();
+    std::streamsize oldPrecision = stream.precision();
+    stream.setf(std::ios::fixed, std::ios::floatfield);
+    stream.precision(9);
+
+    stream << "{\n";
+    stream << "  \"settings\": {\"modules\": " << settings.moduleCount
+           << ", \"files\": " << settings.fileCount
+           << ", \"file_size\": " << settings.fileSize
+           << ", \"warmups\": " << settings.warmups
+           << ", \"repetitions\": " << settings.repetitions << "},\n";
+    stream << "  \"benchmarks\": [";
+    for (std::vector<BenchmarkResult>::size_type i = 0; i < results.size();
+         i++) {
+        const BenchmarkResult& result = results[i];
+        stream << ((i == 0) ? "\n" : ",\n");
+        stream << "    {\"name\": \"" << escapeJsonString(result.name)
+               << "\", \"succeeded\": "
+               << ((result.succeeded) ? "true" : "false")
+               << ", \"items\": " << result.items
+               << ", \"bytes\": " << result.bytes << ", \"seconds\": [";
+        for (std::vector<double>::size_type j = 0; j < result.times.size();
+             j++)
+            stream << ((j == 0) ? "" : ", ") << result.times[j];
+        stream << "], \"min_seconds\": " << result.getMinimum()
+               << ", \"median_seconds\": " << result.getMedian()
+               << ", \"mean_seconds\": " << result.getMean()
+               << ", \"max_seconds\": " << result.getMaximum()
+               << ", \"items_per_second\": " << result.getItemsPerSecond()
+               << ", \"bytes_per_second\": " << result.getBytesPerSecond()
+               << ", \"disk_bytes\": " << result.diskBytes << "}";
+    }
+    stream << ((results.size() > 0) ? "\n  ]\n" : "]\n");
+    stream << "}" << std::endl;
+
+    stream.flags(oldFlags);
+    stream.precision(oldPrecision);
+}
+
+int
+runBenchmarkCommandLine(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    std::string parentDirectory;
+    bool json = false;
+    bool list = false;
+
+    int optionIndex = 0;
+    struct option longOptions[] = { { "modules", required_argument, NULL, 'm' },
+        { "files", required_argument, NULL, 'f' },
+        { "file-size", required_argument, NULL, 'S' },
+        { "warmups", required_argument, NULL, 'w' },
+        { "repetitions", required_argument, NULL, 'r' },
+        { "directory", required_argument, NULL, 'd' },
+        { "json", no_argument, NULL, 'J' }, { "list", no_argument, NULL, 'l' },
+        { "help", no_argument, NULL, 'h' }, { 0, 0, 0, 0 } };
+
+    int getoptValue = getopt_long_only(
+        argc, argv, BENCHMARK_SHORT_OPTIONS, longOptions, &optionIndex);
+    while (getoptValue != -1) {
+        long value = 0;
+        switch (getoptValue) {
+        case 'm':
+            if (!parseCount(optarg, 1, MAX_GENERATED_COUNT, value)) {
+                warnx("Invalid number of modules: %s.", optarg);
+                benchmarkUsage();
+                return EXIT_FAILURE;
+            }
+            settings.moduleCount = value;
+            break;
+        case 'f':
+            if (!parseCount(optarg, 1, MAX_GENERATED_COUNT, value)) {
+                warnx("Invalid number of files: %s.", optarg);
+                benchmarkUsage();
+                return EXIT_FAILURE;
+            }
+            settings.fileCount = value;
+            break;
+        case 'S':
+            if (!parseCount(optarg, 0, LONG_MAX, value)) {
+                warnx("Invalid file size: %s.", optarg);
+                benchmarkUsage();
+                return EXIT_FAILURE;
+            }
+            settings.fileSize = value;
+            break;
+        case 'w':
+            if (!parseCount(optarg, 0, INT_MAX, value)) {
+                warnx("Invalid number of warm-ups: %s.", optarg);
+                benchmarkUsage();
+                return EXIT_FAILURE;
+            }
+            settings.warmups = value;
+            break;
+        case 'r':
+            if (!parseCount(optarg, 1, INT_MAX, value)) {
+                warnx("Invalid number of repetitions: %s.", optarg);
+                benchmarkUsage();
+                return EXIT_FAILURE;
+            }
+            settings.repetitions = value;
+            break;
+        case 'd':
+            parentDirectory = shellExpandPath(optarg);
+            break;
+        case 'J':
+            json = true;
+            break;
+        case 'l':
+            list = true;
+            break;
+        case 'h':
+            benchmarkUsage();
+            return EXIT_SUCCESS;
+        default:
+            benchmarkUsage();
+            return EXIT_FAILURE;
+        }
+        getoptValue = getopt_long_only(
+            argc, argv, BENCHMARK_SHORT_OPTIONS, longOptions, &optionIndex);
+    }
+
+    std::vector<std::unique_ptr<Benchmark>> benchmarks = createBenchmarks();
+    if (list) {
+        for (const auto& benchmark : benchmarks)
+            std::cout << std::left << std::setw(BENCHMARK_NAME_WIDTH)
+                      << benchmark->getName() << benchmark->getDescription()
+                      << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<Benchmark*> selected;
+    for (int i = optind; i < argc; i++) {
+        auto match = std::find_if(benchmarks.begin(), benchmarks.end(),
+            [&](const std::unique_ptr<Benchmark>& benchmark) {
+                return benchmark->getName() == argv[i];
+            });
+        if (match == benchmarks.end()) {
+            warnx("No benchmark named %s.", argv[i]);
+            return EXIT_FAILURE;
+        }
+        selected.push_back(match->get());
+    }
+    if (selected.empty()) {
+        for (const auto& benchmark : benchmarks)
+            selected.push_back(benchmark.get());
+    }
+
+    if (parentDirectory.empty()) {
+        const char* temporaryDirectory = getenv("TMPDIR");
+        parentDirectory = (temporaryDirectory && *temporaryDirectory)
+            ? temporaryDirectory
+            : "/tmp";
+    }
+    std::string directoryTemplate = parentDirectory + "/gdfm-bench-XXXXXX";
+    std::vector<char> directoryBuffer(
+        directoryTemplate.begin(), directoryTemplate.end());
+    directoryBuffer.push_back('\0');
+    if (!mkdtemp(directoryBuffer.data())) {
+        warn("Failed to create a directory in %s", parentDirectory.c_str());
+        return EXIT_FAILURE;
+    }
+    settings.directory = directoryBuffer.data();
+
+    std::vector<BenchmarkResult> results;
+    bool success = true;
+    for (Benchmark* benchmark : selected) {
+        BenchmarkResult result;
+        if (!benchmark->measure(settings, result)) {
+            result.name = benchmark->getName();
+            success = false;
+        }
+        results.push_back(result);
+    }
+
+    /* The benchmarks hold no files open, so the inputs can go now. */
+    selected.clear();
+    benchmarks.clear();
+    if (!deleteDirectory(settings.directory))
+        warnx("Failed to remove %s.", settings.directory.c_str());
+
+    if (json)
+        writeBenchmarkJson(std::cout, settings, results);
+    else
+        writeBenchmarkTable(std::cout, results);
+    return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+} /* namespace gdfm */
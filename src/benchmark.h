@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gdfm {
+
+const char BENCHMARK_SHORT_OPTIONS[] = "m:f:S:w:r:d:Jlh";
+/* How wide the name column is when listing benchmarks or their results. */
+const int BENCHMARK_NAME_WIDTH = 16;
+
+/* How big the generated inputs are and how many times each one is timed. */
+struct BenchmarkSettings {
+    int moduleCount = 200;
+    int fileCount = 1000;
+    long fileSize = 4096;
+    int warmups = 1;
+    int repetitions = 5;
+    /* Scratch directory the inputs are generated in. */
+    std::string directory;
+};
+
+/* The timings for one benchmark. */
+struct BenchmarkResult {
+    std::string name;
+    bool succeeded = false;
+    /* How many items and bytes each repetition processes. */
+    unsigned long items = 0;
+    unsigned long long bytes = 0;
+    /* The time of each repetition in seconds, warm-ups not included. */
+    std::vector<double> times;
+    /*
+     * How much disk space the output of a repetition takes up, or zero if
+     * the benchmark doesn't measure it.
+     */
+    unsigned long long diskBytes = 0;
+
+    double getMinimum() const;
+    double getMedian() const;
+    double getMean() const;
+    double getMaximum() const;
+    /* Returns items per second for the median repetition. */
+    double getItemsPerSecond() const;
+    /* Returns bytes per second for the median repetition. */
+    double getBytesPerSecond() const;
+};
+
+/*
+ * One operation to time. setUp() creates the inputs once, then for every
+ * repetition prepare() is called, run() is timed, and cleanUp() is called.
+ * Only run() counts toward the time, so a benchmark that destroys its input,
+ * like deleting a directory, can recreate it in prepare().
+ */
+class Benchmark {
+public:
+    Benchmark(const std::string& name, const std::string& description);
+    virtual ~Benchmark();
+
+    const std::string& getName() const;
+    const std::string& getDescription() const;
+
+    /*
+     * Creates the inputs and fills in how many items and bytes each
+     * repetition processes.
+     *
+     * Returns true on success, false on failure.
+     */
+    virtual bool setUp(
+        const BenchmarkSettings& settings, BenchmarkResult& result) = 0;
+    virtual bool prepare();
+    virtual bool run() = 0;
+    virtual bool cleanUp();
+
+    /*
+     * Sets up the benchmark, runs the warm-ups and then times each
+     * repetition.
+     *
+     * Returns true if every step succeeded, false otherwise.
+     */
+    bool measure(const BenchmarkSettings& settings, BenchmarkResult& result);
+
+private:
+    std::string name;
+    std::string description;
+};
+
+/* Returns every benchmark gdfm-bench knows about, in the order they run. */
+std::vector<std::unique_ptr<Benchmark>> createBenchmarks();
+
+/*
+ * Creates fileCount files of fileSize bytes under directory, spread across
+ * subdirectories the way a dotfile repository would be. The contents are
+ * generated from a fixed seed so every run compares the same bytes.
+ *
+ * Returns true on success, false on failure.
+ */
+bool generateDotFileTree(
+    const std::string& directory, int fileCount, long fileSize);
+/*
+ * Writes a config file with moduleCount modules, each with a few files and
+ * install, uninstall and update actions, installing into
+ * installDirectory.
+ *
+ * Returns true on success, false on failure.
+ */
+bool generateConfigFile(const std::string& path, int moduleCount,
+    const std::string& installDirectory);
+
+/* Writes the results as a table meant for people. */
+void writeBenchmarkTable(
+    std::ostream& stream, const std::vector<BenchmarkResult>& results);
+/* Writes the settings and results as JSON meant for scripts. */
+void writeBenchmarkJson(std::ostream& stream,
+    const BenchmarkSettings& settings,
+    const std::vector<BenchmarkResult>& results);
+
+/*
+ * Runs the benchmarks named in argv, or all of them, with the options in
+ * argv.
+ *
+ * Returns the exit status for the program.
+ */
+int runBenchmarkCommandLine(int argc, char* argv[]);
+} /* namespace gdfm */
+
+#endif /* BENCHMARK_H */
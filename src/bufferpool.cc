@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "bufferpool.h"
+
+#include <chrono>
+
+#include "runstatistics.h"
+
+namespace gdfm {
+
+namespace {
+/* How many buffers the calling thread holds from any pool. */
+thread_local unsigned int heldBuffers = 0;
+} /* namespace */
+
+BufferPool::Lease::Lease()
+{
+}
+
+BufferPool::Lease::Lease(
+    BufferPool* pool, std::unique_ptr<char[]> data, size_t size)
+    : pool(pool), data(std::move(data)), size(size)
+{
+}
+
+BufferPool::Lease::Lease(Lease&& other)
+    : pool(other.pool), data(std::move(other.data)), size(other.size)
+{
+    other.pool = nullptr;
+    other.size = 0;
+}
+
+BufferPool::Lease&
+BufferPool::Lease::operator=(Lease&& other)
+{
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        data = std::move(other.data);
+        size = other.size;
+        other.pool = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+BufferPool::Lease::~Lease()
+{
+    release();
+}
+
+char*
+BufferPool::Lease::getData() const
+{
+    return data.get();
+}
+
+size_t
+BufferPool::Lease::getSize() const
+{
+    return size;
+}
+
+void
+BufferPool::Lease::release()
+{
+    if (!pool)
+        return;
+    pool->release(std::move(data), size);
+    pool = nullptr;
+    size = 0;
+}
+
+BufferPool::BufferPool(size_t budget) : budget(budget)
+{
+}
+
+size_t
+BufferPool::getBudget() const
+{
+    return budget;
+}
+
+size_t
+BufferPool::getLargestBufferSize() const
+{
+    size_t bufferSize = MIN_BUFFER_SIZE;
+    while (bufferSize * 2 <= budget)
+        bufferSize *= 2;
+    return bufferSize;
+}
+
+BufferPool::Lease
+BufferPool::acquire(size_t size)
+{
+    size = getBufferSize(size);
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    std::unique_lock<std::mutex> lock(mutex);
+    auto fits = [&]() {
+        return bytesInFlight == 0 || bytesInFlight + size <= budget;
+    };
+    if (heldBuffers == 0 && !fits()) {
+        auto startTime = std::chrono::steady_clock::now();
+        releasedCondition.wait(lock, fits);
+        if (statistics) {
+            statistics->addBufferWait(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - startTime)
+                    .count());
+        }
+    }
+    bytesInFlight += size;
+    if (bytesInFlight > peakBytesInFlight)
+        peakBytesInFlight = bytesInFlight;
+    if (statistics)
+        statistics->updatePeakBufferBytes(bytesInFlight);
+    heldBuffers++;
+
+    std::unique_ptr<char[]> data;
+    for (auto it = freeBuffers.begin(); it != freeBuffers.end(); ++it) {
+        if (it->first == size) {
+            data = std::move(it->second);
+            freeBuffers.erase(it);
+            freeBytes -= size;
+            break;
+        }
+    }
+    /* Make room for the new buffer by dropping ones nobody asked for. */
+    while (!data && !freeBuffers.empty()
+        && bytesInFlight + freeBytes > budget) {
+        freeBytes -= freeBuffers.back().first;
+        freeBuffers.pop_back();
+    }
+    lock.unlock();
+    if (!data)
+        data.reset(new char[size]);
+    return Lease(this, std::move(data), size);
+}
+
+uint64_t
+BufferPool::getPeakBytesInFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return peakBytesInFlight;
+}
+
+void
+BufferPool::release(std::unique_ptr<char[]> data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bytesInFlight -= size;
+    heldBuffers--;
+    if (bytesInFlight + freeBytes + size <= budget) {
+        freeBuffers.emplace_back(size, std::move(data));
+        freeBytes += size;
+    }
+    releasedCondition.notify_all();
+}
+
+size_t
+BufferPool::getBufferSize(size_t size)
+{
+    size_t bufferSize = MIN_BUFFER_SIZE;
+    while (bufferSize < size)
+        bufferSize *= 2;
+    return bufferSize;
+}
+} /* namespace gdfm */
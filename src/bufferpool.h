@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gdfm {
+
+/* How much memory copy and compare buffers may take up unless told. */
+const size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+/* The smallest budget that can be asked for. */
+const size_t MIN_MEMORY_BUDGET = 64 * 1024;
+/* Buffers are at least this big, and otherwise a power of two. */
+const size_t MIN_BUFFER_SIZE = 4096;
+
+/*
+ * Lends out the buffers files are copied and compared through, keeping the
+ * memory they take up under a budget however many modules run at once.
+ * Work is let in by how many bytes of buffers it needs rather than by how
+ * many files are in progress, so one large file waits for several small
+ * ones to finish and memory use stays predictable on small machines.
+ * Buffers that are given back are kept for reuse while they fit.
+ *
+ * A request bigger than the whole budget waits until nothing else is lent
+ * out. A thread that already holds a buffer is never made to wait, so
+ * taking a second one can't deadlock, but work should take everything it
+ * needs at once where it can.
+ */
+class BufferPool {
+public:
+    /*
+     * A buffer lent out by a pool. It goes back to the pool when destroyed,
+     * which must happen on the thread that acquired it.
+     */
+    class Lease {
+    public:
+        Lease();
+        Lease(Lease&& other);
+        Lease& operator=(Lease&& other);
+        ~Lease();
+
+        char* getData() const;
+        /* Returns the size of the buffer, which may be more than asked for. */
+        size_t getSize() const;
+
+    private:
+        friend class BufferPool;
+
+        BufferPool* pool = nullptr;
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+
+        Lease(BufferPool* pool, std::unique_ptr<char[]> data, size_t size);
+        void release();
+    };
+
+    explicit BufferPool(size_t budget);
+
+    size_t getBudget() const;
+    /*
+     * Returns the size of the largest buffer that fits in the budget. Work
+     * that goes through a file a piece at a time should use pieces no bigger.
+     */
+    size_t getLargestBufferSize() const;
+    /*
+     * Waits until a buffer of at least size bytes fits in the budget, then
+     * lends it out. Time spent waiting is added to the current run.
+     */
+    Lease acquire(size_t size);
+    /* Returns the most bytes that have been lent out at once. */
+    uint64_t getPeakBytesInFlight() const;
+
+private:
+    size_t budget;
+    mutable std::mutex mutex;
+    std::condition_variable releasedCondition;
+    size_t bytesInFlight = 0;
+    size_t peakBytesInFlight = 0;
+    /* Buffers that were given back, by size. */
+    std::vector<std::pair<size_t, std::unique_ptr<char[]>>> freeBuffers;
+    size_t freeBytes = 0;
+
+    void release(std::unique_ptr<char[]> data, size_t size);
+    /* Returns size rounded up to the size of buffer it would be given. */
+    static size_t getBufferSize(size_t size);
+};
+} /* namespace gdfm */
+
+#endif /* BUFFER_POOL_H */
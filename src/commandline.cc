@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "commandline.h"
+
+#include <dirent.h>
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#include "configfilereader.h"
+#include "filewatcher.h"
+#include "modulerunner.h"
+#include "runcontext.h"
+#include "threadpool.h"
+#include "tracer.h"
+#include "util.h"
+
+namespace gdfm {
+
+namespace {
+/*
+ * Writes the statistics as JSON to the path from the options, with "-"
+ * meaning standard output.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+writeStatistics(const RunStatistics& statistics, const std::string& path)
+{
+    if (path == "-") {
+        statistics.writeJson(std::cout);
+        return true;
+    }
+    std::ofstream writer(path);
+    if (!writer.is_open()) {
+        warnx("Failed to open %s.", path.c_str());
+        return false;
+    }
+    statistics.writeJson(writer);
+    writer.close();
+    return !writer.fail();
+}
+
+/*
+ * Gives runner a new store to back up files in if one was asked for.
+ */
+void
+setUpBackups(const DfmOptions& options, ModuleRunner& runner)
+{
+    if (options.hasBackupDirectory) {
+        runner.setBackupStore(
+            std::make_shared<BackupStore>(options.backupDirectory));
+    }
+}
+
+/* Tells what the last run of runner backed up, if verbose. */
+void
+reportBackups(const DfmOptions& options, const ModuleRunner& runner)
+{
+    std::shared_ptr<BackupStore> store = runner.getBackupStore();
+    if (!options.verboseFlag || !store || store->getRecords().empty())
+        return;
+    std::cout << "Backed up " << store->getRecords().size() << " files to "
+              << store->getDirectory() << " as run " << runner.getRunName()
+              << ", " << store->getObjectsStored() << " of them new."
+              << std::endl;
+}
+
+/*
+ * Tells how each target directory of the last run of runner went, warning
+ * about the ones with failures.
+ */
+void
+reportTargets(const DfmOptions& options, ModuleRunner& runner)
+{
+    const char* operationName =
+        ModuleRunner::getOperationName(runner.getOperation());
+    for (const auto& result : runner.getStatistics().getTargetResults()) {
+        if (result.failedFiles > 0) {
+            warnx("Failed to %s %llu of %llu files in %s.", operationName,
+                static_cast<unsigned long long>(result.failedFiles),
+                static_cast<unsigned long long>(
+                    result.failedFiles + result.succeededFiles),
+                result.directory.c_str());
+        } else if (options.verboseFlag) {
+            std::cout << "Finished " << result.succeededFiles << " files in "
+                      << result.directory << "." << std::endl;
+        }
+    }
+}
+
+/*
+ * Warns that module failed the operation, along with the end of the output
+ * of the command that made it fail, if one did.
+ */
+void
+reportFailure(ModuleRunner::Operation operation,
+    const ModuleRunner::FailedModule& module)
+{
+    const char* operationName = ModuleRunner::getOperationName(operation);
+    if (module.output.empty()) {
+        warnx("Failed to %s module %s.", operationName, module.name.c_str());
+        return;
+    }
+    warnx("Failed to %s module %s, which ended with:\n%s", operationName,
+        module.name.c_str(), module.output.c_str());
+}
+
+/*
+ * Puts back every file the run named in the options replaced or created,
+ * several at a time, starting from the last one it touched. What is there
+ * now is backed up as a run of its own first, so the rollback can be rolled
+ * back too.
+ *
+ * Returns the exit status for the program.
+ */
+int
+rollBackRun(const DfmOptions& options)
+{
+    BackupStore store(options.backupDirectory);
+    std::vector<BackupStore::Record> records;
+    if (!store.readRunRecord(options.rollbackRun, records)) {
+        warnx("Failed to read run %s from %s.", options.rollbackRun.c_str(),
+            options.backupDirectory.c_str());
+        return EXIT_FAILURE;
+    }
+    /* The first record of a file is how it was before the run. */
+    std::vector<const BackupStore::Record*> restoring;
+    std::unordered_set<std::string> paths;
+    for (const auto& record : records) {
+        if (paths.insert(record.path).second)
+            restoring.push_back(&record);
+    }
+
+    BackupStore undoStore(options.backupDirectory);
+    std::string undoRunName = BackupStore::createRunName();
+    undoStore.startRunRecord(undoRunName);
+    unsigned int threadCount = (options.jobs > 1)
+        ? options.jobs
+        : ThreadPool::getDefaultThreadCount();
+    std::atomic<bool> failed(false);
+    {
+        ThreadPool pool(threadCount);
+        for (auto it = restoring.rbegin(); it != restoring.rend(); ++it) {
+            const BackupStore::Record* record = *it;
+            pool.submit([&store, &undoStore, &failed, record]() {
+                std::string objectPath;
+                if (!record->digest.empty()) {
+                    objectPath = store.getObjectPath(record->digest);
+                    if (access(objectPath.c_str(), R_OK) != 0) {
+                        warnx("The contents of %s are missing from the store.",
+                            record->path.c_str());
+                        failed = true;
+                        return;
+                    }
+                }
+                bool backedUp = (record->digest.empty())
+                    ? undoStore.backUp(record->path, true)
+                    : undoStore.backUpInstall(objectPath, record->path);
+                if (!backedUp) {
+                    warnx("Failed to back up %s, leaving it alone.",
+                        record->path.c_str());
+                    failed = true;
+                } else if (!store.restore(*record)) {
+                    warnx("Failed to restore %s.", record->path.c_str());
+                    failed = true;
+                }
+            });
+        }
+        pool.wait();
+    }
+    if (!undoStore.finishRunRecord()) {
+        warnx("Failed to write the backup record for run %s.",
+            undoRunName.c_str());
+        failed = true;
+    }
+    if (options.verboseFlag) {
+        std::cout << "Rolled back " << restoring.size() << " files from run "
+                  << options.rollbackRun << ". What they replaced is run "
+                  << undoRunName << "." << std::endl;
+    }
+    return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Updates the files of the modules whenever their sources change, until
+ * something goes wrong. Only the files that changed are checked.
+ *
+ * Returns the exit status for the program.
+ */
+int
+watchModules(const DfmOptions& options, const std::vector<Module>& modules,
+    const std::string& sourceDirectory, unsigned int jobs)
+{
+    FileWatcher watcher;
+    if (!watcher.watch(modules, sourceDirectory))
+        return EXIT_FAILURE;
+    if (options.verboseFlag) {
+        std::cout << "Watching " << watcher.getWatchCount()
+                  << " directories for " << modules.size() << " modules."
+                  << std::endl;
+    }
+    while (watcher.waitForChanges(WATCH_QUIET_MILLISECONDS)) {
+        std::vector<Module> changed = watcher.takeChangedModules();
+        if (options.verboseFlag) {
+            for (const auto& module : changed)
+                std::cout << "Updating " << module.getName() << "."
+                          << std::endl;
+        }
+        ModuleRunner runner(ModuleRunner::UPDATE_OPERATION, sourceDirectory);
+        runner.setJobs(jobs);
+        runner.setCopyAttributes(options.copyAttributes);
+        runner.setMemoryBudget(options.memoryBudget);
+        setUpBackups(options, runner);
+        runner.run(changed);
+        for (const auto& module : runner.getFailedModules())
+            reportFailure(ModuleRunner::UPDATE_OPERATION, module);
+        reportBackups(options, runner);
+    }
+    return EXIT_FAILURE;
+}
+} /* namespace */
+
+int
+runCommandLine(int argc, char* argv[])
+{
+    std::shared_ptr<DfmOptions> options(new DfmOptions());
+    if (!options->loadFromArguments(argc, argv))
+        return EXIT_FAILURE;
+    if (!options->verifyArguments())
+        return EXIT_FAILURE;
+    if (options->hasTracePath)
+        Tracer::enable();
+    std::string sourceDirectory = (options->hasSourceDirectory)
+        ? options->sourceDirectory
+        : getCurrentDirectory();
+
+    if (options->generateConfigFileFlag) {
+        std::vector<Module> modules;
+        if (!generateModules(sourceDirectory, modules)) {
+            warnx("Failed to read directory %s.", sourceDirectory.c_str());
+            return EXIT_FAILURE;
+        }
+        printConfigFile(modules);
+        return EXIT_SUCCESS;
+    }
+    if (options->rollbackFlag)
+        return rollBackRun(*options);
+
+    ModuleRunner::Operation operation = ModuleRunner::INSTALL_OPERATION;
+    if (options->uninstallModulesFlag)
+        operation = ModuleRunner::UNINSTALL_OPERATION;
+    else if (options->updateModulesFlag || options->watchModulesFlag)
+        operation = ModuleRunner::UPDATE_OPERATION;
+    ModuleRunner runner(operation, sourceDirectory);
+
+    /*
+     * Reading the file is done with the runner's statistics current so the
+     * time spent parsing shows up with the rest of the run.
+     */
+    std::vector<Module> modules;
+    std::string configPath = sourceDirectory + "/" + CONFIG_FILE_NAME;
+    ConfigFileReader reader(configPath, options);
+    if (!reader.isOpen()) {
+        warnx("Failed to open %s.", configPath.c_str());
+        return EXIT_FAILURE;
+    }
+    {
+        RunContext context;
+        context.setStatistics(&runner.getStatistics());
+        RunContext::Scope scope(context);
+        if (!reader.readModules(std::back_inserter(modules)))
+            return EXIT_FAILURE;
+    }
+
+    if (options->printModulesFlag) {
+        for (const auto& module : modules)
+            std::cout << module.getName() << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (options->dumpConfigFileFlag) {
+        printConfigFile(modules);
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<Module> selected;
+    if (!selectModules(*options, modules, selected))
+        return EXIT_FAILURE;
+    /* Prompts from several modules at once would be impossible to answer. */
+    unsigned int jobs = options->jobs;
+    if (options->interactiveFlag && jobs > 1) {
+        warnx("Running one module at a time because of --interactive.");
+        jobs = 1;
+    }
+    if (options->watchModulesFlag)
+        return watchModules(*options, selected, sourceDirectory, jobs);
+    runner.setJobs(jobs);
+    runner.setTargetDirectories(options->targetDirectories);
+    runner.setCopyAttributes(options->copyAttributes);
+    runner.setMemoryBudget(options->memoryBudget);
+    setUpBackups(*options, runner);
+    bool status = runner.run(selected);
+    for (const auto& module : runner.getFailedModules())
+        reportFailure(operation, module);
+    reportTargets(*options, runner);
+    reportBackups(*options, runner);
+
+    if (options->hasStatisticsPath
+        && !writeStatistics(runner.getStatistics(), options->statisticsPath))
+        status = false;
+    if (options->hasTracePath && !Tracer::writeTrace(options->tracePath)) {
+        warnx("Failed to write trace to %s.", options->tracePath.c_str());
+        status = false;
+    }
+    return (status) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool
+selectModules(const DfmOptions& options, const std::vector<Module>& modules,
+    std::vector<Module>& selected)
+{
+    if (options.allFlag) {
+        selected = modules;
+        return true;
+    }
+    bool foundAll = true;
+    for (const auto& name : options.remainingArguments) {
+        bool found = false;
+        for (const auto& module : modules) {
+            if (module.getName() == name) {
+                selected.push_back(module);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            warnx("No module named %s.", name.c_str());
+            foundAll = false;
+        }
+    }
+    return foundAll;
+}
+
+bool
+generateModules(const std::string& directory, std::vector<Module>& modules)
+{
+    struct dirent** entries = nullptr;
+    int entryCount =
+        scandir(directory.c_str(), &entries, returnOne, alphasort);
+    if (entryCount == -1)
+        return false;
+    for (int i = 0; i < entryCount; i++) {
+        std::string name = entries[i]->d_name;
+        free(entries[i]);
+        if (name == "." || name == ".." || name == CONFIG_FILE_NAME
+            || name == ".git" || name == ".hg" || name == ".svn")
+            continue;
+        Module module(name);
+        module.addFile(name);
+        modules.push_back(module);
+    }
+    free(entries);
+    return true;
+}
+
+void
+printConfigFile(const std::vector<Module>& modules)
+{
+    std::string text;
+    for (const auto& module : modules) {
+        module.writeConfig(text);
+        text += '\n';
+    }
+    std::cout << text << std::flush;
+}
+} /* namespace gdfm */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "module.h"
+#include "options.h"
+
+namespace gdfm {
+
+/*
+ * Runs gdfm without a window, the way DotFileManager does, using the options
+ * in argv. This never touches GTK, so it works on servers and from cron
+ * where there is no display.
+ *
+ * Returns the exit status for the program.
+ */
+int runCommandLine(int argc, char* argv[]);
+
+/*
+ * Finds the modules named in the options, or every module if the --all flag
+ * was given. Warns about every name that doesn't match a module.
+ *
+ * Returns true if every name matched a module, false otherwise.
+ */
+bool selectModules(const DfmOptions& options,
+    const std::vector<Module>& modules, std::vector<Module>& selected);
+
+/*
+ * Creates a module for each file in the directory, installing it to the
+ * home directory. The config file itself and version control directories
+ * are skipped.
+ *
+ * Returns true if the directory could be read, false otherwise.
+ */
+bool generateModules(
+    const std::string& directory, std::vector<Module>& modules);
+
+/* Writes the modules to standard output in the config file format. */
+void printConfigFile(const std::vector<Module>& modules);
+} /* namespace gdfm */
+
+#endif /* COMMAND_LINE_H */
@@ -23,8 +23,10 @@
 #include "configfilereader.h"
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <exception>
 #include <regex>
@@ -50,6 +52,7 @@ ConfigFileReader::ConfigFileReader(
     : path(path), reader(path), options(options), environment(options)
 {
     addDefaultCommands();
+    addDefaultVariables();
 }
 
 ConfigFileReader::ConfigFileReader(const char* path)
@@ -102,6 +105,12 @@ ConfigFileReader::setEnvironment(const ReaderEnvironment& environment)
     this->environment = environment;
 }
 
+const std::vector<ConfigFileSpan>&
+ConfigFileReader::getModuleSpans() const
+{
+    return moduleSpans;
+}
+
 bool
 ConfigFileReader::isOpen()
 {
@@ -294,6 +303,13 @@ ConfigFileReader::processLineAsCommand(const std::string& line)
     if (isShellCommand(command)) {
         inShell = true;
         currentShellAction = new ShellAction;
+        if (!setShellActionTimeout(currentShellAction)) {
+            errorMessage(line, "Invalid shell-timeout value.");
+            delete currentShellAction;
+            currentShellAction = nullptr;
+            inShell = false;
+            return false;
+        }
         /* Match everything after one group of whitespace. */
         std::regex re("^\\s+(.*)$");
         std::smatch match;
@@ -324,6 +340,27 @@ ConfigFileReader::processLineAsFile(const std::string& line)
         errorMessage(line, "Too many arguments to file line.");
         return false;
     }
+    /*
+     * Files ending in template-suffix are templates and are installed
+     * without it unless they're given another name.
+     */
+    std::string suffix;
+    const std::string& filename = arguments[0];
+    if (!environment.accessVariable("template-suffix", suffix)
+        || suffix.empty() || filename.length() <= suffix.length()
+        || filename.compare(
+               filename.length() - suffix.length(), suffix.length(), suffix)
+            != 0)
+        return true;
+    ModuleFile& file = currentModule->getFiles().back();
+    if (argumentCount < 3)
+        file.setDestinationFilename(
+            filename.substr(0, filename.length() - suffix.length()));
+    if (!templateVariables) {
+        templateVariables = std::make_shared<const TemplateVariables>(
+            environment.getVariables());
+    }
+    file.setTemplateVariables(templateVariables);
     return true;
 }
 
@@ -362,6 +399,7 @@ void
 ConfigFileReader::startNewModule(const std::string& name)
 {
     currentModule = new Module(name);
+    moduleBegin = currentLineBegin;
     inFiles = true;
     inModuleInstall = false;
     inModuleUninstall = false;
@@ -521,6 +559,7 @@ ConfigFileReader::createInstallAction(
 void
 ConfigFileReader::addDefaultCommands()
 {
+    TraceSpan span("parse", "ConfigFileReader::addDefaultCommands");
     addCommand(&ConfigFileReader::createMessageAction,
         Command::EXACT_COUNT_ARGUMENT_CHECK, 1, "message", "msg", "echo", "m",
         NULL);
@@ -537,6 +576,11 @@ void
 ConfigFileReader::addDefaultVariables()
 {
     environment.setVariable("default-directory", getHomeDirectory());
+    char hostname[HOST_NAME_MAX + 1];
+    if (gethostname(hostname, sizeof(hostname)) == 0) {
+        hostname[HOST_NAME_MAX] = '\0';
+        environment.setVariable("hostname", hostname);
+    }
 }
 
 bool
@@ -719,6 +763,21 @@ ConfigFileReader::setModuleActionFlags(ModuleAction* action)
     action->setInteractive(options->interactiveFlag);
 }
 
+bool
+ConfigFileReader::setShellActionTimeout(ShellAction* action)
+{
+    std::string value;
+    if (!environment.accessVariable("shell-timeout", value))
+        return true;
+    char* end = nullptr;
+    long timeout = strtol(value.c_str(), &end, 10);
+    if (value.length() == 0 || *end != '\0' || timeout < 0
+        || timeout > INT_MAX)
+        return false;
+    action->setTimeout(timeout);
+    return true;
+}
+
 bool
 ConfigFileReader::isAssignmentLine(const std::string& line)
 {
@@ -33,13 +33,16 @@
 #include <vector>
 
 #include "command.h"
+#include "filetemplate.h"
 #include "installaction.h"
 #include "messageaction.h"
 #include "module.h"
 #include "options.h"
 #include "readerenvironment.h"
 #include "removeaction.h"
+#include "runstatistics.h"
 #include "shellaction.h"
+#include "tracer.h"
 
 namespace gdfm {
 
@@ -51,6 +54,16 @@ const char CONFIG_FILE_NAME[] = "config.dfm";
 
 const char COMMENT_DELIMITER = '#';
 
+/*
+ * Where a module is in a config file, in bytes. It starts at the module's
+ * name and ends after the newline of its last line that isn't blank or a
+ * comment, so comments between modules aren't part of either one.
+ */
+struct ConfigFileSpan {
+    std::string::size_type begin;
+    std::string::size_type end;
+};
+
 class ConfigFileReader {
 public:
     ConfigFileReader(const std::string& path);
@@ -90,6 +103,11 @@ public:
      * Returns true on success, false on failure.
      */
     template <class OutputIterator> bool readModules(OutputIterator output);
+    /*
+     * Returns where each module from the last call to readModules() is in the
+     * file, in the order they were read.
+     */
+    const std::vector<ConfigFileSpan>& getModuleSpans() const;
 
     /*
      * Adds a command with the given action and given names. It takes a list of
@@ -148,6 +166,12 @@ private:
      * pass around options.
      */
     ReaderEnvironment environment;
+    /*
+     * The variables template files are filled in with. Since variables are
+     * only set at the top of the file, they are copied once, when the first
+     * template is found, and shared by every template after.
+     */
+    std::shared_ptr<const TemplateVariables> templateVariables;
     /*
      * Wheter or not the reader is at the start of the file and currently
      * setting variables.
@@ -191,6 +215,14 @@ private:
      * messages.
      */
     int currentLineNo = 1;
+    /* Offsets of the start and end of the current line in the file. */
+    std::string::size_type currentLineBegin = 0;
+    std::string::size_type currentLineEnd = 0;
+    /* The end of the last line that wasn't blank or a comment. */
+    std::string::size_type contentEnd = 0;
+    /* Where the current module's name is. */
+    std::string::size_type moduleBegin = 0;
+    std::vector<ConfigFileSpan> moduleSpans;
     /*
      * The list of commands, which is checked against when processing a normal
      * command. It looks through these commands in order, so higher priority
@@ -327,9 +359,11 @@ private:
     /*
      * If the reader is in a module install or uninstall, finishes the module
      * and writes it to output, which must be an output iterator with type
-     * module. This must be called or there will be a memory leak.
+     * module. This must be called or there will be a memory leak. The module's
+     * lines are recorded as ending at end.
      */
-    template <class OutputIterator> void flushModule(OutputIterator output);
+    template <class OutputIterator>
+    void flushModule(OutputIterator output, std::string::size_type end);
     /*
      * Creates a new module with the given name and sets the current module to
      * it. This assumes that the last module has already be flushed, and don't
@@ -412,6 +446,14 @@ private:
      */
     void setModuleActionFlags(std::shared_ptr<ModuleAction> action);
     void setModuleActionFlags(ModuleAction* action);
+    /*
+     * Sets the timeout of the given shell action from the shell-timeout
+     * variable, which is a number of seconds, if it is set.
+     *
+     * Returns false if the variable is set but isn't a valid number of
+     * seconds, true otherwise.
+     */
+    bool setShellActionTimeout(ShellAction* action);
 };
 
 template <class OutputIterator>
@@ -422,8 +464,17 @@ ConfigFileReader::readModules(OutputIterator output)
         warnx("Attempting to read from non-open file reader");
         return false;
     }
+    PhaseTimer timer(RunStatistics::PARSE_PHASE);
+    TraceSpan span("parse", "ConfigFileReader::readModules", path);
+    /* The variables at the top of the file, then the modules after them. */
+    TraceSpan sectionSpan("parse", "ConfigFileReader variables");
 
     currentLineNo = 1;
+    currentLineBegin = 0;
+    currentLineEnd = 0;
+    contentEnd = 0;
+    moduleSpans.clear();
+    templateVariables.reset();
     inVariables = true;
     inFiles = false;
     inModuleInstall = false;
@@ -437,14 +488,19 @@ ConfigFileReader::readModules(OutputIterator output)
     std::string line;
     /* Don't read a line if processing the last line wasn't successful. */
     while (noErrors && getline(reader, line)) {
+        currentLineBegin = currentLineEnd;
+        currentLineEnd += line.length() + (reader.eof() ? 0 : 1);
+        bool wasInVariables = inVariables;
         noErrors = processLine<OutputIterator>(line, output);
+        if (wasInVariables && !inVariables)
+            sectionSpan.restart("ConfigFileReader modules");
         if (noErrors)
             currentLineNo++;
     }
     if (inShell)
         flushShellAction();
     if (inModule())
-        flushModule(output);
+        flushModule(output, contentEnd);
     if (!noErrors)
         errorMessageNoLine(
             "Failed to read config file %s.", getPath().c_str());
@@ -460,6 +516,8 @@ ConfigFileReader::processLine(const std::string& line, OutputIterator output)
     int expectedIndents = getExpectedIndents();
     if (isComment(line, expectedIndents))
         return true;
+    std::string::size_type previousContentEnd = contentEnd;
+    contentEnd = currentLineEnd;
 
     int indents = indentCount(line);
 
@@ -522,7 +580,7 @@ ConfigFileReader::processLine(const std::string& line, OutputIterator output)
     std::string moduleName;
     if (isModuleLine(line, moduleName)) {
         if (inModule())
-            flushModule(output);
+            flushModule(output, previousContentEnd);
         startNewModule(moduleName);
         return true;
     }
@@ -532,8 +590,11 @@ ConfigFileReader::processLine(const std::string& line, OutputIterator output)
 
 template <class OutputIterator>
 void
-ConfigFileReader::flushModule(OutputIterator output)
+ConfigFileReader::flushModule(
+    OutputIterator output, std::string::size_type end)
 {
+    ConfigFileSpan span = { moduleBegin, end };
+    moduleSpans.push_back(span);
     *output = *currentModule;
     delete currentModule;
     inFiles = false;
@@ -22,73 +22,219 @@
 
 #include "configfilewriter.h"
 
+#include <sys/stat.h>
+
 #include <err.h>
 
+#include <unordered_set>
+
+#include "tracer.h"
+#include "util.h"
+
 namespace gdfm {
 
-ConfigFileWriter::ConfigFileWriter(
-    const std::string& path, const std::vector<Module> modules)
-    : path(path), modules(modules)
+bool
+createConfigFileLayout(const std::string& path,
+    const std::vector<ConfigFileSpan>& spans, const ModuleList& moduleList,
+    ConfigFileLayout& layout)
+{
+    layout = ConfigFileLayout();
+    if (spans.size() != moduleList.getModuleCount())
+        return false;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    for (size_t i = 0; i < spans.size(); i++) {
+        ConfigFileLayout::Entry entry = { moduleList.getModuleId(i),
+            spans[i] };
+        layout.entries.push_back(entry);
+    }
+    layout.size = info.st_size;
+    layout.modified = info.st_mtim;
+    layout.valid = true;
+    return true;
+}
+
+ConfigFileWriter::ConfigFileWriter(const std::string& path) : path(path)
+{
+}
+
+const std::string&
+ConfigFileWriter::getPath() const
 {
-    writer.open(path);
+    return path;
 }
 
-ConfigFileWriter::~ConfigFileWriter()
+void
+ConfigFileWriter::setPath(const std::string& path)
 {
-    if (isOpen())
-        close();
+    this->path = path;
 }
 
 bool
-ConfigFileWriter::writeModules()
+ConfigFileWriter::writeModules(const std::vector<Module>& modules)
 {
-    if (!isOpen()) {
-        warnx("Attempting to write to non-open writer.");
-        return false;
-    }
+    TraceSpan span("io", "ConfigFileWriter::writeModules", path);
+    std::string output;
     for (const auto& module : modules) {
-        for (const auto& line : module.createConfigLines())
-            writer << line << std::endl;
-        writer << std::endl;
+        module.writeConfig(output);
+        output += '\n';
     }
-    return true;
+    bytesReused = 0;
+    bytesWritten = output.length();
+    return writeFileAtomically(path, output);
 }
 
 bool
-ConfigFileWriter::isOpen() const
+ConfigFileWriter::writeModules(
+    const ModuleList& moduleList, ConfigFileLayout& layout)
 {
-    return writer.is_open();
+    TraceSpan span("io", "ConfigFileWriter::writeModules", path);
+    std::string output;
+    std::vector<ConfigFileLayout::Entry> entries;
+    for (size_t i = 0; i < moduleList.getModuleCount(); i++) {
+        ConfigFileLayout::Entry entry = { moduleList.getModuleId(i),
+            { output.length(), 0 } };
+        moduleList.getModule(i).writeConfig(output);
+        entry.span.end = output.length();
+        entries.push_back(entry);
+        output += '\n';
+    }
+    bytesReused = 0;
+    return commit(output, entries, layout);
 }
 
-void
-ConfigFileWriter::close()
+bool
+ConfigFileWriter::writeChangedModules(
+    const ModuleList& moduleList, ConfigFileLayout& layout)
 {
-    writer.close();
+    TraceSpan span("io", "ConfigFileWriter::writeChangedModules", path);
+    if (!moduleList.isModified() && isLayoutCurrent(layout)) {
+        bytesWritten = 0;
+        bytesReused = 0;
+        return true;
+    }
+    std::string original;
+    if (!isLayoutCurrent(layout) || !readFileContents(path, original)
+        || original.length() != static_cast<uint64_t>(layout.size))
+        return writeModules(moduleList, layout);
+
+    std::unordered_set<ModuleId> laidOut;
+    for (const auto& entry : layout.entries)
+        laidOut.insert(entry.id);
+
+    std::string output;
+    output.reserve(original.length() + original.length() / 4);
+    std::vector<ConfigFileLayout::Entry> entries;
+    uint64_t reused = 0;
+    /* The next byte of original to copy, and the next module to write. */
+    std::string::size_type position = 0;
+    size_t nextModule = 0;
+    for (const auto& entry : layout.entries) {
+        if (entry.span.begin < position || entry.span.end < entry.span.begin
+            || entry.span.end > original.length())
+            return writeModules(moduleList, layout);
+        output.append(original, position, entry.span.begin - position);
+        reused += entry.span.begin - position;
+        position = entry.span.end;
+
+        size_t index;
+        if (!moduleList.findModule(entry.id, index)) {
+            /* Take the blank lines after a removed module with it. */
+            while (position < original.length() && original[position] == '\n')
+                position++;
+            continue;
+        }
+        if (index < nextModule)
+            return writeModules(moduleList, layout);
+        /* Modules added before this one go right before it. */
+        for (; nextModule < index; nextModule++) {
+            ModuleId id = moduleList.getModuleId(nextModule);
+            if (laidOut.count(id) > 0)
+                return writeModules(moduleList, layout);
+            ConfigFileLayout::Entry added = { id, { output.length(), 0 } };
+            moduleList.getModule(nextModule).writeConfig(output);
+            added.span.end = output.length();
+            entries.push_back(added);
+            output += '\n';
+        }
+        ConfigFileLayout::Entry kept = { entry.id, { output.length(), 0 } };
+        if (moduleList.isModuleModified(entry.id))
+            moduleList.getModule(index).writeConfig(output);
+        else {
+            output.append(original, entry.span.begin,
+                entry.span.end - entry.span.begin);
+            reused += entry.span.end - entry.span.begin;
+        }
+        kept.span.end = output.length();
+        entries.push_back(kept);
+        nextModule = index + 1;
+    }
+    output.append(original, position, std::string::npos);
+    reused += original.length() - position;
+
+    for (; nextModule < moduleList.getModuleCount(); nextModule++) {
+        ModuleId id = moduleList.getModuleId(nextModule);
+        if (laidOut.count(id) > 0)
+            return writeModules(moduleList, layout);
+        /* Keep a blank line between the end of the file and the module. */
+        if (!output.empty() && output.back() != '\n')
+            output += '\n';
+        if (output.length() >= 2
+            && output.compare(output.length() - 2, 2, "\n\n") != 0)
+            output += '\n';
+        ConfigFileLayout::Entry added = { id, { output.length(), 0 } };
+        moduleList.getModule(nextModule).writeConfig(output);
+        added.span.end = output.length();
+        entries.push_back(added);
+        output += '\n';
+    }
+    bytesReused = reused;
+    return commit(output, entries, layout);
 }
 
-const std::string&
-ConfigFileWriter::getPath() const
+uint64_t
+ConfigFileWriter::getBytesWritten() const
 {
-    return path;
+    return bytesWritten;
 }
 
-void
-ConfigFileWriter::setPath(const std::string& path)
+uint64_t
+ConfigFileWriter::getBytesReused() const
 {
-    this->path = path;
-    writer.close();
-    writer.open(path);
+    return bytesReused;
 }
 
-const std::vector<Module>&
-ConfigFileWriter::getModules() const
+bool
+ConfigFileWriter::commit(const std::string& output,
+    std::vector<ConfigFileLayout::Entry>& entries, ConfigFileLayout& layout)
 {
-    return modules;
+    bytesWritten = output.length();
+    layout = ConfigFileLayout();
+    if (!writeFileAtomically(path, output))
+        return false;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        warn("Failed to stat %s", path.c_str());
+        return true;
+    }
+    layout.entries.swap(entries);
+    layout.size = info.st_size;
+    layout.modified = info.st_mtim;
+    layout.valid = true;
+    return true;
 }
 
-void
-ConfigFileWriter::setModules(const std::vector<Module>& modules)
+bool
+ConfigFileWriter::isLayoutCurrent(const ConfigFileLayout& layout) const
 {
-    this->modules = modules;
+    if (!layout.valid)
+        return false;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    return info.st_size == layout.size
+        && info.st_mtim.tv_sec == layout.modified.tv_sec
+        && info.st_mtim.tv_nsec == layout.modified.tv_nsec;
 }
 } /* namespace gdfm */
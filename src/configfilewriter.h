@@ -23,33 +23,112 @@
 #ifndef CONFIG_FILE_WRITER_H
 #define CONFIG_FILE_WRITER_H
 
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
 #include <string>
 #include <vector>
-#include <fstream>
 
+#include "configfilereader.h"
 #include "module.h"
+#include "modulelist.h"
 
 namespace gdfm {
 
+/*
+ * Where each module of a ModuleList is in the config file it came from, and
+ * what the file looked like then. Saving uses this to rewrite only the
+ * modules that changed and copy everything else, comments and variables
+ * included, byte for byte.
+ */
+struct ConfigFileLayout {
+    struct Entry {
+        ModuleId id;
+        ConfigFileSpan span;
+    };
+
+    /* The modules in the order they are in the file. */
+    std::vector<Entry> entries;
+    /*
+     * The size and modification time of the file, to tell if something else
+     * changed it since. The layout is only used if both still match.
+     */
+    off_t size = 0;
+    struct timespec modified = { 0, 0 };
+    bool valid = false;
+};
+
+/*
+ * Creates the layout for the file at path, given the spans a ConfigFileReader
+ * found in it and a ModuleList that was just set to the modules it read.
+ *
+ * Returns true on success, false if the file can't be looked at or the spans
+ * don't match the modules.
+ */
+bool createConfigFileLayout(const std::string& path,
+    const std::vector<ConfigFileSpan>& spans, const ModuleList& moduleList,
+    ConfigFileLayout& layout);
+
+/*
+ * Writes modules to a config file. Everything is put together in one buffer
+ * and written with writeFileAtomically(), so a failed or interrupted save
+ * leaves the old file alone.
+ */
 class ConfigFileWriter {
 public:
-    ConfigFileWriter(
-        const std::string& path, const std::vector<Module> modules);
-    ~ConfigFileWriter();
-
-    bool writeModules();
-    bool isOpen() const;
-    void close();
+    ConfigFileWriter(const std::string& path);
 
     const std::string& getPath() const;
     void setPath(const std::string& path);
-    const std::vector<Module>& getModules() const;
-    void setModules(const std::vector<Module>& modules);
+
+    /*
+     * Replaces the file with modules, each followed by a blank line.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool writeModules(const std::vector<Module>& modules);
+    /*
+     * Same as above, but also sets layout to where each module of moduleList
+     * ended up.
+     */
+    bool writeModules(const ModuleList& moduleList, ConfigFileLayout& layout);
+    /*
+     * Rewrites only the modules in moduleList that changed since it was last
+     * saved. Unchanged modules and everything between them are copied from
+     * the file, removed modules are cut out, and new ones are added where
+     * they are in the list. Falls back to writing every module if layout
+     * isn't valid, the file changed since layout was made, or the modules
+     * were reordered. Comments inside a changed module are lost. Layout is
+     * updated to match the new file. Nothing is written if nothing changed.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool writeChangedModules(
+        const ModuleList& moduleList, ConfigFileLayout& layout);
+
+    /*
+     * Returns true if the file still has the size and time in layout, so
+     * nothing changed it since.
+     */
+    bool isLayoutCurrent(const ConfigFileLayout& layout) const;
+    /* The size of the last file written. */
+    uint64_t getBytesWritten() const;
+    /* How much of the last file was copied from the old one as it was. */
+    uint64_t getBytesReused() const;
 
 private:
-    std::ofstream writer;
     std::string path;
-    std::vector<Module> modules;
+    uint64_t bytesWritten = 0;
+    uint64_t bytesReused = 0;
+
+    /*
+     * Writes output to path, and on success makes layout describe the new
+     * file with entries.
+     */
+    bool commit(const std::string& output,
+        std::vector<ConfigFileLayout::Entry>& entries,
+        ConfigFileLayout& layout);
 };
 } /* namespace gdfm */
 
@@ -28,7 +28,7 @@
 
 #include <iostream>
 
-#include "dependencyeditor.h"
+#include "processlauncher.h"
 
 namespace gdfm {
 
@@ -109,8 +109,16 @@ DependencyAction::performAction()
         std::string userInput;
         std::getline(std::cin, userInput);
         if (userInput.length() != 0) {
-            int status = system(userInput.c_str());
-            if (status == -1) {
+            /*
+             * The command is typed by the user and might ask them for a
+             * password, so it keeps the terminal and stays in the foreground
+             * process group.
+             */
+            ProcessLauncher launcher =
+                ProcessLauncher::forShellCommand(userInput);
+            launcher.setCaptureOutput(false);
+            launcher.setNewProcessGroup(false);
+            if (!launcher.run()) {
                 warnx("Failed to create process to execute command %s.",
                     userInput.c_str());
                 return false;
@@ -122,7 +130,7 @@ DependencyAction::performAction()
              * corresponds to the shell's 0 return. I'm almost certain it is,
              * but this is easier.
              */
-            if (status != 0) {
+            if (!launcher.succeeded()) {
                 warnx("Failed to execute command %s.", userInput.c_str());
                 return false;
             }
@@ -157,6 +165,12 @@ DependencyAction::updateName()
     setName("Dependency Check");
 }
 
+std::shared_ptr<ModuleAction>
+DependencyAction::clone() const
+{
+    return std::shared_ptr<ModuleAction>(new DependencyAction(*this));
+}
+
 std::vector<std::string>
 DependencyAction::createConfigLines() const
 {
@@ -173,11 +187,4 @@ DependencyAction::addDependency(const std::string& dependency)
 {
     dependencies.push_back(dependency);
 }
-
-void
-DependencyAction::graphicalEdit(Gtk::Window& parent)
-{
-    DependencyEditor editor(parent, this);
-    editor.run();
-}
 } /* namespace gdfm */
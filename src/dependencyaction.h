@@ -55,8 +55,8 @@ public:
     std::string getDependenciesAsString(const std::string& delimiter) const;
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     std::vector<std::string> dependencies;
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "driftdetector.h"
+
+#include "filecheckaction.h"
+
+namespace gdfm {
+
+DriftDetector::DriftDetector()
+    : watcher(pool, FileWatcher::DESTINATION_PATHS), pool(1)
+{
+    watcher.setQueueLimit(DRIFT_QUEUE_LIMIT);
+    watcher.setReadyCallback([this]() { notifyUpdate(); });
+}
+
+DriftDetector::~DriftDetector()
+{
+    if (moduleList)
+        moduleList->removeObserver(this);
+    watcher.stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+}
+
+void
+DriftDetector::setUpdateCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    updateCallback = callback;
+}
+
+void
+DriftDetector::setModules(std::shared_ptr<ModuleList> moduleList,
+    const std::string& sourceDirectory)
+{
+    if (moduleList != this->moduleList) {
+        if (this->moduleList)
+            this->moduleList->removeObserver(this);
+        moduleList->addObserver(this);
+        this->moduleList = moduleList;
+    }
+    this->sourceDirectory = sourceDirectory;
+    onModulesReset(ids.size());
+}
+
+bool
+DriftDetector::finishSetup()
+{
+    return watcher.finishSetup();
+}
+
+int
+DriftDetector::getFileDescriptor() const
+{
+    return watcher.getFileDescriptor();
+}
+
+bool
+DriftDetector::readEvents()
+{
+    return watcher.readEvents();
+}
+
+bool
+DriftDetector::hasChanges() const
+{
+    return watcher.hasChanges();
+}
+
+void
+DriftDetector::checkChanges()
+{
+    std::vector<Check> checks;
+    std::unordered_map<ModuleId, size_t> checkIndices;
+    for (const auto& changed : watcher.takeChangedFiles()) {
+        size_t index;
+        if (!moduleList->findModule(changed.module, index))
+            continue;
+        const std::vector<ModuleFile>& files =
+            moduleList->getModule(index).getFiles();
+        if (changed.file >= files.size())
+            continue;
+        auto found = checkIndices.find(changed.module);
+        if (found == checkIndices.end()) {
+            Check check;
+            check.module = changed.module;
+            check.version = versions[changed.module];
+            check.everyFile = false;
+            checks.push_back(check);
+            found = checkIndices.emplace(changed.module, checks.size() - 1)
+                        .first;
+        }
+        Check& check = checks[found->second];
+        check.positions.push_back(changed.file);
+        check.files.push_back(files[changed.file]);
+    }
+    startChecks(std::move(checks));
+}
+
+bool
+DriftDetector::takeResults()
+{
+    std::vector<Check> checks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        checks.swap(finishedChecks);
+    }
+    bool changed = false;
+    for (const auto& check : checks) {
+        auto version = versions.find(check.module);
+        if (version == versions.end() || version->second != check.version)
+            continue;
+        bool wasDrifted = isDrifted(check.module);
+        if (check.everyFile)
+            driftedFiles.erase(check.module);
+        for (size_t i = 0; i < check.positions.size(); i++) {
+            if (check.drifted[i]) {
+                driftedFiles[check.module].insert(check.positions[i]);
+                continue;
+            }
+            auto found = driftedFiles.find(check.module);
+            if (found == driftedFiles.end())
+                continue;
+            found->second.erase(check.positions[i]);
+            if (found->second.empty())
+                driftedFiles.erase(found);
+        }
+        if (isDrifted(check.module) != wasDrifted)
+            changed = true;
+    }
+    return changed;
+}
+
+bool
+DriftDetector::isDrifted(ModuleId id) const
+{
+    return driftedFiles.count(id) > 0;
+}
+
+std::unordered_set<ModuleId>
+DriftDetector::getDriftedModules() const
+{
+    std::unordered_set<ModuleId> drifted;
+    for (const auto& entry : driftedFiles)
+        drifted.insert(entry.first);
+    return drifted;
+}
+
+void
+DriftDetector::onModulesReset(size_t oldCount)
+{
+    ids.clear();
+    for (size_t i = 0; i < moduleList->getModuleCount(); i++)
+        ids.push_back(moduleList->getModuleId(i));
+    /* Drop every comparison that is still running. */
+    versions.clear();
+    for (ModuleId id : ids)
+        versions[id] = nextVersion++;
+    std::vector<Check> checks;
+    std::unordered_map<ModuleId, std::set<size_t>> previous;
+    previous.swap(driftedFiles);
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto found = previous.find(ids[i]);
+        if (found == previous.end())
+            continue;
+        /* Keep it marked until the comparison says otherwise. */
+        driftedFiles.insert(*found);
+        checks.push_back(createModuleCheck(i));
+    }
+    startChecks(std::move(checks));
+    watcher.watchModules(moduleList->getModules(), ids, sourceDirectory);
+}
+
+void
+DriftDetector::onModuleInserted(size_t module)
+{
+    ModuleId id = moduleList->getModuleId(module);
+    ids.insert(ids.begin() + module, id);
+    versions[id] = nextVersion++;
+    watcher.watchModule(id, moduleList->getModule(module));
+}
+
+void
+DriftDetector::onModuleRemoved(size_t module)
+{
+    ModuleId id = ids[module];
+    ids.erase(ids.begin() + module);
+    versions.erase(id);
+    driftedFiles.erase(id);
+    watcher.unwatchModule(id);
+}
+
+void
+DriftDetector::onFileInserted(size_t module, size_t file)
+{
+    updateModule(module);
+}
+
+void
+DriftDetector::onFileRemoved(size_t module, size_t file)
+{
+    updateModule(module);
+}
+
+void
+DriftDetector::onModuleReplaced(size_t module, const Module& previous)
+{
+    if (Module::isSameFiles(
+            previous.getFiles(), moduleList->getModule(module).getFiles()))
+        return;
+    updateModule(module);
+}
+
+void
+DriftDetector::updateModule(size_t index)
+{
+    ModuleId id = ids[index];
+    versions[id] = nextVersion++;
+    watcher.watchModule(id, moduleList->getModule(index));
+    if (isDrifted(id))
+        startChecks(std::vector<Check>{ createModuleCheck(index) });
+}
+
+DriftDetector::Check
+DriftDetector::createModuleCheck(size_t index)
+{
+    Check check;
+    check.module = ids[index];
+    check.version = versions[check.module];
+    check.everyFile = true;
+    check.files = moduleList->getModule(index).getFiles();
+    for (size_t i = 0; i < check.files.size(); i++)
+        check.positions.push_back(i);
+    return check;
+}
+
+void
+DriftDetector::startChecks(std::vector<Check> checks)
+{
+    if (checks.empty())
+        return;
+    std::string directory = sourceDirectory;
+    pool.submit([this, checks, directory]() mutable {
+        for (auto& check : checks) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping)
+                    return;
+            }
+            for (const auto& file : check.files) {
+                check.drifted.push_back(
+                    file.createUpdateAction(directory)->shouldUpdate());
+            }
+        }
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (finishedChecks.empty())
+                callback = updateCallback;
+            for (auto& check : checks)
+                finishedChecks.push_back(std::move(check));
+        }
+        if (callback)
+            callback();
+    });
+}
+
+void
+DriftDetector::notifyUpdate()
+{
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        callback = updateCallback;
+    }
+    if (callback)
+        callback();
+}
+} /* namespace gdfm */
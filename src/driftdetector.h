@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef DRIFT_DETECTOR_H
+#define DRIFT_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "module.h"
+#include "modulelist.h"
+#include "modulewatcher.h"
+#include "threadpool.h"
+
+namespace gdfm {
+
+/*
+ * How many changed destinations are checked one by one before changes count
+ * for the whole directory they are in instead.
+ */
+const size_t DRIFT_QUEUE_LIMIT = 1024;
+
+/*
+ * Notices when installed files are changed by something other than gdfm,
+ * like someone editing them by hand, as it happens instead of at the next
+ * update. The destinations of the modules are watched, and each one that
+ * changes is compared with its source the same way an update would, but
+ * without copying anything. A module has drifted while any of its
+ * destinations doesn't match its source.
+ *
+ * The comparisons and watching every module are done on a thread of its
+ * own. Changes to the list only touch the watches of the modules that
+ * changed, so destinations that changed before then are still checked.
+ *
+ * Everything but the callback is used from one thread.
+ */
+class DriftDetector : public ModuleListObserver {
+public:
+    DriftDetector();
+    ~DriftDetector();
+    DriftDetector(const DriftDetector&) = delete;
+    DriftDetector& operator=(const DriftDetector&) = delete;
+
+    /*
+     * Called on another thread when comparisons finished or the watches are
+     * ready for finishSetup(), once until the results are taken.
+     */
+    void setUpdateCallback(std::function<void()> callback);
+    /*
+     * Starts watching the destinations of the modules in moduleList and
+     * following its changes. Modules that had drifted and are still in the
+     * list are checked again, since where they are installed may be
+     * different. Every destination is watched again on the other thread.
+     */
+    void setModules(std::shared_ptr<ModuleList> moduleList,
+        const std::string& sourceDirectory);
+    /*
+     * Starts using the watches from setModules() once they are ready.
+     *
+     * Returns true if it did, which changes the descriptor, false otherwise.
+     */
+    bool finishSetup();
+    /* Returns a descriptor that is readable when there are events. */
+    int getFileDescriptor() const;
+    /*
+     * Reads the events that are waiting without blocking.
+     *
+     * Returns true on success, false if reading failed.
+     */
+    bool readEvents();
+    bool hasChanges() const;
+    /*
+     * Starts comparing every destination that changed since the last check
+     * with its source.
+     */
+    void checkChanges();
+    /*
+     * Takes the results of the comparisons that finished.
+     *
+     * Returns true if any module started or stopped being drifted.
+     */
+    bool takeResults();
+    bool isDrifted(ModuleId id) const;
+    std::unordered_set<ModuleId> getDriftedModules() const;
+
+    void onModulesReset(size_t oldCount) override;
+    void onModuleInserted(size_t module) override;
+    void onModuleRemoved(size_t module) override;
+    void onFileInserted(size_t module, size_t file) override;
+    void onFileRemoved(size_t module, size_t file) override;
+    void onModuleReplaced(size_t module, const Module& previous) override;
+
+private:
+    /* A comparison of some files of a module with their sources. */
+    struct Check {
+        ModuleId module;
+        /* The version of the module the files are from. */
+        uint64_t version;
+        /* Whether these are all of its files. */
+        bool everyFile;
+        /* The position of each file in the module and the file itself. */
+        std::vector<size_t> positions;
+        std::vector<ModuleFile> files;
+        /* Whether each file doesn't match its source, once checked. */
+        std::vector<bool> drifted;
+    };
+
+    std::shared_ptr<ModuleList> moduleList;
+    std::string sourceDirectory;
+    /* The identifier of each module, parallel to the list. */
+    std::vector<ModuleId> ids;
+    /*
+     * Changed whenever the files of a module are, so comparisons of the
+     * files from before are dropped.
+     */
+    std::unordered_map<ModuleId, uint64_t> versions;
+    uint64_t nextVersion = 1;
+    /* The files that don't match their sources, by module. */
+    std::unordered_map<ModuleId, std::set<size_t>> driftedFiles;
+    /* Uses the pool, which is destroyed first, so it stops first. */
+    ModuleWatcher watcher;
+
+    /* Everything from here to the pool is shared with the thread. */
+    std::mutex mutex;
+    std::vector<Check> finishedChecks;
+    std::function<void()> updateCallback;
+    bool stopping = false;
+    ThreadPool pool;
+
+    /* Watches the module at index again and checks it if it had drifted. */
+    void updateModule(size_t index);
+    /* Returns a check of every file of the module at index. */
+    Check createModuleCheck(size_t index);
+    /* Compares the files of checks on the pool. */
+    void startChecks(std::vector<Check> checks);
+    void notifyUpdate();
+};
+} /* namespace gdfm */
+
+#endif /* DRIFT_DETECTOR_H */
@@ -26,19 +26,99 @@
 
 #include <assert.h>
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <stdlib.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#include <fstream>
+#include <algorithm>
 
-#include "filecheckeditor.h"
+#include "batchio.h"
+#include "bufferpool.h"
 #include "installaction.h"
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
 #include "util.h"
 
 namespace gdfm {
 
+namespace {
+
+/*
+ * Reads exactly size bytes at offset, returning false on errors or if the file
+ * is shorter than expected.
+ */
+bool
+readAt(int descriptor, char* buffer, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t count = pread(descriptor, buffer, size, offset);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        buffer += count;
+        size -= count;
+        offset += count;
+    }
+    return true;
+}
+
+/*
+ * Files are compared line by line, so a file that lacks only its final newline
+ * is considered the same as one that has it. Two files have the same lines if
+ * they are identical or if one is the other followed by a newline, as long as
+ * the shorter one is not empty and does not already end with a newline.
+ */
+bool
+haveSameLines(int source, int destination)
+{
+    struct stat sourceInfo;
+    struct stat destinationInfo;
+    if (fstat(source, &sourceInfo) != 0
+        || fstat(destination, &destinationInfo) != 0)
+        return false;
+    off_t shorterSize = std::min(sourceInfo.st_size, destinationInfo.st_size);
+    off_t longerSize = std::max(sourceInfo.st_size, destinationInfo.st_size);
+    if (longerSize - shorterSize > 1)
+        return false;
+
+    bool isLarge = static_cast<uint64_t>(shorterSize) >= LARGE_FILE_SIZE;
+    size_t chunkSize = isLarge ? LARGE_COPY_BUFFER_SIZE : COPY_BUFFER_SIZE;
+    BufferPool& pool = RunContext::getCurrentBufferPool();
+    chunkSize = std::min(chunkSize, pool.getLargestBufferSize() / 2);
+    chunkSize = std::min<size_t>(chunkSize, std::max<off_t>(shorterSize, 1));
+    BufferPool::Lease buffer = pool.acquire(chunkSize * 2);
+    char* sourceChunk = buffer.getData();
+    char* destinationChunk = sourceChunk + chunkSize;
+    char lastCharacter = '\0';
+    for (off_t offset = 0; offset < shorterSize; offset += chunkSize) {
+        size_t size = std::min<off_t>(chunkSize, shorterSize - offset);
+        if (!readAt(source, sourceChunk, size, offset)
+            || !readAt(destination, destinationChunk, size, offset))
+            return false;
+        if (memcmp(sourceChunk, destinationChunk, size) != 0)
+            return false;
+        lastCharacter = sourceChunk[size - 1];
+    }
+    if (longerSize == shorterSize)
+        return true;
+    if (shorterSize == 0 || lastCharacter == '\n')
+        return false;
+    int longer =
+        (sourceInfo.st_size == longerSize) ? source : destination;
+    char extraCharacter;
+    if (!readAt(longer, &extraCharacter, 1, shorterSize))
+        return false;
+    return extraCharacter == '\n';
+}
+
+} /* namespace */
+
 FileCheckAction::FileCheckAction()
 {
 }
@@ -84,6 +164,19 @@ FileCheckAction::setFiles(
     setDestinationPath(destinationPath);
 }
 
+std::shared_ptr<const TemplateVariables>
+FileCheckAction::getTemplateVariables() const
+{
+    return templateVariables;
+}
+
+void
+FileCheckAction::setTemplateVariables(
+    std::shared_ptr<const TemplateVariables> templateVariables)
+{
+    this->templateVariables = templateVariables;
+}
+
 bool
 FileCheckAction::shouldUpdateRegularFile(
     const std::string& sourcePath, const std::string& destinationPath) const
@@ -92,9 +185,12 @@ FileCheckAction::shouldUpdateRegularFile(
         return false;
     if (sourcePath.length() == 0 || destinationPath.length() == 0)
         return false;
+    PhaseTimer timer(RunStatistics::COMPARE_PHASE);
+    TraceSpan span(
+        "io", "FileCheckAction::shouldUpdateRegularFile", sourcePath);
 
-    std::ifstream sourceReader(sourcePath.c_str());
-    if (!sourceReader.is_open()) {
+    int source = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1) {
         return false;
     }
     /*
@@ -102,44 +198,15 @@ FileCheckAction::shouldUpdateRegularFile(
      * the file it is supposed to be a copy of but not the copied file, meaning
      * it needs to be updated.
      */
-    std::ifstream destinationReader(destinationPath.c_str());
-    if (!destinationReader.is_open()) {
-        sourceReader.close();
+    int destination = open(destinationPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (destination == -1) {
+        close(source);
         return true;
     }
-    std::string sourceLine;
-    std::string destinationLine;
-    bool sourceReadStatus = false;
-    bool destinationReadStatus = false;
-
-    sourceReadStatus = (std::getline(sourceReader, sourceLine)) ? true : false;
-    destinationReadStatus =
-        (std::getline(destinationReader, destinationLine)) ? true : false;
-
-    if (sourceReadStatus != destinationReadStatus) {
-        sourceReader.close();
-        destinationReader.close();
-        return true;
-    }
-    while (sourceReadStatus && destinationReadStatus) {
-        if (sourceLine != destinationLine) {
-            sourceReader.close();
-            destinationReader.close();
-            return true;
-        }
-        sourceReadStatus =
-            (std::getline(sourceReader, sourceLine)) ? true : false;
-        destinationReadStatus =
-            (std::getline(destinationReader, destinationLine)) ? true : false;
-        if (sourceReadStatus != destinationReadStatus) {
-            sourceReader.close();
-            destinationReader.close();
-            return true;
-        }
-    }
-    sourceReader.close();
-    destinationReader.close();
-    return false;
+    bool differs = !haveSameLines(source, destination);
+    close(source);
+    close(destination);
+    return differs;
 }
 
 bool
@@ -149,10 +216,37 @@ FileCheckAction::shouldUpdate() const
         warnx("Missing file to check for updates.");
         return false;
     }
+    if (templateVariables) {
+        return shouldUpdateTemplate(
+            shellExpandPath(sourcePath), shellExpandPath(destinationPath));
+    }
     return shouldUpdateFile(
         shellExpandPath(sourcePath), shellExpandPath(destinationPath));
 }
 
+bool
+FileCheckAction::shouldUpdateTemplate(
+    const std::string& sourcePath, const std::string& destinationPath) const
+{
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (statistics)
+        statistics->addExaminedFile();
+    struct stat sourceInfo;
+    if (stat(sourcePath.c_str(), &sourceInfo) != 0
+        || !S_ISREG(sourceInfo.st_mode))
+        return false;
+    struct stat destinationInfo;
+    if (stat(destinationPath.c_str(), &destinationInfo) != 0
+        || !S_ISREG(destinationInfo.st_mode)
+        || sourceInfo.st_mode != destinationInfo.st_mode)
+        return true;
+    std::shared_ptr<const FileTemplate> fileTemplate =
+        FileTemplate::load(sourcePath);
+    if (!fileTemplate)
+        return false;
+    return !fileTemplate->matchesFile(*templateVariables, destinationPath);
+}
+
 bool
 FileCheckAction::shouldUpdateDirectory(
     const std::string& sourcePath, const std::string& destinationPath) const
@@ -186,7 +280,11 @@ FileCheckAction::shouldUpdateDirectory(
     /*
      * Both lists were sorted using the same algorithm, alphasort, which means
      * that if they contain the same entries they should be in the same order.
+     * The names are all checked first, so the entries can then be compared
+     * in batches.
      */
+    std::vector<std::string> sourceEntryPaths;
+    std::vector<std::string> destinationEntryPaths;
     for (int i = 0; i < sourceCount; i++) {
         struct dirent* sourceEntry = sourceEntries[i];
         struct dirent* destinationEntry = destinationEntries[i];
@@ -201,10 +299,25 @@ FileCheckAction::shouldUpdateDirectory(
             continue;
         if (strcmp(sourceEntry->d_name, destinationEntry->d_name) != 0)
             return true;
-        std::string sourceEntryPath = sourcePath + "/" + sourceEntry->d_name;
-        std::string destinationEntryPath =
-            destinationPath + "/" + destinationEntry->d_name;
-        if (shouldUpdateFile(sourceEntryPath, destinationEntryPath))
+        sourceEntryPaths.push_back(sourcePath + "/" + sourceEntry->d_name);
+        destinationEntryPaths.push_back(
+            destinationPath + "/" + destinationEntry->d_name);
+    }
+    /*
+     * A batch only finds files that are the same byte for byte, so the rest
+     * are compared the usual way.
+     */
+    std::vector<bool> identical(sourceEntryPaths.size(), false);
+    findIdenticalFilesInBatches(
+        sourceEntryPaths, destinationEntryPaths, identical);
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    for (size_t i = 0; i < identical.size(); i++) {
+        if (identical[i]) {
+            if (statistics)
+                statistics->addExaminedFile();
+            continue;
+        }
+        if (shouldUpdateFile(sourceEntryPaths[i], destinationEntryPaths[i]))
             return true;
     }
     return false;
@@ -214,6 +327,9 @@ bool
 FileCheckAction::shouldUpdateFile(
     const std::string& sourcePath, const std::string& destinationPath) const
 {
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (statistics)
+        statistics->addExaminedFile();
     struct stat sourceInfo;
     if (stat(sourcePath.c_str(), &sourceInfo) != 0) {
         return false;
@@ -288,6 +404,7 @@ FileCheckAction::performAction()
         destinationDirectory);
     action.setVerbose(isVerbose());
     action.setInteractive(isInteractive());
+    action.setTemplateVariables(templateVariables);
     return action.performAction();
 }
 
@@ -300,6 +417,12 @@ FileCheckAction::updateName()
     free(sourceCopy);
 }
 
+std::shared_ptr<ModuleAction>
+FileCheckAction::clone() const
+{
+    return std::shared_ptr<ModuleAction>(new FileCheckAction(*this));
+}
+
 std::vector<std::string>
 FileCheckAction::createConfigLines() const
 {
@@ -307,11 +430,4 @@ FileCheckAction::createConfigLines() const
     lines.push_back("remove " + sourcePath + " " + destinationPath);
     return lines;
 }
-
-void
-FileCheckAction::graphicalEdit(Gtk::Window& parent)
-{
-    FileCheckEditor editor(parent, this);
-    editor.run();
-}
 } /* namespace gdfm */
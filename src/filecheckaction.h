@@ -29,6 +29,7 @@
 #include <string>
 #include <vector>
 
+#include "filetemplate.h"
 #include "moduleaction.h"
 
 namespace gdfm {
@@ -46,14 +47,22 @@ public:
 
     void setFiles(
         const std::string& sourcePath, const std::string& destinationPath);
+    /*
+     * The variables the source is filled in with as a template, or nullptr
+     * if it is copied as it is. Templates are compared by what they fill in
+     * to.
+     */
+    std::shared_ptr<const TemplateVariables> getTemplateVariables() const;
+    void setTemplateVariables(
+        std::shared_ptr<const TemplateVariables> templateVariables);
 
     bool performAction() override;
 
     bool shouldUpdate() const;
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     /* Returns if neither path is a zero-length string. */
@@ -65,9 +74,12 @@ private:
         const std::string& destinationPath) const;
     bool shouldUpdateDirectory(const std::string& sourcePath,
         const std::string& destinationPath) const;
+    bool shouldUpdateTemplate(const std::string& sourcePath,
+        const std::string& destinationPath) const;
 
     std::string sourcePath;
     std::string destinationPath;
+    std::shared_ptr<const TemplateVariables> templateVariables;
 };
 } /* namespace 2016 */
 
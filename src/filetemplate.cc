@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "filetemplate.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "bufferpool.h"
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
+#include "util.h"
+
+namespace gdfm {
+
+namespace {
+bool
+isNameCharacter(char character)
+{
+    return (character >= 'a' && character <= 'z')
+        || (character >= 'A' && character <= 'Z')
+        || (character >= '0' && character <= '9') || character == '-'
+        || character == '_' || character == '.';
+}
+
+std::shared_ptr<const FileTemplate>
+readTemplate(const std::string& path)
+{
+    TraceSpan span("io", "readTemplate", path);
+    std::string text;
+    if (!readFileContents(path, text))
+        return std::shared_ptr<const FileTemplate>();
+    return std::make_shared<const FileTemplate>(text);
+}
+} /* namespace */
+
+FileTemplate::FileTemplate(const std::string& text) : text(text)
+{
+    compile();
+}
+
+bool
+FileTemplate::render(const TemplateVariables& variables, const Writer& write,
+    std::string& missingName) const
+{
+    for (const Piece& piece : pieces) {
+        if (!piece.variable) {
+            if (!write(text.data() + piece.begin, piece.length))
+                return false;
+            continue;
+        }
+        std::string name = text.substr(piece.begin, piece.length);
+        auto it = variables.find(name);
+        if (it == variables.end()) {
+            missingName = name;
+            return false;
+        }
+        if (!write(it->second.data(), it->second.size()))
+            return false;
+    }
+    return true;
+}
+
+bool
+FileTemplate::renderToFile(const TemplateVariables& variables,
+    const std::string& path, mode_t mode) const
+{
+    PhaseTimer timer(RunStatistics::COPY_PHASE);
+    TraceSpan span("io", "FileTemplate::renderToFile", path);
+    /* Found before opening the file, so a failure leaves it alone. */
+    std::string missingName;
+    if (!hasVariables(variables, missingName)) {
+        warnx("No variable named %s to fill in %s with.", missingName.c_str(),
+            path.c_str());
+        return false;
+    }
+    if (!ensureParentDirectoriesExist(path))
+        return false;
+    int descriptor =
+        open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (descriptor == -1)
+        return false;
+    /* Pieces are gathered up so small ones don't each take a write. */
+    BufferPool::Lease buffer =
+        RunContext::getCurrentBufferPool().acquire(COPY_BUFFER_SIZE);
+    size_t buffered = 0;
+    uint64_t size = 0;
+    Writer write = [&](const char* data, size_t length) {
+        size += length;
+        if (buffered + length > buffer.getSize()) {
+            if (!writeAll(descriptor, buffer.getData(), buffered))
+                return false;
+            buffered = 0;
+        }
+        if (length >= buffer.getSize())
+            return writeAll(descriptor, data, length);
+        memcpy(buffer.getData() + buffered, data, length);
+        buffered += length;
+        return true;
+    };
+    bool status = render(variables, write, missingName)
+        && writeAll(descriptor, buffer.getData(), buffered)
+        && fchmod(descriptor, mode & 07777) == 0;
+    if (close(descriptor) != 0)
+        status = false;
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (status && statistics)
+        statistics->addCopiedFile(size);
+    return status;
+}
+
+bool
+FileTemplate::matchesFile(
+    const TemplateVariables& variables, const std::string& path) const
+{
+    PhaseTimer timer(RunStatistics::COMPARE_PHASE);
+    TraceSpan span("io", "FileTemplate::matchesFile", path);
+    int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1)
+        return false;
+    BufferPool::Lease buffer =
+        RunContext::getCurrentBufferPool().acquire(COPY_BUFFER_SIZE);
+    size_t available = 0;
+    size_t used = 0;
+    /* Reads more of the file, returning false at its end or on failure. */
+    auto fill = [&]() {
+        ssize_t count;
+        do
+            count = read(descriptor, buffer.getData(), buffer.getSize());
+        while (count == -1 && errno == EINTR);
+        if (count <= 0)
+            return false;
+        available = count;
+        used = 0;
+        return true;
+    };
+    Writer compare = [&](const char* data, size_t length) {
+        while (length > 0) {
+            if (used == available && !fill())
+                return false;
+            size_t count = std::min(length, available - used);
+            if (memcmp(buffer.getData() + used, data, count) != 0)
+                return false;
+            used += count;
+            data += count;
+            length -= count;
+        }
+        return true;
+    };
+    std::string missingName;
+    /* The file must end where the output does, too. */
+    bool matches = render(variables, compare, missingName)
+        && used == available && !fill();
+    close(descriptor);
+    return matches;
+}
+
+std::shared_ptr<const FileTemplate>
+FileTemplate::load(const std::string& path)
+{
+    std::shared_ptr<TemplateCache> cache =
+        RunContext::getCurrentTemplateCache();
+    if (cache)
+        return cache->load(path);
+    return readTemplate(path);
+}
+
+void
+FileTemplate::compile()
+{
+    pieces.clear();
+    std::string::size_type literalBegin = 0;
+    std::string::size_type position = 0;
+    std::string::size_type open;
+    while ((open = text.find("{{", position)) != std::string::npos) {
+        std::string::size_type close = text.find("}}", open + 2);
+        if (close == std::string::npos)
+            break;
+        std::string::size_type nameBegin = open + 2;
+        std::string::size_type nameEnd = close;
+        while (nameBegin < nameEnd && text[nameBegin] == ' ')
+            nameBegin++;
+        while (nameEnd > nameBegin && text[nameEnd - 1] == ' ')
+            nameEnd--;
+        bool isName = nameBegin < nameEnd;
+        for (auto i = nameBegin; isName && i < nameEnd; i++)
+            isName = isNameCharacter(text[i]);
+        /* Try again from the next brace, which may start a placeholder. */
+        if (!isName) {
+            position = open + 1;
+            continue;
+        }
+        if (open > literalBegin)
+            pieces.push_back(Piece{literalBegin, open - literalBegin, false});
+        pieces.push_back(Piece{nameBegin, nameEnd - nameBegin, true});
+        literalBegin = position = close + 2;
+    }
+    if (literalBegin < text.size())
+        pieces.push_back(
+            Piece{literalBegin, text.size() - literalBegin, false});
+}
+
+bool
+FileTemplate::hasVariables(
+    const TemplateVariables& variables, std::string& missingName) const
+{
+    for (const Piece& piece : pieces) {
+        if (!piece.variable)
+            continue;
+        std::string name = text.substr(piece.begin, piece.length);
+        if (variables.count(name) == 0) {
+            missingName = name;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const FileTemplate>
+TemplateCache::load(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return std::shared_ptr<const FileTemplate>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end() && it->second.device == info.st_dev
+            && it->second.inode == info.st_ino
+            && it->second.size == info.st_size
+            && it->second.modified.tv_sec == info.st_mtim.tv_sec
+            && it->second.modified.tv_nsec == info.st_mtim.tv_nsec)
+            return it->second.fileTemplate;
+    }
+    /*
+     * Reading is done without the lock, so two threads may both read a new
+     * template, but neither waits on the other's file.
+     */
+    std::shared_ptr<const FileTemplate> fileTemplate = readTemplate(path);
+    if (!fileTemplate)
+        return fileTemplate;
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[path] = Entry{info.st_dev, info.st_ino, info.st_size,
+        info.st_mtim, fileTemplate};
+    return fileTemplate;
+}
+} /* namespace gdfm */
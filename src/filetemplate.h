@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FILE_TEMPLATE_H
+#define FILE_TEMPLATE_H
+
+#include <sys/stat.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gdfm {
+
+/* The values a template can use, by name. */
+typedef std::map<std::string, std::string> TemplateVariables;
+
+/*
+ * A file whose contents have {{name}} placeholders, filled in with variables
+ * from the config file when it is installed. Spaces are allowed inside the
+ * braces. Braces around anything that isn't a name are left as they are.
+ *
+ * The file is split into the text between placeholders and their names once,
+ * so rendering it only has to write, and the output goes straight to where
+ * it is needed without ever being built up as a whole.
+ */
+class FileTemplate {
+public:
+    /* Called with each piece of output in order. Returns false to stop. */
+    typedef std::function<bool(const char* data, size_t size)> Writer;
+
+    FileTemplate(const std::string& text);
+
+    /*
+     * Passes the output for variables to write, piece by piece.
+     *
+     * Returns true on success. Returns false if write did, or if a variable
+     * is missing, setting missingName to its name.
+     */
+    bool render(const TemplateVariables& variables, const Writer& write,
+        std::string& missingName) const;
+    /*
+     * Writes the output for variables to the file at path, replacing its
+     * contents and giving it the permissions in mode. Warns about missing
+     * variables.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool renderToFile(const TemplateVariables& variables,
+        const std::string& path, mode_t mode) const;
+    /*
+     * Returns true if the file at path has exactly the output for variables,
+     * reading it alongside rendering rather than writing the output
+     * anywhere. Returns false if it doesn't or if it can't be read.
+     */
+    bool matchesFile(
+        const TemplateVariables& variables, const std::string& path) const;
+
+    /*
+     * Returns the template in the file at path, or nullptr if it can't be
+     * read. During a run, each file is only read and split up once.
+     */
+    static std::shared_ptr<const FileTemplate> load(const std::string& path);
+
+private:
+    /* Literal text, or the name of a variable if variable is set. */
+    struct Piece {
+        std::string::size_type begin;
+        std::string::size_type length;
+        bool variable;
+    };
+
+    std::string text;
+    std::vector<Piece> pieces;
+
+    void compile();
+    /*
+     * Returns true if every placeholder has a variable, setting missingName
+     * to the first one that doesn't otherwise.
+     */
+    bool hasVariables(
+        const TemplateVariables& variables, std::string& missingName) const;
+};
+
+/*
+ * The templates that have been loaded during a run, so each is only read
+ * once however many times it is installed or checked. A template is read
+ * again if its file changes. Safe to use from several threads.
+ */
+class TemplateCache {
+public:
+    /* Same as FileTemplate::load(), using the cache. */
+    std::shared_ptr<const FileTemplate> load(const std::string& path);
+
+private:
+    struct Entry {
+        dev_t device;
+        ino_t inode;
+        off_t size;
+        struct timespec modified;
+        std::shared_ptr<const FileTemplate> fileTemplate;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
+} /* namespace gdfm */
+
+#endif /* FILE_TEMPLATE_H */
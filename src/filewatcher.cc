@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "filewatcher.h"
+
+#include "config.h"
+
+#include <sys/stat.h>
+/* Watching is only supported on Linux. */
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+namespace gdfm {
+
+namespace {
+#ifdef HAVE_SYS_INOTIFY_H
+/* Everything that could mean a watched file's contents are different. */
+const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE
+    | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+#endif
+
+/* Splits path into the directory it is in and its name there. */
+void
+splitPath(const std::string& path, std::string& directory, std::string& name)
+{
+    std::string::size_type end = path.find_last_not_of('/');
+    std::string::size_type slash = path.rfind('/', end);
+    if (end == std::string::npos || slash == std::string::npos) {
+        directory = ".";
+        name = path;
+        return;
+    }
+    directory = (slash == 0) ? "/" : path.substr(0, slash);
+    name = path.substr(slash + 1, end - slash);
+}
+} /* namespace */
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool
+FileWatcher::watch(const std::vector<Module>& modules,
+    const std::string& sourceDirectory, WatchedPaths paths)
+{
+    if (!start(sourceDirectory, paths))
+        return false;
+    for (const auto& module : modules)
+        addModule(module);
+    return true;
+}
+
+bool
+FileWatcher::start(const std::string& sourceDirectory, WatchedPaths paths)
+{
+    stop();
+#ifdef HAVE_SYS_INOTIFY_H
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    errno = ENOSYS;
+#endif
+    if (inotifyDescriptor == -1) {
+        warn("Failed to start watching files");
+        return false;
+    }
+    this->sourceDirectory = sourceDirectory;
+    watchedPaths = paths;
+    return true;
+}
+
+size_t
+FileWatcher::addModule(const Module& module)
+{
+    size_t position;
+    if (!freeModules.empty()) {
+        position = freeModules.back();
+        freeModules.pop_back();
+        modules[position] = module;
+    } else {
+        position = modules.size();
+        modules.push_back(module);
+        moduleFiles.emplace_back();
+    }
+    addModuleWatches(position);
+    return position;
+}
+
+void
+FileWatcher::replaceModule(size_t position, const Module& module)
+{
+    removeModuleWatches(position);
+    modules[position] = module;
+    addModuleWatches(position);
+}
+
+void
+FileWatcher::removeModule(size_t position)
+{
+    removeModuleWatches(position);
+    modules[position] = Module();
+    freeModules.push_back(position);
+}
+
+void
+FileWatcher::stop()
+{
+    if (inotifyDescriptor != -1)
+        close(inotifyDescriptor);
+    inotifyDescriptor = -1;
+    modules.clear();
+    moduleFiles.clear();
+    files.clear();
+    freeModules.clear();
+    freeFiles.clear();
+    targets.clear();
+    directories.clear();
+    changedFiles.clear();
+    changedDirectories.clear();
+}
+
+bool
+FileWatcher::isWatching() const
+{
+    return inotifyDescriptor != -1;
+}
+
+int
+FileWatcher::getFileDescriptor() const
+{
+    return inotifyDescriptor;
+}
+
+size_t
+FileWatcher::getWatchCount() const
+{
+    return directories.size();
+}
+
+void
+FileWatcher::setQueueLimit(size_t limit)
+{
+    queueLimit = limit;
+}
+
+bool
+FileWatcher::readEvents()
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (inotifyDescriptor == -1)
+        return false;
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(inotifyDescriptor, buffer, sizeof(buffer));
+        if (length == -1 && errno == EINTR)
+            continue;
+        if (length == -1 && errno == EAGAIN)
+            return true;
+        if (length <= 0) {
+            warn("Failed to read file events");
+            return false;
+        }
+        for (char* position = buffer; position < buffer + length;) {
+            const struct inotify_event* event =
+                reinterpret_cast<const struct inotify_event*>(position);
+            handleEvent(event->wd, event->mask,
+                (event->len > 0) ? event->name : nullptr);
+            position += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+bool
+FileWatcher::hasChanges() const
+{
+    return !changedFiles.empty() || !changedDirectories.empty();
+}
+
+bool
+FileWatcher::waitForChanges(int quietMilliseconds)
+{
+    if (inotifyDescriptor == -1)
+        return false;
+    struct pollfd pollInfo;
+    pollInfo.fd = inotifyDescriptor;
+    pollInfo.events = POLLIN;
+    /* Wait forever for the first change, then until things are quiet. */
+    for (;;) {
+        int timeout = hasChanges() ? quietMilliseconds : -1;
+        int ready = poll(&pollInfo, 1, timeout);
+        if (ready == -1 && errno == EINTR)
+            continue;
+        if (ready == -1) {
+            warn("Failed to wait for file events");
+            return false;
+        }
+        if (ready == 0)
+            return true;
+        if (!readEvents())
+            return false;
+    }
+}
+
+std::vector<Module>
+FileWatcher::takeChangedModules()
+{
+    /* Keep the modules in order, each with its files in order. */
+    std::map<size_t, Module> changedModules;
+    for (const FileLocation& location : takeChangedFiles()) {
+        const Module& module = modules[location.module];
+        auto changed = changedModules.find(location.module);
+        if (changed == changedModules.end())
+            changed = changedModules
+                          .insert(std::make_pair(
+                              location.module, Module(module.getName())))
+                          .first;
+        changed->second.getFiles().push_back(
+            module.getFiles()[location.file]);
+    }
+    std::vector<Module> result;
+    for (auto& changed : changedModules)
+        result.push_back(changed.second);
+    return result;
+}
+
+std::vector<FileWatcher::FileLocation>
+FileWatcher::takeChangedFiles()
+{
+    /* Everything a directory past the limit was watched for is checked. */
+    for (int descriptor : changedDirectories) {
+        auto found = targets.find(descriptor);
+        if (found == targets.end())
+            continue;
+        for (const Target& target : found->second)
+            changedFiles.insert(target.file);
+    }
+    changedDirectories.clear();
+    std::vector<FileLocation> result;
+    for (size_t file : changedFiles)
+        result.push_back(files[file].location);
+    changedFiles.clear();
+    return result;
+}
+
+bool
+FileWatcher::addWatch(const std::string& directory, const Target& target)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    int descriptor = inotify_add_watch(
+        inotifyDescriptor, directory.c_str(), WATCH_EVENTS | IN_ONLYDIR);
+#else
+    int descriptor = -1;
+    errno = ENOSYS;
+#endif
+    if (descriptor == -1) {
+        if (target.source)
+            warn("Failed to watch %s", directory.c_str());
+        return false;
+    }
+    /* Watching the same directory again gives the same descriptor. */
+    targets[descriptor].push_back(target);
+    directories[descriptor] = directory;
+    files[target.file].descriptors.push_back(descriptor);
+    return true;
+}
+
+void
+FileWatcher::addModuleWatches(size_t position)
+{
+    if (inotifyDescriptor == -1)
+        return;
+    const Module& module = modules[position];
+    for (size_t i = 0; i < module.getFiles().size(); i++) {
+        size_t file;
+        if (!freeFiles.empty()) {
+            file = freeFiles.back();
+            freeFiles.pop_back();
+        } else {
+            file = files.size();
+            files.emplace_back();
+        }
+        files[file].location = FileLocation{ position, i };
+        moduleFiles[position].push_back(file);
+        const ModuleFile& moduleFile = module.getFiles()[i];
+        if (watchedPaths & SOURCE_PATHS)
+            addPathWatches(
+                moduleFile.getSourcePath(sourceDirectory), file, true);
+        if (watchedPaths & DESTINATION_PATHS)
+            addPathWatches(moduleFile.getDestinationPath(), file, false);
+    }
+}
+
+void
+FileWatcher::removeModuleWatches(size_t position)
+{
+    for (size_t file : moduleFiles[position]) {
+        for (int descriptor : files[file].descriptors)
+            removeTarget(descriptor, file);
+        files[file].descriptors.clear();
+        changedFiles.erase(file);
+        freeFiles.push_back(file);
+    }
+    moduleFiles[position].clear();
+}
+
+void
+FileWatcher::removeTarget(int descriptor, size_t file)
+{
+    auto found = targets.find(descriptor);
+    if (found == targets.end())
+        return;
+    std::vector<Target>& fileTargets = found->second;
+    fileTargets.erase(std::remove_if(fileTargets.begin(), fileTargets.end(),
+                          [file](const Target& target) {
+                              return target.file == file;
+                          }),
+        fileTargets.end());
+    if (!fileTargets.empty())
+        return;
+#ifdef HAVE_SYS_INOTIFY_H
+    /* The directory may already be gone, which ended the watch. */
+    inotify_rm_watch(inotifyDescriptor, descriptor);
+#endif
+    targets.erase(found);
+    directories.erase(descriptor);
+    changedDirectories.erase(descriptor);
+}
+
+void
+FileWatcher::addPathWatches(
+    const std::string& path, size_t file, bool source)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        addTreeWatches(path, file, source);
+        return;
+    }
+    std::string directory;
+    Target target;
+    target.file = file;
+    target.source = source;
+    splitPath(path, directory, target.name);
+    addWatch(directory, target);
+}
+
+void
+FileWatcher::addTreeWatches(
+    const std::string& directory, size_t file, bool source)
+{
+    Target target;
+    target.file = file;
+    target.source = source;
+    if (!addWatch(directory, target))
+        return;
+    DIR* stream = opendir(directory.c_str());
+    if (!stream)
+        return;
+    while (struct dirent* entry = readdir(stream)) {
+        if (strcmp(entry->d_name, ".") == 0
+            || strcmp(entry->d_name, "..") == 0)
+            continue;
+        std::string path = directory + "/" + entry->d_name;
+        bool isDirectory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat info;
+            isDirectory = lstat(path.c_str(), &info) == 0
+                && S_ISDIR(info.st_mode);
+        }
+        if (isDirectory)
+            addTreeWatches(path, file, source);
+    }
+    closedir(stream);
+}
+
+void
+FileWatcher::handleEvent(int descriptor, uint32_t mask, const char* name)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (mask & IN_Q_OVERFLOW) {
+        /* Events were lost, so anything could have changed. */
+        for (const auto& positions : moduleFiles)
+            changedFiles.insert(positions.begin(), positions.end());
+        return;
+    }
+    auto found = targets.find(descriptor);
+    if (found == targets.end())
+        return;
+    if (mask & IN_IGNORED) {
+        /* The directory is gone or unmounted. */
+        targets.erase(found);
+        directories.erase(descriptor);
+        return;
+    }
+    bool newDirectory =
+        (mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO)) && name;
+    std::vector<Target> trees;
+    for (const Target& target : found->second) {
+        if (target.name.empty()) {
+            addChangedFile(target.file, descriptor);
+            if (newDirectory)
+                trees.push_back(target);
+        } else if (name && target.name == name)
+            addChangedFile(target.file, descriptor);
+    }
+    /* Watching changes targets, so it has to wait until after the loop. */
+    if (!trees.empty()) {
+        std::string path = directories[descriptor] + "/" + name;
+        for (const Target& tree : trees)
+            addTreeWatches(path, tree.file, tree.source);
+    }
+#endif
+}
+
+void
+FileWatcher::addChangedFile(size_t file, int descriptor)
+{
+    if (queueLimit == 0 || changedFiles.size() < queueLimit
+        || changedFiles.count(file) > 0)
+        changedFiles.insert(file);
+    else
+        changedDirectories.insert(descriptor);
+}
+} /* namespace gdfm */
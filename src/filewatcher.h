@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "module.h"
+
+namespace gdfm {
+
+/*
+ * How long nothing has to change before the changed files are updated, in
+ * milliseconds, so that an editor saving or a checkout touching many files
+ * only causes one update.
+ */
+const int WATCH_QUIET_MILLISECONDS = 100;
+
+/*
+ * Watches the source files of modules, or where they are installed, with
+ * inotify and works out which of them changed, so that only those files have
+ * to be checked instead of every module.
+ *
+ * A file is watched through the directory it is in, since editors often
+ * save by replacing the file, which would end a watch on the file itself. A
+ * file that is a directory is watched along with everything under it, and
+ * directories created in it later are watched as they appear.
+ *
+ * The changes waiting to be taken can be limited. Past the limit, a change
+ * counts for the whole directory it happened in, so memory stays bounded
+ * and only the files in those directories have to be checked again. If the
+ * kernel drops events because too many came at once, every file counts as
+ * changed.
+ */
+class FileWatcher {
+public:
+    /* Which paths of each file are watched. */
+    enum WatchedPaths {
+        SOURCE_PATHS = 1,
+        DESTINATION_PATHS = 2,
+        ALL_PATHS = SOURCE_PATHS | DESTINATION_PATHS
+    };
+
+    /* A file of one of the watched modules, by position. */
+    struct FileLocation {
+        size_t module;
+        size_t file;
+    };
+
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /*
+     * Stops watching what was watched before and starts watching the given
+     * paths of every file of modules. Sources whose directories can't be
+     * watched are warned about and skipped. Destinations are skipped
+     * quietly, since modules that aren't installed often don't have them.
+     *
+     * Returns true on success, false if inotify couldn't be used at all.
+     */
+    bool watch(const std::vector<Module>& modules,
+        const std::string& sourceDirectory,
+        WatchedPaths paths = SOURCE_PATHS);
+    /*
+     * Stops watching what was watched before and starts watching no modules,
+     * so they can be added one at a time.
+     *
+     * Returns true on success, false if inotify couldn't be used at all.
+     */
+    bool start(
+        const std::string& sourceDirectory, WatchedPaths paths = SOURCE_PATHS);
+    /*
+     * Watches the files of module as well as the ones watched already.
+     *
+     * Returns the position of module in FileLocation, which may be that of a
+     * module that was removed.
+     */
+    size_t addModule(const Module& module);
+    /*
+     * Watches the files of module instead of those of the module at
+     * position, forgetting their changes. Watches that other modules need
+     * are kept.
+     */
+    void replaceModule(size_t position, const Module& module);
+    /* Stops watching the files of the module at position. */
+    void removeModule(size_t position);
+    void stop();
+    bool isWatching() const;
+    /*
+     * Returns a descriptor that is readable when there are events to read,
+     * for use with poll() or a main loop, or -1 if nothing is watched.
+     */
+    int getFileDescriptor() const;
+    /* Returns how many directories are watched. */
+    size_t getWatchCount() const;
+    /*
+     * Sets how many changed files are kept track of one by one, with 0,
+     * the default, meaning no limit.
+     */
+    void setQueueLimit(size_t limit);
+
+    /*
+     * Reads every event that is waiting without blocking and remembers which
+     * files they affect.
+     *
+     * Returns true on success, false if reading failed.
+     */
+    bool readEvents();
+    bool hasChanges() const;
+    /*
+     * Blocks until a file changes and then nothing else changes for
+     * quietMilliseconds.
+     *
+     * Returns true once there are changes, false if waiting failed.
+     */
+    bool waitForChanges(int quietMilliseconds);
+    /*
+     * Returns a copy of each module that has files that changed, holding
+     * only those files and no actions, so updating them only checks what
+     * changed. The changes are forgotten.
+     */
+    std::vector<Module> takeChangedModules();
+    /*
+     * Returns where each file that changed is in the watched modules, in
+     * order. The changes are forgotten.
+     */
+    std::vector<FileLocation> takeChangedFiles();
+
+private:
+    /* What an event in a watched directory could mean. */
+    struct Target {
+        size_t file;
+        /* The name of the file in the directory, or empty for any entry. */
+        std::string name;
+        /* Whether this is the source of the file rather than where it goes. */
+        bool source;
+    };
+
+    /* What is kept for each watched file, by the index targets use. */
+    struct WatchedFile {
+        FileLocation location;
+        /* The directories watched for the file, which may repeat. */
+        std::vector<int> descriptors;
+    };
+
+    int inotifyDescriptor = -1;
+    size_t queueLimit = 0;
+    std::string sourceDirectory;
+    WatchedPaths watchedPaths = SOURCE_PATHS;
+    std::vector<Module> modules;
+    /* The index in files of each file of each module. */
+    std::vector<std::vector<size_t>> moduleFiles;
+    std::vector<WatchedFile> files;
+    /* Positions of removed modules and files, for reuse. */
+    std::vector<size_t> freeModules;
+    std::vector<size_t> freeFiles;
+    std::unordered_map<int, std::vector<Target>> targets;
+    /* The path of each watched directory, for watching new directories. */
+    std::unordered_map<int, std::string> directories;
+    std::set<size_t> changedFiles;
+    /* Directories with changes past the limit, by watch descriptor. */
+    std::set<int> changedDirectories;
+
+    /*
+     * Watches directory for the given target.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool addWatch(const std::string& directory, const Target& target);
+    /* Watches every file of the module at position. */
+    void addModuleWatches(size_t position);
+    /* Stops watching the files of the module at position. */
+    void removeModuleWatches(size_t position);
+    /*
+     * Forgets that the directory with descriptor is watched for file, and
+     * stops watching it if nothing else needs it.
+     */
+    void removeTarget(int descriptor, size_t file);
+    /* Watches path, which is a file or a whole tree, for file. */
+    void addPathWatches(const std::string& path, size_t file, bool source);
+    /* Watches directory and every directory under it for file. */
+    void addTreeWatches(
+        const std::string& directory, size_t file, bool source);
+    void handleEvent(int descriptor, uint32_t mask, const char* name);
+    /* Remembers that file changed because of an event in a directory. */
+    void addChangedFile(size_t file, int descriptor);
+};
+} /* namespace gdfm */
+
+#endif /* FILE_WATCHER_H */
@@ -31,12 +31,16 @@
 
 #include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
 
 #include "configfilereader.h"
 #include "configfilewriter.h"
 #include "createmoduledialog.h"
+#include "graphicaledit.h"
 #include "moduleactioneditor.h"
 #include "modulefileeditor.h"
+#include "runsummarydialog.h"
 #include "util.h"
 
 namespace gdfm {
@@ -50,10 +54,30 @@ GdfmWindow::GdfmWindow(
     initModulesView();
     connectSignals();
     updateVisibleButtons();
+    startStatusChecks();
+    startDriftDetection();
 }
 
 GdfmWindow::~GdfmWindow()
 {
+    moduleList->removeObserver(this);
+    stopWatching();
+    driftEventsConnection.disconnect();
+    driftQuietConnection.disconnect();
+    statusEventsConnection.disconnect();
+    statusQuietConnection.disconnect();
+    modulesModel->setStatusCache(nullptr);
+    fileQuietConnection.disconnect();
+    if (reloadThread.joinable())
+        reloadThread.join();
+    /*
+     * The worker thread uses this window's members, so let it stop at the
+     * next action and wait for it before they go away.
+     */
+    if (runThread.joinable()) {
+        runner->cancel();
+        runThread.join();
+    }
 }
 
 void
@@ -64,8 +88,15 @@ GdfmWindow::initChildren()
     builder->get_widget("install_all_button", installAllModulesButton);
     builder->get_widget("uninstall_all_button", uninstallAllModulesButton);
     builder->get_widget("update_all_button", updateAllModuleButton);
+    builder->get_widget("watch_button", watchButton);
     builder->get_widget("move_up_button", moveUpButton);
     builder->get_widget("move_down_button", moveDownButton);
+    builder->get_widget("run_box", runBox);
+    builder->get_widget("output_view", outputView);
+    builder->get_widget("run_progress_bar", runProgressBar);
+    builder->get_widget("cancel_run_button", cancelRunButton);
+    builder->get_widget("run_summary_button", runSummaryButton);
+    builder->get_widget("search_entry", searchEntry);
 }
 
 void
@@ -83,12 +114,38 @@ GdfmWindow::connectSignals()
         sigc::mem_fun(*this, &GdfmWindow::onUninstallAllModulesButtonClicked));
     updateAllModuleButton->signal_clicked().connect(
         sigc::mem_fun(*this, &GdfmWindow::onUpdateAllModulesButtonClicked));
+    watchButton->signal_toggled().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onWatchButtonToggled));
     moveUpButton->signal_clicked().connect(
         sigc::mem_fun(*this, &GdfmWindow::onMoveUpButtonClicked));
     moveDownButton->signal_clicked().connect(
         sigc::mem_fun(*this, &GdfmWindow::onMoveDownButtonClicked));
     modulesSelection->signal_changed().connect(
         sigc::mem_fun(*this, &GdfmWindow::onModulesSelectionChanged));
+    cancelRunButton->signal_clicked().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onCancelRunButtonClicked));
+    runSummaryButton->signal_clicked().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onRunSummaryButtonClicked));
+    searchEntry->signal_search_changed().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onSearchChanged));
+    progressDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onRunProgress));
+    outputDispatcher.connect(sigc::mem_fun(*this, &GdfmWindow::onRunOutput));
+    runFinishedDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onRunFinished));
+    statusDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onStatusUpdated));
+    statusCache.setUpdateCallback([this]() { statusDispatcher.emit(); });
+    watchDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onWatchUpdated));
+    watcher.setReadyCallback([this]() { watchDispatcher.emit(); });
+    driftDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onDriftUpdated));
+    driftDetector.setUpdateCallback([this]() { driftDispatcher.emit(); });
+    reloadDispatcher.connect(
+        sigc::mem_fun(*this, &GdfmWindow::onReloadFinished));
+    modulesView->get_vadjustment()->signal_value_changed().connect(
+        sigc::mem_fun(*this, &GdfmWindow::prioritizeVisibleModules));
 }
 
 void
@@ -101,6 +158,9 @@ GdfmWindow::addActions()
     this->add_action("save", sigc::mem_fun(*this, &GdfmWindow::onActionSave));
     this->add_action(
         "save-as", sigc::mem_fun(*this, &GdfmWindow::onActionSaveAs));
+    this->add_action("undo", sigc::mem_fun(*this, &GdfmWindow::onActionUndo));
+    this->add_action("redo", sigc::mem_fun(*this, &GdfmWindow::onActionRedo));
+    this->add_action("find", sigc::mem_fun(*this, &GdfmWindow::onActionFind));
     this->add_action("quit", sigc::mem_fun(*this, &GdfmWindow::onActionQuit));
     this->add_action(
         "about", sigc::mem_fun(*this, &GdfmWindow::onActionAbout));
@@ -109,78 +169,40 @@ GdfmWindow::addActions()
 void
 GdfmWindow::initModulesView()
 {
-    columns.add(moduleNameColumn);
-    columns.add(actionNameColumn);
-    columns.add(fileColumn);
-    columns.add(rowTypeColumn);
-    columns.add(moduleColumn);
-    columns.add(moduleFileColumn);
-    columns.add(actionColumn);
-    modulesStore = Gtk::TreeStore::create(columns);
-    modulesView->set_model(modulesStore);
-    modulesView->append_column("Module", moduleNameColumn);
-    modulesView->append_column("Files", fileColumn);
-    modulesView->append_column("Actions", actionNameColumn);
+    moduleList = std::make_shared<ModuleList>();
+    modulesModel = ModulesTreeModel::create(moduleList);
+    searchIndex.reset(new ModuleSearchIndex(moduleList));
+    moduleList->addObserver(this);
+    modulesModel->setStatusCache(&statusCache);
+    modulesView->set_model(modulesModel);
+    modulesView->append_column("Module", modulesModel->getModuleNameColumn());
+    modulesView->append_column("Status", modulesModel->getStatusColumn());
+    modulesView->append_column("Files", modulesModel->getFileColumn());
+    modulesView->append_column(
+        "Actions", modulesModel->getActionNameColumn());
+    modulesView->append_column("Drift", modulesModel->getDriftColumn());
 
     modulesSelection = modulesView->get_selection();
     modulesSelection->set_mode(Gtk::SELECTION_SINGLE);
 }
 
-std::vector<Module>
-GdfmWindow::createModulesFromView() const
+bool
+GdfmWindow::getRowLocation(const Gtk::TreeRowReference& row,
+    ModulesTreeModel::Location& location) const
 {
-    std::vector<Module> newModules;
-    for (const auto moduleRow : modulesStore->children())
-        newModules.push_back(createModuleForRow(moduleRow));
-    return newModules;
+    if (!row.is_valid())
+        return false;
+    return modulesModel->getLocation(
+        modulesModel->get_iter(row.get_path()), location);
 }
 
 Module
-GdfmWindow::createModuleForRow(const Gtk::TreeRow& row) const
-{
-    std::shared_ptr<Module> storedModule = row[moduleColumn];
-    Module newModule;
-    newModule.setName(storedModule->getName());
-    Gtk::TreeIter childIter = row.children().begin();
-    if (childIter == row.children().end())
-        return newModule;
-    Gtk::TreeRow childRow = *childIter;
-    while (childRow[rowTypeColumn] != MODULE_TYPE_ROW) {
-        std::shared_ptr<ModuleFile> file = childRow[moduleFileColumn];
-        newModule.addFile(file->getFilename(), file->getDestinationDirectory(),
-            file->getDestinationFilename());
-        childIter++;
-        childRow = *childIter;
-        if (childIter == row.children().end())
-            return newModule;
-    }
-    /*
-     * At this point it the code, the iterator is guaranteed to be a module
-     * type row.
-     */
-    if (childRow[moduleNameColumn] == "Install") {
-        for (const auto& actionIter : childRow.children()) {
-            Gtk::TreeRow actionRow = *actionIter;
-            newModule.addInstallAction(actionRow[actionColumn]);
-        }
-        childIter++;
-        childRow = *childIter;
-    }
-    if (childRow[moduleNameColumn] == "Uninstall") {
-        for (const auto& actionIter : childRow.children()) {
-            Gtk::TreeRow actionRow = *actionIter;
-            newModule.addUninstallAction(actionRow[actionColumn]);
-        }
-        childIter++;
-        childRow = *childIter;
-    }
-    if (childRow[moduleNameColumn] == "Update") {
-        for (const auto& actionIter : childRow.children()) {
-            Gtk::TreeRow actionRow = *actionIter;
-            newModule.addUpdateAction(actionRow[actionColumn]);
-        }
-    }
-    return newModule;
+GdfmWindow::createModuleForRow(const Gtk::TreeIter& iter) const
+{
+    ModulesTreeModel::Location location;
+    if (!modulesModel->getLocation(iter, location))
+        return Module();
+    return moduleList->getModule(location.module);
 }
 
 bool
@@ -195,10 +217,16 @@ GdfmWindow::loadFile(const std::string& path)
         dialog.run();
         return false;
     }
-    for (auto &module : modules)
-        module.setParent(this);
     currentFilePath = path;
-    setModulesViewFromModules(modules);
+    /* Opening a file replaces whatever was being edited before. */
+    moduleList->setModules(modules);
+    startStatusChecks();
+    startDriftDetection();
+    if (watcher.isWatching())
+        startWatching();
+    createConfigFileLayout(
+        path, reader.getModuleSpans(), *moduleList, configLayout);
+    watchCurrentFile();
     return true;
 }
 
@@ -218,83 +246,10 @@ GdfmWindow::loadDirectory(const std::string& path)
     return true;
 }
 
-void
-GdfmWindow::setModulesViewFromModules(const std::vector<Module>& modules)
-{
-    for (const auto& module : modules) {
-        appendModule(module);
-    }
-}
-
 void
 GdfmWindow::appendModule(const Module& module)
 {
-    Gtk::TreeModel::iterator topIter = modulesStore->append();
-    Gtk::TreeModel::Row topRow = *topIter;
-    topRow[moduleNameColumn] = module.getName();
-    topRow[moduleColumn] = std::shared_ptr<Module>(new Module(module));
-    topRow[rowTypeColumn] = MODULE_ROW;
-
-    for (const auto& file : module.getFiles()) {
-        Gtk::TreeIter fileIter = modulesStore->append(topRow.children());
-        Gtk::TreeRow fileRow = *fileIter;
-        fileRow[fileColumn] = file.getFilename();
-        fileRow[moduleFileColumn] =
-            std::shared_ptr<ModuleFile>(new ModuleFile(file));
-        fileRow[rowTypeColumn] = MODULE_FILE_ROW;
-    }
-
-    const std::vector<std::shared_ptr<ModuleAction>> installActions =
-        module.getInstallActions();
-    if (installActions.size() > 0) {
-        Gtk::TreeModel::iterator typeIter =
-            modulesStore->append(topRow.children());
-        Gtk::TreeModel::Row typeRow = *typeIter;
-        typeRow[moduleNameColumn] = "Install";
-        typeRow[rowTypeColumn] = MODULE_TYPE_ROW;
-        for (const auto& action : installActions) {
-            Gtk::TreeModel::iterator actionIter =
-                modulesStore->append(typeRow.children());
-            Gtk::TreeModel::Row actionRow = *actionIter;
-            actionRow[actionNameColumn] = action->getName();
-            actionRow[actionColumn] = action;
-            actionRow[rowTypeColumn] = MODULE_ACTION_ROW;
-        }
-    }
-    const std::vector<std::shared_ptr<ModuleAction>> uninstallActions =
-        module.getUninstallActions();
-    if (uninstallActions.size() > 0) {
-        Gtk::TreeModel::iterator typeIter =
-            modulesStore->append(topRow.children());
-        Gtk::TreeModel::Row typeRow = *typeIter;
-        typeRow[moduleNameColumn] = "Uninstall";
-        typeRow[rowTypeColumn] = MODULE_TYPE_ROW;
-        for (const auto& action : uninstallActions) {
-            Gtk::TreeModel::iterator actionIter =
-                modulesStore->append(typeRow.children());
-            Gtk::TreeModel::Row actionRow = *actionIter;
-            actionRow[actionNameColumn] = action->getName();
-            actionRow[actionColumn] = action;
-            actionRow[rowTypeColumn] = MODULE_ACTION_ROW;
-        }
-    }
-    const std::vector<std::shared_ptr<ModuleAction>> updateActions =
-        module.getUpdateActions();
-    if (updateActions.size() > 0) {
-        Gtk::TreeModel::iterator typeIter =
-            modulesStore->append(topRow.children());
-        Gtk::TreeModel::Row typeRow = *typeIter;
-        typeRow[moduleNameColumn] = "Update";
-        typeRow[rowTypeColumn] = MODULE_TYPE_ROW;
-        for (const auto& action : updateActions) {
-            Gtk::TreeModel::iterator actionIter =
-                modulesStore->append(typeRow.children());
-            Gtk::TreeModel::Row actionRow = *actionIter;
-            actionRow[actionNameColumn] = action->getName();
-            actionRow[actionColumn] = action;
-            actionRow[rowTypeColumn] = MODULE_ACTION_ROW;
-        }
-    }
+    moduleList->appendModule(module);
 }
 
 void
@@ -348,7 +303,6 @@ GdfmWindow::onActionOpenDirectory()
 void
 GdfmWindow::onActionSave()
 {
-    std::vector<Module> modules = createModulesFromView();
     std::string outputFile = currentFilePath;
     if (outputFile.length() == 0) {
         Gtk::FileChooserDialog dialog(
@@ -364,26 +318,12 @@ GdfmWindow::onActionSave()
         else
             return;
     }
-    ConfigFileWriter writer(outputFile, modules);
-    if (!writer.isOpen()) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to open file " + outputFile + ".", false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dialog.run();
-    }
-    bool status = writer.writeModules();
-    if (!status) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to write to file " + outputFile + ".", false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dialog.run();
-    }
+    saveToFile(outputFile);
 }
 
 void
 GdfmWindow::onActionSaveAs()
 {
-    std::vector<Module> modules = createModulesFromView();
     Gtk::FileChooserDialog dialog(
         *this, "Save As", Gtk::FILE_CHOOSER_ACTION_SAVE);
     dialog.set_select_multiple(false);
@@ -395,20 +335,55 @@ GdfmWindow::onActionSaveAs()
     if (response != Gtk::RESPONSE_OK)
         return;
     std::string outputFile = dialog.get_filename();
-    ConfigFileWriter writer(outputFile, modules);
-    if (!writer.isOpen()) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to open file " + outputFile + ".", false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dialog.run();
-    }
-    bool status = writer.writeModules();
+    saveToFile(outputFile);
+}
+
+bool
+GdfmWindow::saveToFile(const std::string& path)
+{
+    ConfigFileWriter writer(path);
+    bool status;
+    if (path == currentFilePath)
+        status = writer.writeChangedModules(*moduleList, configLayout);
+    else
+        status = writer.writeModules(*moduleList, configLayout);
     if (!status) {
         Gtk::MessageDialog dialog(*this,
-            "Failed to write to file " + outputFile + ".", false,
+            "Failed to write to file " + path + ".", false,
             Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
         dialog.run();
+        return false;
+    }
+    moduleList->markSaved();
+    if (path != currentFilePath) {
+        currentFilePath = path;
+        watchCurrentFile();
+        startStatusChecks();
+        startDriftDetection();
+        if (watcher.isWatching())
+            startWatching();
     }
+    return true;
+}
+
+void
+GdfmWindow::onActionUndo()
+{
+    if (!isRunning())
+        moduleList->undo();
+}
+
+void
+GdfmWindow::onActionRedo()
+{
+    if (!isRunning())
+        moduleList->redo();
+}
+
+void
+GdfmWindow::onActionFind()
+{
+    searchEntry->grab_focus();
 }
 
 void
@@ -438,20 +413,19 @@ void
 GdfmWindow::onModulesViewRowActivated(
     const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* column)
 {
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow row = *iter;
-    RowType type = row[rowTypeColumn];
+    ModulesTreeModel::Location location;
+    if (!modulesModel->getLocation(modulesModel->get_iter(path), location))
+        return;
+    /* Edit a copy so the change can be undone. */
+    Module module = moduleList->getModule(location.module).clone();
     /* I could use a switch statement here, but changing it wasn't worth it. */
-    if (type == MODULE_ACTION_ROW) {
-        std::shared_ptr<ModuleAction> action = row[actionColumn];
-        action->graphicalEdit(*this);
-        /* This is just in case the action name changed. */
-        row[actionNameColumn] = action->getName();
-    } else if (type == MODULE_FILE_ROW) {
-        std::shared_ptr<ModuleFile> file = row[moduleFileColumn];
-        file->graphicalEdit(*this);
-        /* This is also just in case the name changed. */
-        row[fileColumn] = file->getFilename();
+    if (location.type == ModulesTreeModel::MODULE_ACTION_ROW) {
+        graphicalEdit(
+            *this, *module.getActions(location.actionType)[location.index]);
+        moduleList->replaceModule(location.module, module);
+    } else if (location.type == ModulesTreeModel::MODULE_FILE_ROW) {
+        graphicalEdit(*this, module.getFiles()[location.index]);
+        moduleList->replaceModule(location.module, module);
     }
 }
 
@@ -488,10 +462,12 @@ GdfmWindow::onModulesViewButtonPressEvent(GdkEventButton* button)
             sigc::mem_fun(*this, &GdfmWindow::onAddModuleItemActivated));
         menu->append(*addModuleItem);
     } else {
-        Gtk::TreeIter selectedIter = modulesStore->get_iter(selectedPath);
-        Gtk::TreeRow selectedRow = *selectedIter;
-        Gtk::TreeRowReference selectedRowReference(modulesStore, selectedPath);
-        RowType type = selectedRow[rowTypeColumn];
+        Gtk::TreeIter selectedIter = modulesModel->get_iter(selectedPath);
+        if (!modulesModel->isValidIter(selectedIter))
+            return;
+        Gtk::TreeRowReference selectedRowReference(modulesModel, selectedPath);
+        ModulesTreeModel::RowType type =
+            modulesModel->getRowType(selectedIter);
         auto addMenuItem = [this, &menu, &selectedRowReference](
             const std::string& name,
             const sigc::slot<void, Gtk::TreeRowReference>& slot) {
@@ -500,7 +476,7 @@ GdfmWindow::onModulesViewButtonPressEvent(GdkEventButton* button)
                 sigc::bind<Gtk::TreeRowReference>(slot, selectedRowReference));
             menu->append(*item);
         };
-        if (type == MODULE_ROW) {
+        if (type == ModulesTreeModel::MODULE_ROW) {
             addMenuItem("Edit",
                 sigc::mem_fun(*this, &GdfmWindow::onModuleEditItemActivated));
             addMenuItem(
@@ -527,14 +503,14 @@ GdfmWindow::onModulesViewButtonPressEvent(GdkEventButton* button)
             addMenuItem(
                 "Update", sigc::mem_fun(*this,
                               &GdfmWindow::onModuleUpdateItemActivated));
-        } else if (type == MODULE_FILE_ROW) {
+        } else if (type == ModulesTreeModel::MODULE_FILE_ROW) {
             addMenuItem(
                 "Edit", sigc::mem_fun(*this,
                             &GdfmWindow::onModuleFileEditItemActivated));
             addMenuItem(
                 "Remove", sigc::mem_fun(*this,
                               &GdfmWindow::onModuleFileRemoveItemActivated));
-        } else if (type == MODULE_ACTION_ROW) {
+        } else if (type == ModulesTreeModel::MODULE_ACTION_ROW) {
             addMenuItem(
                 "Edit", sigc::mem_fun(*this,
                             &GdfmWindow::onModuleActionEditItemActivated));
@@ -568,256 +544,105 @@ GdfmWindow::onModuleEditItemActivated(Gtk::TreeRowReference row)
 void
 GdfmWindow::onModuleRemoveItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
+    ModulesTreeModel::Location location;
+    if (!getRowLocation(row, location))
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    modulesStore->erase(iter);
+    moduleList->removeModule(location.module);
 }
 
 void
 GdfmWindow::onModuleAddFileItemActivated(Gtk::TreeRowReference row)
 {
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow referencedRow = *iter;
-
-    ModuleFile* file = new ModuleFile();
-    ModuleFileEditor editor(*this, file);
+    if (!row.is_valid())
+        return;
+    ModuleFile file;
+    ModuleFileEditor editor(*this, &file);
     int response = editor.run();
-    if (response != Gtk::RESPONSE_OK) {
-        delete file;
+    ModulesTreeModel::Location location;
+    if (response != Gtk::RESPONSE_OK || !getRowLocation(row, location))
         return;
-    }
-    for (auto childIter = referencedRow.children().begin();
-         childIter != referencedRow.children().end(); childIter++) {
-        Gtk::TreeRow childRow = *childIter;
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW) {
-            Gtk::TreeIter newIter = modulesStore->insert(childIter);
-            Gtk::TreeRow newRow = *newIter;
-            newRow[fileColumn] = file->getFilename();
-            newRow[moduleFileColumn] = std::shared_ptr<ModuleFile>(file);
-            newRow[rowTypeColumn] = MODULE_FILE_ROW;
-            return;
-        }
-    }
-    Gtk::TreeIter newIter = modulesStore->append(referencedRow.children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[fileColumn] = file->getFilename();
-    newRow[moduleFileColumn] = std::shared_ptr<ModuleFile>(file);
-    newRow[rowTypeColumn] = MODULE_FILE_ROW;
+    moduleList->addFile(location.module, file);
 }
 
 void
 GdfmWindow::onModuleAddInstallActionItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
-        return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow referencedRow = *iter;
-
-    ModuleActionEditor editor(*this);
-    int response = editor.run();
-    if (response != Gtk::RESPONSE_OK)
-        return;
-    std::shared_ptr<ModuleAction> action = editor.getAction();
-    if (!action)
-        return;
-    Gtk::TreeRowReference installRow = getInstallRow(referencedRow);
-    Gtk::TreePath installPath = installRow.get_path();
-    Gtk::TreeIter installIter = modulesStore->get_iter(installPath);
-    Gtk::TreeIter newIter = modulesStore->append(installIter->children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[actionNameColumn] = action->getName();
-    newRow[actionColumn] = action;
-    newRow[rowTypeColumn] = MODULE_ACTION_ROW;
+    addActionToModule(row, Module::INSTALL_ACTIONS);
 }
 
 void
 GdfmWindow::onModuleAddUninstallActionItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
-        return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow referencedRow = *iter;
-
-    ModuleActionEditor editor(*this);
-    int response = editor.run();
-    if (response != Gtk::RESPONSE_OK)
-        return;
-    std::shared_ptr<ModuleAction> action = editor.getAction();
-    if (!action)
-        return;
-    Gtk::TreeRowReference uninstallRow = getUninstallRow(referencedRow);
-    Gtk::TreePath uninstallPath = uninstallRow.get_path();
-    Gtk::TreeIter uninstallIter = modulesStore->get_iter(uninstallPath);
-    Gtk::TreeIter newIter = modulesStore->append(uninstallIter->children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[actionNameColumn] = action->getName();
-    newRow[actionColumn] = action;
-    newRow[rowTypeColumn] = MODULE_ACTION_ROW;
+    addActionToModule(row, Module::UNINSTALL_ACTIONS);
 }
 
 void
 GdfmWindow::onModuleAddUpdateActionItemActivated(Gtk::TreeRowReference row)
+{
+    addActionToModule(row, Module::UPDATE_ACTIONS);
+}
+
+void
+GdfmWindow::addActionToModule(
+    Gtk::TreeRowReference row, Module::ActionType type)
 {
     if (!row.is_valid())
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow referencedRow = *iter;
-
     ModuleActionEditor editor(*this);
     int response = editor.run();
-    if (response != Gtk::RESPONSE_OK)
+    ModulesTreeModel::Location location;
+    if (response != Gtk::RESPONSE_OK || !getRowLocation(row, location))
         return;
     std::shared_ptr<ModuleAction> action = editor.getAction();
     if (!action)
         return;
-    Gtk::TreeRowReference updateRow = getUpdateRow(referencedRow);
-    Gtk::TreePath updatePath = updateRow.get_path();
-    Gtk::TreeIter updateIter = modulesStore->get_iter(updatePath);
-    Gtk::TreeIter newIter = modulesStore->append(updateIter->children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[actionNameColumn] = action->getName();
-    newRow[actionColumn] = action;
-    newRow[rowTypeColumn] = MODULE_ACTION_ROW;
+    moduleList->addAction(location.module, type, action);
 }
 
 void
 GdfmWindow::onModuleFileEditItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
+    ModulesTreeModel::Location location;
+    if (!getRowLocation(row, location)
+        || location.type != ModulesTreeModel::MODULE_FILE_ROW)
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow selectedRow = *iter;
-    std::shared_ptr<ModuleFile> file = selectedRow[moduleFileColumn];
-    if (file)
-        file->graphicalEdit(*this);
+    Module module = moduleList->getModule(location.module).clone();
+    graphicalEdit(*this, module.getFiles()[location.index]);
+    moduleList->replaceModule(location.module, module);
 }
 
 void
 GdfmWindow::onModuleFileRemoveItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
+    ModulesTreeModel::Location location;
+    if (!getRowLocation(row, location)
+        || location.type != ModulesTreeModel::MODULE_FILE_ROW)
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    modulesStore->erase(iter);
+    moduleList->removeFile(location.module, location.index);
 }
 
 void
 GdfmWindow::onModuleActionEditItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
+    ModulesTreeModel::Location location;
+    if (!getRowLocation(row, location)
+        || location.type != ModulesTreeModel::MODULE_ACTION_ROW)
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreeRow selectedRow = *iter;
-    std::shared_ptr<ModuleAction> action = selectedRow[actionColumn];
-    if (action)
-        action->graphicalEdit(*this);
+    Module module = moduleList->getModule(location.module).clone();
+    graphicalEdit(
+        *this, *module.getActions(location.actionType)[location.index]);
+    moduleList->replaceModule(location.module, module);
 }
 
 void
 GdfmWindow::onModuleActionRemoveItemActivated(Gtk::TreeRowReference row)
 {
-    if (!row.is_valid())
+    ModulesTreeModel::Location location;
+    if (!getRowLocation(row, location)
+        || location.type != ModulesTreeModel::MODULE_ACTION_ROW)
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Gtk::TreePath parentPath = modulesStore->get_path(iter->parent());
-    modulesStore->erase(iter);
-    Gtk::TreeIter parentIter = modulesStore->get_iter(parentPath);
-    if (parentIter->children().size() == 0)
-        modulesStore->erase(parentIter);
-}
-
-Gtk::TreeRowReference
-GdfmWindow::getInstallRow(const Gtk::TreeRow& moduleRow)
-{
-    if (moduleRow[rowTypeColumn] != MODULE_ROW)
-        return Gtk::TreeRowReference();
-    for (auto iter = moduleRow.children().begin();
-         iter != moduleRow.children().end(); iter++) {
-        Gtk::TreeRow childRow = *iter;
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW
-            && childRow[moduleNameColumn] == "Install") {
-            return Gtk::TreeRowReference(
-                modulesStore, modulesStore->get_path(iter));
-        }
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW
-            && childRow[moduleNameColumn] != "Uninstall") {
-            Gtk::TreeIter newIter = modulesStore->insert(iter);
-            Gtk::TreeRow newRow = *newIter;
-            newRow[moduleNameColumn] = "Install";
-            newRow[rowTypeColumn] = MODULE_TYPE_ROW;
-            return Gtk::TreeRowReference(
-                modulesStore, modulesStore->get_path(newIter));
-        }
-    }
-    Gtk::TreeIter newIter = modulesStore->append(moduleRow.children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[moduleNameColumn] = "Install";
-    newRow[rowTypeColumn] = MODULE_TYPE_ROW;
-    return Gtk::TreeRowReference(
-        modulesStore, modulesStore->get_path(newIter));
-}
-
-Gtk::TreeRowReference
-GdfmWindow::getUninstallRow(const Gtk::TreeRow& moduleRow)
-{
-    if (moduleRow[rowTypeColumn] != MODULE_ROW)
-        return Gtk::TreeRowReference();
-    for (auto iter = moduleRow.children().begin();
-         iter != moduleRow.children().end(); iter++) {
-        Gtk::TreeRow childRow = *iter;
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW
-            && childRow[moduleNameColumn] == "Uninstall") {
-            return Gtk::TreeRowReference(
-                modulesStore, modulesStore->get_path(iter));
-        }
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW
-            && childRow[moduleNameColumn] == "Update") {
-            Gtk::TreeIter newIter = modulesStore->insert(iter);
-            Gtk::TreeRow newRow = *newIter;
-            newRow[moduleNameColumn] = "Uninstall";
-            newRow[rowTypeColumn] = MODULE_TYPE_ROW;
-            return Gtk::TreeRowReference(
-                modulesStore, modulesStore->get_path(newIter));
-        }
-    }
-    Gtk::TreeIter newIter = modulesStore->append(moduleRow.children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[moduleNameColumn] = "Uninstall";
-    newRow[rowTypeColumn] = MODULE_TYPE_ROW;
-    return Gtk::TreeRowReference(
-        modulesStore, modulesStore->get_path(newIter));
-}
-
-Gtk::TreeRowReference
-GdfmWindow::getUpdateRow(const Gtk::TreeRow& moduleRow)
-{
-    if (moduleRow[rowTypeColumn] != MODULE_ROW)
-        return Gtk::TreeRowReference();
-    for (auto iter = moduleRow.children().begin();
-         iter != moduleRow.children().end(); iter++) {
-        Gtk::TreeRow childRow = *iter;
-        if (childRow[rowTypeColumn] == MODULE_TYPE_ROW
-            && childRow[moduleNameColumn] == "Update") {
-            return Gtk::TreeRowReference(
-                modulesStore, modulesStore->get_path(iter));
-        }
-    }
-    Gtk::TreeIter newIter = modulesStore->append(moduleRow.children());
-    Gtk::TreeRow newRow = *newIter;
-    newRow[moduleNameColumn] = "Update";
-    newRow[rowTypeColumn] = MODULE_TYPE_ROW;
-    return Gtk::TreeRowReference(
-        modulesStore, modulesStore->get_path(newIter));
+    moduleList->removeAction(
+        location.module, location.actionType, location.index);
 }
 
 void
@@ -825,12 +650,7 @@ GdfmWindow::onInstallAllModulesButtonClicked()
 {
     if (!promptContinueIfNoDirectory())
         return;
-    std::vector<Module> modules = createModulesFromView();
-    std::string sourceDirectory = getSourceDirectory();
-    for (const auto& module : modules) {
-        if (!installModuleWithPopups(module, sourceDirectory))
-            return;
-    }
+    startRun(ModuleRunner::INSTALL_OPERATION, moduleList->getModules());
 }
 
 void
@@ -838,12 +658,7 @@ GdfmWindow::onUninstallAllModulesButtonClicked()
 {
     if (!promptContinueIfNoDirectory())
         return;
-    std::vector<Module> modules = createModulesFromView();
-    std::string sourceDirectory = getSourceDirectory();
-    for (const auto& module : modules) {
-        if (!uninstallModuleWithPopups(module, sourceDirectory))
-            return;
-    }
+    startRun(ModuleRunner::UNINSTALL_OPERATION, moduleList->getModules());
 }
 
 void
@@ -851,12 +666,7 @@ GdfmWindow::onUpdateAllModulesButtonClicked()
 {
     if (!promptContinueIfNoDirectory())
         return;
-    std::vector<Module> modules = createModulesFromView();
-    std::string sourceDirectory = getSourceDirectory();
-    for (const auto& module : modules) {
-        if (!updateModuleWithPopups(module, sourceDirectory))
-            return;
-    }
+    startRun(ModuleRunner::UPDATE_OPERATION, moduleList->getModules());
 }
 
 std::string
@@ -889,10 +699,12 @@ GdfmWindow::onModuleInstallItemActivated(Gtk::TreeRowReference row)
 {
     if (!promptContinueIfNoDirectory())
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Module module = createModuleForRow(*iter);
-    installModuleWithPopups(module, getSourceDirectory());
+    if (!row.is_valid())
+        return;
+    std::vector<Module> modules;
+    modules.push_back(
+        createModuleForRow(modulesModel->get_iter(row.get_path())));
+    startRun(ModuleRunner::INSTALL_OPERATION, modules);
 }
 
 void
@@ -900,10 +712,12 @@ GdfmWindow::onModuleUninstallItemActivated(Gtk::TreeRowReference row)
 {
     if (!promptContinueIfNoDirectory())
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Module module = createModuleForRow(*iter);
-    uninstallModuleWithPopups(module, getSourceDirectory());
+    if (!row.is_valid())
+        return;
+    std::vector<Module> modules;
+    modules.push_back(
+        createModuleForRow(modulesModel->get_iter(row.get_path())));
+    startRun(ModuleRunner::UNINSTALL_OPERATION, modules);
 }
 
 void
@@ -911,52 +725,170 @@ GdfmWindow::onModuleUpdateItemActivated(Gtk::TreeRowReference row)
 {
     if (!promptContinueIfNoDirectory())
         return;
-    Gtk::TreePath path = row.get_path();
-    Gtk::TreeIter iter = modulesStore->get_iter(path);
-    Module module = createModuleForRow(*iter);
-    updateModuleWithPopups(module, getSourceDirectory());
+    if (!row.is_valid())
+        return;
+    std::vector<Module> modules;
+    modules.push_back(
+        createModuleForRow(modulesModel->get_iter(row.get_path())));
+    startRun(ModuleRunner::UPDATE_OPERATION, modules);
 }
 
 bool
-GdfmWindow::installModuleWithPopups(
-    const Module& module, const std::string& sourceDirectory)
+GdfmWindow::isRunning() const
 {
-    bool status = module.install(sourceDirectory);
-    if (!status) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to install module " + module.getName(), false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dialog.run();
-    }
-    return status;
+    return runThread.joinable();
 }
 
-bool
-GdfmWindow::uninstallModuleWithPopups(
-    const Module& module, const std::string& sourceDirectory)
+void
+GdfmWindow::startRun(
+    ModuleRunner::Operation operation, const std::vector<Module>& modules)
 {
-    bool status = module.uninstall(sourceDirectory);
-    if (!status) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to uninstall module " + module.getName(), false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
-        dialog.run();
+    if (isRunning())
+        return;
+    runModules = modules;
+    runOutput = std::make_shared<QueuedOutputSink>();
+    runOutput->setNotifyHandler([this]() { outputDispatcher.emit(); });
+    runner.reset(new ModuleRunner(operation, getSourceDirectory()));
+    runner->setOutputSink(runOutput);
+    runner->getStatistics().setProgressHandler(
+        [this]() { progressDispatcher.emit(); });
+    outputView->get_buffer()->set_text("");
+    runProgressBar->set_fraction(0);
+    std::string operationName = ModuleRunner::getOperationName(operation);
+    runProgressBar->set_text("Starting to " + operationName);
+    setRunning(true);
+    runThread = std::thread([this]() {
+        runStatus = runner->run(runModules);
+        runFinishedDispatcher.emit();
+    });
+}
+
+void
+GdfmWindow::setRunning(bool running)
+{
+    if (running)
+        runBox->show();
+    cancelRunButton->set_sensitive(running);
+    runSummaryButton->set_sensitive(!running);
+    modulesView->set_sensitive(!running);
+    addModuleButton->set_sensitive(!running);
+    installAllModulesButton->set_sensitive(!running);
+    uninstallAllModulesButton->set_sensitive(!running);
+    updateAllModuleButton->set_sensitive(!running);
+    moveUpButton->set_sensitive(!running);
+    moveDownButton->set_sensitive(!running);
+    /* The run still refers to the modules and directory that are open. */
+    lookup_simple_action("open-file")->set_enabled(!running);
+    lookup_simple_action("open-directory")->set_enabled(!running);
+}
+
+void
+GdfmWindow::onCancelRunButtonClicked()
+{
+    if (!isRunning())
+        return;
+    runner->cancel();
+    cancelRunButton->set_sensitive(false);
+    runProgressBar->set_text("Cancelling after the current action");
+}
+
+void
+GdfmWindow::onRunSummaryButtonClicked()
+{
+    if (!runner || isRunning())
+        return;
+    RunSummaryDialog dialog(*this, runner->getStatistics());
+    dialog.run();
+}
+
+void
+GdfmWindow::onRunProgress()
+{
+    /* Progress can still arrive after the run is over. */
+    if (!runner || runner->wasCancelled())
+        return;
+    const RunStatistics& statistics = runner->getStatistics();
+    std::ostringstream text;
+    text.precision(1);
+    text << std::fixed << statistics.getFinishedActions() << " of "
+         << statistics.getTotalActions() << " actions, "
+         << statistics.getFilesPerSecond() << " files/s, "
+         << formatByteCount(statistics.getBytesPerSecond()) << "/s";
+    runProgressBar->set_fraction(statistics.getFractionFinished());
+    runProgressBar->set_text(text.str());
+}
+
+void
+GdfmWindow::onRunOutput()
+{
+    if (!runOutput)
+        return;
+    Glib::RefPtr<Gtk::TextBuffer> buffer = outputView->get_buffer();
+    for (const auto& line : runOutput->takeLines()) {
+        std::string text;
+        if (line.source.length() > 0)
+            text = "[" + line.source + "] ";
+        text += line.text + "\n";
+        buffer->insert(buffer->end(), text);
     }
-    return status;
+    int extraLines = buffer->get_line_count() - MAX_OUTPUT_VIEW_LINES;
+    if (extraLines > 0)
+        buffer->erase(buffer->begin(), buffer->get_iter_at_line(extraLines));
+    outputView->scroll_to(buffer->get_insert());
 }
 
-bool
-GdfmWindow::updateModuleWithPopups(
-    const Module& module, const std::string& sourceDirectory)
+void
+GdfmWindow::onRunFinished()
 {
-    bool status = module.update(sourceDirectory);
-    if (!status) {
-        Gtk::MessageDialog dialog(*this,
-            "Failed to update module " + module.getName(), false,
-            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+    if (!isRunning())
+        return;
+    runThread.join();
+    onRunOutput();
+    onRunProgress();
+    if (runner->wasCancelled())
+        runProgressBar->set_text("Cancelled");
+    else if (runStatus)
+        runProgressBar->set_text("Finished, " + runProgressBar->get_text());
+    setRunning(false);
+    /*
+     * Check what the run did. Changes while it ran were put off, and
+     * directories it created can only be watched now.
+     */
+    std::unordered_set<std::string> runNames;
+    for (const auto& module : runModules)
+        runNames.insert(module.getName());
+    startStatusChecks();
+    startDriftDetection();
+    std::vector<ModuleId> ranModules;
+    for (size_t i = 0; i < moduleList->getModuleCount(); i++) {
+        if (runNames.count(moduleList->getModule(i).getName()) > 0)
+            ranModules.push_back(moduleList->getModuleId(i));
+    }
+    statusCache.invalidate(ranModules);
+
+    /*
+     * Messages from the modules are held until now so that they don't stop
+     * the run while waiting to be closed.
+     */
+    for (const auto& message : runOutput->takeMessages()) {
+        Gtk::MessageDialog dialog(*this, message.text, false,
+            Gtk::MESSAGE_INFO, Gtk::BUTTONS_OK, true);
+        dialog.set_title(message.source);
         dialog.run();
     }
-    return status;
+    ModuleRunner::Operation operation = runner->getOperation();
+    for (const auto& module : runner->getFailedModules()) {
+        std::string message = std::string("Failed to ")
+            + ModuleRunner::getOperationName(operation) + " module "
+            + module.name;
+        Gtk::MessageDialog dialog(*this, message, false, Gtk::MESSAGE_ERROR,
+            Gtk::BUTTONS_OK, true);
+        /* What the command printed last usually says what went wrong. */
+        if (!module.output.empty())
+            dialog.set_secondary_text(module.output);
+        dialog.run();
+    }
+    runModules.clear();
 }
 
 void
@@ -969,55 +901,395 @@ void
 GdfmWindow::updateVisibleButtons()
 {
     Gtk::TreeIter selectedIter = modulesSelection->get_selected();
-    bool visibility = true;
-    if (!modulesStore->iter_is_valid(selectedIter))
-        visibility = false;
-    else {
-        Gtk::TreeRow selectedRow = *selectedIter;
-        visibility = selectedRow[rowTypeColumn] == MODULE_ACTION_ROW;
-    }
+    bool visibility = modulesModel->isValidIter(selectedIter)
+        && modulesModel->getRowType(selectedIter)
+            == ModulesTreeModel::MODULE_ACTION_ROW;
     moveUpButton->set_visible(visibility);
     moveDownButton->set_visible(visibility);
 }
 
 void
-GdfmWindow::onMoveUpButtonClicked()
+GdfmWindow::updateSearch()
 {
-    Gtk::TreeIter selectedIter = modulesSelection->get_selected();
-    if (!modulesStore->iter_is_valid(selectedIter))
+    std::string query = searchEntry->get_text();
+    if (query.find_first_not_of(" \t") == std::string::npos)
+        modulesModel->clearFilter();
+    else
+        modulesModel->setVisibleModules(searchIndex->search(query));
+}
+
+void
+GdfmWindow::onModulesChanged()
+{
+    if (changesPending)
         return;
-    Gtk::TreeRow selectedRow = *selectedIter;
-    if (selectedRow[rowTypeColumn] != MODULE_ACTION_ROW)
+    /* Wait until the idle loop, since this may be one of many changes. */
+    changesPending = true;
+    Glib::signal_idle().connect_once(
+        sigc::mem_fun(*this, &GdfmWindow::onModulesChangedIdle));
+}
+
+void
+GdfmWindow::onModulesChangedIdle()
+{
+    changesPending = false;
+    updateSearch();
+    /* The detector forgets the modules that were removed. */
+    modulesModel->setDriftedModules(driftDetector.getDriftedModules());
+    prioritizeVisibleModules();
+}
+
+void
+GdfmWindow::startWatching()
+{
+    watcher.setModules(moduleList, getSourceDirectory());
+}
+
+void
+GdfmWindow::stopWatching()
+{
+    watchEventsConnection.disconnect();
+    watchQuietConnection.disconnect();
+    watcher.stop();
+}
+
+void
+GdfmWindow::onWatchButtonToggled()
+{
+    if (!watchButton->get_active()) {
+        stopWatching();
         return;
-    Gtk::TreePath startPath = modulesStore->get_path(selectedIter);
-    Gtk::TreePath endPath = startPath;
-    if (!endPath.prev())
+    }
+    if (!promptContinueIfNoDirectory()) {
+        watchButton->set_active(false);
         return;
-    modulesStore->move(
-        modulesStore->get_iter(startPath), modulesStore->get_iter(endPath));
+    }
+    startWatching();
+}
+
+bool
+GdfmWindow::onWatchEvents(Glib::IOCondition condition)
+{
+    if (!watcher.readEvents()) {
+        watchButton->set_active(false);
+        return false;
+    }
+    if (watcher.hasChanges()) {
+        /* Start waiting over, so a burst of events causes one update. */
+        watchQuietConnection.disconnect();
+        watchQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onWatchQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+    return true;
+}
+
+bool
+GdfmWindow::onWatchQuiet()
+{
+    if (isRunning())
+        return true;
+    startRun(ModuleRunner::UPDATE_OPERATION, watcher.takeChangedModules());
+    return false;
 }
 
 void
-GdfmWindow::onMoveDownButtonClicked()
+GdfmWindow::onWatchUpdated()
 {
-    Gtk::TreeIter selectedIter = modulesSelection->get_selected();
-    if (!modulesStore->iter_is_valid(selectedIter))
-        return;
-    Gtk::TreeRow selectedRow = *selectedIter;
-    if (selectedRow[rowTypeColumn] != MODULE_ACTION_ROW)
+    if (!watcher.finishSetup())
         return;
-    Gtk::TreePath startPath = modulesStore->get_path(selectedIter);
-    Gtk::TreePath endPath = startPath;
-    endPath.next();
-    Gtk::TreeIter endIter = modulesStore->get_iter(endPath);
-    if (!modulesStore->iter_is_valid(endIter))
+    watchEventsConnection.disconnect();
+    if (watcher.getFileDescriptor() == -1) {
+        watchButton->set_active(false);
+        Gtk::MessageDialog dialog(*this, "Failed to watch the files.", false,
+            Gtk::MESSAGE_ERROR, Gtk::BUTTONS_OK, true);
+        dialog.run();
         return;
+    }
+    watchEventsConnection = Glib::signal_io().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onWatchEvents),
+        watcher.getFileDescriptor(), Glib::IO_IN);
+    /* The old watches may have seen changes that weren't updated yet. */
+    if (watcher.hasChanges() && !watchQuietConnection.connected()) {
+        watchQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onWatchQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+}
+
+void
+GdfmWindow::startDriftDetection()
+{
+    driftDetector.setModules(moduleList, getSourceDirectory());
+}
+
+void
+GdfmWindow::watchDriftEvents()
+{
+    driftEventsConnection.disconnect();
     /*
-     * I wanted to use a move function here, and I have before when using GTK+.
-     * However, the C api has a move_after function which I used for move
-     * functions like these but I don't think gtkmm has it. Since it's only
-     * moving one row, though, a swap works.
+     * Not being able to watch the destinations only means changes to them
+     * aren't noticed, so there's no need to bother the user about it.
      */
-    modulesStore->iter_swap(modulesStore->get_iter(startPath), endIter);
+    if (driftDetector.getFileDescriptor() == -1)
+        return;
+    driftEventsConnection = Glib::signal_io().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onDriftEvents),
+        driftDetector.getFileDescriptor(), Glib::IO_IN);
+    /* The old watches may have seen changes that weren't checked yet. */
+    if (driftDetector.hasChanges() && !driftQuietConnection.connected()) {
+        driftQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onDriftQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+}
+
+bool
+GdfmWindow::onDriftEvents(Glib::IOCondition condition)
+{
+    if (!driftDetector.readEvents())
+        return false;
+    if (driftDetector.hasChanges()) {
+        driftQuietConnection.disconnect();
+        driftQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onDriftQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+    return true;
+}
+
+bool
+GdfmWindow::onDriftQuiet()
+{
+    /* Files being installed are only half written until the run is over. */
+    if (isRunning())
+        return true;
+    driftDetector.checkChanges();
+    return false;
+}
+
+void
+GdfmWindow::onDriftUpdated()
+{
+    if (driftDetector.finishSetup())
+        watchDriftEvents();
+    if (driftDetector.takeResults())
+        modulesModel->setDriftedModules(driftDetector.getDriftedModules());
+}
+
+void
+GdfmWindow::startStatusChecks()
+{
+    statusCache.setModules(moduleList, getSourceDirectory());
+    prioritizeVisibleModules();
+}
+
+void
+GdfmWindow::watchStatusEvents()
+{
+    statusEventsConnection.disconnect();
+    if (statusCache.getFileDescriptor() == -1)
+        return;
+    statusEventsConnection = Glib::signal_io().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onStatusEvents),
+        statusCache.getFileDescriptor(), Glib::IO_IN);
+    /* The old watches may have seen changes that weren't checked yet. */
+    if (statusCache.hasChanges() && !statusQuietConnection.connected()) {
+        statusQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onStatusQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+}
+
+void
+GdfmWindow::prioritizeVisibleModules()
+{
+    Gtk::TreeModel::Path start;
+    Gtk::TreeModel::Path end;
+    if (!modulesView->get_visible_range(start, end))
+        return;
+    std::vector<ModuleId> visible;
+    for (int row = start[0]; row <= end[0]; row++) {
+        Gtk::TreeModel::Path path;
+        path.push_back(row);
+        ModulesTreeModel::Location location;
+        if (modulesModel->getLocation(modulesModel->get_iter(path), location))
+            visible.push_back(moduleList->getModuleId(location.module));
+    }
+    statusCache.prioritize(visible);
+}
+
+bool
+GdfmWindow::onStatusEvents(Glib::IOCondition condition)
+{
+    if (!statusCache.readEvents())
+        return false;
+    if (statusCache.hasChanges()) {
+        statusQuietConnection.disconnect();
+        statusQuietConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &GdfmWindow::onStatusQuiet),
+            WATCH_QUIET_MILLISECONDS);
+    }
+    return true;
+}
+
+bool
+GdfmWindow::onStatusQuiet()
+{
+    if (isRunning())
+        return true;
+    statusCache.invalidateChanges();
+    prioritizeVisibleModules();
+    return false;
+}
+
+void
+GdfmWindow::onStatusUpdated()
+{
+    if (statusCache.finishSetup())
+        watchStatusEvents();
+    modulesModel->updateModuleStatuses(statusCache.takeUpdatedModules());
+}
+
+void
+GdfmWindow::watchCurrentFile()
+{
+    fileQuietConnection.disconnect();
+    fileMonitor.reset();
+    try {
+        fileMonitor =
+            Gio::File::create_for_path(currentFilePath)->monitor_file();
+    } catch (const Glib::Error& error) {
+        warnx("Failed to watch %s: %s", currentFilePath.c_str(),
+            error.what().c_str());
+        return;
+    }
+    fileMonitor->signal_changed().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onCurrentFileChanged));
+}
+
+void
+GdfmWindow::startReload()
+{
+    reloadPath = currentFilePath;
+    reloadAgain = false;
+    reloadThread = std::thread([this]() {
+        struct stat info;
+        reloadLayout = ConfigFileLayout();
+        if (stat(reloadPath.c_str(), &info) == 0) {
+            reloadLayout.size = info.st_size;
+            reloadLayout.modified = info.st_mtim;
+        }
+        reloadModules.clear();
+        ConfigFileReader reader(reloadPath);
+        reloadStatus = reader.readModules(std::back_inserter(reloadModules));
+        reloadSpans = reader.getModuleSpans();
+        reloadDispatcher.emit();
+    });
+}
+
+void
+GdfmWindow::onCurrentFileChanged(const Glib::RefPtr<Gio::File>& file,
+    const Glib::RefPtr<Gio::File>& otherFile, Gio::FileMonitorEvent event)
+{
+    /* Saving can take a few events, so wait for them to stop coming. */
+    fileQuietConnection.disconnect();
+    fileQuietConnection = Glib::signal_timeout().connect(
+        sigc::mem_fun(*this, &GdfmWindow::onCurrentFileQuiet),
+        WATCH_QUIET_MILLISECONDS);
+}
+
+bool
+GdfmWindow::onCurrentFileQuiet()
+{
+    if (isRunning())
+        return true;
+    if (reloadThread.joinable()) {
+        reloadAgain = true;
+        return false;
+    }
+    ConfigFileWriter writer(currentFilePath);
+    if (!writer.isLayoutCurrent(configLayout))
+        startReload();
+    return false;
+}
+
+void
+GdfmWindow::onReloadFinished()
+{
+    reloadThread.join();
+    if (reloadAgain) {
+        startReload();
+        return;
+    }
+    if (reloadPath != currentFilePath)
+        return;
+    if (!reloadStatus) {
+        warnx("Failed to reload %s.", reloadPath.c_str());
+        return;
+    }
+    if (moduleList->isModified()) {
+        Gtk::MessageDialog dialog(*this,
+            "The config file was changed by something else. Reload it and "
+            "lose the changes that weren't saved?",
+            false, Gtk::MESSAGE_QUESTION, Gtk::BUTTONS_YES_NO, true);
+        if (dialog.run() != Gtk::RESPONSE_YES)
+            return;
+    }
+    moduleList->mergeModules(reloadModules);
+    moduleList->markSaved();
+    createConfigFileLayout(
+        currentFilePath, reloadSpans, *moduleList, configLayout);
+    /* The file changed again after it was read, so read it once more. */
+    if (configLayout.size != reloadLayout.size
+        || configLayout.modified.tv_sec != reloadLayout.modified.tv_sec
+        || configLayout.modified.tv_nsec != reloadLayout.modified.tv_nsec) {
+        configLayout.valid = false;
+        startReload();
+    }
+}
+
+void
+GdfmWindow::onSearchChanged()
+{
+    updateSearch();
+}
+
+void
+GdfmWindow::onMoveUpButtonClicked()
+{
+    moveSelectedAction(true);
+}
+
+void
+GdfmWindow::onMoveDownButtonClicked()
+{
+    moveSelectedAction(false);
+}
+
+void
+GdfmWindow::moveSelectedAction(bool up)
+{
+    ModulesTreeModel::Location location;
+    if (!modulesModel->getLocation(modulesSelection->get_selected(), location)
+        || location.type != ModulesTreeModel::MODULE_ACTION_ROW)
+        return;
+    size_t actionCount = moduleList->getModule(location.module)
+                             .getActions(location.actionType)
+                             .size();
+    ModulesTreeModel::Location otherLocation = location;
+    if (up) {
+        if (location.index == 0)
+            return;
+        otherLocation.index--;
+    } else {
+        if (location.index + 1 >= actionCount)
+            return;
+        otherLocation.index++;
+    }
+    moduleList->swapActions(location.module, location.actionType,
+        location.index, otherLocation.index);
+    /* Keep the moved action selected rather than the row it replaced. */
+    modulesSelection->select(modulesModel->getPath(otherLocation));
 }
 } /* namespace gdfm */
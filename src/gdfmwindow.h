@@ -25,32 +25,38 @@
 
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gtkmm.h>
 
+#include "configfilewriter.h"
+#include "driftdetector.h"
+#include "filewatcher.h"
 #include "module.h"
+#include "modulelist.h"
+#include "modulerunner.h"
+#include "modulestatuscache.h"
+#include "modulesearchindex.h"
+#include "modulestreemodel.h"
+#include "outputsink.h"
+#include "sourcewatcher.h"
 
 namespace gdfm {
 
-class GdfmWindow : public Gtk::ApplicationWindow {
+/*
+ * The most lines the output view keeps. Older lines are removed as new ones
+ * come in so a long run doesn't slow the view down.
+ */
+const int MAX_OUTPUT_VIEW_LINES = 5000;
+
+class GdfmWindow : public Gtk::ApplicationWindow,
+                   private ModuleListObserver {
 public:
     GdfmWindow(
         BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>& builder);
     virtual ~GdfmWindow();
 
-    /*
-     * This is a type to make testing what type of row is much easier. Before,
-     * it would check to see if certain columns were filled and what their
-     * content was, but having an extra hidden column with the type makes the
-     * row activated signal handler easier to write.
-     */
-    enum RowType {
-        MODULE_ROW,
-        MODULE_TYPE_ROW,
-        MODULE_FILE_ROW,
-        MODULE_ACTION_ROW
-    };
     /*
      * Reads the modules in the file given by path. Sets the current file to
      * the given config file.
@@ -67,7 +73,6 @@ public:
      * currently editing it.
      */
     bool loadDirectory(const std::string& directoryPath);
-    void setModulesViewFromModules(const std::vector<Module>& modules);
     std::string getSourceDirectory() const;
     /*
      * If there is no current filename, then prompts the user for if it is okay
@@ -86,6 +91,8 @@ public:
      * pointer otherwise.
      */
     std::shared_ptr<Module> createModuleDialog();
+    /* Returns true if modules are being run in the background. */
+    bool isRunning() const;
 
 private:
     std::string currentFilePath;
@@ -98,21 +105,96 @@ private:
     Gtk::Button* installAllModulesButton;
     Gtk::Button* uninstallAllModulesButton;
     Gtk::Button* updateAllModuleButton;
+    Gtk::ToggleButton* watchButton;
     Gtk::Button* moveUpButton;
     Gtk::Button* moveDownButton;
+    Gtk::Box* runBox;
+    Gtk::TextView* outputView;
+    Gtk::ProgressBar* runProgressBar;
+    Gtk::Button* cancelRunButton;
+    Gtk::Button* runSummaryButton;
+    Gtk::SearchEntry* searchEntry;
 
+    /*
+     * The modules being edited. Every change goes through moduleList, which
+     * keeps modulesModel and the view up to date.
+     */
+    std::shared_ptr<ModuleList> moduleList;
+    /* Where the modules are in currentFilePath, for saving only changes. */
+    ConfigFileLayout configLayout;
+    /* Finds the modules to show while there is text in searchEntry. */
+    std::unique_ptr<ModuleSearchIndex> searchIndex;
+    /*
+     * While watchButton is down, the files of the modules are updated as
+     * their sources change. Events are read from the main loop, and the
+     * update starts once they stop coming for a moment. The watches are set
+     * up in the background, so the dispatcher has to outlive the watcher.
+     */
+    Glib::Dispatcher watchDispatcher;
+    SourceWatcher watcher;
+    sigc::connection watchEventsConnection;
+    sigc::connection watchQuietConnection;
+    /*
+     * Marks the modules whose installed files were changed by something
+     * else in the drift column, checking each burst of events once they
+     * stop coming like watcher does. The comparisons are done in the
+     * background, so the dispatcher has to outlive the detector.
+     */
+    Glib::Dispatcher driftDispatcher;
+    DriftDetector driftDetector;
+    sigc::connection driftEventsConnection;
+    sigc::connection driftQuietConnection;
+    /*
+     * Whether onModulesChangedIdle() is waiting to run after the modules
+     * changed.
+     */
+    bool changesPending = false;
     /* Tree view related items. */
-    Gtk::TreeModelColumnRecord columns;
-    Gtk::TreeModelColumn<Glib::ustring> moduleNameColumn;
-    Gtk::TreeModelColumn<Glib::ustring> actionNameColumn;
-    Gtk::TreeModelColumn<Glib::ustring> fileColumn;
-    Gtk::TreeModelColumn<RowType> rowTypeColumn;
-    Gtk::TreeModelColumn<std::shared_ptr<Module>> moduleColumn;
-    Gtk::TreeModelColumn<std::shared_ptr<ModuleFile>> moduleFileColumn;
-    Gtk::TreeModelColumn<std::shared_ptr<ModuleAction>> actionColumn;
-    Glib::RefPtr<Gtk::TreeStore> modulesStore;
+    Glib::RefPtr<ModulesTreeModel> modulesModel;
     Glib::RefPtr<Gtk::TreeSelection> modulesSelection;
 
+    /*
+     * State for the run happening in the background, if any. The worker
+     * thread only touches the runner and the modules it runs, and tells this
+     * thread about progress through the dispatchers. The runner is kept after
+     * the run is over so its statistics can be shown.
+     */
+    std::unique_ptr<ModuleRunner> runner;
+    std::vector<Module> runModules;
+    std::shared_ptr<QueuedOutputSink> runOutput;
+    std::thread runThread;
+    bool runStatus = false;
+    Glib::Dispatcher progressDispatcher;
+    Glib::Dispatcher outputDispatcher;
+    Glib::Dispatcher runFinishedDispatcher;
+    /*
+     * Finds the status of each module in the background for the status
+     * column, checking the modules on the screen first. The dispatcher has
+     * to outlive the cache, since the workers use it until they stop.
+     */
+    Glib::Dispatcher statusDispatcher;
+    sigc::connection statusEventsConnection;
+    sigc::connection statusQuietConnection;
+    ModuleStatusCache statusCache;
+    /*
+     * Reloads currentFilePath when something else changes it, like a pull.
+     * The file is read on reloadThread and the modules are merged into
+     * moduleList, so only the rows that changed are touched and the rest
+     * stay expanded and selected.
+     */
+    Glib::RefPtr<Gio::FileMonitor> fileMonitor;
+    sigc::connection fileQuietConnection;
+    std::thread reloadThread;
+    std::string reloadPath;
+    std::vector<Module> reloadModules;
+    std::vector<ConfigFileSpan> reloadSpans;
+    /* The size and time of the file from just before it was read. */
+    ConfigFileLayout reloadLayout;
+    bool reloadStatus = false;
+    /* Whether the file changed again while it was being read. */
+    bool reloadAgain = false;
+    Glib::Dispatcher reloadDispatcher;
+
     /*
      * This method must be called before accessing any of the widgets specified
      * in the builder file. It assigns the pointers for the member widgets of
@@ -135,42 +217,36 @@ private:
     void addActions();
     /*
      * Initializes the tree view for the modules. This includes initializing
-     * modulesStore.
+     * modulesModel.
      */
     void initModulesView();
 
     /*
-     * Creates a set of modules for use with saving. The point of this is that
-     * orders in the tree view can be changed and modules will be added and
-     * removed without being update in the modules variable.
+     * Finds where row is in moduleList.
      *
-     * Returns a list of modules represented by the current state of
-     * modulesView.
+     * Returns true if row is still valid, false otherwise.
      */
-    std::vector<Module> createModulesFromView() const;
-    Module createModuleForRow(const Gtk::TreeRow& row) const;
+    bool getRowLocation(const Gtk::TreeRowReference& row,
+        ModulesTreeModel::Location& location) const;
     /*
-     * Installs the module and creates a popup if it failed notifying the use.
-     *
-     * Returns true if the module was successfully installed, false otherwise.
+     * Returns a copy of the module that the row at iter belongs to, so a run
+     * can use it on another thread while it is edited here.
      */
-    bool installModuleWithPopups(
-        const Module& module, const std::string& sourceDirectory);
+    Module createModuleForRow(const Gtk::TreeIter& iter) const;
     /*
-     * Uninstall the module and creates a popup if it failed notifying the use.
-     *
-     * Returns true if the module was successfully uninstalled, false
-     * otherwise.
+     * Starts running the operation on the modules on a worker thread and
+     * returns right away. Progress and output are shown in the run box, and
+     * once the run is over a popup is created for each module that failed.
+     * Does nothing if a run is already happening.
      */
-    bool uninstallModuleWithPopups(
-        const Module& module, const std::string& sourceDirectory);
+    void startRun(
+        ModuleRunner::Operation operation, const std::vector<Module>& modules);
     /*
-     * Updates the module and creates a popup if it failed notifying the use.
-     *
-     * Returns true if the module was successfully updated, false otherwise.
+     * Makes the parts of the window that could change the modules
+     * insensitive while a run is happening, and sensitive again after.
+     * Opening another file or directory is disabled as well.
      */
-    bool updateModuleWithPopups(
-        const Module& module, const std::string& sourceDirectory);
+    void setRunning(bool running);
     /*
      * Show the correct buttons in the action area on the right of the view
      * based on the current selection. This needs to be called whenever the
@@ -180,6 +256,47 @@ private:
      * hides them otherwise.
      */
     void updateVisibleButtons();
+    /*
+     * Shows only the modules that match the text in searchEntry, or every
+     * module if there isn't any.
+     */
+    void updateSearch();
+    /*
+     * Searches again once the current changes are done, so that the results
+     * follow edits. The watcher, the status cache and the drift detector
+     * follow the edits themselves.
+     */
+    void onModulesChanged() override;
+    void onModulesChangedIdle();
+    /*
+     * Has watcher follow moduleList from the current source directory and
+     * watch every source again in the background. Changes the watches from
+     * before saw are still updated.
+     */
+    void startWatching();
+    void stopWatching();
+    /*
+     * Has driftDetector follow moduleList from the current source directory
+     * and watch every destination again in the background. The modules that
+     * had drifted are checked again.
+     */
+    void startDriftDetection();
+    /* Reads the events of driftDetector, whose descriptor changed. */
+    void watchDriftEvents();
+    /*
+     * Has statusCache follow moduleList from the current source directory
+     * and watch every file again in the background, such as after a run
+     * created directories. Only the modules whose files moved are checked.
+     */
+    void startStatusChecks();
+    /* Reads the events of statusCache, whose descriptor changed. */
+    void watchStatusEvents();
+    /* Has statusCache check the modules on the screen first. */
+    void prioritizeVisibleModules();
+    /* Watches currentFilePath for changes, replacing the last one watched. */
+    void watchCurrentFile();
+    /* Starts reading currentFilePath again on reloadThread. */
+    void startReload();
 
     /* Signal handlers. */
     void onAddModuleButtonClicked();
@@ -191,7 +308,56 @@ private:
     void onUpdateAllModulesButtonClicked();
     void onMoveUpButtonClicked();
     void onMoveDownButtonClicked();
+    /* Swaps the selected action with the one above or below it. */
+    void moveSelectedAction(bool up);
     void onModulesSelectionChanged();
+    void onCancelRunButtonClicked();
+    void onRunSummaryButtonClicked();
+    void onSearchChanged();
+    void onWatchButtonToggled();
+    /* Reads events from the watcher and waits for them to stop coming. */
+    bool onWatchEvents(Glib::IOCondition condition);
+    /* Updates the files that changed, or waits for the current run. */
+    bool onWatchQuiet();
+    /*
+     * Starts reading the events of watcher once its watches are set up.
+     * Turns watchButton off and shows an error if they couldn't be.
+     */
+    void onWatchUpdated();
+    bool onDriftEvents(Glib::IOCondition condition);
+    /*
+     * Starts checking the destinations that changed, or waits for the
+     * current run.
+     */
+    bool onDriftQuiet();
+    /*
+     * Shows the drifted modules that driftDetector found in the view, and
+     * starts using its watches once they are set up.
+     */
+    void onDriftUpdated();
+    bool onStatusEvents(Glib::IOCondition condition);
+    /* Checks the modules whose files changed, or waits for the run. */
+    bool onStatusQuiet();
+    /*
+     * Shows the statuses that statusCache found in the view, and starts
+     * using its watches once they are set up.
+     */
+    void onStatusUpdated();
+    void onCurrentFileChanged(const Glib::RefPtr<Gio::File>& file,
+        const Glib::RefPtr<Gio::File>& otherFile,
+        Gio::FileMonitorEvent event);
+    /* Reloads the file once it is done changing, unless this wrote it. */
+    bool onCurrentFileQuiet();
+    /*
+     * Merges the modules that were read into moduleList, asking first if
+     * that would throw away changes that weren't saved.
+     */
+    void onReloadFinished();
+    /* Shows the current counters from the runner on the progress bar. */
+    void onRunProgress();
+    /* Moves output lines that are waiting into the output view. */
+    void onRunOutput();
+    void onRunFinished();
     /*
      * These signal handlers are specifically for the popup menu that can
      * be
@@ -211,30 +377,33 @@ private:
     void onModuleFileRemoveItemActivated(Gtk::TreeRowReference row);
     void onModuleActionEditItemActivated(Gtk::TreeRowReference row);
     void onModuleActionRemoveItemActivated(Gtk::TreeRowReference row);
+    /*
+     * Lets the user create an action and adds it to the given list of the
+     * module at row.
+     */
+    void addActionToModule(
+        Gtk::TreeRowReference row, Module::ActionType type);
 
     /* Actions for use with bar. */
     void onActionOpenFile();
     void onActionOpenDirectory();
     void onActionSave();
     void onActionSaveAs();
+    /*
+     * Writes the modules to path, which becomes the current file. Saving to
+     * the current file only rewrites the modules that changed. Shows an
+     * error dialog on failure.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool saveToFile(const std::string& path);
+    void onActionUndo();
+    void onActionRedo();
+    void onActionFind();
     void onActionQuit();
     void onActionAbout();
 
     void appendModule(const Module& module);
-
-    /*
-     * Gets the row that has the children representing install actions for
-     * the given row that represents a module. Also creates the row if it
-     * doesn't exist.
-     *
-     * Returns a Gtk::TreeRow for the install section if it existed or a new
-     * row that was just created if it didn't.
-     */
-    Gtk::TreeRowReference getInstallRow(const Gtk::TreeRow& moduleRow);
-    /* Same as above getInstallRow() with uninstall. */
-    Gtk::TreeRowReference getUninstallRow(const Gtk::TreeRow& moduleRow);
-    /* Same as getInstallRow() with update. */
-    Gtk::TreeRowReference getUpdateRow(const Gtk::TreeRow& moduleRow);
 };
 } /* namespace gdfm */
 
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "graphicaledit.h"
+
+#include "dependencyaction.h"
+#include "dependencyeditor.h"
+#include "filecheckaction.h"
+#include "filecheckeditor.h"
+#include "installaction.h"
+#include "installactioneditor.h"
+#include "messageaction.h"
+#include "messageeditor.h"
+#include "modulefileeditor.h"
+#include "removeaction.h"
+#include "removeactioneditor.h"
+#include "shellaction.h"
+#include "shelleditor.h"
+
+namespace gdfm {
+
+void
+graphicalEdit(Gtk::Window& parent, ModuleAction& action)
+{
+    if (auto dependency = dynamic_cast<DependencyAction*>(&action)) {
+        DependencyEditor editor(parent, dependency);
+        editor.run();
+    } else if (auto fileCheck = dynamic_cast<FileCheckAction*>(&action)) {
+        FileCheckEditor editor(parent, fileCheck);
+        editor.run();
+    } else if (auto install = dynamic_cast<InstallAction*>(&action)) {
+        InstallActionEditor editor(parent, install);
+        editor.run();
+    } else if (auto message = dynamic_cast<MessageAction*>(&action)) {
+        MessageEditor editor(parent, message);
+        editor.run();
+    } else if (auto remove = dynamic_cast<RemoveAction*>(&action)) {
+        RemoveActionEditor editor(parent, remove);
+        editor.run();
+    } else if (auto shell = dynamic_cast<ShellAction*>(&action)) {
+        ShellEditor editor(parent, shell);
+        editor.run();
+    }
+}
+
+void
+graphicalEdit(Gtk::Window& parent, ModuleFile& file)
+{
+    ModuleFileEditor editor(parent, &file);
+    editor.run();
+}
+} /* namespace gdfm */
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GRAPHICAL_EDIT_H
+#define GRAPHICAL_EDIT_H
+
+#include <gtkmm.h>
+
+#include "moduleaction.h"
+#include "modulefile.h"
+
+namespace gdfm {
+
+/*
+ * Opens the editor dialog for the given action, picked by the action's type,
+ * and waits for it to close. The editors are part of the window rather than
+ * the actions so that the actions don't have to pull in gtkmm, which the
+ * command line version doesn't have. Does nothing for types that don't have an
+ * editor.
+ */
+void graphicalEdit(Gtk::Window& parent, ModuleAction& action);
+/* Opens the editor dialog for the given file and waits for it to close. */
+void graphicalEdit(Gtk::Window& parent, ModuleFile& file);
+} /* namespace gdfm */
+
+#endif /* GRAPHICAL_EDIT_H */
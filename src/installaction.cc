@@ -27,7 +27,8 @@
 
 #include <iostream>
 
-#include "installactioneditor.h"
+#include "runcontext.h"
+#include "runstatistics.h"
 #include "util.h"
 
 namespace gdfm {
@@ -119,10 +120,38 @@ InstallAction::setInstallFilename(const std::string& installFilename)
     this->installFilename = installFilename;
 }
 
+const std::vector<std::string>&
+InstallAction::getTargetDirectories() const
+{
+    return targetDirectories;
+}
+
+void
+InstallAction::setTargetDirectories(
+    const std::vector<std::string>& targetDirectories)
+{
+    this->targetDirectories = targetDirectories;
+}
+
+std::shared_ptr<const TemplateVariables>
+InstallAction::getTemplateVariables() const
+{
+    return templateVariables;
+}
+
+void
+InstallAction::setTemplateVariables(
+    std::shared_ptr<const TemplateVariables> templateVariables)
+{
+    this->templateVariables = templateVariables;
+}
+
 bool
 InstallAction::performAction()
 {
     std::string sourcePath = shellExpandPath(getFilePath());
+    if (!targetDirectories.empty() && isInHomeDirectory(destinationDirectory))
+        return installInTargets(sourcePath);
     std::string destinationPath = shellExpandPath(getInstallationPath());
 
     if (isInteractive()) {
@@ -146,15 +175,96 @@ InstallAction::performAction()
             "Failed to use destination directory %s, isn't directory or couldn't be created.",
             destinationDirectory.c_str());
     }
+    if (!RunContext::backUpInstall(sourcePath, destinationPath))
+        return false;
+    if (templateVariables)
+        return renderTemplate(sourcePath, destinationPath);
     return copyFile(sourcePath, destinationPath);
 }
 
+bool
+InstallAction::installInTargets(const std::string& sourcePath)
+{
+    if (isInteractive()) {
+        std::string prompt = "Install " + sourcePath + " to "
+            + std::to_string(targetDirectories.size()) + " targets?";
+        if (!getYesOrNo(prompt))
+            return true;
+        std::cout << std::endl;
+    }
+    verboseMessage("Installing %s to %zu targets.\n\n", sourcePath.c_str(),
+        targetDirectories.size());
+
+    if (!fileExists(sourcePath)) {
+        warnx(
+            "File %s doesn't exist, can't be installed.", sourcePath.c_str());
+        return false;
+    }
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    bool status = true;
+    std::vector<std::string> targets;
+    std::vector<std::string> destinationPaths;
+    for (const auto& target : targetDirectories) {
+        std::string destinationPath =
+            shellExpandPath(getInstallationPath(), target);
+        if (RunContext::backUpInstall(sourcePath, destinationPath)) {
+            targets.push_back(target);
+            destinationPaths.push_back(destinationPath);
+            continue;
+        }
+        status = false;
+        if (statistics)
+            statistics->addTargetResult(target, false);
+    }
+    std::vector<bool> copied;
+    if (templateVariables) {
+        for (const auto& destinationPath : destinationPaths) {
+            copied.push_back(renderTemplate(sourcePath, destinationPath));
+            if (!copied.back())
+                status = false;
+        }
+    } else if (!copyFileToAll(sourcePath, destinationPaths, copied))
+        status = false;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (!copied[i]) {
+            warnx("Failed to install %s to %s.", sourcePath.c_str(),
+                destinationPaths[i].c_str());
+        }
+        if (statistics)
+            statistics->addTargetResult(targets[i], copied[i]);
+    }
+    return status;
+}
+
+bool
+InstallAction::renderTemplate(
+    const std::string& sourcePath, const std::string& destinationPath) const
+{
+    std::shared_ptr<const FileTemplate> fileTemplate =
+        FileTemplate::load(sourcePath);
+    if (!fileTemplate) {
+        warnx("Failed to read template %s.", sourcePath.c_str());
+        return false;
+    }
+    struct stat sourceInfo;
+    if (stat(sourcePath.c_str(), &sourceInfo) != 0)
+        return false;
+    return fileTemplate->renderToFile(
+        *templateVariables, destinationPath, sourceInfo.st_mode);
+}
+
 void
 InstallAction::updateName()
 {
     setName(filename);
 }
 
+std::shared_ptr<ModuleAction>
+InstallAction::clone() const
+{
+    return std::shared_ptr<ModuleAction>(new InstallAction(*this));
+}
+
 std::vector<std::string>
 InstallAction::createConfigLines() const
 {
@@ -167,11 +277,4 @@ InstallAction::createConfigLines() const
     lines.push_back(line);
     return lines;
 }
-
-void
-InstallAction::graphicalEdit(Gtk::Window& parent)
-{
-    InstallActionEditor editor(parent, this);
-    editor.run();
-}
 } /* namespace gdfm */
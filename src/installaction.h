@@ -24,7 +24,9 @@
 #define INSTALL_ACTION_H
 
 #include <string>
+#include <vector>
 
+#include "filetemplate.h"
 #include "moduleaction.h"
 
 namespace gdfm {
@@ -49,16 +51,47 @@ public:
     void setDestinationDirectory(const std::string& destinationDirectory);
     const std::string& getInstallFilename() const;
     void setInstallFilename(const std::string& installFilename);
+    /*
+     * If the destination is in the home directory, the file is installed in
+     * each of these instead, reading it once for all of them.
+     */
+    const std::vector<std::string>& getTargetDirectories() const;
+    void setTargetDirectories(
+        const std::vector<std::string>& targetDirectories);
+    /*
+     * The variables to fill the file in with as a template, or nullptr to
+     * copy it as it is.
+     */
+    std::shared_ptr<const TemplateVariables> getTemplateVariables() const;
+    void setTemplateVariables(
+        std::shared_ptr<const TemplateVariables> templateVariables);
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     std::string filename;
     std::string sourceDirectory;
     std::string installFilename;
     std::string destinationDirectory;
+    std::vector<std::string> targetDirectories;
+    std::shared_ptr<const TemplateVariables> templateVariables;
+
+    /*
+     * Fills in the template at sourcePath and writes it to destinationPath.
+     *
+     * Returns true on success, false on failure.
+     */
+    bool renderTemplate(const std::string& sourcePath,
+        const std::string& destinationPath) const;
+
+    /*
+     * Installs the file at sourcePath in every target directory.
+     *
+     * Returns true if it was installed in all of them, false otherwise.
+     */
+    bool installInTargets(const std::string& sourcePath);
 };
 } /* namespace gdfm */
 
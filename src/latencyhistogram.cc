@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "latencyhistogram.h"
+
+namespace gdfm {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void
+LatencyHistogram::record(uint64_t nanoseconds)
+{
+    buckets[getBucketIndex(nanoseconds)]++;
+    count++;
+    total += nanoseconds;
+    uint64_t currentMaximum = maximum;
+    while (nanoseconds > currentMaximum
+        && !maximum.compare_exchange_weak(currentMaximum, nanoseconds))
+        ;
+}
+
+void
+LatencyHistogram::reset()
+{
+    for (auto& bucket : buckets)
+        bucket = 0;
+    count = 0;
+    total = 0;
+    maximum = 0;
+}
+
+uint64_t
+LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+uint64_t
+LatencyHistogram::getTotal() const
+{
+    return total;
+}
+
+uint64_t
+LatencyHistogram::getMaximum() const
+{
+    return maximum;
+}
+
+uint64_t
+LatencyHistogram::getPercentile(double percentile) const
+{
+    uint64_t recorded = 0;
+    for (const auto& bucket : buckets)
+        recorded += bucket;
+    if (recorded == 0)
+        return 0;
+    /* The rank of the wanted value, counting from one. */
+    uint64_t rank = static_cast<uint64_t>(recorded * percentile / 100.0 + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > recorded)
+        rank = recorded;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen < rank)
+            continue;
+        /* Use the middle of the bucket, but never more than the maximum. */
+        uint64_t start = getBucketStart(i);
+        uint64_t end = (i + 1 < HISTOGRAM_BUCKET_COUNT)
+            ? getBucketStart(i + 1)
+            : UINT64_MAX;
+        uint64_t middle = start + (end - start) / 2;
+        uint64_t currentMaximum = maximum;
+        return (middle < currentMaximum) ? middle : currentMaximum;
+    }
+    return maximum;
+}
+
+size_t
+LatencyHistogram::getBucketIndex(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(HISTOGRAM_SUB_BUCKETS))
+        return value;
+    /*
+     * Values from 2^n up to 2^(n + 1) share a group of buckets, and the bits
+     * after the highest one pick the bucket within the group.
+     */
+    int highestBit = 63 - __builtin_clzll(value);
+    int shift = highestBit - HISTOGRAM_SUB_BUCKET_BITS;
+    size_t subBucket = (value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+uint64_t
+LatencyHistogram::getBucketStart(size_t index)
+{
+    if (index < static_cast<size_t>(HISTOGRAM_SUB_BUCKETS))
+        return index;
+    int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t subBucket = index % HISTOGRAM_SUB_BUCKETS;
+    return (HISTOGRAM_SUB_BUCKETS + subBucket) << shift;
+}
+} /* namespace gdfm */
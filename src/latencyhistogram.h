@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace gdfm {
+
+/*
+ * Each power of two is split into 2^HISTOGRAM_SUB_BUCKET_BITS buckets, so a
+ * percentile is never off by more than an eighth of its value.
+ */
+const int HISTOGRAM_SUB_BUCKET_BITS = 2;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+/* Enough buckets for any 64 bit value. */
+const size_t HISTOGRAM_BUCKET_COUNT = 64 * HISTOGRAM_SUB_BUCKETS;
+
+/*
+ * A histogram of durations in nanoseconds with logarithmic buckets. Values
+ * can be recorded from several threads at once without locking, and the
+ * memory used doesn't depend on how many values there are.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t getCount() const;
+    /* Returns the sum of every recorded value. */
+    uint64_t getTotal() const;
+    uint64_t getMaximum() const;
+    /*
+     * Returns an estimate of the value that the given percentage of recorded
+     * values are at or below, such as 50 for the median. Returns 0 if nothing
+     * has been recorded.
+     */
+    uint64_t getPercentile(double percentile) const;
+
+private:
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKET_COUNT];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> maximum;
+
+    static size_t getBucketIndex(uint64_t value);
+    /* Returns the smallest value that goes in the bucket. */
+    static uint64_t getBucketStart(size_t index);
+};
+} /* namespace gdfm */
+
+#endif /* LATENCY_HISTOGRAM_H */
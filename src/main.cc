@@ -20,17 +20,33 @@
  * IN THE SOFTWARE.
  */
 
+#include <err.h>
 #include <stdlib.h>
 
 #include <iostream>
 
+#include "commandline.h"
 #include "gdfmwindow.h"
+#include "tracer.h"
 
 int
 main(int argc, char* argv[])
 {
+    /*
+     * Any arguments mean gdfm is being used from a terminal or a script, so
+     * it works without GTK and never needs a display.
+     */
+    if (argc > 1)
+        return gdfm::runCommandLine(argc, argv);
+
+    const char* tracePath = getenv(gdfm::TRACE_ENVIRONMENT_VARIABLE);
+    if (tracePath && *tracePath)
+        gdfm::Tracer::enable();
     auto application =
         Gtk::Application::create(argc, argv, "com.waataja.gdfm");
+    application->set_accel_for_action("win.undo", "<Primary>z");
+    application->set_accel_for_action("win.redo", "<Primary><Shift>z");
+    application->set_accel_for_action("win.find", "<Primary>f");
     try {
         auto builder = Gtk::Builder::create_from_resource(
             "/com/waataja/gdfm/ui/mainwindow.glade");
@@ -38,6 +54,9 @@ main(int argc, char* argv[])
         builder->get_widget_derived("main_window", window);
         int status = application->run(*window);
         delete window;
+        if (gdfm::Tracer::isEnabled()
+            && !gdfm::Tracer::writeTrace(tracePath))
+            warnx("Failed to write trace to %s.", tracePath);
         return status;
     } catch (const Glib::FileError e) {
         std::cerr << e.what() << std::endl;
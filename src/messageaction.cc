@@ -25,7 +25,7 @@
 #include <iostream>
 #include <sstream>
 
-#include "messageeditor.h"
+#include "runcontext.h"
 
 namespace gdfm {
 
@@ -41,11 +41,14 @@ MessageAction::MessageAction(const std::string& message) : message(message)
 bool
 MessageAction::performAction()
 {
-    if (!getParent())
-        return false;
-    Gtk::MessageDialog dialog(*getParent(), message, false, Gtk::MESSAGE_INFO,
-        Gtk::BUTTONS_OK, true);
-    dialog.run();
+    /*
+     * Messages always go to the run's output. Outside of a run that is
+     * standard output, and the window shows the messages from its runs
+     * itself.
+     */
+    RunContext* context = RunContext::getCurrent();
+    std::string source = context ? context->getModuleName() : getName();
+    RunContext::getCurrentOutputSink()->writeMessage(source, message);
     return true;
 }
 
@@ -67,11 +70,10 @@ MessageAction::updateName()
     setName("Message");
 }
 
-void
-MessageAction::graphicalEdit(Gtk::Window& parent)
+std::shared_ptr<ModuleAction>
+MessageAction::clone() const
 {
-    MessageEditor editor(parent, this);
-    editor.run();
+    return std::shared_ptr<ModuleAction>(new MessageAction(*this));
 }
 
 std::vector<std::string>
@@ -38,8 +38,8 @@ public:
     void setMessage(const std::string& message);
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     std::string message;
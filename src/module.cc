@@ -24,8 +24,53 @@
 
 #include <err.h>
 
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
+
 namespace gdfm {
 
+namespace {
+/*
+ * Performs a single action as part of installing, uninstalling, or updating.
+ * If the current run was cancelled, the action isn't started. Finished
+ * actions are counted towards the run's progress whether or not they
+ * succeeded.
+ */
+bool
+performRunAction(ModuleAction& action, const char* operationName)
+{
+    if (RunContext::isCurrentCancelled())
+        return false;
+    TraceSpan span("action", "ModuleAction::performAction", action.getName());
+    bool status = action.performAction();
+    span.finish();
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (statistics)
+        statistics->addFinishedAction();
+    if (!status) {
+        warnx("Failed to perform %s action \"%s\".", operationName,
+            action.getName().c_str());
+    }
+    return status;
+}
+
+/*
+ * Same as performRunAction(), also counting the result towards target if
+ * there is one.
+ */
+bool
+performTargetAction(ModuleAction& action, const char* operationName,
+    const std::string& target)
+{
+    bool status = performRunAction(action, operationName);
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (!target.empty() && statistics)
+        statistics->addTargetResult(target, status);
+    return status;
+}
+} /* namespace */
+
 Module::Module() : name(DEFAULT_MODULE_NAMES)
 {
 }
@@ -49,66 +94,89 @@ Module::setName(const std::string& name)
 bool
 Module::install(const std::string& sourceDirectory) const
 {
+    return install(sourceDirectory, std::vector<std::string>());
+}
+
+bool
+Module::uninstall(const std::string& sourceDirectory) const
+{
+    return uninstall(sourceDirectory, std::vector<std::string>());
+}
+
+bool
+Module::update(const std::string& sourceDirectory) const
+{
+    return update(sourceDirectory, std::vector<std::string>());
+}
+
+bool
+Module::install(const std::string& sourceDirectory,
+    const std::vector<std::string>& targetDirectories) const
+{
+    TraceSpan span("module", "Module::install", name);
     for (const auto& file : files) {
-        std::shared_ptr<InstallAction> installAction =
-            file.createInstallAction(sourceDirectory);
-        if (!installAction->performAction()) {
-            warnx("Failed to perform install action \"%s\".",
-                installAction->getName().c_str());
-            return false;
+        std::shared_ptr<InstallAction> installAction;
+        {
+            PhaseTimer timer(RunStatistics::PLAN_PHASE);
+            installAction = file.createInstallAction(sourceDirectory);
+            installAction->setTargetDirectories(targetDirectories);
         }
+        if (!performRunAction(*installAction, "install"))
+            return false;
     }
     for (const auto& action : installActions) {
-        if (!action->performAction()) {
-            warnx("Failed to perform install action \"%s\".",
-                action->getName().c_str());
+        if (!performRunAction(*action, "install"))
             return false;
-        }
     }
     return true;
 }
 
 bool
-Module::uninstall(const std::string& sourceDirectory) const
+Module::uninstall(const std::string& sourceDirectory,
+    const std::vector<std::string>& targetDirectories) const
 {
+    TraceSpan span("module", "Module::uninstall", name);
     for (const auto& file : files) {
-        std::shared_ptr<RemoveAction> uninstallAction =
-            file.createUninstallAction();
-        if (!uninstallAction->performAction()) {
-            warnx("Failed to uninstall perform action \"%s\".",
-                uninstallAction->getName().c_str());
-            return false;
+        for (const auto& target : getFileTargets(file, targetDirectories)) {
+            std::shared_ptr<RemoveAction> uninstallAction;
+            {
+                PhaseTimer timer(RunStatistics::PLAN_PHASE);
+                uninstallAction = (target.empty())
+                    ? file.createUninstallAction()
+                    : file.createUninstallAction(target);
+            }
+            if (!performTargetAction(*uninstallAction, "uninstall", target))
+                return false;
         }
     }
     for (const auto& action : uninstallActions) {
-        if (!action->performAction()) {
-            warnx("Failed to perform uninstall action \"%s\".",
-                action->getName().c_str());
+        if (!performRunAction(*action, "uninstall"))
             return false;
-        }
     }
     return true;
 }
 
-
 bool
-Module::update(const std::string& sourceDirectory) const
+Module::update(const std::string& sourceDirectory,
+    const std::vector<std::string>& targetDirectories) const
 {
+    TraceSpan span("module", "Module::update", name);
     for (const auto& file : files) {
-        std::shared_ptr<FileCheckAction> updateAction =
-            file.createUpdateAction(sourceDirectory);
-        if (!updateAction->performAction()) {
-            warnx("Failed to perform update action \"%s\".",
-                updateAction->getName().c_str());
-            return false;
+        for (const auto& target : getFileTargets(file, targetDirectories)) {
+            std::shared_ptr<FileCheckAction> updateAction;
+            {
+                PhaseTimer timer(RunStatistics::PLAN_PHASE);
+                updateAction = (target.empty())
+                    ? file.createUpdateAction(sourceDirectory)
+                    : file.createUpdateAction(sourceDirectory, target);
+            }
+            if (!performTargetAction(*updateAction, "update", target))
+                return false;
         }
     }
     for (const auto& action : updateActions) {
-        if (!action->performAction()) {
-            warnx("Failed to perform update action \"%s\".",
-                action->getName().c_str());
+        if (!performRunAction(*action, "update"))
             return false;
-        }
     }
     return true;
 }
@@ -171,28 +239,35 @@ Module::addFile(const std::string& filename,
         ModuleFile(filename, destinationDirectory, destinationFilename));
 }
 
-const std::vector<ModuleFile>
+const std::vector<ModuleFile>&
 Module::getFiles() const
 {
     return files;
 }
 
-Gtk::Window*
-Module::getParent() const
+std::vector<ModuleFile>&
+Module::getFiles()
 {
-    return parent;
+    return files;
 }
 
-void
-Module::setParent(Gtk::Window* parent)
+const std::vector<std::shared_ptr<ModuleAction>>&
+Module::getActions(ActionType type) const
 {
-    this->parent = parent;
-    for (auto& module : installActions)
-        module->setParent(parent);
-    for (auto& module : uninstallActions)
-        module->setParent(parent);
-    for (auto& module : updateActions)
-        module->setParent(parent);
+    return const_cast<Module*>(this)->getActions(type);
+}
+
+std::vector<std::shared_ptr<ModuleAction>>&
+Module::getActions(ActionType type)
+{
+    switch (type) {
+    case UNINSTALL_ACTIONS:
+        return uninstallActions;
+    case UPDATE_ACTIONS:
+        return updateActions;
+    default:
+        return installActions;
+    }
 }
 
 std::vector<std::string>
@@ -226,4 +301,74 @@ Module::createConfigLines() const
     }
     return lines;
 }
+
+Module
+Module::clone() const
+{
+    Module copy(*this);
+    for (int i = 0; i < ACTION_TYPE_COUNT; i++) {
+        for (auto& action : copy.getActions(static_cast<ActionType>(i)))
+            action = action->clone();
+    }
+    return copy;
+}
+
+void
+Module::writeConfig(std::string& output) const
+{
+    output += name;
+    output += ":\n";
+    for (const auto& file : files) {
+        output += '\t';
+        output += file.createConfigLines()[0];
+        output += '\n';
+    }
+    writeActionsConfig(output, "install:\n", installActions);
+    writeActionsConfig(output, "uninstall:\n", uninstallActions);
+    writeActionsConfig(output, "update:\n", updateActions);
+}
+
+void
+Module::writeActionsConfig(std::string& output, const char* header,
+    const std::vector<std::shared_ptr<ModuleAction>>& actions)
+{
+    if (actions.empty())
+        return;
+    output += header;
+    for (const auto& action : actions) {
+        for (const auto& line : action->createConfigLines()) {
+            output += '\t';
+            output += line;
+            output += '\n';
+        }
+    }
+}
+
+std::vector<std::string>
+Module::getFileTargets(
+    const ModuleFile& file, const std::vector<std::string>& targetDirectories)
+{
+    if (targetDirectories.empty() || !file.isInHomeDirectory())
+        return std::vector<std::string>(1);
+    return targetDirectories;
+}
+
+bool
+Module::isSameFiles(const std::vector<ModuleFile>& first,
+    const std::vector<ModuleFile>& second)
+{
+    if (first.size() != second.size())
+        return false;
+    for (size_t i = 0; i < first.size(); i++) {
+        if (first[i].getFilename() != second[i].getFilename()
+            || first[i].getDestinationDirectory()
+                != second[i].getDestinationDirectory()
+            || first[i].getDestinationFilename()
+                != second[i].getDestinationFilename()
+            || first[i].getTemplateVariables()
+                != second[i].getTemplateVariables())
+            return false;
+    }
+    return true;
+}
 } /* namespace gdfm */
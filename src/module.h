@@ -27,8 +27,6 @@
 #include <string>
 #include <vector>
 
-#include <gtkmm.h>
-
 #include "moduleaction.h"
 #include "modulefile.h"
 
@@ -38,6 +36,14 @@ const char DEFAULT_MODULE_NAMES[] = "Generic Module";
 
 class Module {
 public:
+    /* The lists of actions a module has, in the order they're written. */
+    enum ActionType {
+        INSTALL_ACTIONS,
+        UNINSTALL_ACTIONS,
+        UPDATE_ACTIONS,
+        ACTION_TYPE_COUNT
+    };
+
     Module();
     Module(const std::string& name);
     void addFile(const std::string& filename);
@@ -52,6 +58,30 @@ public:
     bool install(const std::string& sourceDirectory) const;
     bool uninstall(const std::string& sourceDirectory) const;
     bool update(const std::string& sourceDirectory) const;
+    /*
+     * Same as install(), uninstall() and update(), except that files that go
+     * in the home directory go in each of targetDirectories instead. The
+     * other actions are only performed once.
+     */
+    bool install(const std::string& sourceDirectory,
+        const std::vector<std::string>& targetDirectories) const;
+    bool uninstall(const std::string& sourceDirectory,
+        const std::vector<std::string>& targetDirectories) const;
+    bool update(const std::string& sourceDirectory,
+        const std::vector<std::string>& targetDirectories) const;
+    /*
+     * Returns the directories that stand in for the home directory when
+     * running the file, or just "" for the home directory itself.
+     */
+    static std::vector<std::string> getFileTargets(const ModuleFile& file,
+        const std::vector<std::string>& targetDirectories);
+    /*
+     * Returns true if both have the same files in the same order, going to
+     * the same places and filled in the same way, so a module that went
+     * from one to the other is installed the same as before.
+     */
+    static bool isSameFiles(const std::vector<ModuleFile>& first,
+        const std::vector<ModuleFile>& second);
     const std::vector<std::shared_ptr<ModuleAction>>&
     getInstallActions() const;
     const std::vector<std::shared_ptr<ModuleAction>>&
@@ -59,12 +89,25 @@ public:
     const std::vector<std::shared_ptr<ModuleAction>>& getUpdateActions() const;
     const std::string& getName() const;
     void setName(const std::string& name);
-    const std::vector<ModuleFile> getFiles() const;
-    Gtk::Window* getParent() const;
-    /* Not, this also sets all ModuleActions as well. */
-    void setParent(Gtk::Window* parent);
+    const std::vector<ModuleFile>& getFiles() const;
+    /* Allows the files to be edited in place. */
+    std::vector<ModuleFile>& getFiles();
+    const std::vector<std::shared_ptr<ModuleAction>>& getActions(
+        ActionType type) const;
+    std::vector<std::shared_ptr<ModuleAction>>& getActions(ActionType type);
 
+    /*
+     * Returns a copy of this module with copies of its actions, rather than
+     * the shared actions a plain copy has, so the copy can be edited on its
+     * own.
+     */
+    Module clone() const;
     std::vector<std::string> createConfigLines() const;
+    /*
+     * Appends the same lines as createConfigLines() to output, each ending in
+     * a newline, without building a list of them first.
+     */
+    void writeConfig(std::string& output) const;
 
 private:
     std::string name;
@@ -72,7 +115,10 @@ private:
     std::vector<std::shared_ptr<ModuleAction>> installActions;
     std::vector<std::shared_ptr<ModuleAction>> uninstallActions;
     std::vector<std::shared_ptr<ModuleAction>> updateActions;
-    Gtk::Window* parent = nullptr;
+
+    /* Writes header and then each action's lines, if there are any. */
+    static void writeActionsConfig(std::string& output, const char* header,
+        const std::vector<std::shared_ptr<ModuleAction>>& actions);
 };
 } /* namespace gdfm */
 
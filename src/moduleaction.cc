@@ -34,6 +34,10 @@ ModuleAction::ModuleAction(const std::string& name) : name(name)
 {
 }
 
+ModuleAction::~ModuleAction()
+{
+}
+
 const std::string&
 ModuleAction::getName() const
 {
@@ -97,23 +101,6 @@ ModuleAction::updateName()
     name = DEFAULT_ACTION_NAME;
 }
 
-void
-ModuleAction::graphicalEdit(Gtk::Window& parent)
-{
-}
-
-Gtk::Window*
-ModuleAction::getParent() const
-{
-    return parent;
-}
-
-void
-ModuleAction::setParent(Gtk::Window* parent)
-{
-    this->parent = parent;
-}
-
 std::vector<std::string>
 ModuleAction::createConfigLines() const
 {
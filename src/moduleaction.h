@@ -25,11 +25,10 @@
 
 #include <stdarg.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
-#include <gtkmm.h>
-
 namespace gdfm {
 
 const char DEFAULT_ACTION_NAME[] = "generic action";
@@ -38,6 +37,7 @@ class ModuleAction {
 public:
     ModuleAction();
     ModuleAction(const std::string& name);
+    virtual ~ModuleAction();
     virtual bool performAction() = 0;
 
     void verboseMessage(const char* format, ...);
@@ -51,15 +51,6 @@ public:
     void setInteractive(bool interactive);
 
     virtual void updateName();
-    /*
-     * This method is a method to open a dialog to edit the given action. This
-     * is not meant to be in the DFM version of this file because it requires
-     * pulling in gtkmm which is not what I want for the command line version.
-     * This method should create a popup with several fields for editing.
-     */
-    virtual void graphicalEdit(Gtk::Window& parent);
-    Gtk::Window* getParent() const;
-    void setParent(Gtk::Window* parent);
     /*
      * Creates a list of lines that would create the given command when used in
      * a dfm config file.
@@ -75,12 +66,16 @@ public:
      * the given command.
      */
     virtual std::vector<std::string> createConfigLines() const;
+    /*
+     * Returns a copy of this action that can be edited without changing this
+     * one.
+     */
+    virtual std::shared_ptr<ModuleAction> clone() const = 0;
 
 private:
     std::string name;
     bool verbose = false;
     bool interactive = false;
-    Gtk::Window* parent = nullptr;
 };
 } /* namespace gdfm */
 
@@ -22,7 +22,6 @@
 
 #include "modulefile.h"
 
-#include "modulefileeditor.h"
 #include "util.h"
 
 namespace gdfm {
@@ -102,11 +101,45 @@ ModuleFile::getDestinationPath() const
     return destinationPath;
 }
 
+std::string
+ModuleFile::getDestinationPath(const std::string& homeDirectory) const
+{
+    return shellExpandPath(
+        destinationDirectory + "/" + destinationFilename, homeDirectory);
+}
+
+bool
+ModuleFile::isInHomeDirectory() const
+{
+    return gdfm::isInHomeDirectory(destinationDirectory);
+}
+
+std::shared_ptr<const TemplateVariables>
+ModuleFile::getTemplateVariables() const
+{
+    return templateVariables;
+}
+
+void
+ModuleFile::setTemplateVariables(
+    std::shared_ptr<const TemplateVariables> templateVariables)
+{
+    this->templateVariables = templateVariables;
+}
+
+bool
+ModuleFile::isTemplate() const
+{
+    return templateVariables != nullptr;
+}
+
 std::shared_ptr<InstallAction>
 ModuleFile::createInstallAction(const std::string& sourceDirectory) const
 {
-    return std::shared_ptr<InstallAction>(new InstallAction(
+    std::shared_ptr<InstallAction> action(new InstallAction(
         filename, sourceDirectory, destinationFilename, destinationDirectory));
+    action->setTemplateVariables(templateVariables);
+    return action;
 }
 
 std::shared_ptr<RemoveAction>
@@ -116,11 +149,30 @@ ModuleFile::createUninstallAction() const
         new RemoveAction(getDestinationPath()));
 }
 
+std::shared_ptr<RemoveAction>
+ModuleFile::createUninstallAction(const std::string& homeDirectory) const
+{
+    return std::shared_ptr<RemoveAction>(
+        new RemoveAction(getDestinationPath(homeDirectory)));
+}
+
 std::shared_ptr<FileCheckAction>
 ModuleFile::createUpdateAction(const std::string& sourceDirectory) const
 {
-    return std::shared_ptr<FileCheckAction>(new FileCheckAction(
+    std::shared_ptr<FileCheckAction> action(new FileCheckAction(
         getSourcePath(sourceDirectory), getDestinationPath()));
+    action->setTemplateVariables(templateVariables);
+    return action;
+}
+
+std::shared_ptr<FileCheckAction>
+ModuleFile::createUpdateAction(const std::string& sourceDirectory,
+    const std::string& homeDirectory) const
+{
+    std::shared_ptr<FileCheckAction> action(new FileCheckAction(
+        getSourcePath(sourceDirectory), getDestinationPath(homeDirectory)));
+    action->setTemplateVariables(templateVariables);
+    return action;
 }
 
 std::vector<std::string>
@@ -133,11 +185,4 @@ ModuleFile::createConfigLines() const
     lines.push_back(line);
     return lines;
 }
-
-void
-ModuleFile::graphicalEdit(Gtk::Window& window)
-{
-    ModuleFileEditor editor(window, this);
-    editor.run();
-}
 } /* namespace gdfm */
@@ -27,6 +27,7 @@
 #include <string>
 
 #include "filecheckaction.h"
+#include "filetemplate.h"
 #include "installaction.h"
 #include "removeaction.h"
 
@@ -51,21 +52,41 @@ public:
 
     std::string getSourcePath(const std::string& sourceDirectory) const;
     std::string getDestinationPath() const;
+    /*
+     * Returns where the file goes when homeDirectory stands in for the home
+     * directory.
+     */
+    std::string getDestinationPath(const std::string& homeDirectory) const;
+    /* Returns true if the file goes somewhere in the home directory. */
+    bool isInHomeDirectory() const;
+    /*
+     * The variables to fill the file in with as a template when it is
+     * installed, or nullptr if it is copied as it is.
+     */
+    std::shared_ptr<const TemplateVariables> getTemplateVariables() const;
+    void setTemplateVariables(
+        std::shared_ptr<const TemplateVariables> templateVariables);
+    bool isTemplate() const;
 
     std::shared_ptr<InstallAction> createInstallAction(
         const std::string& sourceDirectory) const;
     std::shared_ptr<RemoveAction> createUninstallAction() const;
+    std::shared_ptr<RemoveAction> createUninstallAction(
+        const std::string& homeDirectory) const;
     std::shared_ptr<FileCheckAction> createUpdateAction(
         const std::string& sourceDirectory) const;
+    std::shared_ptr<FileCheckAction> createUpdateAction(
+        const std::string& sourceDirectory,
+        const std::string& homeDirectory) const;
 
     std::vector<std::string> createConfigLines() const;
 
-    void graphicalEdit(Gtk::Window& window);
 
 private:
     std::string filename;
     std::string destinationDirectory;
     std::string destinationFilename;
+    std::shared_ptr<const TemplateVariables> templateVariables;
 };
 } /* namespace gdfm */
 
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulelist.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+
+namespace gdfm {
+
+namespace {
+
+/* Stands for a module that isn't matched with any other. */
+const size_t NO_MATCH = SIZE_MAX;
+
+/*
+ * Returns what a module is matched by when merging, which is its name and
+ * how many modules with that name came before it.
+ */
+std::string
+createMergeKey(const std::string& name,
+    std::unordered_map<std::string, size_t>& counts)
+{
+    return name + '\0' + std::to_string(counts[name]++);
+}
+
+/*
+ * Finds the longest run of targets that only go up, skipping any that are
+ * NO_MATCH.
+ *
+ * Returns whether each target is part of it.
+ */
+std::vector<bool>
+findIncreasingTargets(const std::vector<size_t>& targets)
+{
+    /* The last index of the best run of each length found so far. */
+    std::vector<size_t> tails;
+    std::vector<size_t> previous(targets.size(), NO_MATCH);
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (targets[i] == NO_MATCH)
+            continue;
+        auto tail = std::lower_bound(tails.begin(), tails.end(), i,
+            [&targets](size_t first, size_t second) {
+                return targets[first] < targets[second];
+            });
+        if (tail != tails.begin())
+            previous[i] = *(tail - 1);
+        if (tail == tails.end())
+            tails.push_back(i);
+        else
+            *tail = i;
+    }
+    std::vector<bool> increasing(targets.size(), false);
+    if (tails.empty())
+        return increasing;
+    for (size_t i = tails.back(); i != NO_MATCH; i = previous[i])
+        increasing[i] = true;
+    return increasing;
+}
+} /* namespace */
+
+ModuleListObserver::~ModuleListObserver()
+{
+}
+
+void
+ModuleListObserver::onModulesReset(size_t oldCount)
+{
+}
+
+void
+ModuleListObserver::onModuleInserted(size_t module)
+{
+}
+
+void
+ModuleListObserver::onModuleRemoved(size_t module)
+{
+}
+
+void
+ModuleListObserver::onFileInserted(size_t module, size_t file)
+{
+}
+
+void
+ModuleListObserver::onFileRemoved(size_t module, size_t file)
+{
+}
+
+void
+ModuleListObserver::onActionInserted(
+    size_t module, Module::ActionType type, size_t action)
+{
+}
+
+void
+ModuleListObserver::onActionRemoved(
+    size_t module, Module::ActionType type, size_t action)
+{
+}
+
+void
+ModuleListObserver::onActionsSwapped(
+    size_t module, Module::ActionType type, size_t first, size_t second)
+{
+}
+
+void
+ModuleListObserver::onModuleReplaced(size_t module, const Module& previous)
+{
+}
+
+void
+ModuleListObserver::onModulesChanged()
+{
+}
+
+const size_t ModuleList::DEFAULT_HISTORY_LIMIT;
+
+ModuleList::ModuleList()
+{
+}
+
+std::vector<Module>
+ModuleList::getModules() const
+{
+    std::vector<Module> copies;
+    copies.reserve(modules.size());
+    for (const auto& module : modules)
+        copies.push_back(*module);
+    return copies;
+}
+
+size_t
+ModuleList::getModuleCount() const
+{
+    return modules.size();
+}
+
+const Module&
+ModuleList::getModule(size_t index) const
+{
+    return *modules[index];
+}
+
+ModuleId
+ModuleList::getModuleId(size_t index) const
+{
+    return ids[index];
+}
+
+bool
+ModuleList::findModule(ModuleId id, size_t& index) const
+{
+    auto iter = indices.find(id);
+    if (iter == indices.end())
+        return false;
+    index = iter->second;
+    return true;
+}
+
+void
+ModuleList::setModules(const std::vector<Module>& modules)
+{
+    size_t oldCount = this->modules.size();
+    this->modules.clear();
+    ids.clear();
+    indices.clear();
+    for (const auto& module : modules) {
+        this->modules.push_back(std::make_shared<const Module>(module));
+        ids.push_back(nextId++);
+    }
+    updateIndices(0);
+    clearHistory();
+    markSaved();
+    for (ModuleListObserver* observer : observers)
+        observer->onModulesReset(oldCount);
+    notifyChanged();
+}
+
+ModuleId
+ModuleList::appendModule(const Module& module)
+{
+    return insertModule(modules.size(), module);
+}
+
+ModuleId
+ModuleList::insertModule(size_t index, const Module& module)
+{
+    ModuleId id = nextId++;
+    Change change = { Change::INSERT, index, id, nullptr,
+        std::make_shared<const Module>(module) };
+    insertAt(index, id, change.after);
+    record(change);
+    for (ModuleListObserver* observer : observers)
+        observer->onModuleInserted(index);
+    notifyChanged();
+    return id;
+}
+
+void
+ModuleList::removeModule(size_t index)
+{
+    Change change = { Change::REMOVE, index, ids[index], modules[index],
+        nullptr };
+    eraseAt(index);
+    record(change);
+    for (ModuleListObserver* observer : observers)
+        observer->onModuleRemoved(index);
+    notifyChanged();
+}
+
+void
+ModuleList::addFile(size_t module, const ModuleFile& file)
+{
+    std::shared_ptr<Module> changed =
+        std::make_shared<Module>(*modules[module]);
+    changed->getFiles().push_back(file);
+    size_t fileIndex = changed->getFiles().size() - 1;
+    replaceAt(module, changed);
+    for (ModuleListObserver* observer : observers)
+        observer->onFileInserted(module, fileIndex);
+    notifyChanged();
+}
+
+void
+ModuleList::removeFile(size_t module, size_t file)
+{
+    std::shared_ptr<Module> changed =
+        std::make_shared<Module>(*modules[module]);
+    std::vector<ModuleFile>& files = changed->getFiles();
+    files.erase(files.begin() + file);
+    replaceAt(module, changed);
+    for (ModuleListObserver* observer : observers)
+        observer->onFileRemoved(module, file);
+    notifyChanged();
+}
+
+void
+ModuleList::addAction(size_t module, Module::ActionType type,
+    std::shared_ptr<ModuleAction> action)
+{
+    std::shared_ptr<Module> changed =
+        std::make_shared<Module>(*modules[module]);
+    std::vector<std::shared_ptr<ModuleAction>>& actions =
+        changed->getActions(type);
+    actions.push_back(action);
+    size_t actionIndex = actions.size() - 1;
+    replaceAt(module, changed);
+    for (ModuleListObserver* observer : observers)
+        observer->onActionInserted(module, type, actionIndex);
+    notifyChanged();
+}
+
+void
+ModuleList::removeAction(size_t module, Module::ActionType type, size_t action)
+{
+    std::shared_ptr<Module> changed =
+        std::make_shared<Module>(*modules[module]);
+    std::vector<std::shared_ptr<ModuleAction>>& actions =
+        changed->getActions(type);
+    actions.erase(actions.begin() + action);
+    replaceAt(module, changed);
+    for (ModuleListObserver* observer : observers)
+        observer->onActionRemoved(module, type, action);
+    notifyChanged();
+}
+
+void
+ModuleList::swapActions(
+    size_t module, Module::ActionType type, size_t first, size_t second)
+{
+    std::shared_ptr<Module> changed =
+        std::make_shared<Module>(*modules[module]);
+    std::vector<std::shared_ptr<ModuleAction>>& actions =
+        changed->getActions(type);
+    std::swap(actions[first], actions[second]);
+    replaceAt(module, changed);
+    for (ModuleListObserver* observer : observers)
+        observer->onActionsSwapped(module, type, first, second);
+    notifyChanged();
+}
+
+void
+ModuleList::replaceModule(size_t index, const Module& module)
+{
+    std::string oldText;
+    std::string newText;
+    modules[index]->writeConfig(oldText);
+    module.writeConfig(newText);
+    if (oldText == newText)
+        return;
+    std::shared_ptr<const Module> previous = modules[index];
+    replaceAt(index, std::make_shared<const Module>(module));
+    for (ModuleListObserver* observer : observers)
+        observer->onModuleReplaced(index, *previous);
+    notifyChanged();
+}
+
+void
+ModuleList::mergeModules(const std::vector<Module>& newModules)
+{
+    std::unordered_map<std::string, size_t> counts;
+    std::unordered_map<std::string, size_t> positions;
+    for (size_t i = 0; i < newModules.size(); i++)
+        positions[createMergeKey(newModules[i].getName(), counts)] = i;
+    counts.clear();
+    /* Where each module in the list is in newModules, if it is. */
+    std::vector<size_t> targets;
+    for (const auto& module : modules) {
+        auto found = positions.find(createMergeKey(module->getName(), counts));
+        targets.push_back(found != positions.end() ? found->second : NO_MATCH);
+    }
+    /*
+     * Modules that are matched but out of order are removed and inserted
+     * again where they go, keeping as many in place as possible.
+     */
+    std::vector<bool> kept = findIncreasingTargets(targets);
+
+    beginChanges();
+    std::vector<size_t> keptTargets;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (kept[i])
+            keptTargets.push_back(targets[i]);
+    }
+    for (size_t i = targets.size(); i-- > 0;) {
+        if (!kept[i])
+            removeModule(i);
+    }
+    size_t next = 0;
+    for (size_t i = 0; i < newModules.size(); i++) {
+        if (next < keptTargets.size() && keptTargets[next] == i) {
+            replaceModule(i, newModules[i]);
+            next++;
+        } else
+            insertModule(i, newModules[i]);
+    }
+    endChanges();
+}
+
+void
+ModuleList::beginChanges()
+{
+    changeDepth++;
+}
+
+void
+ModuleList::endChanges()
+{
+    if (changeDepth > 0 && --changeDepth == 0)
+        finishStep();
+}
+
+bool
+ModuleList::canUndo() const
+{
+    return !undoSteps.empty();
+}
+
+bool
+ModuleList::canRedo() const
+{
+    return !redoSteps.empty();
+}
+
+bool
+ModuleList::undo()
+{
+    if (changeDepth > 0 || undoSteps.empty())
+        return false;
+    Step step = std::move(undoSteps.back());
+    undoSteps.pop_back();
+    for (auto iter = step.rbegin(); iter != step.rend(); ++iter)
+        applyChange(*iter, false);
+    redoSteps.push_back(std::move(step));
+    notifyChanged();
+    return true;
+}
+
+bool
+ModuleList::redo()
+{
+    if (changeDepth > 0 || redoSteps.empty())
+        return false;
+    Step step = std::move(redoSteps.back());
+    redoSteps.pop_back();
+    for (const Change& change : step)
+        applyChange(change, true);
+    undoSteps.push_back(std::move(step));
+    notifyChanged();
+    return true;
+}
+
+void
+ModuleList::clearHistory()
+{
+    undoSteps.clear();
+    redoSteps.clear();
+    currentStep.clear();
+}
+
+size_t
+ModuleList::getHistoryLimit() const
+{
+    return historyLimit;
+}
+
+void
+ModuleList::setHistoryLimit(size_t limit)
+{
+    historyLimit = limit;
+    while (undoSteps.size() > historyLimit)
+        undoSteps.pop_front();
+}
+
+bool
+ModuleList::isModified() const
+{
+    return !modifiedModules.empty() || !removedModules.empty();
+}
+
+bool
+ModuleList::isModuleModified(ModuleId id) const
+{
+    return modifiedModules.count(id) > 0;
+}
+
+std::vector<ModuleId>
+ModuleList::getModifiedModules() const
+{
+    return std::vector<ModuleId>(
+        modifiedModules.begin(), modifiedModules.end());
+}
+
+std::vector<ModuleId>
+ModuleList::getRemovedModules() const
+{
+    return std::vector<ModuleId>(
+        removedModules.begin(), removedModules.end());
+}
+
+void
+ModuleList::markSaved()
+{
+    savedModules.clear();
+    for (size_t i = 0; i < modules.size(); i++)
+        savedModules[ids[i]] = modules[i];
+    modifiedModules.clear();
+    removedModules.clear();
+}
+
+void
+ModuleList::addObserver(ModuleListObserver* observer)
+{
+    observers.push_back(observer);
+}
+
+void
+ModuleList::removeObserver(ModuleListObserver* observer)
+{
+    observers.erase(std::remove(observers.begin(), observers.end(), observer),
+        observers.end());
+}
+
+void
+ModuleList::replaceAt(size_t index, std::shared_ptr<const Module> changed)
+{
+    Change change = { Change::REPLACE, index, ids[index], modules[index],
+        changed };
+    modules[index] = changed;
+    record(change);
+}
+
+void
+ModuleList::insertAt(
+    size_t index, ModuleId id, std::shared_ptr<const Module> module)
+{
+    modules.insert(modules.begin() + index, module);
+    ids.insert(ids.begin() + index, id);
+    updateIndices(index);
+}
+
+void
+ModuleList::eraseAt(size_t index)
+{
+    indices.erase(ids[index]);
+    modules.erase(modules.begin() + index);
+    ids.erase(ids.begin() + index);
+    updateIndices(index);
+}
+
+void
+ModuleList::record(const Change& change)
+{
+    redoSteps.clear();
+    currentStep.push_back(change);
+    updateModified(change.id);
+    if (changeDepth == 0)
+        finishStep();
+}
+
+void
+ModuleList::finishStep()
+{
+    if (currentStep.empty())
+        return;
+    undoSteps.push_back(std::move(currentStep));
+    currentStep.clear();
+    while (undoSteps.size() > historyLimit)
+        undoSteps.pop_front();
+}
+
+void
+ModuleList::applyChange(const Change& change, bool forward)
+{
+    Change::Kind kind = change.kind;
+    /* Undoing an insert is a remove, and the other way around. */
+    if (!forward && kind == Change::INSERT)
+        kind = Change::REMOVE;
+    else if (!forward && kind == Change::REMOVE)
+        kind = Change::INSERT;
+
+    switch (kind) {
+    case Change::INSERT:
+        insertAt(change.index, change.id,
+            (forward) ? change.after : change.before);
+        for (ModuleListObserver* observer : observers)
+            observer->onModuleInserted(change.index);
+        break;
+    case Change::REMOVE:
+        eraseAt(change.index);
+        for (ModuleListObserver* observer : observers)
+            observer->onModuleRemoved(change.index);
+        break;
+    case Change::REPLACE: {
+        std::shared_ptr<const Module> previous = modules[change.index];
+        modules[change.index] = (forward) ? change.after : change.before;
+        for (ModuleListObserver* observer : observers)
+            observer->onModuleReplaced(change.index, *previous);
+        break;
+    }
+    }
+    updateModified(change.id);
+}
+
+void
+ModuleList::updateModified(ModuleId id)
+{
+    auto saved = savedModules.find(id);
+    size_t index;
+    if (findModule(id, index)) {
+        removedModules.erase(id);
+        if (saved != savedModules.end() && saved->second == modules[index])
+            modifiedModules.erase(id);
+        else
+            modifiedModules.insert(id);
+    } else {
+        modifiedModules.erase(id);
+        if (saved != savedModules.end())
+            removedModules.insert(id);
+        else
+            removedModules.erase(id);
+    }
+}
+
+void
+ModuleList::updateIndices(size_t start)
+{
+    for (size_t i = start; i < ids.size(); i++)
+        indices[ids[i]] = i;
+}
+
+void
+ModuleList::notifyChanged()
+{
+    for (ModuleListObserver* observer : observers)
+        observer->onModulesChanged();
+}
+} /* namespace gdfm */
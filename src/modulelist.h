@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULE_LIST_H
+#define MODULE_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "module.h"
+
+namespace gdfm {
+
+/*
+ * Identifies a module in a ModuleList for as long as it is in the list, even
+ * as modules before it are added and removed. Identifiers aren't reused.
+ */
+typedef uint64_t ModuleId;
+
+/*
+ * Gets told about every change to a ModuleList right after it happens, so a
+ * view can stay in sync without reading the whole list again. The indices
+ * are positions after the change.
+ */
+class ModuleListObserver {
+public:
+    virtual ~ModuleListObserver();
+
+    /* Every module was replaced. There used to be oldCount of them. */
+    virtual void onModulesReset(size_t oldCount);
+    virtual void onModuleInserted(size_t module);
+    /* The module that used to be at this index was removed. */
+    virtual void onModuleRemoved(size_t module);
+    virtual void onFileInserted(size_t module, size_t file);
+    virtual void onFileRemoved(size_t module, size_t file);
+    virtual void onActionInserted(size_t module,
+        Module::ActionType type, size_t action);
+    virtual void onActionRemoved(size_t module,
+        Module::ActionType type, size_t action);
+    virtual void onActionsSwapped(size_t module, Module::ActionType type,
+        size_t first, size_t second);
+    /*
+     * The module at this index was swapped for another version of it, such
+     * as an edited copy or the version from before a change that was undone.
+     * Anything in it may be different from previous.
+     */
+    virtual void onModuleReplaced(size_t module, const Module& previous);
+    /*
+     * Something changed. This comes after the callbacks above, once for each
+     * change and once for each step that is undone or redone, for observers
+     * that only care that the modules are different.
+     */
+    virtual void onModulesChanged();
+};
+
+/*
+ * The modules being edited, and the one place they are kept. Every change
+ * goes through here so that observers hear about it, so that the list knows
+ * which modules changed since they were last saved, and so that changes can
+ * be undone.
+ *
+ * Modules in the list are never changed in place. A change puts a changed
+ * copy in place of the module, so the history only keeps the versions of the
+ * modules each step touched and shares everything else with the list. That
+ * keeps the history's memory proportional to the edits rather than to the
+ * number of modules, and undoing a step only swaps back the modules it
+ * touched.
+ */
+class ModuleList {
+public:
+    /* How many steps of history are kept unless told otherwise. */
+    static const size_t DEFAULT_HISTORY_LIMIT = 10000;
+
+    ModuleList();
+
+    /* Returns a copy of every module, such as for a run on another thread. */
+    std::vector<Module> getModules() const;
+    size_t getModuleCount() const;
+    const Module& getModule(size_t index) const;
+    ModuleId getModuleId(size_t index) const;
+    /*
+     * Finds the module with the given identifier and stores its index.
+     *
+     * Returns true if it is in the list, false otherwise.
+     */
+    bool findModule(ModuleId id, size_t& index) const;
+
+    /*
+     * Replaces every module, such as after reading a config file. The new
+     * modules start out unmodified and the history is cleared.
+     */
+    void setModules(const std::vector<Module>& modules);
+    ModuleId appendModule(const Module& module);
+    ModuleId insertModule(size_t index, const Module& module);
+    void removeModule(size_t index);
+    void addFile(size_t module, const ModuleFile& file);
+    void removeFile(size_t module, size_t file);
+    void addAction(size_t module, Module::ActionType type,
+        std::shared_ptr<ModuleAction> action);
+    void removeAction(size_t module, Module::ActionType type, size_t action);
+    void swapActions(
+        size_t module, Module::ActionType type, size_t first, size_t second);
+    /*
+     * Puts module in place of the one at index. Edit a copy from
+     * Module::clone() and pass it here, since the actions of a plain copy
+     * are shared with the history. Nothing happens if module would be
+     * written to a config file the same way as the one it replaces, such as
+     * when an edit was cancelled.
+     */
+    void replaceModule(size_t index, const Module& module);
+    /*
+     * Changes the list into modules, such as after the config file was
+     * changed by something else, with as few changes as it takes. Modules
+     * are matched up by name, and by order among modules with the same
+     * name. Matched modules keep their identifiers and are replaced only if
+     * they are different, and those that are already in order stay where
+     * they are. Everything else is removed or inserted. It all becomes one
+     * step of history.
+     */
+    void mergeModules(const std::vector<Module>& modules);
+
+    /*
+     * Every change until the matching endChanges() becomes one step of
+     * history, so one undo takes all of them back. Calls may be nested.
+     */
+    void beginChanges();
+    void endChanges();
+    bool canUndo() const;
+    bool canRedo() const;
+    /*
+     * Takes back the most recent step of history, or puts back the most
+     * recently undone one. Any new change forgets what was undone.
+     *
+     * Returns true if there was a step to undo or redo, false otherwise.
+     */
+    bool undo();
+    bool redo();
+    void clearHistory();
+    size_t getHistoryLimit() const;
+    /* Forgets the oldest steps if there are more than limit. */
+    void setHistoryLimit(size_t limit);
+
+    /* Returns true if anything changed since the last load or save. */
+    bool isModified() const;
+    bool isModuleModified(ModuleId id) const;
+    /*
+     * Returns the modules that were changed or added since the last load or
+     * save, in no particular order. A module that was changed and then
+     * changed back, like by undoing, doesn't count.
+     */
+    std::vector<ModuleId> getModifiedModules() const;
+    /*
+     * Returns the modules that were in the list at the last load or save and
+     * have been removed since, in no particular order.
+     */
+    std::vector<ModuleId> getRemovedModules() const;
+    /* Makes the current modules the saved ones. */
+    void markSaved();
+
+    /*
+     * The observer must be removed before it is destroyed. The list doesn't
+     * own it.
+     */
+    void addObserver(ModuleListObserver* observer);
+    void removeObserver(ModuleListObserver* observer);
+
+private:
+    /*
+     * One change to one module, holding the versions from before and after
+     * it. Inserted modules have no before, and removed ones have no after.
+     */
+    struct Change {
+        enum Kind { INSERT, REMOVE, REPLACE };
+
+        Kind kind;
+        size_t index;
+        ModuleId id;
+        std::shared_ptr<const Module> before;
+        std::shared_ptr<const Module> after;
+    };
+    typedef std::vector<Change> Step;
+
+    std::vector<std::shared_ptr<const Module>> modules;
+    /* The identifier of each module, parallel to modules. */
+    std::vector<ModuleId> ids;
+    std::unordered_map<ModuleId, size_t> indices;
+    ModuleId nextId = 1;
+
+    std::deque<Step> undoSteps;
+    std::vector<Step> redoSteps;
+    /* The changes since the outermost beginChanges(). */
+    Step currentStep;
+    int changeDepth = 0;
+    size_t historyLimit = DEFAULT_HISTORY_LIMIT;
+
+    /* The version of each module as of the last load or save. */
+    std::unordered_map<ModuleId, std::shared_ptr<const Module>> savedModules;
+    std::unordered_set<ModuleId> modifiedModules;
+    std::unordered_set<ModuleId> removedModules;
+
+    std::vector<ModuleListObserver*> observers;
+
+    /*
+     * Puts changed in place of the module at index and records it, without
+     * telling observers.
+     */
+    void replaceAt(size_t index, std::shared_ptr<const Module> changed);
+    void insertAt(
+        size_t index, ModuleId id, std::shared_ptr<const Module> module);
+    void eraseAt(size_t index);
+    /* Adds change to the current step, which ends here if not grouped. */
+    void record(const Change& change);
+    /* Adds the current step to the history if it has anything in it. */
+    void finishStep();
+    /* Does change again, or undoes it if forward is false. */
+    void applyChange(const Change& change, bool forward);
+    /* Compares the module with id to its saved version. */
+    void updateModified(ModuleId id);
+    /* Fixes the index of every module from start on after a change. */
+    void updateIndices(size_t start);
+    void notifyChanged();
+};
+} /* namespace gdfm */
+
+#endif /* MODULE_LIST_H */
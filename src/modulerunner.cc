@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulerunner.h"
+
+#include <err.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "filetemplate.h"
+#include "runcontext.h"
+#include "threadpool.h"
+#include "tracer.h"
+
+namespace gdfm {
+
+namespace {
+/* Returns the last count lines of text, which may end with a newline. */
+std::string
+getLastLines(const std::string& text, size_t count)
+{
+    size_t end = text.length();
+    if (end > 0 && text[end - 1] == '\n')
+        end--;
+    size_t start = end;
+    for (size_t lines = 0; start > 0; start--) {
+        if (text[start - 1] == '\n' && ++lines == count)
+            break;
+    }
+    return text.substr(start, end - start);
+}
+} /* namespace */
+
+ModuleRunner::ModuleRunner(
+    Operation operation, const std::string& sourceDirectory)
+    : operation(operation),
+      sourceDirectory(sourceDirectory),
+      outputSink(StreamOutputSink::getStandardOutput()),
+      cancelled(false)
+{
+}
+
+ModuleRunner::Operation
+ModuleRunner::getOperation() const
+{
+    return operation;
+}
+
+const std::string&
+ModuleRunner::getSourceDirectory() const
+{
+    return sourceDirectory;
+}
+
+unsigned int
+ModuleRunner::getJobs() const
+{
+    return jobs;
+}
+
+void
+ModuleRunner::setJobs(unsigned int jobs)
+{
+    this->jobs = (jobs > 0) ? jobs : 1;
+}
+
+std::shared_ptr<OutputSink>
+ModuleRunner::getOutputSink() const
+{
+    return outputSink;
+}
+
+void
+ModuleRunner::setOutputSink(std::shared_ptr<OutputSink> outputSink)
+{
+    this->outputSink = outputSink;
+}
+
+std::shared_ptr<BackupStore>
+ModuleRunner::getBackupStore() const
+{
+    return backupStore;
+}
+
+void
+ModuleRunner::setBackupStore(std::shared_ptr<BackupStore> backupStore)
+{
+    this->backupStore = backupStore;
+}
+
+const std::vector<std::string>&
+ModuleRunner::getTargetDirectories() const
+{
+    return targetDirectories;
+}
+
+void
+ModuleRunner::setTargetDirectories(
+    const std::vector<std::string>& targetDirectories)
+{
+    this->targetDirectories = targetDirectories;
+}
+
+int
+ModuleRunner::getCopyAttributes() const
+{
+    return copyAttributes;
+}
+
+void
+ModuleRunner::setCopyAttributes(int copyAttributes)
+{
+    this->copyAttributes = copyAttributes;
+}
+
+size_t
+ModuleRunner::getMemoryBudget() const
+{
+    return memoryBudget;
+}
+
+void
+ModuleRunner::setMemoryBudget(size_t memoryBudget)
+{
+    this->memoryBudget = memoryBudget;
+}
+
+const std::string&
+ModuleRunner::getRunName() const
+{
+    return runName;
+}
+
+RunStatistics&
+ModuleRunner::getStatistics()
+{
+    return statistics;
+}
+
+bool
+ModuleRunner::run(const std::vector<Module>& modules)
+{
+    TraceSpan span("run", "ModuleRunner::run", getOperationName(operation));
+    failedModules.clear();
+    runName = BackupStore::createRunName();
+    templateCache = std::make_shared<TemplateCache>();
+    bufferPool = std::make_shared<BufferPool>(memoryBudget);
+    if (backupStore)
+        backupStore->startRunRecord(runName);
+    statistics.start();
+    uint64_t totalActions = 0;
+    for (const auto& module : modules)
+        totalActions += countActions(operation, module, targetDirectories);
+    statistics.setTotalActions(totalActions);
+    bool status = runModules(modules);
+    statistics.stop();
+    if (backupStore && !backupStore->finishRunRecord()) {
+        warnx("Failed to write the backup record for run %s.",
+            runName.c_str());
+        status = false;
+    }
+    return status;
+}
+
+bool
+ModuleRunner::runModules(const std::vector<Module>& modules)
+{
+    if (jobs == 1 || modules.size() < 2) {
+        for (const auto& module : modules) {
+            if (cancelled)
+                return false;
+            std::string failureOutput;
+            if (!runModule(module, failureOutput)) {
+                addFailedModule(module.getName(), failureOutput);
+                return false;
+            }
+        }
+        return !cancelled;
+    }
+
+    unsigned int threadCount =
+        (modules.size() < jobs) ? modules.size() : jobs;
+    std::atomic<bool> failed(false);
+    ThreadPool pool(threadCount);
+    for (const auto& module : modules) {
+        const Module* modulePointer = &module;
+        pool.submit([this, modulePointer, &failed]() {
+            if (failed || cancelled)
+                return;
+            std::string failureOutput;
+            if (!runModule(*modulePointer, failureOutput)) {
+                failed = true;
+                addFailedModule(modulePointer->getName(), failureOutput);
+            }
+        });
+    }
+    pool.wait();
+    return !failed && !cancelled;
+}
+
+bool
+ModuleRunner::runModule(const Module& module, std::string& failureOutput)
+{
+    RunContext context;
+    context.setModuleName(module.getName());
+    context.setOutputSink(outputSink);
+    context.setStatistics(&statistics);
+    context.setBackupStore(backupStore);
+    context.setTemplateCache(templateCache);
+    context.setCopyAttributes(copyAttributes);
+    context.setBufferPool(bufferPool);
+    context.setCancelFlag(&cancelled);
+    RunContext::Scope scope(context);
+    std::chrono::steady_clock::time_point startTime =
+        std::chrono::steady_clock::now();
+    bool status = false;
+    switch (operation) {
+    case INSTALL_OPERATION:
+        status = module.install(sourceDirectory, targetDirectories);
+        break;
+    case UNINSTALL_OPERATION:
+        status = module.uninstall(sourceDirectory, targetDirectories);
+        break;
+    case UPDATE_OPERATION:
+        status = module.update(sourceDirectory, targetDirectories);
+        break;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    statistics.addModuleTime(
+        ModuleTime{module.getName(), elapsed.count(), status});
+    failureOutput =
+        getLastLines(context.getFailureOutput(), FAILURE_OUTPUT_LINES);
+    /* A module that was stopped by cancelling the run didn't fail. */
+    return status || cancelled;
+}
+
+void
+ModuleRunner::addFailedModule(
+    const std::string& name, const std::string& failureOutput)
+{
+    std::lock_guard<std::mutex> lock(failedModulesMutex);
+    failedModules.push_back(FailedModule{name, failureOutput});
+}
+
+const std::vector<ModuleRunner::FailedModule>&
+ModuleRunner::getFailedModules() const
+{
+    return failedModules;
+}
+
+void
+ModuleRunner::cancel()
+{
+    cancelled = true;
+}
+
+bool
+ModuleRunner::wasCancelled() const
+{
+    return cancelled;
+}
+
+const char*
+ModuleRunner::getOperationName(Operation operation)
+{
+    switch (operation) {
+    case INSTALL_OPERATION:
+        return "install";
+    case UNINSTALL_OPERATION:
+        return "uninstall";
+    case UPDATE_OPERATION:
+        return "update";
+    }
+    return "unknown";
+}
+
+size_t
+ModuleRunner::countActions(Operation operation, const Module& module)
+{
+    size_t fileCount = module.getFiles().size();
+    switch (operation) {
+    case INSTALL_OPERATION:
+        return fileCount + module.getInstallActions().size();
+    case UNINSTALL_OPERATION:
+        return fileCount + module.getUninstallActions().size();
+    case UPDATE_OPERATION:
+        return fileCount + module.getUpdateActions().size();
+    }
+    return fileCount;
+}
+
+size_t
+ModuleRunner::countActions(Operation operation, const Module& module,
+    const std::vector<std::string>& targetDirectories)
+{
+    size_t actionCount = countActions(operation, module);
+    /* Installing puts a file in every target with one action. */
+    if (operation == INSTALL_OPERATION)
+        return actionCount;
+    for (const auto& file : module.getFiles())
+        actionCount +=
+            Module::getFileTargets(file, targetDirectories).size() - 1;
+    return actionCount;
+}
+} /* namespace gdfm */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULE_RUNNER_H
+#define MODULE_RUNNER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "backupstore.h"
+#include "bufferpool.h"
+#include "module.h"
+#include "outputsink.h"
+#include "runstatistics.h"
+#include "util.h"
+
+namespace gdfm {
+
+/*
+ * How many lines from the end of the output of a command that failed are
+ * kept to show with the failure.
+ */
+const size_t FAILURE_OUTPUT_LINES = 10;
+
+/*
+ * Installs, uninstalls, or updates a list of modules. With one job, which is
+ * the default, modules run in order and the run stops at the first failure,
+ * the same as looping over them by hand. With more, modules run at the same
+ * time on a pool of that many threads, so each module's actions must not
+ * depend on another module having run first.
+ *
+ * Every module runs with its own RunContext, so output from its shell
+ * actions goes to the output sink prefixed with the module's name.
+ *
+ * A run can be cancelled from another thread. It then stops between actions,
+ * so no action is ever interrupted halfway through.
+ */
+class ModuleRunner {
+public:
+    enum Operation {
+        INSTALL_OPERATION,
+        UNINSTALL_OPERATION,
+        UPDATE_OPERATION
+    };
+
+    /* A module that failed in a run. */
+    struct FailedModule {
+        std::string name;
+        /*
+         * The last FAILURE_OUTPUT_LINES lines of output from the command
+         * that made it fail, or empty if it wasn't a command.
+         */
+        std::string output;
+    };
+
+    ModuleRunner(Operation operation, const std::string& sourceDirectory);
+
+    Operation getOperation() const;
+    const std::string& getSourceDirectory() const;
+    unsigned int getJobs() const;
+    void setJobs(unsigned int jobs);
+    std::shared_ptr<OutputSink> getOutputSink() const;
+    void setOutputSink(std::shared_ptr<OutputSink> outputSink);
+    /*
+     * Keeps every file the run writes over or removes in backupStore first,
+     * and writes down what it kept and created under the name of the run, so
+     * the run can be rolled back. A file that can't be backed up is left
+     * alone and its module fails. The store remembers what it backed up, so
+     * use a new one for each run.
+     */
+    std::shared_ptr<BackupStore> getBackupStore() const;
+    void setBackupStore(std::shared_ptr<BackupStore> backupStore);
+    /*
+     * Puts the files that go in the home directory in each of these
+     * directories instead, when there are any.
+     */
+    const std::vector<std::string>& getTargetDirectories() const;
+    void setTargetDirectories(
+        const std::vector<std::string>& targetDirectories);
+    /*
+     * What copies keep besides their contents, as a mask of CopyAttribute.
+     * Only the permissions by default.
+     */
+    int getCopyAttributes() const;
+    void setCopyAttributes(int copyAttributes);
+    /*
+     * How many bytes the buffers files are copied and compared through may
+     * take up at once, across every module of a run.
+     */
+    size_t getMemoryBudget() const;
+    void setMemoryBudget(size_t memoryBudget);
+    /* Returns the name of the last run, which is set as it starts. */
+    const std::string& getRunName() const;
+    /*
+     * Returns the counters for the runner. They may be read from other
+     * threads while a run is happening. Work done before run() while they
+     * are current, such as reading the config file, is counted too.
+     */
+    RunStatistics& getStatistics();
+
+    /*
+     * Runs the operation on every module. When running in parallel, a
+     * failure stops modules that haven't started yet but lets the ones that
+     * already started finish.
+     *
+     * Returns true if every module succeeded, false otherwise.
+     */
+    bool run(const std::vector<Module>& modules);
+    /* The modules that failed in the last run. */
+    const std::vector<FailedModule>& getFailedModules() const;
+    /*
+     * Asks the run to stop before its next action. Safe to call from any
+     * thread, including before the run starts. A cancelled runner stays
+     * cancelled.
+     */
+    void cancel();
+    /* Returns true if cancel() has been called. */
+    bool wasCancelled() const;
+
+    /* Returns "install", "uninstall", or "update". */
+    static const char* getOperationName(Operation operation);
+    /*
+     * Returns the number of actions that the operation performs on the
+     * module, counting one for each of its files.
+     */
+    static size_t countActions(Operation operation, const Module& module);
+    /* Same as above, running the module in targetDirectories. */
+    static size_t countActions(Operation operation, const Module& module,
+        const std::vector<std::string>& targetDirectories);
+
+private:
+    Operation operation;
+    std::string sourceDirectory;
+    unsigned int jobs = 1;
+    std::shared_ptr<OutputSink> outputSink;
+    std::shared_ptr<BackupStore> backupStore;
+    std::vector<std::string> targetDirectories;
+    int copyAttributes = COPY_MODE;
+    size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+    /* The buffers of the current run. */
+    std::shared_ptr<BufferPool> bufferPool;
+    /* Templates read during the current run. */
+    std::shared_ptr<TemplateCache> templateCache;
+    std::string runName;
+    std::vector<FailedModule> failedModules;
+    std::mutex failedModulesMutex;
+    RunStatistics statistics;
+    std::atomic<bool> cancelled;
+
+    bool runModules(const std::vector<Module>& modules);
+    /*
+     * Runs the operation on module, storing the output of the command that
+     * made it fail in failureOutput if it does.
+     */
+    bool runModule(const Module& module, std::string& failureOutput);
+    void addFailedModule(
+        const std::string& name, const std::string& failureOutput);
+};
+} /* namespace gdfm */
+
+#endif /* MODULE_RUNNER_H */
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulesearchindex.h"
+
+#include <ctype.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace gdfm {
+
+namespace {
+
+/*
+ * Lowercases text in place. Bytes of UTF-8 characters are above 127, so they
+ * are passed to tolower as unsigned char, and it leaves them as they are.
+ */
+void
+makeLowercase(std::string& text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](unsigned char c) { return static_cast<char>(tolower(c)); });
+}
+} /* namespace */
+
+ModuleSearchIndex::ModuleSearchIndex(std::shared_ptr<ModuleList> moduleList)
+    : moduleList(moduleList)
+{
+    moduleList->addObserver(this);
+    rebuild();
+}
+
+ModuleSearchIndex::~ModuleSearchIndex()
+{
+    moduleList->removeObserver(this);
+}
+
+std::vector<size_t>
+ModuleSearchIndex::search(const std::string& query) const
+{
+    std::vector<std::string> terms;
+    std::istringstream stream(query);
+    std::string term;
+    while (stream >> term) {
+        makeLowercase(term);
+        terms.push_back(term);
+    }
+
+    std::vector<size_t> matches;
+    if (terms.empty()) {
+        for (size_t i = 0; i < documents.size(); i++)
+            matches.push_back(i);
+        return matches;
+    }
+
+    /*
+     * Only modules with every trigram of a term can contain it, so the ones
+     * with the term's rarest trigram are the only candidates. Terms shorter
+     * than a trigram have to be checked against everything.
+     */
+    const std::vector<ModuleId>* candidates = nullptr;
+    for (const auto& term : terms) {
+        for (const Trigram trigram : createTrigrams(term)) {
+            auto posting = postings.find(trigram);
+            if (posting == postings.end())
+                return matches;
+            if (!candidates || posting->second.size() < candidates->size())
+                candidates = &posting->second;
+        }
+    }
+
+    auto containsTerms = [&terms](const Document& document) {
+        for (const auto& term : terms) {
+            if (document.text.find(term) == std::string::npos)
+                return false;
+        }
+        return true;
+    };
+    /*
+     * Once a good part of the modules are candidates, going through all of
+     * them in order is faster than finding each candidate.
+     */
+    if (!candidates || candidates->size() > documents.size() / 8) {
+        for (size_t i = 0; i < documents.size(); i++) {
+            if (containsTerms(documents[i]))
+                matches.push_back(i);
+        }
+        return matches;
+    }
+    size_t index;
+    for (const ModuleId id : *candidates) {
+        if (moduleList->findModule(id, index)
+            && containsTerms(documents[index]))
+            matches.push_back(index);
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+void
+ModuleSearchIndex::onModulesReset(size_t oldCount)
+{
+    rebuild();
+}
+
+void
+ModuleSearchIndex::onModuleInserted(size_t module)
+{
+    auto document = documents.insert(documents.begin() + module, Document());
+    document->id = moduleList->getModuleId(module);
+    indexDocument(*document, moduleList->getModule(module));
+}
+
+void
+ModuleSearchIndex::onModuleRemoved(size_t module)
+{
+    removePostings(documents[module]);
+    documents.erase(documents.begin() + module);
+}
+
+void
+ModuleSearchIndex::onFileInserted(size_t module, size_t file)
+{
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::onFileRemoved(size_t module, size_t file)
+{
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::onActionInserted(
+    size_t module, Module::ActionType type, size_t action)
+{
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::onActionRemoved(
+    size_t module, Module::ActionType type, size_t action)
+{
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::onActionsSwapped(
+    size_t module, Module::ActionType type, size_t first, size_t second)
+{
+    /* The same text in a different order has the same trigrams. */
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::onModuleReplaced(size_t module, const Module& previous)
+{
+    reindex(module);
+}
+
+void
+ModuleSearchIndex::rebuild()
+{
+    postings.clear();
+    documents.clear();
+    documents.resize(moduleList->getModuleCount());
+    for (size_t i = 0; i < documents.size(); i++) {
+        documents[i].id = moduleList->getModuleId(i);
+        indexDocument(documents[i], moduleList->getModule(i));
+    }
+}
+
+void
+ModuleSearchIndex::indexDocument(Document& document, const Module& module)
+{
+    document.text = createText(module);
+    document.trigrams = createTrigrams(document.text);
+    for (const Trigram trigram : document.trigrams)
+        postings[trigram].push_back(document.id);
+}
+
+void
+ModuleSearchIndex::removePostings(const Document& document)
+{
+    for (const Trigram trigram : document.trigrams) {
+        auto posting = postings.find(trigram);
+        if (posting == postings.end())
+            continue;
+        std::vector<ModuleId>& modules = posting->second;
+        auto iter = std::find(modules.begin(), modules.end(), document.id);
+        if (iter != modules.end()) {
+            /* Order doesn't matter, so fill the hole with the last one. */
+            *iter = modules.back();
+            modules.pop_back();
+        }
+        if (modules.empty())
+            postings.erase(posting);
+    }
+}
+
+void
+ModuleSearchIndex::reindex(size_t module)
+{
+    removePostings(documents[module]);
+    indexDocument(documents[module], moduleList->getModule(module));
+}
+
+std::string
+ModuleSearchIndex::createText(const Module& module)
+{
+    /*
+     * Newlines keep a match from spanning two parts. Destinations are kept
+     * as they are written, like "~/.config/foo", since that is what people
+     * search for, and expanding them would run a shell for each one.
+     */
+    std::string text = module.getName();
+    for (const auto& file : module.getFiles()) {
+        text += '\n';
+        text += file.getFilename();
+        text += '\n';
+        text += file.getDestinationDirectory();
+        text += '/';
+        text += file.getDestinationFilename();
+    }
+    for (int i = 0; i < Module::ACTION_TYPE_COUNT; i++) {
+        Module::ActionType type = static_cast<Module::ActionType>(i);
+        for (const auto& action : module.getActions(type)) {
+            for (const auto& line : action->createConfigLines()) {
+                text += '\n';
+                text += line;
+            }
+        }
+    }
+    makeLowercase(text);
+    return text;
+}
+
+std::vector<ModuleSearchIndex::Trigram>
+ModuleSearchIndex::createTrigrams(const std::string& text)
+{
+    std::vector<Trigram> trigrams;
+    for (std::string::size_type i = 0; i + 3 <= text.length(); i++)
+        trigrams.push_back(makeTrigram(text.data() + i));
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(
+        std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+ModuleSearchIndex::Trigram
+ModuleSearchIndex::makeTrigram(const char* characters)
+{
+    return static_cast<unsigned char>(characters[0]) << 16
+        | static_cast<unsigned char>(characters[1]) << 8
+        | static_cast<unsigned char>(characters[2]);
+}
+} /* namespace gdfm */
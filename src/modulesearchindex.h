@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULE_SEARCH_INDEX_H
+#define MODULE_SEARCH_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "modulelist.h"
+
+namespace gdfm {
+
+/*
+ * Finds modules by what is in them, for searching a large config as someone
+ * types. The name of each module, the paths of its files, and the config
+ * lines of its actions are kept lowercased, and every three character
+ * sequence in them, or trigram, maps to the modules that contain it. A
+ * search only looks at the modules that contain the rarest trigram of each
+ * search term instead of at every module.
+ *
+ * The index is an observer of its ModuleList and only reindexes the modules
+ * that change, so it is always up to date without being rebuilt.
+ */
+class ModuleSearchIndex : public ModuleListObserver {
+public:
+    ModuleSearchIndex(std::shared_ptr<ModuleList> moduleList);
+    virtual ~ModuleSearchIndex();
+
+    /*
+     * Finds the modules that contain every word of query, ignoring case.
+     *
+     * Returns the indices of the matching modules in the list, in order. An
+     * empty query matches every module.
+     */
+    std::vector<size_t> search(const std::string& query) const;
+
+    void onModulesReset(size_t oldCount) override;
+    void onModuleInserted(size_t module) override;
+    void onModuleRemoved(size_t module) override;
+    void onFileInserted(size_t module, size_t file) override;
+    void onFileRemoved(size_t module, size_t file) override;
+    void onActionInserted(
+        size_t module, Module::ActionType type, size_t action) override;
+    void onActionRemoved(
+        size_t module, Module::ActionType type, size_t action) override;
+    void onActionsSwapped(size_t module, Module::ActionType type,
+        size_t first, size_t second) override;
+    void onModuleReplaced(size_t module, const Module& previous) override;
+
+private:
+    typedef uint32_t Trigram;
+
+    /* What is searched for one module. */
+    struct Document {
+        ModuleId id;
+        std::string text;
+        std::vector<Trigram> trigrams;
+    };
+
+    std::shared_ptr<ModuleList> moduleList;
+    /*
+     * The document for each module, parallel to the list, so that removed
+     * modules can still be found by index.
+     */
+    std::vector<Document> documents;
+    /* The modules that contain each trigram, in no particular order. */
+    std::unordered_map<Trigram, std::vector<ModuleId>> postings;
+
+    void rebuild();
+    /* Fills in document for module and adds it to the postings. */
+    void indexDocument(Document& document, const Module& module);
+    void removePostings(const Document& document);
+    void reindex(size_t module);
+    /* Returns everything about module that can be searched for, lowercased. */
+    static std::string createText(const Module& module);
+    /* Returns the distinct trigrams in text. */
+    static std::vector<Trigram> createTrigrams(const std::string& text);
+    static Trigram makeTrigram(const char* characters);
+};
+} /* namespace gdfm */
+
+#endif /* MODULE_SEARCH_INDEX_H */
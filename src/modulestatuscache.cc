@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulestatuscache.h"
+
+#include <sys/stat.h>
+
+#include <unordered_set>
+
+namespace gdfm {
+
+const char*
+getModuleStatusLabel(ModuleStatus status)
+{
+    switch (status) {
+    case STATUS_INSTALLED:
+        return "Installed";
+    case STATUS_OUTDATED:
+        return "Outdated";
+    case STATUS_PARTIAL:
+        return "Partial";
+    case STATUS_MISSING:
+        return "Missing";
+    default:
+        return "";
+    }
+}
+
+ModuleStatusCache::ModuleStatusCache(unsigned int threadCount)
+    : watcher(pool, FileWatcher::ALL_PATHS), pool(threadCount)
+{
+    watcher.setReadyCallback([this]() { notifyUpdate(); });
+}
+
+ModuleStatusCache::~ModuleStatusCache()
+{
+    if (moduleList)
+        moduleList->removeObserver(this);
+    /* Don't wait for the watches to be set up just to throw them away. */
+    watcher.stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+}
+
+void
+ModuleStatusCache::setUpdateCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    updateCallback = callback;
+}
+
+void
+ModuleStatusCache::setModules(std::shared_ptr<ModuleList> moduleList,
+    const std::string& sourceDirectory)
+{
+    if (moduleList != this->moduleList) {
+        if (this->moduleList)
+            this->moduleList->removeObserver(this);
+        moduleList->addObserver(this);
+        this->moduleList = moduleList;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sourceDirectory != this->sourceDirectory) {
+            /* Every source is somewhere else now. */
+            this->sourceDirectory = sourceDirectory;
+            entries.clear();
+        }
+    }
+    reset();
+}
+
+bool
+ModuleStatusCache::finishSetup()
+{
+    return watcher.finishSetup();
+}
+
+void
+ModuleStatusCache::invalidate(const std::vector<ModuleId>& modules)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (ModuleId id : modules) {
+        auto found = entries.find(id);
+        if (found != entries.end())
+            enqueue(id, found->second);
+    }
+    startWorkers();
+}
+
+void
+ModuleStatusCache::prioritize(const std::vector<ModuleId>& modules)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    priorityQueue.clear();
+    for (ModuleId id : modules) {
+        auto found = entries.find(id);
+        if (found != entries.end() && found->second.queued)
+            priorityQueue.push_back(id);
+    }
+}
+
+bool
+ModuleStatusCache::getStatus(ModuleId id, ModuleStatus& status) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(id);
+    if (found == entries.end() || !found->second.known)
+        return false;
+    status = found->second.status;
+    return true;
+}
+
+std::vector<ModuleId>
+ModuleStatusCache::takeUpdatedModules()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ModuleId> updated;
+    updated.swap(updatedModules);
+    return updated;
+}
+
+int
+ModuleStatusCache::getFileDescriptor() const
+{
+    return watcher.getFileDescriptor();
+}
+
+bool
+ModuleStatusCache::readEvents()
+{
+    return watcher.readEvents();
+}
+
+bool
+ModuleStatusCache::hasChanges() const
+{
+    return watcher.hasChanges();
+}
+
+void
+ModuleStatusCache::invalidateChanges()
+{
+    std::unordered_set<ModuleId> changed;
+    for (const auto& file : watcher.takeChangedFiles())
+        changed.insert(file.module);
+    invalidate(std::vector<ModuleId>(changed.begin(), changed.end()));
+}
+
+void
+ModuleStatusCache::onModulesReset(size_t oldCount)
+{
+    reset();
+}
+
+void
+ModuleStatusCache::onModuleInserted(size_t module)
+{
+    ModuleId id = moduleList->getModuleId(module);
+    ids.insert(ids.begin() + module, id);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[id];
+        entry.files = moduleList->getModule(module).getFiles();
+        enqueue(id, entry);
+        startWorkers();
+    }
+    watcher.watchModule(id, moduleList->getModule(module));
+}
+
+void
+ModuleStatusCache::onModuleRemoved(size_t module)
+{
+    ModuleId id = ids[module];
+    ids.erase(ids.begin() + module);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(id);
+    }
+    watcher.unwatchModule(id);
+}
+
+void
+ModuleStatusCache::onFileInserted(size_t module, size_t file)
+{
+    updateModule(module);
+}
+
+void
+ModuleStatusCache::onFileRemoved(size_t module, size_t file)
+{
+    updateModule(module);
+}
+
+void
+ModuleStatusCache::onModuleReplaced(size_t module, const Module& previous)
+{
+    updateModule(module);
+}
+
+ModuleStatus
+ModuleStatusCache::checkStatus(
+    const std::vector<std::shared_ptr<FileCheckAction>>& checks)
+{
+    if (checks.empty())
+        return STATUS_UNKNOWN;
+    size_t missing = 0;
+    size_t outdated = 0;
+    for (const auto& check : checks) {
+        struct stat info;
+        if (stat(check->getDestinationPath().c_str(), &info) != 0)
+            missing++;
+        else if (check->shouldUpdate())
+            outdated++;
+    }
+    if (missing == checks.size())
+        return STATUS_MISSING;
+    if (missing > 0)
+        return STATUS_PARTIAL;
+    return (outdated > 0) ? STATUS_OUTDATED : STATUS_INSTALLED;
+}
+
+void
+ModuleStatusCache::reset()
+{
+    ids.clear();
+    for (size_t i = 0; i < moduleList->getModuleCount(); i++)
+        ids.push_back(moduleList->getModuleId(i));
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<ModuleId, Entry> previous;
+        previous.swap(entries);
+        for (size_t i = 0; i < ids.size(); i++) {
+            const std::vector<ModuleFile>& files =
+                moduleList->getModule(i).getFiles();
+            auto found = previous.find(ids[i]);
+            if (found != previous.end()
+                && Module::isSameFiles(found->second.files, files)) {
+                entries[ids[i]] = std::move(found->second);
+                continue;
+            }
+            Entry& entry = entries[ids[i]];
+            entry.files = files;
+            enqueue(ids[i], entry);
+        }
+        startWorkers();
+        directory = sourceDirectory;
+    }
+    watcher.watchModules(moduleList->getModules(), ids, directory);
+}
+
+void
+ModuleStatusCache::updateModule(size_t index)
+{
+    ModuleId id = ids[index];
+    const Module& module = moduleList->getModule(index);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[id];
+        if (Module::isSameFiles(entry.files, module.getFiles()))
+            return;
+        entry.files = module.getFiles();
+        enqueue(id, entry);
+        startWorkers();
+    }
+    watcher.watchModule(id, module);
+}
+
+void
+ModuleStatusCache::enqueue(ModuleId id, Entry& entry)
+{
+    entry.version = nextVersion++;
+    if (entry.queued)
+        return;
+    entry.queued = true;
+    queue.push_back(id);
+}
+
+void
+ModuleStatusCache::startWorkers()
+{
+    size_t waiting = queue.size() + priorityQueue.size();
+    while (runningWorkers < pool.getThreadCount()
+        && runningWorkers < waiting) {
+        runningWorkers++;
+        pool.submit([this]() { workerLoop(); });
+    }
+}
+
+void
+ModuleStatusCache::notifyUpdate()
+{
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        callback = updateCallback;
+    }
+    if (callback)
+        callback();
+}
+
+void
+ModuleStatusCache::workerLoop()
+{
+    while (true) {
+        std::vector<ModuleFile> files;
+        std::string directory;
+        ModuleId id;
+        uint64_t version;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!takeNextModule(id)) {
+                runningWorkers--;
+                return;
+            }
+            const Entry& entry = entries[id];
+            files = entry.files;
+            directory = sourceDirectory;
+            version = entry.version;
+        }
+        std::vector<std::shared_ptr<FileCheckAction>> checks;
+        for (const auto& file : files)
+            checks.push_back(file.createUpdateAction(directory));
+        ModuleStatus status = checkStatus(checks);
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = entries.find(id);
+            if (found == entries.end() || found->second.version != version)
+                continue;
+            found->second.status = status;
+            found->second.known = true;
+            if (updatedModules.empty())
+                callback = updateCallback;
+            updatedModules.push_back(id);
+        }
+        if (callback)
+            callback();
+    }
+}
+
+bool
+ModuleStatusCache::takeNextModule(ModuleId& id)
+{
+    while (!stopping) {
+        std::deque<ModuleId>& next =
+            priorityQueue.empty() ? queue : priorityQueue;
+        if (next.empty())
+            return false;
+        id = next.front();
+        next.pop_front();
+        auto found = entries.find(id);
+        if (found == entries.end() || !found->second.queued)
+            continue;
+        found->second.queued = false;
+        return true;
+    }
+    return false;
+}
+} /* namespace gdfm */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULE_STATUS_CACHE_H
+#define MODULE_STATUS_CACHE_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filecheckaction.h"
+#include "modulelist.h"
+#include "modulewatcher.h"
+#include "threadpool.h"
+
+namespace gdfm {
+
+/* How the installed files of a module compare with their sources. */
+enum ModuleStatus {
+    /* Not checked yet, or there are no files to check. */
+    STATUS_UNKNOWN,
+    /* Every file is installed and matches its source. */
+    STATUS_INSTALLED,
+    /* Every file is installed, but some don't match their sources. */
+    STATUS_OUTDATED,
+    /* Some files are installed and some aren't. */
+    STATUS_PARTIAL,
+    /* None of the files are installed. */
+    STATUS_MISSING
+};
+
+/* Returns a word for status to show the user, empty for STATUS_UNKNOWN. */
+const char* getModuleStatusLabel(ModuleStatus status);
+
+/*
+ * Works out the status of every module in the background and remembers it
+ * until the files it depends on change, so showing it never waits on the
+ * disk. The files are compared the same way FileCheckAction does before an
+ * update, and nothing is ever written.
+ *
+ * Modules are checked by a thread pool in the order they were queued,
+ * except for the ones asked to be prioritized, like those that are on the
+ * screen, which go first. The sources and destinations of the modules are
+ * watched, and a module is queued again once one of them changes.
+ *
+ * Changes to the list only touch the modules that changed. Paths are
+ * expanded when a module is checked, and watching every module is left to
+ * the pool, so that neither holds up the thread the list is edited on.
+ *
+ * Everything but the callback is used from one thread.
+ */
+class ModuleStatusCache : public ModuleListObserver {
+public:
+    ModuleStatusCache(
+        unsigned int threadCount = ThreadPool::getDefaultThreadCount());
+    /* Waits for the checks that already started. */
+    ~ModuleStatusCache();
+    ModuleStatusCache(const ModuleStatusCache&) = delete;
+    ModuleStatusCache& operator=(const ModuleStatusCache&) = delete;
+
+    /*
+     * Called on a worker thread when there are new statuses to take, once
+     * until they are taken, or when the watches are ready for
+     * finishSetup().
+     */
+    void setUpdateCallback(std::function<void()> callback);
+    /*
+     * Starts keeping the statuses of the modules in moduleList and following
+     * its changes. Statuses of modules whose files are the same as before
+     * are kept, and the rest are queued to be checked. Every file is watched
+     * again on the pool, such as to watch directories a run created.
+     */
+    void setModules(std::shared_ptr<ModuleList> moduleList,
+        const std::string& sourceDirectory);
+    /*
+     * Starts using the watches from setModules() once they are ready.
+     *
+     * Returns true if it did, which changes the descriptor, false otherwise.
+     */
+    bool finishSetup();
+    /* Queues the given modules to be checked again, such as after a run. */
+    void invalidate(const std::vector<ModuleId>& modules);
+    /*
+     * Checks the given modules before any others that are queued, replacing
+     * the modules that were prioritized before.
+     */
+    void prioritize(const std::vector<ModuleId>& modules);
+    /*
+     * Gets the last status found for the module. A module that is queued
+     * again keeps its old status until the new one is found.
+     *
+     * Returns true if it is known, false if it wasn't checked yet.
+     */
+    bool getStatus(ModuleId id, ModuleStatus& status) const;
+    /* Returns the modules whose statuses were found since the last call. */
+    std::vector<ModuleId> takeUpdatedModules();
+
+    /*
+     * Returns a descriptor that is readable when files of the modules
+     * change, or -1 if they aren't watched.
+     */
+    int getFileDescriptor() const;
+    /*
+     * Reads the file events that are waiting without blocking.
+     *
+     * Returns true on success, false if reading failed.
+     */
+    bool readEvents();
+    bool hasChanges() const;
+    /* Queues every module with a file that changed to be checked again. */
+    void invalidateChanges();
+
+    void onModulesReset(size_t oldCount) override;
+    void onModuleInserted(size_t module) override;
+    void onModuleRemoved(size_t module) override;
+    void onFileInserted(size_t module, size_t file) override;
+    void onFileRemoved(size_t module, size_t file) override;
+    void onModuleReplaced(size_t module, const Module& previous) override;
+
+    /* Returns the status of a module from a comparison of each file. */
+    static ModuleStatus checkStatus(
+        const std::vector<std::shared_ptr<FileCheckAction>>& checks);
+
+private:
+    struct Entry {
+        /* The files to compare with their sources, never changed. */
+        std::vector<ModuleFile> files;
+        ModuleStatus status = STATUS_UNKNOWN;
+        bool known = false;
+        bool queued = false;
+        /*
+         * Changed whenever the entry is queued, so results of checks that
+         * started before then are dropped.
+         */
+        uint64_t version = 0;
+    };
+
+    std::shared_ptr<ModuleList> moduleList;
+    /* The identifier of each module, parallel to the list. */
+    std::vector<ModuleId> ids;
+    /* Uses the pool, which is destroyed first, so it stops first. */
+    ModuleWatcher watcher;
+
+    /* Everything from here to the pool is shared with the workers. */
+    mutable std::mutex mutex;
+    std::string sourceDirectory;
+    std::unordered_map<ModuleId, Entry> entries;
+    /*
+     * The modules waiting to be checked. Entries that were checked since
+     * they were added, or that were removed, are skipped.
+     */
+    std::deque<ModuleId> queue;
+    std::deque<ModuleId> priorityQueue;
+    std::vector<ModuleId> updatedModules;
+    std::function<void()> updateCallback;
+    uint64_t nextVersion = 1;
+    unsigned int runningWorkers = 0;
+    bool stopping = false;
+    /* Destroyed first, so the workers are done before the rest goes. */
+    ThreadPool pool;
+
+    /*
+     * Keeps the entries of the modules whose files are the same and queues
+     * the rest, then watches every module again.
+     */
+    void reset();
+    /* Queues and watches the module at index again if its files changed. */
+    void updateModule(size_t index);
+    /* Queues the entry. The mutex must be held. */
+    void enqueue(ModuleId id, Entry& entry);
+    /* Calls the callback from a worker thread. */
+    void notifyUpdate();
+    /* Starts another worker if there is work and room for one. */
+    void startWorkers();
+    void workerLoop();
+    /*
+     * Takes the next module to check off the queues. The mutex must be
+     * held.
+     *
+     * Returns true if there was one, false if there is nothing left to do.
+     */
+    bool takeNextModule(ModuleId& id);
+};
+} /* namespace gdfm */
+
+#endif /* MODULE_STATUS_CACHE_H */
@@ -0,0 +1,825 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulestreemodel.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+namespace gdfm {
+
+ModulesTreeModel::ModulesTreeModel(std::shared_ptr<ModuleList> moduleList)
+    : Glib::ObjectBase(typeid(ModulesTreeModel)),
+      Glib::Object(),
+      moduleList(moduleList)
+{
+    columns.add(moduleNameColumn);
+    columns.add(fileColumn);
+    columns.add(actionNameColumn);
+    columns.add(rowTypeColumn);
+    columns.add(driftColumn);
+    columns.add(statusColumn);
+    moduleList->addObserver(this);
+}
+
+ModulesTreeModel::~ModulesTreeModel()
+{
+    moduleList->removeObserver(this);
+}
+
+Glib::RefPtr<ModulesTreeModel>
+ModulesTreeModel::create(std::shared_ptr<ModuleList> moduleList)
+{
+    return Glib::RefPtr<ModulesTreeModel>(new ModulesTreeModel(moduleList));
+}
+
+const Gtk::TreeModelColumn<Glib::ustring>&
+ModulesTreeModel::getModuleNameColumn() const
+{
+    return moduleNameColumn;
+}
+
+const Gtk::TreeModelColumn<Glib::ustring>&
+ModulesTreeModel::getFileColumn() const
+{
+    return fileColumn;
+}
+
+const Gtk::TreeModelColumn<Glib::ustring>&
+ModulesTreeModel::getActionNameColumn() const
+{
+    return actionNameColumn;
+}
+
+const Gtk::TreeModelColumn<int>&
+ModulesTreeModel::getRowTypeColumn() const
+{
+    return rowTypeColumn;
+}
+
+const Gtk::TreeModelColumn<Glib::ustring>&
+ModulesTreeModel::getDriftColumn() const
+{
+    return driftColumn;
+}
+
+const Gtk::TreeModelColumn<Glib::ustring>&
+ModulesTreeModel::getStatusColumn() const
+{
+    return statusColumn;
+}
+
+bool
+ModulesTreeModel::isValidIter(const iterator& iter) const
+{
+    Location location;
+    return getLocation(iter, location);
+}
+
+ModulesTreeModel::RowType
+ModulesTreeModel::getRowType(const iterator& iter) const
+{
+    Location location;
+    if (!getLocation(iter, location))
+        return MODULE_ROW;
+    return location.type;
+}
+
+void
+ModulesTreeModel::setVisibleModules(const std::vector<size_t>& modules)
+{
+    updateVisibleModules(modules, true);
+}
+
+void
+ModulesTreeModel::clearFilter()
+{
+    if (filtered)
+        updateVisibleModules(std::vector<size_t>(), false);
+}
+
+bool
+ModulesTreeModel::isFiltered() const
+{
+    return filtered;
+}
+
+bool
+ModulesTreeModel::isModuleVisible(size_t module) const
+{
+    size_t row;
+    return getModuleRow(module, row);
+}
+
+void
+ModulesTreeModel::setDriftedModules(
+    const std::unordered_set<ModuleId>& modules)
+{
+    std::vector<ModuleId> changed;
+    for (ModuleId id : driftedModules) {
+        if (modules.count(id) == 0)
+            changed.push_back(id);
+    }
+    for (ModuleId id : modules) {
+        if (driftedModules.count(id) == 0)
+            changed.push_back(id);
+    }
+    driftedModules = modules;
+    for (ModuleId id : changed) {
+        size_t module;
+        if (moduleList->findModule(id, module))
+            notifyRowChanged(getModuleLocation(module));
+    }
+}
+
+void
+ModulesTreeModel::setStatusCache(const ModuleStatusCache* cache)
+{
+    statusCache = cache;
+}
+
+void
+ModulesTreeModel::updateModuleStatuses(const std::vector<ModuleId>& modules)
+{
+    for (ModuleId id : modules) {
+        size_t module;
+        if (moduleList->findModule(id, module))
+            notifyRowChanged(getModuleLocation(module));
+    }
+}
+
+void
+ModulesTreeModel::onModulesReset(size_t oldCount)
+{
+    stamp++;
+    size_t oldRows = filtered ? visibleModules.size() : oldCount;
+    filtered = false;
+    visibleModules.clear();
+    /* Delete from the end so each path is still right when it's sent. */
+    for (size_t i = oldRows; i > 0; i--) {
+        Path path;
+        path.push_back(i - 1);
+        row_deleted(path);
+    }
+    for (size_t i = 0; i < moduleList->getModuleCount(); i++)
+        notifyRowInserted(getModuleLocation(i));
+}
+
+void
+ModulesTreeModel::onModuleInserted(size_t module)
+{
+    stamp++;
+    if (filtered) {
+        /* Show the new module, which moves every later module down one. */
+        auto position = std::lower_bound(
+            visibleModules.begin(), visibleModules.end(), module);
+        for (auto iter = position; iter != visibleModules.end(); ++iter)
+            (*iter)++;
+        visibleModules.insert(position, module);
+    }
+    notifyRowInserted(getModuleLocation(module));
+}
+
+void
+ModulesTreeModel::onModuleRemoved(size_t module)
+{
+    stamp++;
+    size_t row = module;
+    bool visible = true;
+    if (filtered) {
+        auto position = std::lower_bound(
+            visibleModules.begin(), visibleModules.end(), module);
+        visible = position != visibleModules.end() && *position == module;
+        row = position - visibleModules.begin();
+        if (visible)
+            position = visibleModules.erase(position);
+        for (; position != visibleModules.end(); ++position)
+            (*position)--;
+    }
+    if (visible) {
+        Path path;
+        path.push_back(row);
+        row_deleted(path);
+    }
+}
+
+void
+ModulesTreeModel::onFileInserted(size_t module, size_t file)
+{
+    stamp++;
+    Location location = { MODULE_FILE_ROW, module, Module::INSTALL_ACTIONS,
+        file };
+    notifyRowInserted(location);
+    if (countModuleChildren(module) == 1)
+        notifyHasChildToggled(getModuleLocation(module));
+}
+
+void
+ModulesTreeModel::onFileRemoved(size_t module, size_t file)
+{
+    stamp++;
+    if (!isModuleVisible(module))
+        return;
+    Path path = getPath(getModuleLocation(module));
+    path.push_back(file);
+    row_deleted(path);
+    if (countModuleChildren(module) == 0)
+        notifyHasChildToggled(getModuleLocation(module));
+}
+
+void
+ModulesTreeModel::onActionInserted(
+    size_t module, Module::ActionType type, size_t action)
+{
+    stamp++;
+    if (moduleList->getModule(module).getActions(type).size() > 1) {
+        Location location = { MODULE_ACTION_ROW, module, type, action };
+        notifyRowInserted(location);
+        return;
+    }
+    /* The row for the list is new and comes with the action under it. */
+    Location typeLocation = { MODULE_TYPE_ROW, module, type, 0 };
+    notifyRowInserted(typeLocation);
+    if (countModuleChildren(module) == 1)
+        notifyHasChildToggled(getModuleLocation(module));
+}
+
+void
+ModulesTreeModel::onActionRemoved(
+    size_t module, Module::ActionType type, size_t action)
+{
+    stamp++;
+    /*
+     * The position of the list's row only depends on the lists before it, so
+     * it can be found even if the list is now empty and the row is gone.
+     */
+    if (!isModuleVisible(module))
+        return;
+    Path path = getPath(getModuleLocation(module));
+    path.push_back(getActionTypePosition(module, type));
+    bool listRemoved = moduleList->getModule(module).getActions(type).empty();
+    /* Deleting the row for the list deletes the action with it. */
+    if (!listRemoved)
+        path.push_back(action);
+    row_deleted(path);
+    if (listRemoved && countModuleChildren(module) == 0)
+        notifyHasChildToggled(getModuleLocation(module));
+}
+
+void
+ModulesTreeModel::onActionsSwapped(
+    size_t module, Module::ActionType type, size_t first, size_t second)
+{
+    /*
+     * No rows are added or removed, so redrawing both rows is all the view
+     * needs.
+     */
+    Location location = { MODULE_ACTION_ROW, module, type, first };
+    notifyRowChanged(location);
+    location.index = second;
+    notifyRowChanged(location);
+}
+
+void
+ModulesTreeModel::onModuleReplaced(size_t module, const Module& previous)
+{
+    if (!isModuleVisible(module))
+        return;
+    const Module& current = moduleList->getModule(module);
+    Location moduleLocation = getModuleLocation(module);
+    bool sameRows = current.getFiles().size() == previous.getFiles().size();
+    for (int i = 0; sameRows && i < Module::ACTION_TYPE_COUNT; i++) {
+        Module::ActionType type = static_cast<Module::ActionType>(i);
+        sameRows = current.getActions(type).size()
+            == previous.getActions(type).size();
+    }
+    Location location;
+    if (sameRows) {
+        /* No rows were added or removed, but any of their text could have. */
+        notifyRowChanged(moduleLocation);
+        for (int i = 0; getModuleChild(module, i, location); i++) {
+            notifyRowChanged(location);
+            if (location.type != MODULE_TYPE_ROW)
+                continue;
+            size_t actionCount =
+                current.getActions(location.actionType).size();
+            Location actionLocation = { MODULE_ACTION_ROW, module,
+                location.actionType, 0 };
+            for (; actionLocation.index < actionCount; actionLocation.index++)
+                notifyRowChanged(actionLocation);
+        }
+        return;
+    }
+    /*
+     * Replace every row under the module but keep the module's own row, so
+     * it stays expanded if it still has children.
+     */
+    stamp++;
+    int previousCount = countChildren(previous);
+    for (int i = previousCount; i > 0; i--) {
+        Path path = getPath(moduleLocation);
+        path.push_back(i - 1);
+        row_deleted(path);
+    }
+    for (int i = 0; getModuleChild(module, i, location); i++)
+        notifyRowInserted(location);
+    if ((previousCount > 0) != (countModuleChildren(module) > 0))
+        notifyHasChildToggled(moduleLocation);
+    notifyRowChanged(moduleLocation);
+}
+
+Gtk::TreeModelFlags
+ModulesTreeModel::get_flags_vfunc() const
+{
+    /* Iterators are positions, so they don't survive changes. */
+    return Gtk::TreeModelFlags(0);
+}
+
+int
+ModulesTreeModel::get_n_columns_vfunc() const
+{
+    return columns.size();
+}
+
+GType
+ModulesTreeModel::get_column_type_vfunc(int index) const
+{
+    if (index < 0 || index >= static_cast<int>(columns.size()))
+        return G_TYPE_INVALID;
+    return columns.types()[index];
+}
+
+void
+ModulesTreeModel::get_value_vfunc(
+    const iterator& iter, int column, Glib::ValueBase& value) const
+{
+    value.init(get_column_type_vfunc(column));
+    Location location;
+    if (!getLocation(iter, location))
+        return;
+
+    if (column == rowTypeColumn.index()) {
+        Glib::Value<int> typeValue;
+        typeValue.init(Glib::Value<int>::value_type());
+        typeValue.set(location.type);
+        value = typeValue;
+        return;
+    }
+
+    const Module& module = moduleList->getModule(location.module);
+    Glib::ustring text;
+    if (column == moduleNameColumn.index()) {
+        if (location.type == MODULE_ROW)
+            text = module.getName();
+        else if (location.type == MODULE_TYPE_ROW)
+            text = getActionTypeLabel(location.actionType);
+    } else if (column == fileColumn.index()) {
+        if (location.type == MODULE_FILE_ROW)
+            text = module.getFiles()[location.index].getFilename();
+    } else if (column == actionNameColumn.index()) {
+        if (location.type == MODULE_ACTION_ROW)
+            text = module.getActions(location.actionType)[location.index]
+                       ->getName();
+    } else if (column == driftColumn.index()) {
+        ModuleId id = moduleList->getModuleId(location.module);
+        if (location.type == MODULE_ROW && driftedModules.count(id) > 0)
+            text = "Modified";
+    } else if (column == statusColumn.index()) {
+        ModuleId id = moduleList->getModuleId(location.module);
+        ModuleStatus status;
+        if (location.type == MODULE_ROW && statusCache
+            && statusCache->getStatus(id, status))
+            text = getModuleStatusLabel(status);
+    } else
+        return;
+    Glib::Value<Glib::ustring> textValue;
+    textValue.init(Glib::Value<Glib::ustring>::value_type());
+    textValue.set(text);
+    value = textValue;
+}
+
+bool
+ModulesTreeModel::iter_next_vfunc(
+    const iterator& iter, iterator& iter_next) const
+{
+    Location location;
+    if (!getLocation(iter, location))
+        return false;
+    switch (location.type) {
+    case MODULE_ROW: {
+        size_t row;
+        if (!getModuleRow(location.module, row) || row + 1 >= getRowCount())
+            return false;
+        location.module = getRowModule(row + 1);
+        break;
+    }
+    case MODULE_FILE_ROW:
+        if (!getModuleChild(location.module, location.index + 1, location))
+            return false;
+        break;
+    case MODULE_TYPE_ROW: {
+        int position =
+            getActionTypePosition(location.module, location.actionType);
+        if (!getModuleChild(location.module, position + 1, location))
+            return false;
+        break;
+    }
+    case MODULE_ACTION_ROW:
+        if (location.index + 1
+            >= moduleList->getModule(location.module)
+                   .getActions(location.actionType)
+                   .size())
+            return false;
+        location.index++;
+        break;
+    }
+    setLocation(location, iter_next);
+    return true;
+}
+
+bool
+ModulesTreeModel::iter_children_vfunc(
+    const iterator& parent, iterator& iter) const
+{
+    return iter_nth_child_vfunc(parent, 0, iter);
+}
+
+bool
+ModulesTreeModel::iter_has_child_vfunc(const iterator& iter) const
+{
+    return iter_n_children_vfunc(iter) > 0;
+}
+
+int
+ModulesTreeModel::iter_n_children_vfunc(const iterator& iter) const
+{
+    Location location;
+    if (!getLocation(iter, location))
+        return 0;
+    if (location.type == MODULE_ROW)
+        return countModuleChildren(location.module);
+    if (location.type == MODULE_TYPE_ROW)
+        return moduleList->getModule(location.module)
+            .getActions(location.actionType)
+            .size();
+    return 0;
+}
+
+int
+ModulesTreeModel::iter_n_root_children_vfunc() const
+{
+    return getRowCount();
+}
+
+bool
+ModulesTreeModel::iter_nth_child_vfunc(
+    const iterator& parent, int n, iterator& iter) const
+{
+    Location location;
+    if (!getLocation(parent, location) || n < 0)
+        return false;
+    if (location.type == MODULE_ROW) {
+        if (!getModuleChild(location.module, n, location))
+            return false;
+    } else if (location.type == MODULE_TYPE_ROW) {
+        if (static_cast<size_t>(n)
+            >= moduleList->getModule(location.module)
+                   .getActions(location.actionType)
+                   .size())
+            return false;
+        location.type = MODULE_ACTION_ROW;
+        location.index = n;
+    } else
+        return false;
+    setLocation(location, iter);
+    return true;
+}
+
+bool
+ModulesTreeModel::iter_nth_root_child_vfunc(int n, iterator& iter) const
+{
+    if (n < 0 || static_cast<size_t>(n) >= getRowCount())
+        return false;
+    Location location = getModuleLocation(getRowModule(n));
+    setLocation(location, iter);
+    return true;
+}
+
+bool
+ModulesTreeModel::iter_parent_vfunc(
+    const iterator& child, iterator& iter) const
+{
+    Location location;
+    if (!getLocation(child, location) || location.type == MODULE_ROW)
+        return false;
+    if (location.type == MODULE_ACTION_ROW) {
+        location.type = MODULE_TYPE_ROW;
+        location.index = 0;
+    } else {
+        location.type = MODULE_ROW;
+        location.actionType = Module::INSTALL_ACTIONS;
+        location.index = 0;
+    }
+    setLocation(location, iter);
+    return true;
+}
+
+Gtk::TreeModel::Path
+ModulesTreeModel::get_path_vfunc(const iterator& iter) const
+{
+    Location location;
+    if (!getLocation(iter, location))
+        return Path();
+    return getPath(location);
+}
+
+bool
+ModulesTreeModel::get_iter_vfunc(const Path& path, iterator& iter) const
+{
+    if (path.size() < 1 || path.size() > 3)
+        return false;
+    if (path[0] < 0 || static_cast<size_t>(path[0]) >= getRowCount())
+        return false;
+    Location location = getModuleLocation(getRowModule(path[0]));
+    if (path.size() >= 2
+        && !getModuleChild(location.module, path[1], location))
+        return false;
+    if (path.size() == 3) {
+        if (location.type != MODULE_TYPE_ROW || path[2] < 0
+            || static_cast<size_t>(path[2])
+                >= moduleList->getModule(location.module)
+                       .getActions(location.actionType)
+                       .size())
+            return false;
+        location.type = MODULE_ACTION_ROW;
+        location.index = path[2];
+    }
+    setLocation(location, iter);
+    return true;
+}
+
+bool
+ModulesTreeModel::getLocation(const iterator& iter, Location& location) const
+{
+    const GtkTreeIter* gobject = iter.gobj();
+    if (!gobject || iter.get_stamp() != stamp)
+        return false;
+    uintptr_t kind = reinterpret_cast<uintptr_t>(gobject->user_data2);
+    location.module = reinterpret_cast<uintptr_t>(gobject->user_data);
+    location.type = static_cast<RowType>(kind & 0xf);
+    location.actionType = static_cast<Module::ActionType>(kind >> 4);
+    location.index = reinterpret_cast<uintptr_t>(gobject->user_data3);
+
+    if (!isModuleVisible(location.module)
+        || location.actionType >= Module::ACTION_TYPE_COUNT)
+        return false;
+    const Module& module = moduleList->getModule(location.module);
+    switch (location.type) {
+    case MODULE_ROW:
+        return true;
+    case MODULE_FILE_ROW:
+        return location.index < module.getFiles().size();
+    case MODULE_TYPE_ROW:
+        return !module.getActions(location.actionType).empty();
+    case MODULE_ACTION_ROW:
+        return location.index
+            < module.getActions(location.actionType).size();
+    }
+    return false;
+}
+
+void
+ModulesTreeModel::setLocation(const Location& location, iterator& iter) const
+{
+    iter.set_stamp(stamp);
+    GtkTreeIter* gobject = iter.gobj();
+    gobject->user_data = reinterpret_cast<gpointer>(
+        static_cast<uintptr_t>(location.module));
+    gobject->user_data2 = reinterpret_cast<gpointer>(
+        static_cast<uintptr_t>(location.type | (location.actionType << 4)));
+    gobject->user_data3 = reinterpret_cast<gpointer>(
+        static_cast<uintptr_t>(location.index));
+}
+
+size_t
+ModulesTreeModel::getRowCount() const
+{
+    return filtered ? visibleModules.size() : moduleList->getModuleCount();
+}
+
+size_t
+ModulesTreeModel::getRowModule(size_t row) const
+{
+    return filtered ? visibleModules[row] : row;
+}
+
+bool
+ModulesTreeModel::getModuleRow(size_t moduleIndex, size_t& row) const
+{
+    if (!filtered) {
+        row = moduleIndex;
+        return moduleIndex < moduleList->getModuleCount();
+    }
+    auto position = std::lower_bound(
+        visibleModules.begin(), visibleModules.end(), moduleIndex);
+    if (position == visibleModules.end() || *position != moduleIndex)
+        return false;
+    row = position - visibleModules.begin();
+    return true;
+}
+
+void
+ModulesTreeModel::updateVisibleModules(
+    const std::vector<size_t>& modules, bool filter)
+{
+    std::vector<size_t> current = visibleModules;
+    std::vector<size_t> next = modules;
+    for (size_t i = 0; !filtered && i < moduleList->getModuleCount(); i++)
+        current.push_back(i);
+    for (size_t i = 0; !filter && i < moduleList->getModuleCount(); i++)
+        next.push_back(i);
+
+    /*
+     * Only the modules that are shown or hidden are sent, so the rows that
+     * stay keep their state in the view. Rows are hidden from the bottom up
+     * and shown from the top down, changing visibleModules one row at a
+     * time, so the model always matches what the view has been told.
+     */
+    stamp++;
+    filtered = true;
+    visibleModules = current;
+    for (size_t row = current.size(); row > 0; row--) {
+        if (std::binary_search(next.begin(), next.end(), current[row - 1]))
+            continue;
+        visibleModules.erase(visibleModules.begin() + (row - 1));
+        Path path;
+        path.push_back(row - 1);
+        row_deleted(path);
+    }
+    for (size_t module : next) {
+        auto position = std::lower_bound(
+            visibleModules.begin(), visibleModules.end(), module);
+        if (position != visibleModules.end() && *position == module)
+            continue;
+        visibleModules.insert(position, module);
+        notifyRowInserted(getModuleLocation(module));
+    }
+    filtered = filter;
+    if (!filtered)
+        visibleModules.clear();
+}
+
+Gtk::TreeModel::Path
+ModulesTreeModel::getPath(const Location& location) const
+{
+    Path path;
+    size_t row;
+    if (!getModuleRow(location.module, row))
+        return path;
+    path.push_back(row);
+    if (location.type == MODULE_ROW)
+        return path;
+    if (location.type == MODULE_FILE_ROW) {
+        path.push_back(location.index);
+        return path;
+    }
+    path.push_back(
+        getActionTypePosition(location.module, location.actionType));
+    if (location.type == MODULE_ACTION_ROW)
+        path.push_back(location.index);
+    return path;
+}
+
+bool
+ModulesTreeModel::getModuleChild(
+    size_t moduleIndex, int n, Location& location) const
+{
+    if (n < 0)
+        return false;
+    const Module& module = moduleList->getModule(moduleIndex);
+    location.module = moduleIndex;
+    std::vector<ModuleFile>::size_type fileCount = module.getFiles().size();
+    if (static_cast<std::vector<ModuleFile>::size_type>(n) < fileCount) {
+        location.type = MODULE_FILE_ROW;
+        location.actionType = Module::INSTALL_ACTIONS;
+        location.index = n;
+        return true;
+    }
+    int position = n - fileCount;
+    for (int i = 0; i < Module::ACTION_TYPE_COUNT; i++) {
+        Module::ActionType type = static_cast<Module::ActionType>(i);
+        if (module.getActions(type).empty())
+            continue;
+        if (position == 0) {
+            location.type = MODULE_TYPE_ROW;
+            location.actionType = type;
+            location.index = 0;
+            return true;
+        }
+        position--;
+    }
+    return false;
+}
+
+int
+ModulesTreeModel::countModuleChildren(size_t moduleIndex) const
+{
+    return countChildren(moduleList->getModule(moduleIndex));
+}
+
+int
+ModulesTreeModel::countChildren(const Module& module)
+{
+    int count = module.getFiles().size();
+    for (int i = 0; i < Module::ACTION_TYPE_COUNT; i++) {
+        if (!module.getActions(static_cast<Module::ActionType>(i)).empty())
+            count++;
+    }
+    return count;
+}
+
+int
+ModulesTreeModel::getActionTypePosition(
+    size_t moduleIndex, Module::ActionType type) const
+{
+    const Module& module = moduleList->getModule(moduleIndex);
+    int position = module.getFiles().size();
+    for (int i = 0; i < type; i++) {
+        if (!module.getActions(static_cast<Module::ActionType>(i)).empty())
+            position++;
+    }
+    return position;
+}
+
+void
+ModulesTreeModel::notifyRowInserted(const Location& location)
+{
+    Path path = getPath(location);
+    /* Nothing is shown for modules that are hidden. */
+    if (path.empty())
+        return;
+    row_inserted(path, get_iter(path));
+    if (location.type == MODULE_TYPE_ROW
+        || (location.type == MODULE_ROW
+            && countModuleChildren(location.module) > 0))
+        notifyHasChildToggled(location);
+}
+
+void
+ModulesTreeModel::notifyHasChildToggled(const Location& location)
+{
+    Path path = getPath(location);
+    if (path.empty())
+        return;
+    row_has_child_toggled(path, get_iter(path));
+}
+
+void
+ModulesTreeModel::notifyRowChanged(const Location& location)
+{
+    Path path = getPath(location);
+    if (path.empty())
+        return;
+    row_changed(path, get_iter(path));
+}
+
+ModulesTreeModel::Location
+ModulesTreeModel::getModuleLocation(size_t module)
+{
+    Location location = { MODULE_ROW, module, Module::INSTALL_ACTIONS, 0 };
+    return location;
+}
+
+const char*
+ModulesTreeModel::getActionTypeLabel(Module::ActionType type)
+{
+    switch (type) {
+    case Module::UNINSTALL_ACTIONS:
+        return "Uninstall";
+    case Module::UPDATE_ACTIONS:
+        return "Update";
+    default:
+        return "Install";
+    }
+}
+} /* namespace gdfm */
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULES_TREE_MODEL_H
+#define MODULES_TREE_MODEL_H
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include <gtkmm.h>
+
+#include "module.h"
+#include "modulelist.h"
+#include "modulestatuscache.h"
+
+namespace gdfm {
+
+/*
+ * A tree model that shows the modules in a ModuleList without copying them
+ * into rows. Each module has its files as children, followed by an
+ * "Install", "Uninstall" and "Update" row for each list of actions that
+ * isn't empty, which have the actions as children. Nothing is stored per
+ * row. Iterators hold the position of their row, and the view asks for the
+ * children of a row only when it is expanded, so loading thousands of
+ * modules only costs the module list itself.
+ *
+ * This is only a view. Changes are made to the ModuleList, which tells this
+ * model about them so it can tell the tree view. Since iterators are
+ * positions, any change that adds or removes a row invalidates every
+ * iterator from before it.
+ *
+ * The model can also show only some of the modules, such as the results of
+ * a search. The modules that are hidden keep their rows and children out of
+ * the view entirely.
+ */
+class ModulesTreeModel : public Glib::Object,
+                         public Gtk::TreeModel,
+                         public ModuleListObserver {
+public:
+    /*
+     * The kind of each row, which makes it easy for the window to know what
+     * a row that was clicked on represents.
+     */
+    enum RowType {
+        MODULE_ROW,
+        MODULE_TYPE_ROW,
+        MODULE_FILE_ROW,
+        MODULE_ACTION_ROW
+    };
+
+    /* Where a row is, which is everything an iterator needs to hold. */
+    struct Location {
+        RowType type;
+        size_t module;
+        Module::ActionType actionType;
+        /* The file or action index, depending on type. */
+        size_t index;
+    };
+
+    static Glib::RefPtr<ModulesTreeModel> create(
+        std::shared_ptr<ModuleList> moduleList);
+    virtual ~ModulesTreeModel();
+
+    /* Columns for use with a Gtk::TreeView. */
+    const Gtk::TreeModelColumn<Glib::ustring>& getModuleNameColumn() const;
+    const Gtk::TreeModelColumn<Glib::ustring>& getFileColumn() const;
+    const Gtk::TreeModelColumn<Glib::ustring>& getActionNameColumn() const;
+    const Gtk::TreeModelColumn<int>& getRowTypeColumn() const;
+    /* Says whether the module was changed after it was installed. */
+    const Gtk::TreeModelColumn<Glib::ustring>& getDriftColumn() const;
+    /* Shows how the installed files of the module compare. */
+    const Gtk::TreeModelColumn<Glib::ustring>& getStatusColumn() const;
+
+    /*
+     * Reads the location out of iter.
+     *
+     * Returns true if iter points to a row that exists, false otherwise.
+     */
+    bool getLocation(const iterator& iter, Location& location) const;
+    /* Returns an empty path if the module at location is hidden. */
+    Path getPath(const Location& location) const;
+    /* Returns true if iter came from this model and is still usable. */
+    bool isValidIter(const iterator& iter) const;
+    RowType getRowType(const iterator& iter) const;
+
+    /*
+     * Shows only the modules at the given indices, which must be sorted.
+     * Modules that stay visible keep their rows, so they stay expanded and
+     * selected. Modules that are added later are shown until the next call.
+     */
+    void setVisibleModules(const std::vector<size_t>& modules);
+    /* Shows every module again. */
+    void clearFilter();
+    bool isFiltered() const;
+    bool isModuleVisible(size_t module) const;
+    /*
+     * Marks the given modules as changed since they were installed in the
+     * drift column, and clears the mark from every other module.
+     */
+    void setDriftedModules(const std::unordered_set<ModuleId>& modules);
+    /*
+     * Shows the statuses from cache in the status column. The model doesn't
+     * own it, and it may be null to show nothing. The view isn't told, so
+     * set it before there are rows.
+     */
+    void setStatusCache(const ModuleStatusCache* cache);
+    /* Tells the view that the statuses of the given modules changed. */
+    void updateModuleStatuses(const std::vector<ModuleId>& modules);
+
+    void onModulesReset(size_t oldCount) override;
+    void onModuleInserted(size_t module) override;
+    void onModuleRemoved(size_t module) override;
+    void onFileInserted(size_t module, size_t file) override;
+    void onFileRemoved(size_t module, size_t file) override;
+    void onActionInserted(
+        size_t module, Module::ActionType type, size_t action) override;
+    void onActionRemoved(
+        size_t module, Module::ActionType type, size_t action) override;
+    void onActionsSwapped(size_t module, Module::ActionType type,
+        size_t first, size_t second) override;
+    void onModuleReplaced(size_t module, const Module& previous) override;
+
+protected:
+    ModulesTreeModel(std::shared_ptr<ModuleList> moduleList);
+
+    Gtk::TreeModelFlags get_flags_vfunc() const override;
+    int get_n_columns_vfunc() const override;
+    GType get_column_type_vfunc(int index) const override;
+    void get_value_vfunc(const iterator& iter, int column,
+        Glib::ValueBase& value) const override;
+    bool iter_next_vfunc(
+        const iterator& iter, iterator& iter_next) const override;
+    bool iter_children_vfunc(
+        const iterator& parent, iterator& iter) const override;
+    bool iter_has_child_vfunc(const iterator& iter) const override;
+    int iter_n_children_vfunc(const iterator& iter) const override;
+    int iter_n_root_children_vfunc() const override;
+    bool iter_nth_child_vfunc(
+        const iterator& parent, int n, iterator& iter) const override;
+    bool iter_nth_root_child_vfunc(int n, iterator& iter) const override;
+    bool iter_parent_vfunc(
+        const iterator& child, iterator& iter) const override;
+    Path get_path_vfunc(const iterator& iter) const override;
+    bool get_iter_vfunc(const Path& path, iterator& iter) const override;
+
+private:
+    Gtk::TreeModelColumnRecord columns;
+    Gtk::TreeModelColumn<Glib::ustring> moduleNameColumn;
+    Gtk::TreeModelColumn<Glib::ustring> fileColumn;
+    Gtk::TreeModelColumn<Glib::ustring> actionNameColumn;
+    Gtk::TreeModelColumn<int> rowTypeColumn;
+    Gtk::TreeModelColumn<Glib::ustring> driftColumn;
+    Gtk::TreeModelColumn<Glib::ustring> statusColumn;
+
+    std::shared_ptr<ModuleList> moduleList;
+    /* Changed whenever rows are added or removed, to catch stale iters. */
+    int stamp = 1;
+    /* Whether only the modules in visibleModules are shown. */
+    bool filtered = false;
+    /* The indices of the modules that are shown, in order, when filtered. */
+    std::vector<size_t> visibleModules;
+    /* The modules that are marked in driftColumn. */
+    std::unordered_set<ModuleId> driftedModules;
+    const ModuleStatusCache* statusCache = nullptr;
+
+    void setLocation(const Location& location, iterator& iter) const;
+    /* Returns how many modules are shown at the top level. */
+    size_t getRowCount() const;
+    /* Returns the index of the module shown at the given top level row. */
+    size_t getRowModule(size_t row) const;
+    /*
+     * Finds the top level row that shows the module at moduleIndex.
+     *
+     * Returns true if the module is shown, false otherwise.
+     */
+    bool getModuleRow(size_t moduleIndex, size_t& row) const;
+    /*
+     * Tells the view about every module that is shown or hidden by going
+     * from the current modules to modules, which are all of them if filter
+     * is false.
+     */
+    void updateVisibleModules(
+        const std::vector<size_t>& modules, bool filter);
+    /*
+     * Finds the location of the nth child of the module at moduleIndex.
+     *
+     * Returns true if there is such a child, false otherwise.
+     */
+    bool getModuleChild(size_t moduleIndex, int n, Location& location) const;
+    /* Returns how many rows the module at moduleIndex has under it. */
+    int countModuleChildren(size_t moduleIndex) const;
+    static int countChildren(const Module& module);
+    /*
+     * Returns the position of the row for the given list of actions among
+     * the children of the module, counting only lists that aren't empty.
+     */
+    int getActionTypePosition(
+        size_t moduleIndex, Module::ActionType type) const;
+    /* Tells the view about a new row and whether it has children. */
+    void notifyRowInserted(const Location& location);
+    /*
+     * Tells the view that the row at location went from having no children
+     * to having some, or the other way around.
+     */
+    void notifyHasChildToggled(const Location& location);
+    void notifyRowChanged(const Location& location);
+    static Location getModuleLocation(size_t module);
+    static const char* getActionTypeLabel(Module::ActionType type);
+};
+} /* namespace gdfm */
+
+#endif /* MODULES_TREE_MODEL_H */
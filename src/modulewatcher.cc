@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "modulewatcher.h"
+
+namespace gdfm {
+
+ModuleWatcher::ModuleWatcher(ThreadPool& pool, FileWatcher::WatchedPaths paths)
+    : pool(pool), paths(paths)
+{
+}
+
+ModuleWatcher::~ModuleWatcher()
+{
+    cancelSetup();
+}
+
+void
+ModuleWatcher::setQueueLimit(size_t limit)
+{
+    queueLimit = limit;
+    if (watcher)
+        watcher->setQueueLimit(limit);
+}
+
+void
+ModuleWatcher::setReadyCallback(std::function<void()> callback)
+{
+    readyCallback = callback;
+}
+
+void
+ModuleWatcher::watchModules(std::vector<Module> modules,
+    const std::vector<ModuleId>& ids, const std::string& sourceDirectory)
+{
+    cancelSetup();
+    changedModules.clear();
+    this->sourceDirectory = sourceDirectory;
+    setup = std::make_shared<Setup>();
+    setup->ids = ids;
+
+    std::shared_ptr<Setup> task = setup;
+    /* Shared so the task doesn't copy every module when it is copied. */
+    auto taskModules = std::make_shared<std::vector<Module>>();
+    taskModules->swap(modules);
+    FileWatcher::WatchedPaths paths = this->paths;
+    size_t queueLimit = this->queueLimit;
+    std::function<void()> callback = readyCallback;
+    pool.submit([task, taskModules, sourceDirectory, paths, queueLimit,
+                    callback]() {
+        std::unique_ptr<FileWatcher> watcher(new FileWatcher);
+        watcher->setQueueLimit(queueLimit);
+        watcher->start(sourceDirectory, paths);
+        for (const auto& module : *taskModules) {
+            if (task->cancelled)
+                return;
+            watcher->addModule(module);
+        }
+        {
+            std::lock_guard<std::mutex> lock(task->mutex);
+            if (task->cancelled)
+                return;
+            task->watcher = std::move(watcher);
+            task->ready = true;
+        }
+        if (callback)
+            callback();
+    });
+}
+
+bool
+ModuleWatcher::finishSetup()
+{
+    if (!setup)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(setup->mutex);
+        if (!setup->ready)
+            return false;
+    }
+    /* Keep what the old watches saw, which the new ones missed. */
+    if (watcher && watcher->isWatching()) {
+        watcher->readEvents();
+        std::vector<ChangedFile> changes = takeChangedFiles();
+        keptChanges.swap(changes);
+    }
+    watcher = std::move(setup->watcher);
+    ids.swap(setup->ids);
+    setup.reset();
+    positions.clear();
+    for (size_t i = 0; i < ids.size(); i++)
+        positions[ids[i]] = i;
+
+    std::unordered_map<ModuleId, std::shared_ptr<const Module>> changed;
+    changed.swap(changedModules);
+    for (const auto& module : changed) {
+        if (module.second)
+            watchModule(module.first, *module.second);
+        else
+            unwatchModule(module.first);
+    }
+    return true;
+}
+
+void
+ModuleWatcher::watchModule(ModuleId id, const Module& module)
+{
+    if (setup)
+        changedModules[id] = std::make_shared<const Module>(module);
+    if (!watcher || !watcher->isWatching())
+        return;
+    auto found = positions.find(id);
+    if (found != positions.end()) {
+        watcher->replaceModule(found->second, module);
+        return;
+    }
+    size_t position = watcher->addModule(module);
+    if (position >= ids.size())
+        ids.resize(position + 1);
+    ids[position] = id;
+    positions[id] = position;
+}
+
+void
+ModuleWatcher::unwatchModule(ModuleId id)
+{
+    if (setup)
+        changedModules[id] = nullptr;
+    auto found = positions.find(id);
+    if (!watcher || found == positions.end())
+        return;
+    watcher->removeModule(found->second);
+    positions.erase(found);
+}
+
+void
+ModuleWatcher::stop()
+{
+    cancelSetup();
+    changedModules.clear();
+    watcher.reset();
+    ids.clear();
+    positions.clear();
+    keptChanges.clear();
+}
+
+int
+ModuleWatcher::getFileDescriptor() const
+{
+    return watcher ? watcher->getFileDescriptor() : -1;
+}
+
+bool
+ModuleWatcher::readEvents()
+{
+    return watcher && watcher->readEvents();
+}
+
+bool
+ModuleWatcher::hasChanges() const
+{
+    return !keptChanges.empty() || (watcher && watcher->hasChanges());
+}
+
+std::vector<ModuleWatcher::ChangedFile>
+ModuleWatcher::takeChangedFiles()
+{
+    std::vector<ChangedFile> changes;
+    changes.swap(keptChanges);
+    if (!watcher)
+        return changes;
+    for (const auto& location : watcher->takeChangedFiles())
+        changes.push_back(ChangedFile{ ids[location.module], location.file });
+    return changes;
+}
+
+void
+ModuleWatcher::cancelSetup()
+{
+    if (!setup)
+        return;
+    std::shared_ptr<Setup> cancelled;
+    cancelled.swap(setup);
+    std::lock_guard<std::mutex> lock(cancelled->mutex);
+    cancelled->cancelled = true;
+}
+} /* namespace gdfm */
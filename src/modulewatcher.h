@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MODULE_WATCHER_H
+#define MODULE_WATCHER_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filewatcher.h"
+#include "module.h"
+#include "modulelist.h"
+#include "threadpool.h"
+
+namespace gdfm {
+
+/*
+ * Watches the files of modules by their identifiers, so the watches of one
+ * module can be changed as it is edited without touching the others.
+ *
+ * Watching every module at once, like after a config file is opened,
+ * expands every path and walks every tree, so it is done on a thread pool.
+ * The watches from before keep working until finishSetup() puts the new
+ * ones in their place, and the changes they saw are kept.
+ *
+ * Everything but the ready callback is used from one thread.
+ */
+class ModuleWatcher {
+public:
+    /* A file that changed, by its module and its position in it. */
+    struct ChangedFile {
+        ModuleId module;
+        size_t file;
+    };
+
+    ModuleWatcher(ThreadPool& pool, FileWatcher::WatchedPaths paths);
+    /* Stops the setup that is running at the next module. */
+    ~ModuleWatcher();
+    ModuleWatcher(const ModuleWatcher&) = delete;
+    ModuleWatcher& operator=(const ModuleWatcher&) = delete;
+
+    /* See FileWatcher::setQueueLimit(). */
+    void setQueueLimit(size_t limit);
+    /*
+     * Called on a thread of the pool when watches started by watchModules()
+     * are ready for finishSetup().
+     */
+    void setReadyCallback(std::function<void()> callback);
+
+    /*
+     * Starts watching modules, whose identifiers are in ids, on the pool.
+     * Whatever was watched before stays watched until finishSetup().
+     */
+    void watchModules(std::vector<Module> modules,
+        const std::vector<ModuleId>& ids, const std::string& sourceDirectory);
+    /*
+     * Starts using the watches set up by watchModules() if they are ready.
+     * Modules that were watched or unwatched since it was called are
+     * watched or unwatched again.
+     *
+     * Returns true if the watches were replaced, which changes the
+     * descriptor, false if they aren't ready.
+     */
+    bool finishSetup();
+    /* Watches module, replacing the watches of the module with id. */
+    void watchModule(ModuleId id, const Module& module);
+    void unwatchModule(ModuleId id);
+    void stop();
+
+    /*
+     * Returns a descriptor that is readable when there are events to read,
+     * or -1 if nothing is watched.
+     */
+    int getFileDescriptor() const;
+    /*
+     * Reads the events that are waiting without blocking.
+     *
+     * Returns true on success, false if reading failed.
+     */
+    bool readEvents();
+    bool hasChanges() const;
+    /* Returns each file that changed. The changes are forgotten. */
+    std::vector<ChangedFile> takeChangedFiles();
+
+private:
+    /* Watches being set up on the pool, shared with the task doing it. */
+    struct Setup {
+        std::atomic<bool> cancelled{ false };
+        std::mutex mutex;
+        bool ready = false;
+        std::unique_ptr<FileWatcher> watcher;
+        /* The identifier of the module at each position of watcher. */
+        std::vector<ModuleId> ids;
+    };
+
+    ThreadPool& pool;
+    FileWatcher::WatchedPaths paths;
+    size_t queueLimit = 0;
+    std::function<void()> readyCallback;
+    std::string sourceDirectory;
+    std::unique_ptr<FileWatcher> watcher;
+    /* The identifier of the module at each position of watcher. */
+    std::vector<ModuleId> ids;
+    std::unordered_map<ModuleId, size_t> positions;
+    std::shared_ptr<Setup> setup;
+    /*
+     * The latest version of each module that changed while setup was
+     * running, or nullptr for those that were unwatched.
+     */
+    std::unordered_map<ModuleId, std::shared_ptr<const Module>>
+        changedModules;
+    /* Changes seen by watches that were replaced. */
+    std::vector<ChangedFile> keptChanges;
+
+    void cancelSetup();
+};
+} /* namespace gdfm */
+
+#endif /* MODULE_WATCHER_H */
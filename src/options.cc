@@ -24,13 +24,48 @@
 
 #include <err.h>
 #include <getopt.h>
+#include <stdint.h>
+#include <stdlib.h>
 
 #include <iostream>
 
+#include "bufferpool.h"
 #include "util.h"
 
 namespace gdfm {
 
+namespace {
+/*
+ * Adds the attributes named in list, which is separated by commas, to
+ * attributes. Accepts "times", "xattrs", "owner", and "all".
+ *
+ * Returns true on success, false if a name isn't one of those.
+ */
+bool
+parseCopyAttributes(const std::string& list, int& attributes)
+{
+    std::string::size_type begin = 0;
+    while (begin <= list.size()) {
+        std::string::size_type end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string name = list.substr(begin, end - begin);
+        if (name == "times")
+            attributes |= COPY_TIMES;
+        else if (name == "xattrs")
+            attributes |= COPY_EXTENDED_ATTRIBUTES;
+        else if (name == "owner")
+            attributes |= COPY_OWNER;
+        else if (name == "all")
+            attributes |= COPY_TIMES | COPY_EXTENDED_ATTRIBUTES | COPY_OWNER;
+        else
+            return false;
+        begin = end + 1;
+    }
+    return true;
+}
+} /* namespace */
+
 /*
  * I couyld use default values since this requires C++ 11 and it's easier and
  * easier to read, but it only really offers a benefit it there are multiple
@@ -46,7 +81,15 @@ DfmOptions::DfmOptions()
       generateConfigFileFlag(false),
       dumpConfigFileFlag(false),
       printModulesFlag(false),
-      hasSourceDirectory(false)
+      watchModulesFlag(false),
+      rollbackFlag(false),
+      hasSourceDirectory(false),
+      jobs(1),
+      hasStatisticsPath(false),
+      hasBackupDirectory(false),
+      copyAttributes(COPY_MODE),
+      memoryBudget(DEFAULT_MEMORY_BUDGET),
+      hasTracePath(false)
 {
 }
 
@@ -67,7 +110,16 @@ DfmOptions::loadFromArguments(int argc, char* argv[])
         { "generate-config-file", no_argument, NULL, 'g' },
         { "dump-config-file", no_argument, NULL, 'G' },
         { "print-modules", no_argument, NULL, 'p' },
-        { "directory", required_argument, NULL, 'd' }, { 0, 0, 0, 0 } };
+        { "watch", no_argument, NULL, 'w' },
+        { "backup", required_argument, NULL, 'b' },
+        { "directory", required_argument, NULL, 'd' },
+        { "jobs", required_argument, NULL, 'j' },
+        { "memory", required_argument, NULL, 'm' },
+        { "rollback", required_argument, NULL, 'r' },
+        { "statistics", required_argument, NULL, 's' },
+        { "trace", required_argument, NULL, 't' },
+        { "preserve", required_argument, NULL, 'P' },
+        { "target", required_argument, NULL, 'T' }, { 0, 0, 0, 0 } };
 
     int getoptValue = getopt_long_only(
         argc, argv, GETOPT_SHORT_OPTIONS, longOptions, &optionIndex);
@@ -104,13 +156,65 @@ DfmOptions::loadFromArguments(int argc, char* argv[])
         case 'G':
             dumpConfigFileFlag = true;
             break;
+        case 'b':
+            hasBackupDirectory = true;
+            backupDirectory = shellExpandPath(optarg);
+            break;
         case 'd':
             hasSourceDirectory = true;
             sourceDirectory = shellExpandPath(optarg);
             break;
+        case 'j': {
+            char* end = nullptr;
+            long jobCount = strtol(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || jobCount < 1
+                || jobCount > MAX_JOBS) {
+                warnx("Invalid number of jobs: %s.", optarg);
+                usage();
+                return false;
+            }
+            jobs = jobCount;
+            break;
+        }
+        case 'm': {
+            uint64_t budget = 0;
+            if (!parseByteCount(optarg, budget) || budget < MIN_MEMORY_BUDGET
+                || budget > SIZE_MAX) {
+                warnx("Invalid memory budget: %s.", optarg);
+                usage();
+                return false;
+            }
+            memoryBudget = budget;
+            break;
+        }
+        case 'r':
+            rollbackFlag = true;
+            rollbackRun = optarg;
+            break;
+        case 's':
+            hasStatisticsPath = true;
+            statisticsPath = shellExpandPath(optarg);
+            break;
+        case 't':
+            hasTracePath = true;
+            tracePath = shellExpandPath(optarg);
+            break;
+        case 'P':
+            if (!parseCopyAttributes(optarg, copyAttributes)) {
+                warnx("Invalid attributes to preserve: %s.", optarg);
+                usage();
+                return false;
+            }
+            break;
+        case 'T':
+            targetDirectories.push_back(shellExpandPath(optarg));
+            break;
         case 'p':
             printModulesFlag = true;
             break;
+        case 'w':
+            watchModulesFlag = true;
+            break;
         case 'v':
             verboseFlag = true;
             break;
@@ -159,6 +263,10 @@ DfmOptions::verifyFlagsConsistency() const
         operationsCount++;
     if (printModulesFlag)
         operationsCount++;
+    if (watchModulesFlag)
+        operationsCount++;
+    if (rollbackFlag)
+        operationsCount++;
 
     if (operationsCount == 0) {
         warnx("Must specify an operation.");
@@ -179,6 +287,36 @@ DfmOptions::verifyFlagsConsistency() const
         }
         return true;
     }
+    bool changesFiles =
+        installModulesFlag || uninstallModulesFlag || updateModulesFlag;
+    if (!targetDirectories.empty() && !changesFiles) {
+        warnx("Targets can only be installed, uninstalled, or updated.");
+        usage();
+        return false;
+    }
+    if (copyAttributes != COPY_MODE && !changesFiles && !watchModulesFlag) {
+        warnx("Attributes can only be preserved when copying files.");
+        usage();
+        return false;
+    }
+    if (rollbackFlag) {
+        if (!hasBackupDirectory) {
+            warnx("Must give the --backup store to roll back from.");
+            usage();
+            return false;
+        }
+        if (allFlag || remainingArguments.size() > 0) {
+            warnx("No modules expected when rolling back a run.");
+            usage();
+            return false;
+        }
+        if (rollbackRun.empty() || rollbackRun.find('/') != std::string::npos
+            || rollbackRun[0] == '.') {
+            warnx("Invalid run name: %s.", rollbackRun.c_str());
+            return false;
+        }
+        return true;
+    }
     if (printModulesFlag) {
         if (remainingArguments.size() > 0) {
             warnx("No arguments expected when printing modules.");
@@ -222,7 +360,7 @@ void
 DfmOptions::usage()
 {
     std::cout
-        << "usage: dfm [-Iv] [-c|-g|-G|-i|-u|-p] [-d directory] [-a|[MODULES]]"
+        << "usage: dfm [-Iv] [-c|-g|-G|-i|-u|-p|-w|-r run] [-b directory] [-d directory] [-j jobs] [-m memory] [-s file] [-t file] [-P attributes] [-T directory ...] [-a|[MODULES]]"
         << std::endl;
 }
 } /* namespace gdfm */
@@ -23,13 +23,17 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
 
+#include <stddef.h>
+
 #include <string>
 #include <vector>
 
 namespace gdfm {
 
 /* Inital colon gets getopt to return ":" on missing required argument.  */
-const char GETOPT_SHORT_OPTIONS[] = "iuaIcvgGpd:";
+const char GETOPT_SHORT_OPTIONS[] = "iuaIcvgGpwb:d:j:m:r:s:t:P:T:";
+/* The most modules that can be run at once with the --jobs option. */
+const long MAX_JOBS = 256;
 
 class DfmOptions {
 public:
@@ -56,9 +60,46 @@ public:
     bool generateConfigFileFlag;
     bool dumpConfigFileFlag;
     bool printModulesFlag;
+    /*
+     * Keeps running, updating the files of the modules as their sources
+     * change.
+     */
+    bool watchModulesFlag;
+    /* Puts back what the run with the name in rollbackRun replaced. */
+    bool rollbackFlag;
+    std::string rollbackRun;
     std::vector<std::string> remainingArguments;
     bool hasSourceDirectory;
     std::string sourceDirectory;
+    /* The number of modules that may be run at the same time. */
+    unsigned int jobs;
+    /*
+     * Where to write the statistics for a run as JSON, with "-" meaning
+     * standard output.
+     */
+    bool hasStatisticsPath;
+    std::string statisticsPath;
+    /*
+     * The store to back up files in before they are written over or
+     * removed, if any.
+     */
+    bool hasBackupDirectory;
+    std::string backupDirectory;
+    /*
+     * Directories to put the files that go in the home directory in instead,
+     * each one getting all of them.
+     */
+    std::vector<std::string> targetDirectories;
+    /*
+     * What copies keep besides their contents and permissions, as a mask of
+     * CopyAttribute.
+     */
+    int copyAttributes;
+    /* How much memory copy and compare buffers may take up at once. */
+    size_t memoryBudget;
+    /* Where to write a Chrome trace of the run, if anywhere. */
+    bool hasTracePath;
+    std::string tracePath;
 
     /*
      * The getopt_long function sets flags sometimes. I want 1 to be true and 0
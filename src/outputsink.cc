@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "outputsink.h"
+
+#include <iostream>
+
+namespace gdfm {
+
+OutputSink::~OutputSink()
+{
+}
+
+void
+OutputSink::writeMessage(const std::string& source, const std::string& message)
+{
+    writeLine(source, message);
+}
+
+StreamOutputSink::StreamOutputSink(std::ostream& stream) : stream(stream)
+{
+}
+
+void
+StreamOutputSink::writeLine(const std::string& source, const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (source.length() > 0)
+        stream << "[" << source << "] ";
+    stream << line << std::endl;
+}
+
+std::shared_ptr<OutputSink>
+StreamOutputSink::getStandardOutput()
+{
+    static std::shared_ptr<OutputSink> standardOutput(
+        new StreamOutputSink(std::cout));
+    return standardOutput;
+}
+
+QueuedOutputSink::QueuedOutputSink()
+{
+}
+
+void
+QueuedOutputSink::writeLine(const std::string& source, const std::string& line)
+{
+    bool wasEmpty = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wasEmpty = lines.empty();
+        lines.push_back(OutputLine{source, line});
+    }
+    /*
+     * Once something is queued, the reader has already been told and will
+     * take this line along with it.
+     */
+    if (wasEmpty && notifyHandler)
+        notifyHandler();
+}
+
+void
+QueuedOutputSink::writeMessage(
+    const std::string& source, const std::string& message)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(OutputLine{source, message});
+    }
+    writeLine(source, message);
+}
+
+void
+QueuedOutputSink::setNotifyHandler(std::function<void()> handler)
+{
+    notifyHandler = handler;
+}
+
+std::vector<OutputLine>
+QueuedOutputSink::takeLines()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<OutputLine> taken;
+    taken.swap(lines);
+    return taken;
+}
+
+std::vector<OutputLine>
+QueuedOutputSink::takeMessages()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<OutputLine> taken;
+    taken.swap(messages);
+    return taken;
+}
+
+ActionOutput::ActionOutput(
+    std::shared_ptr<OutputSink> sink, const std::string& source)
+    : ActionOutput(sink, source, ACTION_OUTPUT_CAPACITY)
+{
+}
+
+ActionOutput::ActionOutput(std::shared_ptr<OutputSink> sink,
+    const std::string& source, size_t capacity)
+    : sink(sink), source(source), tail(capacity)
+{
+}
+
+void
+ActionOutput::write(const char* data, size_t length)
+{
+    tail.append(data, length);
+    size_t lineStart = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != '\n')
+            continue;
+        partialLine.append(data + lineStart, i - lineStart);
+        sink->writeLine(source, partialLine);
+        partialLine.clear();
+        lineStart = i + 1;
+    }
+    partialLine.append(data + lineStart, length - lineStart);
+    if (partialLine.length() >= MAX_OUTPUT_LINE_LENGTH) {
+        sink->writeLine(source, partialLine);
+        partialLine.clear();
+    }
+}
+
+void
+ActionOutput::flush()
+{
+    if (partialLine.length() == 0)
+        return;
+    sink->writeLine(source, partialLine);
+    partialLine.clear();
+}
+
+void
+ActionOutput::writeLine(const std::string& line)
+{
+    flush();
+    sink->writeLine(source, line);
+}
+
+std::string
+ActionOutput::getTail() const
+{
+    return tail.getContents();
+}
+} /* namespace gdfm */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ringbuffer.h"
+
+namespace gdfm {
+
+/* How much of each command's output is kept after it finishes, in bytes. */
+const size_t ACTION_OUTPUT_CAPACITY = 64 * 1024;
+/*
+ * Output without a newline is passed on anyway once it gets this long, so a
+ * command that never prints one can't grow the line buffer forever.
+ */
+const size_t MAX_OUTPUT_LINE_LENGTH = 16 * 1024;
+
+/*
+ * Something that receives output from actions one whole line at a time.
+ * Implementations must be safe to call from several threads at once, and
+ * must never mix two lines together.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink();
+    /*
+     * Receives one line of output, without the trailing newline. The source
+     * is what produced the line, normally the name of the module, and may be
+     * empty.
+     */
+    virtual void writeLine(
+        const std::string& source, const std::string& line) = 0;
+    /*
+     * Receives a message meant for the user, such as from a MessageAction.
+     * By default it is written like any other line.
+     */
+    virtual void writeMessage(
+        const std::string& source, const std::string& message);
+};
+
+/*
+ * Writes lines to an output stream, prefixed with their source in square
+ * brackets if there is one.
+ */
+class StreamOutputSink : public OutputSink {
+public:
+    StreamOutputSink(std::ostream& stream);
+
+    void writeLine(
+        const std::string& source, const std::string& line) override;
+
+    /* Returns a sink shared by everything that writes to standard output. */
+    static std::shared_ptr<OutputSink> getStandardOutput();
+
+private:
+    std::ostream& stream;
+    std::mutex mutex;
+};
+
+/* A line of output along with where it came from. */
+struct OutputLine {
+    std::string source;
+    std::string text;
+};
+
+/*
+ * Holds lines until another thread takes them, so output produced during a
+ * background run can be shown by the thread that owns the window. Messages
+ * are also kept separately so they can be shown once the run is over.
+ */
+class QueuedOutputSink : public OutputSink {
+public:
+    QueuedOutputSink();
+
+    void writeLine(
+        const std::string& source, const std::string& line) override;
+    void writeMessage(
+        const std::string& source, const std::string& message) override;
+
+    /*
+     * Sets a function called after lines are added to an empty queue. It is
+     * called on the writing thread.
+     */
+    void setNotifyHandler(std::function<void()> handler);
+    /* Removes and returns every line waiting in the queue. */
+    std::vector<OutputLine> takeLines();
+    /* Removes and returns every message received so far. */
+    std::vector<OutputLine> takeMessages();
+
+private:
+    std::mutex mutex;
+    std::vector<OutputLine> lines;
+    std::vector<OutputLine> messages;
+    std::function<void()> notifyHandler;
+};
+
+/*
+ * The output of a single running action. Raw output goes into its own ring
+ * buffer and is split into lines, which are streamed to a sink as soon as
+ * each is complete.
+ */
+class ActionOutput {
+public:
+    ActionOutput(std::shared_ptr<OutputSink> sink, const std::string& source);
+    ActionOutput(std::shared_ptr<OutputSink> sink, const std::string& source,
+        size_t capacity);
+
+    void write(const char* data, size_t length);
+    /* Sends out the last line even if it doesn't end with a newline. */
+    void flush();
+    /* Writes a line that didn't come from the command itself. */
+    void writeLine(const std::string& line);
+    /* Returns the most recent output, up to the buffer capacity. */
+    std::string getTail() const;
+
+private:
+    std::shared_ptr<OutputSink> sink;
+    std::string source;
+    RingBuffer tail;
+    std::string partialLine;
+};
+} /* namespace gdfm */
+
+#endif /* OUTPUT_SINK_H */
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "processlauncher.h"
+
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+extern char** environ;
+
+namespace gdfm {
+
+ProcessLauncher::ProcessLauncher()
+{
+}
+
+ProcessLauncher::ProcessLauncher(const std::vector<std::string>& arguments)
+    : arguments(arguments)
+{
+}
+
+ProcessLauncher
+ProcessLauncher::forShellCommand(const std::string& command)
+{
+    std::vector<std::string> arguments;
+    arguments.push_back(SHELL_PATH);
+    arguments.push_back("-c");
+    arguments.push_back(command);
+    return ProcessLauncher(arguments);
+}
+
+const std::vector<std::string>&
+ProcessLauncher::getArguments() const
+{
+    return arguments;
+}
+
+void
+ProcessLauncher::setArguments(const std::vector<std::string>& arguments)
+{
+    this->arguments = arguments;
+}
+
+int
+ProcessLauncher::getTimeout() const
+{
+    return timeout;
+}
+
+void
+ProcessLauncher::setTimeout(int timeout)
+{
+    this->timeout = timeout;
+}
+
+bool
+ProcessLauncher::usesNewProcessGroup() const
+{
+    return newProcessGroup;
+}
+
+void
+ProcessLauncher::setNewProcessGroup(bool newProcessGroup)
+{
+    this->newProcessGroup = newProcessGroup;
+}
+
+bool
+ProcessLauncher::isCapturingOutput() const
+{
+    return captureOutput;
+}
+
+void
+ProcessLauncher::setCaptureOutput(bool captureOutput)
+{
+    this->captureOutput = captureOutput;
+}
+
+void
+ProcessLauncher::setOutputHandler(
+    std::function<void(const char*, size_t)> outputHandler)
+{
+    this->outputHandler = outputHandler;
+}
+
+bool
+ProcessLauncher::run()
+{
+    output.clear();
+    waitStatus = 0;
+    exited = false;
+    timedOut = false;
+    if (arguments.size() < 1) {
+        warnx("No program given to run.");
+        return false;
+    }
+
+    int pipeFds[2] = { -1, -1 };
+    if (captureOutput) {
+        if (pipe(pipeFds) != 0) {
+            warn("Failed to create pipe for process output");
+            return false;
+        }
+        /*
+         * The close-on-exec flag keeps the child from inheriting both ends,
+         * dup2() in the child clears it on the copies that it actually uses.
+         */
+        fcntl(pipeFds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipeFds[1], F_SETFD, FD_CLOEXEC);
+        fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+    }
+    bool spawned = spawn(pipeFds[1]);
+    if (captureOutput)
+        close(pipeFds[1]);
+    if (!spawned) {
+        if (captureOutput)
+            close(pipeFds[0]);
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+    bool pipeOpen = captureOutput;
+    while (!exited) {
+        /*
+         * While the pipe is open, the end of the pipe is what normally wakes
+         * this loop up, so the wait time only matters for noticing a child
+         * that exited while something it started still holds the pipe.
+         */
+        long waitTime = (pipeOpen) ? 100 : 10;
+        if (timeout > 0) {
+            long remaining =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now())
+                    .count();
+            if (remaining <= 0) {
+                timedOut = true;
+                warnx("Process %s timed out after %d seconds, killing it.",
+                    arguments[0].c_str(), timeout);
+                killChild();
+                break;
+            }
+            waitTime = std::min(waitTime, remaining);
+        } else if (!pipeOpen) {
+            /* There's nothing left to watch, so block until it exits. */
+            while (waitpid(pid, &waitStatus, 0) == -1 && errno == EINTR)
+                ;
+            exited = true;
+            break;
+        }
+
+        if (pipeOpen) {
+            struct pollfd pollInfo;
+            pollInfo.fd = pipeFds[0];
+            pollInfo.events = POLLIN;
+            pollInfo.revents = 0;
+            int ready = poll(&pollInfo, 1, waitTime);
+            if (ready > 0)
+                pipeOpen = drainOutput(pipeFds[0]);
+            else if (ready == -1 && errno != EINTR) {
+                warn("Failed to wait for process output");
+                pipeOpen = false;
+            }
+        } else
+            poll(NULL, 0, waitTime);
+        pollExited();
+    }
+    if (captureOutput) {
+        drainOutput(pipeFds[0]);
+        close(pipeFds[0]);
+    }
+    return true;
+}
+
+bool
+ProcessLauncher::spawn(int outputFd)
+{
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawnattr_init(&attributes);
+
+    /*
+     * The child shouldn't inherit a blocked signal mask or ignored signals
+     * from whatever thread happens to be running it.
+     */
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    posix_spawnattr_setsigmask(&attributes, &emptyMask);
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    sigaddset(&defaultSignals, SIGINT);
+    sigaddset(&defaultSignals, SIGQUIT);
+    sigaddset(&defaultSignals, SIGHUP);
+    sigaddset(&defaultSignals, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    if (newProcessGroup) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attributes, 0);
+    }
+    posix_spawnattr_setflags(&attributes, flags);
+
+    if (captureOutput) {
+        posix_spawn_file_actions_addopen(
+            &fileActions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(
+            &fileActions, outputFd, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(
+            &fileActions, outputFd, STDERR_FILENO);
+    }
+
+    std::vector<char*> argv;
+    for (const auto& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(NULL);
+
+    int status = posix_spawnp(
+        &pid, argv[0], &fileActions, &attributes, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    posix_spawnattr_destroy(&attributes);
+    if (status != 0) {
+        errno = status;
+        warn("Failed to start %s", arguments[0].c_str());
+        pid = -1;
+        return false;
+    }
+    return true;
+}
+
+void
+ProcessLauncher::handleOutput(const char* data, size_t length)
+{
+    if (outputHandler)
+        outputHandler(data, length);
+    else
+        output.append(data, length);
+}
+
+bool
+ProcessLauncher::drainOutput(int fd)
+{
+    char buffer[PROCESS_READ_SIZE];
+    for (;;) {
+        ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+        if (bytesRead > 0)
+            handleOutput(buffer, bytesRead);
+        else if (bytesRead == 0)
+            return false;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+        else if (errno != EINTR) {
+            warn("Failed to read process output");
+            return false;
+        }
+    }
+}
+
+bool
+ProcessLauncher::pollExited()
+{
+    if (exited)
+        return true;
+    pid_t result = waitpid(pid, &waitStatus, WNOHANG);
+    /*
+     * If it failed for any reason other than an interrupt, there's no child
+     * left to wait for so treat it as exited.
+     */
+    if (result == pid || (result == -1 && errno != EINTR))
+        exited = true;
+    return exited;
+}
+
+void
+ProcessLauncher::killChild()
+{
+    pid_t target = (newProcessGroup) ? -pid : pid;
+    kill(target, SIGTERM);
+    for (int waited = 0; waited < KILL_GRACE_PERIOD; waited += 10) {
+        if (pollExited())
+            break;
+        poll(NULL, 0, 10);
+    }
+    /*
+     * Even if the child itself exited, anything it started in the same group
+     * might still be running and should go too.
+     * A lone child that was already reaped is left alone since its process
+     * ID could have been reused.
+     */
+    if (newProcessGroup || !exited)
+        kill(target, SIGKILL);
+    if (!exited) {
+        while (waitpid(pid, &waitStatus, 0) == -1 && errno == EINTR)
+            ;
+        exited = true;
+    }
+}
+
+bool
+ProcessLauncher::succeeded() const
+{
+    return exited && !timedOut && WIFEXITED(waitStatus)
+        && WEXITSTATUS(waitStatus) == 0;
+}
+
+bool
+ProcessLauncher::hasTimedOut() const
+{
+    return timedOut;
+}
+
+int
+ProcessLauncher::getWaitStatus() const
+{
+    return waitStatus;
+}
+
+const std::string&
+ProcessLauncher::getOutput() const
+{
+    return output;
+}
+} /* namespace gdfm */
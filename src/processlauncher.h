@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PROCESS_LAUNCHER_H
+#define PROCESS_LAUNCHER_H
+
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gdfm {
+
+/* The shell used to run command strings, same as the one system() uses. */
+const char SHELL_PATH[] = "/bin/sh";
+/*
+ * How long to wait after sending SIGTERM to a timed out process group before
+ * sending SIGKILL, in milliseconds.
+ */
+const int KILL_GRACE_PERIOD = 2000;
+/* The size of the buffer used when reading output from a child process. */
+const size_t PROCESS_READ_SIZE = 4096;
+
+/*
+ * Runs a single child process with posix_spawn. Unlike system(), this doesn't
+ * fork the address space of the parent, doesn't block SIGCHLD, can put the
+ * child in its own process group so that everything it starts can be killed
+ * at once, can enforce a wall-clock timeout, and can capture the combined
+ * standard output and error of the child through a non-blocking pipe.
+ */
+class ProcessLauncher {
+public:
+    ProcessLauncher();
+    ProcessLauncher(const std::vector<std::string>& arguments);
+
+    /*
+     * Creates a launcher that runs command with SHELL_PATH, the same way
+     * system() would.
+     */
+    static ProcessLauncher forShellCommand(const std::string& command);
+
+    const std::vector<std::string>& getArguments() const;
+    void setArguments(const std::vector<std::string>& arguments);
+    /*
+     * The timeout is in seconds. A value of zero or less means that the
+     * process is allowed to run forever, which is the default.
+     */
+    int getTimeout() const;
+    void setTimeout(int timeout);
+    /*
+     * Whether or not the child is put in a new process group. This is true by
+     * default. It should be turned off for processes that need to read from
+     * the terminal, since only the foreground process group is allowed to.
+     */
+    bool usesNewProcessGroup() const;
+    void setNewProcessGroup(bool newProcessGroup);
+    /*
+     * Whether or not the output of the child is captured. If it isn't, the
+     * child inherits the standard input, output, and error of this process.
+     * If it is, standard input is redirected from /dev/null and standard
+     * output and error are sent through a pipe to the output handler.
+     */
+    bool isCapturingOutput() const;
+    void setCaptureOutput(bool captureOutput);
+    /*
+     * Sets the function that receives output from the child as it arrives.
+     * The chunks are not split on line boundaries. If no handler is set, then
+     * captured output is collected and can be retrieved with getOutput().
+     */
+    void setOutputHandler(
+        std::function<void(const char*, size_t)> outputHandler);
+
+    /*
+     * Starts the process and waits for it to finish, killing its process
+     * group if it runs longer than the timeout.
+     *
+     * Returns true if the process was started and waited for, false if it
+     * couldn't be started. Use succeeded() to check the exit status.
+     */
+    bool run();
+
+    /* Returns if the process exited normally with a status of zero. */
+    bool succeeded() const;
+    bool hasTimedOut() const;
+    /* The status as returned by waitpid, only valid after run(). */
+    int getWaitStatus() const;
+    const std::string& getOutput() const;
+
+private:
+    std::vector<std::string> arguments;
+    int timeout = 0;
+    bool newProcessGroup = true;
+    bool captureOutput = true;
+    std::function<void(const char*, size_t)> outputHandler;
+
+    pid_t pid = -1;
+    int waitStatus = 0;
+    bool exited = false;
+    bool timedOut = false;
+    std::string output;
+
+    bool spawn(int outputFd);
+    void handleOutput(const char* data, size_t length);
+    /*
+     * Reads everything that is currently available from fd without blocking.
+     *
+     * Returns false once the end of the pipe is reached, true otherwise.
+     */
+    bool drainOutput(int fd);
+    /* Checks if the child has exited without blocking. */
+    bool pollExited();
+    /*
+     * Sends SIGTERM to the child's process group, or just the child if it
+     * isn't in its own group, then SIGKILL if it doesn't exit within
+     * KILL_GRACE_PERIOD.
+     */
+    void killChild();
+};
+} /* namespace gdfm */
+
+#endif /* PROCESS_LAUNCHER_H */
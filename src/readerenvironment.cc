@@ -98,4 +98,10 @@ ReaderEnvironment::accessVariable(const std::string& name, std::string& value)
     } else
         return false;
 }
+
+const std::map<std::string, std::string>&
+ReaderEnvironment::getVariables() const
+{
+    return variables;
+}
 } /* namespace gdfm */
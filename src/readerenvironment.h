@@ -80,6 +80,8 @@ public:
      * Returns whether or not the variable given by name is set.
      */
     bool accessVariable(const std::string& name, std::string& value);
+    /* Returns every variable that is set, by name. */
+    const std::map<std::string, std::string>& getVariables() const;
 
 private:
     std::shared_ptr<DfmOptions> options;
@@ -29,7 +29,8 @@
 
 #include <iostream>
 
-#include "removeactioneditor.h"
+#include "runcontext.h"
+#include "runstatistics.h"
 #include "util.h"
 
 namespace gdfm {
@@ -81,7 +82,11 @@ RemoveAction::performAction()
         std::cout << std::endl;
     }
     verboseMessage("Removing %s.\n\n", filePath.c_str());
-    return deleteFile(shellExpandPath(filePath));
+    std::string path = shellExpandPath(filePath);
+    if (!RunContext::backUpCurrent(path, true))
+        return false;
+    PhaseTimer timer(RunStatistics::DELETE_PHASE);
+    return deleteFile(path);
 }
 
 void
@@ -93,6 +98,12 @@ RemoveAction::updateName()
     free(pathCopy);
 }
 
+std::shared_ptr<ModuleAction>
+RemoveAction::clone() const
+{
+    return std::shared_ptr<ModuleAction>(new RemoveAction(*this));
+}
+
 std::vector<std::string>
 RemoveAction::createConfigLines() const
 {
@@ -100,11 +111,4 @@ RemoveAction::createConfigLines() const
     lines.push_back("remove " + filePath);
     return lines;
 }
-
-void
-RemoveAction::graphicalEdit(Gtk::Window& parent)
-{
-    RemoveActionEditor editor(parent, this);
-    editor.run();
-}
 } /* namespace gdfm */
@@ -41,8 +41,8 @@ public:
     bool performAction() override;
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     std::string filePath;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "ringbuffer.h"
+
+#include <string.h>
+
+namespace gdfm {
+
+RingBuffer::RingBuffer(size_t capacity) : buffer(capacity)
+{
+}
+
+void
+RingBuffer::append(const char* data, size_t length)
+{
+    size_t capacity = buffer.size();
+    if (capacity == 0)
+        return;
+    /* Only the last capacity bytes could ever survive. */
+    if (length > capacity) {
+        data += length - capacity;
+        length = capacity;
+        overflowed = true;
+    }
+    size_t firstPart = capacity - head;
+    if (firstPart > length)
+        firstPart = length;
+    memcpy(&buffer[head], data, firstPart);
+    memcpy(&buffer[0], data + firstPart, length - firstPart);
+    head = (head + length) % capacity;
+    if (size + length > capacity)
+        overflowed = true;
+    size = (size + length > capacity) ? capacity : size + length;
+}
+
+void
+RingBuffer::clear()
+{
+    head = 0;
+    size = 0;
+    overflowed = false;
+}
+
+std::string
+RingBuffer::getContents() const
+{
+    size_t capacity = buffer.size();
+    size_t start = (head + capacity - size) % (capacity > 0 ? capacity : 1);
+    std::string contents;
+    contents.reserve(size);
+    size_t firstPart = capacity - start;
+    if (firstPart > size)
+        firstPart = size;
+    contents.append(buffer.data() + start, firstPart);
+    contents.append(buffer.data(), size - firstPart);
+    return contents;
+}
+
+size_t
+RingBuffer::getSize() const
+{
+    return size;
+}
+
+size_t
+RingBuffer::getCapacity() const
+{
+    return buffer.size();
+}
+
+bool
+RingBuffer::hasOverflowed() const
+{
+    return overflowed;
+}
+} /* namespace gdfm */
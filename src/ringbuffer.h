@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace gdfm {
+
+/*
+ * A fixed size buffer of bytes that keeps only the most recent bytes written
+ * to it. Used to hold the tail of a command's output without letting a noisy
+ * command use an unbounded amount of memory.
+ */
+class RingBuffer {
+public:
+    RingBuffer(size_t capacity);
+
+    void append(const char* data, size_t length);
+    void clear();
+    /* Returns the bytes currently held, oldest first. */
+    std::string getContents() const;
+    size_t getSize() const;
+    size_t getCapacity() const;
+    /* Returns if bytes were ever dropped to make room for newer ones. */
+    bool hasOverflowed() const;
+
+private:
+    std::vector<char> buffer;
+    /* The index the next byte will be written to. */
+    size_t head = 0;
+    size_t size = 0;
+    bool overflowed = false;
+};
+} /* namespace gdfm */
+
+#endif /* RING_BUFFER_H */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "runcontext.h"
+
+#include <err.h>
+
+#include "backupstore.h"
+#include "bufferpool.h"
+
+namespace gdfm {
+
+namespace {
+thread_local RunContext* currentContext = nullptr;
+} /* namespace */
+
+RunContext::RunContext()
+{
+}
+
+const std::string&
+RunContext::getModuleName() const
+{
+    return moduleName;
+}
+
+void
+RunContext::setModuleName(const std::string& moduleName)
+{
+    this->moduleName = moduleName;
+}
+
+std::shared_ptr<OutputSink>
+RunContext::getOutputSink() const
+{
+    return outputSink;
+}
+
+void
+RunContext::setOutputSink(std::shared_ptr<OutputSink> outputSink)
+{
+    this->outputSink = outputSink;
+}
+
+RunStatistics*
+RunContext::getStatistics() const
+{
+    return statistics;
+}
+
+void
+RunContext::setStatistics(RunStatistics* statistics)
+{
+    this->statistics = statistics;
+}
+
+std::shared_ptr<BackupStore>
+RunContext::getBackupStore() const
+{
+    return backupStore;
+}
+
+void
+RunContext::setBackupStore(std::shared_ptr<BackupStore> backupStore)
+{
+    this->backupStore = backupStore;
+}
+
+std::shared_ptr<TemplateCache>
+RunContext::getTemplateCache() const
+{
+    return templateCache;
+}
+
+void
+RunContext::setTemplateCache(std::shared_ptr<TemplateCache> templateCache)
+{
+    this->templateCache = templateCache;
+}
+
+std::shared_ptr<BufferPool>
+RunContext::getBufferPool() const
+{
+    return bufferPool;
+}
+
+void
+RunContext::setBufferPool(std::shared_ptr<BufferPool> bufferPool)
+{
+    this->bufferPool = bufferPool;
+}
+
+int
+RunContext::getCopyAttributes() const
+{
+    return copyAttributes;
+}
+
+void
+RunContext::setCopyAttributes(int copyAttributes)
+{
+    this->copyAttributes = copyAttributes;
+}
+
+void
+RunContext::setCancelFlag(const std::atomic<bool>* cancelFlag)
+{
+    this->cancelFlag = cancelFlag;
+}
+
+bool
+RunContext::isCancelled() const
+{
+    return cancelFlag && *cancelFlag;
+}
+
+const std::string&
+RunContext::getFailureOutput() const
+{
+    return failureOutput;
+}
+
+void
+RunContext::setFailureOutput(const std::string& failureOutput)
+{
+    this->failureOutput = failureOutput;
+}
+
+RunContext*
+RunContext::getCurrent()
+{
+    return currentContext;
+}
+
+std::shared_ptr<OutputSink>
+RunContext::getCurrentOutputSink()
+{
+    if (currentContext && currentContext->outputSink)
+        return currentContext->outputSink;
+    return StreamOutputSink::getStandardOutput();
+}
+
+bool
+RunContext::isCurrentCancelled()
+{
+    return currentContext && currentContext->isCancelled();
+}
+
+std::shared_ptr<TemplateCache>
+RunContext::getCurrentTemplateCache()
+{
+    if (currentContext)
+        return currentContext->templateCache;
+    return std::shared_ptr<TemplateCache>();
+}
+
+BufferPool&
+RunContext::getCurrentBufferPool()
+{
+    static BufferPool defaultPool(DEFAULT_MEMORY_BUDGET);
+    if (currentContext && currentContext->bufferPool)
+        return *currentContext->bufferPool;
+    return defaultPool;
+}
+
+int
+RunContext::getCurrentCopyAttributes()
+{
+    if (currentContext)
+        return currentContext->copyAttributes;
+    return COPY_MODE;
+}
+
+bool
+RunContext::backUpCurrent(const std::string& path, bool removing)
+{
+    if (!currentContext || !currentContext->backupStore)
+        return true;
+    if (currentContext->backupStore->backUp(path, removing))
+        return true;
+    warnx("Failed to back up %s, leaving it alone.", path.c_str());
+    return false;
+}
+
+bool
+RunContext::backUpInstall(
+    const std::string& sourcePath, const std::string& destinationPath)
+{
+    if (!currentContext || !currentContext->backupStore)
+        return true;
+    if (currentContext->backupStore->backUpInstall(
+            sourcePath, destinationPath))
+        return true;
+    warnx("Failed to back up %s, leaving it alone.",
+        destinationPath.c_str());
+    return false;
+}
+
+RunContext::Scope::Scope(RunContext& context) : previous(currentContext)
+{
+    currentContext = &context;
+}
+
+RunContext::Scope::~Scope()
+{
+    currentContext = previous;
+}
+} /* namespace gdfm */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RUN_CONTEXT_H
+#define RUN_CONTEXT_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "outputsink.h"
+#include "util.h"
+
+namespace gdfm {
+
+class BackupStore;
+class BufferPool;
+class RunStatistics;
+class TemplateCache;
+
+/*
+ * State for the module that is currently being installed, uninstalled, or
+ * updated on a thread. Actions don't take any arguments when they're
+ * performed, so they look this up with getCurrent() instead. Nothing is
+ * current outside of a run, and actions fall back to their old behavior.
+ */
+class RunContext {
+public:
+    RunContext();
+
+    const std::string& getModuleName() const;
+    void setModuleName(const std::string& moduleName);
+    std::shared_ptr<OutputSink> getOutputSink() const;
+    void setOutputSink(std::shared_ptr<OutputSink> outputSink);
+    RunStatistics* getStatistics() const;
+    void setStatistics(RunStatistics* statistics);
+    /* Where files are kept before they're replaced, if anywhere. */
+    std::shared_ptr<BackupStore> getBackupStore() const;
+    void setBackupStore(std::shared_ptr<BackupStore> backupStore);
+    /* Where templates are kept once they're read, if anywhere. */
+    std::shared_ptr<TemplateCache> getTemplateCache() const;
+    void setTemplateCache(std::shared_ptr<TemplateCache> templateCache);
+    /* Where copy and compare buffers come from, if not the default pool. */
+    std::shared_ptr<BufferPool> getBufferPool() const;
+    void setBufferPool(std::shared_ptr<BufferPool> bufferPool);
+    /* What copies keep besides the contents, as a mask of CopyAttribute. */
+    int getCopyAttributes() const;
+    void setCopyAttributes(int copyAttributes);
+    /*
+     * Sets the flag that is raised when the run should stop. The flag isn't
+     * owned by the context and must outlive it.
+     */
+    void setCancelFlag(const std::atomic<bool>* cancelFlag);
+    /* Returns true if the run this context belongs to has been cancelled. */
+    bool isCancelled() const;
+    /*
+     * The end of the output of the command that made the module fail, if
+     * a command did.
+     */
+    const std::string& getFailureOutput() const;
+    void setFailureOutput(const std::string& failureOutput);
+
+    /* Returns the context current on this thread, or nullptr if none is. */
+    static RunContext* getCurrent();
+    /*
+     * Returns the sink of the current context, or one for standard output if
+     * there isn't one.
+     */
+    static std::shared_ptr<OutputSink> getCurrentOutputSink();
+    /*
+     * Returns true if there is a current context and its run has been
+     * cancelled.
+     */
+    static bool isCurrentCancelled();
+    /* Returns the template cache of the current context, if any. */
+    static std::shared_ptr<TemplateCache> getCurrentTemplateCache();
+    /*
+     * Returns the buffer pool of the current context, or one shared by the
+     * whole process with DEFAULT_MEMORY_BUDGET if there isn't one.
+     */
+    static BufferPool& getCurrentBufferPool();
+    /*
+     * Returns the copy attributes of the current context, or COPY_MODE if
+     * there isn't one.
+     */
+    static int getCurrentCopyAttributes();
+    /*
+     * Backs up the file at path in the store of the current context before
+     * it is written over, or removed if removing is set. Warns about
+     * failures.
+     *
+     * Returns true if it was backed up or there is no store, false if the
+     * file must be left alone.
+     */
+    static bool backUpCurrent(const std::string& path, bool removing);
+    /*
+     * Same as backUpCurrent() for copying sourcePath to destinationPath,
+     * also noting every file the copy will create.
+     */
+    static bool backUpInstall(
+        const std::string& sourcePath, const std::string& destinationPath);
+
+    /*
+     * Makes a context current on the calling thread for as long as it exists,
+     * then restores whatever was current before.
+     */
+    class Scope {
+    public:
+        Scope(RunContext& context);
+        ~Scope();
+
+    private:
+        RunContext* previous;
+    };
+
+private:
+    std::string moduleName;
+    std::shared_ptr<OutputSink> outputSink;
+    RunStatistics* statistics = nullptr;
+    std::shared_ptr<BackupStore> backupStore;
+    std::shared_ptr<TemplateCache> templateCache;
+    std::shared_ptr<BufferPool> bufferPool;
+    int copyAttributes = COPY_MODE;
+    const std::atomic<bool>* cancelFlag = nullptr;
+    std::string failureOutput;
+};
+} /* namespace gdfm */
+
+#endif /* RUN_CONTEXT_H */
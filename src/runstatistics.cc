@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "runstatistics.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "runcontext.h"
+#include "util.h"
+
+namespace gdfm {
+
+RunStatistics::RunStatistics()
+    : totalActions(0),
+      finishedActions(0),
+      copiedFiles(0),
+      copiedBytes(0),
+      examinedFiles(0),
+      peakBufferBytes(0),
+      startTime(getClockNanoseconds()),
+      stopTime(0),
+      lastProgressTime(0)
+{
+}
+
+void
+RunStatistics::reset()
+{
+    totalActions = 0;
+    finishedActions = 0;
+    copiedFiles = 0;
+    copiedBytes = 0;
+    examinedFiles = 0;
+    for (auto& histogram : phaseHistograms)
+        histogram.reset();
+    bufferWaitHistogram.reset();
+    peakBufferBytes = 0;
+    stopPeakResidentBytes = 0;
+    startTime = getClockNanoseconds();
+    stopTime = 0;
+    started = false;
+    systemCallCountsKnown = false;
+    lastProgressTime = 0;
+    std::lock_guard<std::mutex> lock(moduleTimesMutex);
+    moduleTimes.clear();
+    targetResults.clear();
+}
+
+void
+RunStatistics::start()
+{
+    if (started)
+        return;
+    started = true;
+    systemCallCountsKnown =
+        readSystemCallCounts(startReadCalls, startWriteCalls);
+    startTime = getClockNanoseconds();
+    stopTime = 0;
+}
+
+void
+RunStatistics::stop()
+{
+    if (systemCallCountsKnown)
+        readSystemCallCounts(stopReadCalls, stopWriteCalls);
+    stopPeakResidentBytes = readPeakResidentBytes();
+    stopTime = getClockNanoseconds();
+}
+
+uint64_t
+RunStatistics::getTotalActions() const
+{
+    return totalActions;
+}
+
+void
+RunStatistics::setTotalActions(uint64_t totalActions)
+{
+    this->totalActions = totalActions;
+}
+
+uint64_t
+RunStatistics::getFinishedActions() const
+{
+    return finishedActions;
+}
+
+uint64_t
+RunStatistics::getCopiedFiles() const
+{
+    return copiedFiles;
+}
+
+uint64_t
+RunStatistics::getCopiedBytes() const
+{
+    return copiedBytes;
+}
+
+uint64_t
+RunStatistics::getExaminedFiles() const
+{
+    return examinedFiles;
+}
+
+double
+RunStatistics::getElapsedSeconds() const
+{
+    return getElapsedMilliseconds() / 1000.0;
+}
+
+double
+RunStatistics::getFilesPerSecond() const
+{
+    double seconds = getElapsedSeconds();
+    return (seconds > 0) ? copiedFiles / seconds : 0;
+}
+
+double
+RunStatistics::getBytesPerSecond() const
+{
+    double seconds = getElapsedSeconds();
+    return (seconds > 0) ? copiedBytes / seconds : 0;
+}
+
+double
+RunStatistics::getFractionFinished() const
+{
+    uint64_t total = totalActions;
+    if (total == 0)
+        return 0;
+    uint64_t finished = finishedActions;
+    return (finished < total) ? static_cast<double>(finished) / total : 1;
+}
+
+bool
+RunStatistics::hasSystemCallCounts() const
+{
+    return systemCallCountsKnown;
+}
+
+uint64_t
+RunStatistics::getReadCalls() const
+{
+    if (!systemCallCountsKnown)
+        return 0;
+    if (stopTime != 0)
+        return stopReadCalls - startReadCalls;
+    uint64_t readCalls = 0;
+    uint64_t writeCalls = 0;
+    readSystemCallCounts(readCalls, writeCalls);
+    return readCalls - startReadCalls;
+}
+
+uint64_t
+RunStatistics::getWriteCalls() const
+{
+    if (!systemCallCountsKnown)
+        return 0;
+    if (stopTime != 0)
+        return stopWriteCalls - startWriteCalls;
+    uint64_t readCalls = 0;
+    uint64_t writeCalls = 0;
+    readSystemCallCounts(readCalls, writeCalls);
+    return writeCalls - startWriteCalls;
+}
+
+uint64_t
+RunStatistics::getPeakResidentBytes() const
+{
+    if (stopTime != 0)
+        return stopPeakResidentBytes;
+    return readPeakResidentBytes();
+}
+
+uint64_t
+RunStatistics::getPeakBufferBytes() const
+{
+    return peakBufferBytes;
+}
+
+const LatencyHistogram&
+RunStatistics::getBufferWaitHistogram() const
+{
+    return bufferWaitHistogram;
+}
+
+void
+RunStatistics::addFinishedAction()
+{
+    finishedActions++;
+    notifyProgress();
+}
+
+void
+RunStatistics::addCopiedFile(uint64_t bytes)
+{
+    copiedFiles++;
+    copiedBytes += bytes;
+    notifyProgress();
+}
+
+void
+RunStatistics::addExaminedFile()
+{
+    examinedFiles++;
+}
+
+void
+RunStatistics::addPhaseTime(Phase phase, uint64_t nanoseconds)
+{
+    phaseHistograms[phase].record(nanoseconds);
+}
+
+void
+RunStatistics::addBufferWait(uint64_t nanoseconds)
+{
+    bufferWaitHistogram.record(nanoseconds);
+}
+
+void
+RunStatistics::updatePeakBufferBytes(uint64_t bytes)
+{
+    uint64_t peak = peakBufferBytes;
+    while (bytes > peak && !peakBufferBytes.compare_exchange_weak(peak, bytes))
+        ;
+}
+
+const LatencyHistogram&
+RunStatistics::getPhaseHistogram(Phase phase) const
+{
+    return phaseHistograms[phase];
+}
+
+void
+RunStatistics::addModuleTime(const ModuleTime& moduleTime)
+{
+    std::lock_guard<std::mutex> lock(moduleTimesMutex);
+    moduleTimes.push_back(moduleTime);
+}
+
+std::vector<ModuleTime>
+RunStatistics::getModuleTimes() const
+{
+    std::lock_guard<std::mutex> lock(moduleTimesMutex);
+    return moduleTimes;
+}
+
+void
+RunStatistics::addTargetResult(const std::string& directory, bool succeeded)
+{
+    std::lock_guard<std::mutex> lock(moduleTimesMutex);
+    /* There are only ever a few targets, so searching is cheap. */
+    TargetResult* result = nullptr;
+    for (auto& targetResult : targetResults) {
+        if (targetResult.directory == directory) {
+            result = &targetResult;
+            break;
+        }
+    }
+    if (!result) {
+        targetResults.push_back(TargetResult{directory, 0, 0});
+        result = &targetResults.back();
+    }
+    if (succeeded)
+        result->succeededFiles++;
+    else
+        result->failedFiles++;
+}
+
+std::vector<TargetResult>
+RunStatistics::getTargetResults() const
+{
+    std::lock_guard<std::mutex> lock(moduleTimesMutex);
+    return targetResults;
+}
+
+void
+RunStatistics::setProgressHandler(std::function<void()> handler)
+{
+    progressHandler = handler;
+}
+
+void
+RunStatistics::writeJson(std::ostream& stream) const
+{
+    std::ostream::fmtflags oldFlags = stream.flags();
+    std::streamsize oldPrecision = stream.precision();
+    stream.setf(std::ios::fixed, std::ios::floatfield);
+    stream.precision(6);
+
+    stream << "{\n";
+    stream << "  \"elapsed_seconds\": " << getElapsedSeconds() << ",\n";
+    stream << "  \"total_actions\": " << getTotalActions() << ",\n";
+    stream << "  \"finished_actions\": " << getFinishedActions() << ",\n";
+    stream << "  \"copied_files\": " << getCopiedFiles() << ",\n";
+    stream << "  \"copied_bytes\": " << getCopiedBytes() << ",\n";
+    stream << "  \"examined_files\": " << getExaminedFiles() << ",\n";
+    stream << "  \"files_per_second\": " << getFilesPerSecond() << ",\n";
+    stream << "  \"bytes_per_second\": " << getBytesPerSecond() << ",\n";
+    if (hasSystemCallCounts()) {
+        stream << "  \"system_calls\": {\"read\": " << getReadCalls()
+               << ", \"write\": " << getWriteCalls() << "},\n";
+    } else
+        stream << "  \"system_calls\": null,\n";
+    const LatencyHistogram& waits = getBufferWaitHistogram();
+    stream << "  \"memory\": {\"peak_resident_bytes\": "
+           << getPeakResidentBytes()
+           << ", \"peak_buffer_bytes\": " << getPeakBufferBytes()
+           << ", \"buffer_waits\": " << waits.getCount()
+           << ", \"buffer_wait_seconds\": " << waits.getTotal() / 1e9
+           << ", \"buffer_wait_p99_seconds\": "
+           << waits.getPercentile(99) / 1e9 << "},\n";
+
+    stream << "  \"phases\": {";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        Phase phase = static_cast<Phase>(i);
+        const LatencyHistogram& histogram = getPhaseHistogram(phase);
+        stream << ((i == 0) ? "\n" : ",\n");
+        stream << "    \"" << getPhaseName(phase) << "\": {"
+               << "\"count\": " << histogram.getCount()
+               << ", \"total_seconds\": " << histogram.getTotal() / 1e9
+               << ", \"p50_seconds\": " << histogram.getPercentile(50) / 1e9
+               << ", \"p99_seconds\": " << histogram.getPercentile(99) / 1e9
+               << ", \"max_seconds\": " << histogram.getMaximum() / 1e9
+               << "}";
+    }
+    stream << "\n  },\n";
+
+    stream << "  \"modules\": [";
+    std::vector<ModuleTime> times = getModuleTimes();
+    for (std::vector<ModuleTime>::size_type i = 0; i < times.size(); i++) {
+        stream << ((i == 0) ? "\n" : ",\n");
+        stream << "    {\"name\": \"" << escapeJsonString(times[i].name)
+               << "\", \"seconds\": " << times[i].seconds
+               << ", \"succeeded\": "
+               << ((times[i].succeeded) ? "true" : "false") << "}";
+    }
+    stream << ((times.size() > 0) ? "\n  ],\n" : "],\n");
+
+    stream << "  \"targets\": [";
+    std::vector<TargetResult> targets = getTargetResults();
+    for (std::vector<TargetResult>::size_type i = 0; i < targets.size();
+         i++) {
+        stream << ((i == 0) ? "\n" : ",\n");
+        stream << "    {\"directory\": \""
+               << escapeJsonString(targets[i].directory)
+               << "\", \"succeeded_files\": " << targets[i].succeededFiles
+               << ", \"failed_files\": " << targets[i].failedFiles << "}";
+    }
+    stream << ((targets.size() > 0) ? "\n  ]\n" : "]\n");
+    stream << "}" << std::endl;
+
+    stream.flags(oldFlags);
+    stream.precision(oldPrecision);
+}
+
+const char*
+RunStatistics::getPhaseName(Phase phase)
+{
+    switch (phase) {
+    case PARSE_PHASE:
+        return "parse";
+    case PLAN_PHASE:
+        return "plan";
+    case COPY_PHASE:
+        return "copy";
+    case COMPARE_PHASE:
+        return "compare";
+    case DELETE_PHASE:
+        return "delete";
+    case SHELL_PHASE:
+        return "shell";
+    case PHASE_COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+RunStatistics*
+RunStatistics::getCurrent()
+{
+    RunContext* context = RunContext::getCurrent();
+    return (context) ? context->getStatistics() : nullptr;
+}
+
+void
+RunStatistics::notifyProgress()
+{
+    if (!progressHandler)
+        return;
+    int64_t now = getElapsedMilliseconds();
+    int64_t last = lastProgressTime;
+    if (last != 0 && now - last < PROGRESS_INTERVAL)
+        return;
+    /* Only the thread that wins the exchange calls the handler. */
+    if (!lastProgressTime.compare_exchange_strong(last, (now > 0) ? now : 1))
+        return;
+    progressHandler();
+}
+
+int64_t
+RunStatistics::getElapsedMilliseconds() const
+{
+    int64_t end = stopTime;
+    if (end == 0)
+        end = getClockNanoseconds();
+    return (end - startTime) / 1000000;
+}
+
+int64_t
+RunStatistics::getClockNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool
+RunStatistics::readSystemCallCounts(
+    uint64_t& readCalls, uint64_t& writeCalls)
+{
+    FILE* ioFile = fopen("/proc/self/io", "r");
+    if (!ioFile)
+        return false;
+    bool foundRead = false;
+    bool foundWrite = false;
+    char line[128];
+    while (fgets(line, sizeof(line), ioFile)) {
+        uint64_t value = 0;
+        if (sscanf(line, "syscr: %" SCNu64, &value) == 1) {
+            readCalls = value;
+            foundRead = true;
+        } else if (sscanf(line, "syscw: %" SCNu64, &value) == 1) {
+            writeCalls = value;
+            foundWrite = true;
+        }
+    }
+    fclose(ioFile);
+    return foundRead && foundWrite;
+}
+
+uint64_t
+RunStatistics::readPeakResidentBytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    /* Linux and the BSDs count it in kilobytes. */
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+PhaseTimer::PhaseTimer(RunStatistics::Phase phase)
+    : statistics(RunStatistics::getCurrent()), phase(phase)
+{
+    if (statistics)
+        startTime = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer()
+{
+    if (!statistics)
+        return;
+    statistics->addPhaseTime(phase,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count());
+}
+} /* namespace gdfm */
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RUN_STATISTICS_H
+#define RUN_STATISTICS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "latencyhistogram.h"
+
+namespace gdfm {
+
+/* The progress handler is called at most this often, in milliseconds. */
+const int PROGRESS_INTERVAL = 100;
+
+/* How long one module took to run. */
+struct ModuleTime {
+    std::string name;
+    double seconds;
+    bool succeeded;
+};
+
+/* How the files of a run went for one target directory. */
+struct TargetResult {
+    std::string directory;
+    uint64_t succeededFiles;
+    uint64_t failedFiles;
+};
+
+/*
+ * Counters for a run that is in progress. They are updated from whichever
+ * thread is performing an action and can be read from any other thread at
+ * any time, so a window can show progress while a run happens in the
+ * background.
+ *
+ * Besides the counters, the time spent in each phase of the work is kept in
+ * a histogram so slow files stand out from the average.
+ */
+class RunStatistics {
+public:
+    enum Phase {
+        PARSE_PHASE,
+        PLAN_PHASE,
+        COPY_PHASE,
+        COMPARE_PHASE,
+        DELETE_PHASE,
+        SHELL_PHASE,
+        PHASE_COUNT
+    };
+
+    RunStatistics();
+
+    /* Zeroes every counter and restarts the clock. */
+    void reset();
+    /*
+     * Marks the start of the run itself. The clock and the system call counts
+     * start from here, unless the run was already started.
+     */
+    void start();
+    /* Marks the end of the run, after which the rates stop changing. */
+    void stop();
+
+    uint64_t getTotalActions() const;
+    void setTotalActions(uint64_t totalActions);
+    uint64_t getFinishedActions() const;
+    uint64_t getCopiedFiles() const;
+    uint64_t getCopiedBytes() const;
+    uint64_t getExaminedFiles() const;
+    /*
+     * Returns how long the run has been going, or how long it took if it
+     * stopped, in seconds.
+     */
+    double getElapsedSeconds() const;
+    double getFilesPerSecond() const;
+    double getBytesPerSecond() const;
+    /*
+     * Returns the fraction of the actions that have finished, between 0 and
+     * 1. If the total isn't known, returns 0.
+     */
+    double getFractionFinished() const;
+    /*
+     * Returns true if the system reports how many read and write calls the
+     * process made, which on Linux comes from /proc/self/io.
+     */
+    bool hasSystemCallCounts() const;
+    /* Returns the number of read system calls made during the run. */
+    uint64_t getReadCalls() const;
+    /* Returns the number of write system calls made during the run. */
+    uint64_t getWriteCalls() const;
+    /*
+     * Returns the most memory the process has had resident, as of the end
+     * of the run or now if it hasn't ended, or zero if it isn't known.
+     */
+    uint64_t getPeakResidentBytes() const;
+    /* Returns the most bytes of copy and compare buffers lent out at once. */
+    uint64_t getPeakBufferBytes() const;
+    /* The times spent waiting for buffers to fit in the memory budget. */
+    const LatencyHistogram& getBufferWaitHistogram() const;
+
+    void addFinishedAction();
+    /* Counts one regular file of the given size as copied. */
+    void addCopiedFile(uint64_t bytes);
+    /* Counts one file or directory as looked at to see if it changed. */
+    void addExaminedFile();
+    void addPhaseTime(Phase phase, uint64_t nanoseconds);
+    void addBufferWait(uint64_t nanoseconds);
+    /* Raises the peak of buffer bytes lent out to bytes if it's higher. */
+    void updatePeakBufferBytes(uint64_t bytes);
+    const LatencyHistogram& getPhaseHistogram(Phase phase) const;
+    void addModuleTime(const ModuleTime& moduleTime);
+    std::vector<ModuleTime> getModuleTimes() const;
+    /* Counts one file as done, or not, for a target directory. */
+    void addTargetResult(const std::string& directory, bool succeeded);
+    /* Returns the results for each target directory, in order of use. */
+    std::vector<TargetResult> getTargetResults() const;
+
+    /*
+     * Sets a function called whenever the counters change, but no more than
+     * once every PROGRESS_INTERVAL milliseconds. It is called on the thread
+     * that changed them, so it should only hand the work off to another
+     * thread.
+     */
+    void setProgressHandler(std::function<void()> handler);
+
+    /*
+     * Writes everything as a single JSON object, with times in seconds, so
+     * that runs can be compared by other programs.
+     */
+    void writeJson(std::ostream& stream) const;
+
+    /* Returns "parse", "plan", "copy", "compare", "delete", or "shell". */
+    static const char* getPhaseName(Phase phase);
+    /* Returns the statistics for the current run, or nullptr if none. */
+    static RunStatistics* getCurrent();
+
+private:
+    std::atomic<uint64_t> totalActions;
+    std::atomic<uint64_t> finishedActions;
+    std::atomic<uint64_t> copiedFiles;
+    std::atomic<uint64_t> copiedBytes;
+    std::atomic<uint64_t> examinedFiles;
+    LatencyHistogram phaseHistograms[PHASE_COUNT];
+    LatencyHistogram bufferWaitHistogram;
+    std::atomic<uint64_t> peakBufferBytes;
+    /* Read when the run stops, zero until then. */
+    uint64_t stopPeakResidentBytes = 0;
+    /*
+     * Times on the steady clock in nanoseconds, kept as atomics so another
+     * thread can work out the rates while the run starts or stops. The stop
+     * time is zero until the run stops.
+     */
+    std::atomic<int64_t> startTime;
+    std::atomic<int64_t> stopTime;
+    bool started = false;
+    bool systemCallCountsKnown = false;
+    uint64_t startReadCalls = 0;
+    uint64_t startWriteCalls = 0;
+    uint64_t stopReadCalls = 0;
+    uint64_t stopWriteCalls = 0;
+    std::atomic<int64_t> lastProgressTime;
+    std::function<void()> progressHandler;
+    std::vector<ModuleTime> moduleTimes;
+    std::vector<TargetResult> targetResults;
+    /* Guards targetResults too. */
+    mutable std::mutex moduleTimesMutex;
+
+    void notifyProgress();
+    /*
+     * Returns the time from the start until the stop, or until now if the
+     * run hasn't stopped, in milliseconds.
+     */
+    int64_t getElapsedMilliseconds() const;
+    static int64_t getClockNanoseconds();
+    /*
+     * Reads how many read and write system calls the process has made so
+     * far.
+     *
+     * Returns true if the counts could be read.
+     */
+    static bool readSystemCallCounts(
+        uint64_t& readCalls, uint64_t& writeCalls);
+    /* Returns the peak resident memory of the process so far. */
+    static uint64_t readPeakResidentBytes();
+};
+
+/*
+ * Measures how long it exists for and adds that to a phase of the current
+ * run. If there is no current run, it doesn't even read the clock.
+ */
+class PhaseTimer {
+public:
+    PhaseTimer(RunStatistics::Phase phase);
+    ~PhaseTimer();
+
+private:
+    RunStatistics* statistics;
+    RunStatistics::Phase phase;
+    std::chrono::steady_clock::time_point startTime;
+};
+} /* namespace gdfm */
+
+#endif /* RUN_STATISTICS_H */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "runsummarydialog.h"
+
+#include <stdio.h>
+
+#include <sstream>
+
+#include "util.h"
+
+namespace gdfm {
+
+RunSummaryDialog::RunSummaryDialog(
+    Gtk::Window& parent, const RunStatistics& statistics)
+    : Gtk::Dialog("Run Summary", parent, true)
+{
+    set_default_size(500, 400);
+
+    totalsLabel = Gtk::manage(new Gtk::Label());
+    totalsLabel->set_line_wrap(true);
+    totalsLabel->set_xalign(0);
+    get_content_area()->pack_start(*totalsLabel, false, false);
+    phasesWindow = Gtk::manage(new Gtk::ScrolledWindow());
+    get_content_area()->pack_start(*phasesWindow, true, true);
+    phasesView = Gtk::manage(new Gtk::TreeView());
+    phasesWindow->add(*phasesView);
+    modulesWindow = Gtk::manage(new Gtk::ScrolledWindow());
+    get_content_area()->pack_start(*modulesWindow, true, true);
+    modulesView = Gtk::manage(new Gtk::TreeView());
+    modulesWindow->add(*modulesView);
+
+    add_button("Close", Gtk::RESPONSE_CLOSE);
+    show_all_children();
+
+    std::ostringstream totals;
+    totals.precision(2);
+    totals << std::fixed << statistics.getFinishedActions() << " of "
+           << statistics.getTotalActions() << " actions in "
+           << formatDuration(statistics.getElapsedSeconds()) << ". "
+           << statistics.getCopiedFiles() << " files copied ("
+           << formatByteCount(statistics.getCopiedBytes()) << ", "
+           << formatByteCount(statistics.getBytesPerSecond()) << "/s), "
+           << statistics.getExaminedFiles() << " files examined.";
+    if (statistics.hasSystemCallCounts()) {
+        totals << " " << statistics.getReadCalls() << " read and "
+               << statistics.getWriteCalls() << " write system calls.";
+    }
+    totalsLabel->set_text(totals.str());
+
+    phasesRecord.add(phaseNameColumn);
+    phasesRecord.add(phaseCountColumn);
+    phasesRecord.add(phaseTotalColumn);
+    phasesRecord.add(phaseMedianColumn);
+    phasesRecord.add(phaseTailColumn);
+    phasesRecord.add(phaseMaximumColumn);
+    phasesList = Gtk::ListStore::create(phasesRecord);
+    phasesView->set_model(phasesList);
+    phasesView->append_column("Phase", phaseNameColumn);
+    phasesView->append_column("Count", phaseCountColumn);
+    phasesView->append_column("Total", phaseTotalColumn);
+    phasesView->append_column("p50", phaseMedianColumn);
+    phasesView->append_column("p99", phaseTailColumn);
+    phasesView->append_column("Max", phaseMaximumColumn);
+    fillPhases(statistics);
+
+    modulesRecord.add(moduleNameColumn);
+    modulesRecord.add(moduleTimeColumn);
+    modulesRecord.add(moduleResultColumn);
+    modulesList = Gtk::ListStore::create(modulesRecord);
+    modulesView->set_model(modulesList);
+    modulesView->append_column("Module", moduleNameColumn);
+    modulesView->append_column("Time", moduleTimeColumn);
+    modulesView->append_column("Result", moduleResultColumn);
+    fillModules(statistics);
+}
+
+RunSummaryDialog::~RunSummaryDialog()
+{
+}
+
+void
+RunSummaryDialog::fillPhases(const RunStatistics& statistics)
+{
+    for (int i = 0; i < RunStatistics::PHASE_COUNT; i++) {
+        RunStatistics::Phase phase = static_cast<RunStatistics::Phase>(i);
+        const LatencyHistogram& histogram =
+            statistics.getPhaseHistogram(phase);
+        if (histogram.getCount() == 0)
+            continue;
+        Gtk::TreeRow row = *phasesList->append();
+        row[phaseNameColumn] = RunStatistics::getPhaseName(phase);
+        row[phaseCountColumn] = histogram.getCount();
+        row[phaseTotalColumn] = formatDuration(histogram.getTotal() / 1e9);
+        row[phaseMedianColumn] =
+            formatDuration(histogram.getPercentile(50) / 1e9);
+        row[phaseTailColumn] =
+            formatDuration(histogram.getPercentile(99) / 1e9);
+        row[phaseMaximumColumn] = formatDuration(histogram.getMaximum() / 1e9);
+    }
+}
+
+void
+RunSummaryDialog::fillModules(const RunStatistics& statistics)
+{
+    for (const auto& moduleTime : statistics.getModuleTimes()) {
+        Gtk::TreeRow row = *modulesList->append();
+        row[moduleNameColumn] = moduleTime.name;
+        row[moduleTimeColumn] = formatDuration(moduleTime.seconds);
+        row[moduleResultColumn] =
+            (moduleTime.succeeded) ? "Succeeded" : "Failed";
+    }
+}
+
+std::string
+RunSummaryDialog::formatDuration(double seconds)
+{
+    char buffer[32];
+    if (seconds < 1)
+        snprintf(buffer, sizeof(buffer), "%.3f ms", seconds * 1000);
+    else
+        snprintf(buffer, sizeof(buffer), "%.2f s", seconds);
+    return buffer;
+}
+} /* namespace gdfm */
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RUN_SUMMARY_DIALOG_H
+#define RUN_SUMMARY_DIALOG_H
+
+#include <gtkmm.h>
+
+#include "runstatistics.h"
+
+namespace gdfm {
+
+/*
+ * Shows the statistics from a finished run: the totals, how long each phase
+ * took along with its median and 99th percentile, and how long each module
+ * took.
+ */
+class RunSummaryDialog : public Gtk::Dialog {
+public:
+    RunSummaryDialog(Gtk::Window& parent, const RunStatistics& statistics);
+    virtual ~RunSummaryDialog();
+
+private:
+    Gtk::Label* totalsLabel;
+    Gtk::ScrolledWindow* phasesWindow;
+    Gtk::TreeView* phasesView;
+    Gtk::ScrolledWindow* modulesWindow;
+    Gtk::TreeView* modulesView;
+
+    Gtk::TreeModelColumnRecord phasesRecord;
+    Gtk::TreeModelColumn<Glib::ustring> phaseNameColumn;
+    Gtk::TreeModelColumn<unsigned long> phaseCountColumn;
+    Gtk::TreeModelColumn<Glib::ustring> phaseTotalColumn;
+    Gtk::TreeModelColumn<Glib::ustring> phaseMedianColumn;
+    Gtk::TreeModelColumn<Glib::ustring> phaseTailColumn;
+    Gtk::TreeModelColumn<Glib::ustring> phaseMaximumColumn;
+    Glib::RefPtr<Gtk::ListStore> phasesList;
+
+    Gtk::TreeModelColumnRecord modulesRecord;
+    Gtk::TreeModelColumn<Glib::ustring> moduleNameColumn;
+    Gtk::TreeModelColumn<Glib::ustring> moduleTimeColumn;
+    Gtk::TreeModelColumn<Glib::ustring> moduleResultColumn;
+    Glib::RefPtr<Gtk::ListStore> modulesList;
+
+    void fillPhases(const RunStatistics& statistics);
+    void fillModules(const RunStatistics& statistics);
+
+    /* Returns the duration in milliseconds or seconds, whichever fits. */
+    static std::string formatDuration(double seconds);
+};
+} /* namespace gdfm */
+
+#endif /* RUN_SUMMARY_DIALOG_H */
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "sha256.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace gdfm {
+
+namespace {
+
+const uint32_t ROUND_CONSTANTS[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf,
+    0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98,
+    0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+    0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8,
+    0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e,
+    0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+    0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c,
+    0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee,
+    0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2 };
+
+/* How much of a file is hashed at a time. */
+const size_t HASH_READ_SIZE = 64 * 1024;
+
+inline uint32_t
+rotateRight(uint32_t value, int count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+} /* namespace */
+
+Sha256::Sha256()
+    : state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+          0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+{
+}
+
+void
+Sha256::update(const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    length += size;
+    if (blockUsed > 0) {
+        size_t count = BLOCK_SIZE - blockUsed;
+        if (count > size)
+            count = size;
+        memcpy(block + blockUsed, bytes, count);
+        blockUsed += count;
+        bytes += count;
+        size -= count;
+        if (blockUsed < BLOCK_SIZE)
+            return;
+        processBlock(block);
+        blockUsed = 0;
+    }
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE, bytes += BLOCK_SIZE)
+        processBlock(bytes);
+    memcpy(block, bytes, size);
+    blockUsed = size;
+}
+
+std::string
+Sha256::finish()
+{
+    uint64_t bitLength = length * 8;
+    unsigned char padding[BLOCK_SIZE + 8] = { 0x80 };
+    size_t paddingSize = (blockUsed < 56) ? 56 - blockUsed : 120 - blockUsed;
+    update(padding, paddingSize);
+    unsigned char lengthBytes[8];
+    for (int i = 0; i < 8; i++)
+        lengthBytes[i] = bitLength >> (56 - 8 * i);
+    update(lengthBytes, sizeof(lengthBytes));
+
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string digest;
+    for (uint32_t word : state) {
+        for (int shift = 28; shift >= 0; shift -= 4)
+            digest += HEX_DIGITS[(word >> shift) & 0xf];
+    }
+    return digest;
+}
+
+bool
+Sha256::hashFile(const std::string& path, std::string& digest)
+{
+    int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1)
+        return false;
+    Sha256 hash;
+    std::string buffer(HASH_READ_SIZE, '\0');
+    ssize_t count;
+    while ((count = read(descriptor, &buffer[0], buffer.size())) != 0) {
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            close(descriptor);
+            return false;
+        }
+        hash.update(buffer.data(), count);
+    }
+    close(descriptor);
+    digest = hash.finish();
+    return true;
+}
+
+void
+Sha256::processBlock(const unsigned char* data)
+{
+    uint32_t words[64];
+    for (int i = 0; i < 16; i++) {
+        words[i] = (uint32_t(data[4 * i]) << 24)
+            | (uint32_t(data[4 * i + 1]) << 16)
+            | (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotateRight(words[i - 15], 7)
+            ^ rotateRight(words[i - 15], 18) ^ (words[i - 15] >> 3);
+        uint32_t s1 = rotateRight(words[i - 2], 17)
+            ^ rotateRight(words[i - 2], 19) ^ (words[i - 2] >> 10);
+        words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 =
+            rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t first = h + s1 + choice + ROUND_CONSTANTS[i] + words[i];
+        uint32_t s0 =
+            rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t second = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + first;
+        d = c;
+        c = b;
+        b = a;
+        a = first + second;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+} /* namespace gdfm */
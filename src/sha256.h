@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace gdfm {
+
+/*
+ * Computes SHA-256 digests, as in FIPS 180-4, for naming file contents. Feed
+ * it with update() as often as needed, then call finish() once.
+ */
+class Sha256 {
+public:
+    static const size_t BLOCK_SIZE = 64;
+    static const size_t DIGEST_SIZE = 32;
+
+    Sha256();
+
+    void update(const void* data, size_t size);
+    /* Returns the digest as lowercase hexadecimal. */
+    std::string finish();
+
+    /*
+     * Computes the digest of the file at path.
+     *
+     * Returns true on success, false if the file couldn't be read.
+     */
+    static bool hashFile(const std::string& path, std::string& digest);
+
+private:
+    uint32_t state[8];
+    uint64_t length = 0;
+    unsigned char block[BLOCK_SIZE];
+    size_t blockUsed = 0;
+
+    void processBlock(const unsigned char* data);
+};
+} /* namespace gdfm */
+
+#endif /* SHA256_H */
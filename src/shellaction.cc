@@ -27,7 +27,11 @@
 
 #include <iostream>
 
-#include "shelleditor.h"
+#include "outputsink.h"
+#include "processlauncher.h"
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
 
 namespace gdfm {
 
@@ -58,21 +62,46 @@ ShellAction::performAction()
 {
     if (shellCommands.size() < 1)
         return true;
-    if (isVerbose() && shellCommands.size() > 0) {
-        std::cout << "Executing with shell:";
+    RunContext* context = RunContext::getCurrent();
+    std::string source = (context) ? context->getModuleName() : "";
+    ActionOutput output(RunContext::getCurrentOutputSink(), source);
+    if (isVerbose()) {
         if (shellCommands.size() == 1)
-            std::cout << " \"" << shellCommands[0] << "\"" << std::endl;
+            output.writeLine(
+                "Executing with shell: \"" + shellCommands[0] + "\"");
         else {
-            std::cout << std::endl;
+            output.writeLine("Executing with shell:");
             for (const auto& commandName : shellCommands)
-                std::cout << "\t" << commandName << std::endl;
+                output.writeLine("\t" + commandName);
         }
     }
     std::string command = shellCommands[0];
     for (std::vector<std::string>::size_type i = 1; i < shellCommands.size();
          i++)
         command += "; " + shellCommands[i];
-    return system(command.c_str()) == 0;
+
+    ProcessLauncher launcher = ProcessLauncher::forShellCommand(command);
+    launcher.setTimeout(timeout);
+    launcher.setOutputHandler([&output](const char* data, size_t length) {
+        output.write(data, length);
+    });
+    bool started = false;
+    {
+        PhaseTimer timer(RunStatistics::SHELL_PHASE);
+        TraceSpan span("shell", "ProcessLauncher::run", command);
+        started = launcher.run();
+    }
+    output.flush();
+    bool status = started;
+    if (status && launcher.hasTimedOut()) {
+        warnx("Shell command timed out after %d seconds.", timeout);
+        status = false;
+    }
+    status = status && launcher.succeeded();
+    /* The run shows what the command printed last along with the failure. */
+    if (!status && context)
+        context->setFailureOutput(output.getTail());
+    return status;
 }
 
 void
@@ -81,17 +110,28 @@ ShellAction::addCommand(const std::string& command)
     shellCommands.push_back(command);
 }
 
+int
+ShellAction::getTimeout() const
+{
+    return timeout;
+}
+
+void
+ShellAction::setTimeout(int timeout)
+{
+    this->timeout = timeout;
+}
+
 void
 ShellAction::updateName()
 {
     setName("shell command");
 }
 
-void
-ShellAction::graphicalEdit(Gtk::Window& parent)
+std::shared_ptr<ModuleAction>
+ShellAction::clone() const
 {
-    ShellEditor editor(parent, this);
-    editor.run();
+    return std::shared_ptr<ModuleAction>(new ShellAction(*this));
 }
 
 std::vector<std::string>
@@ -42,13 +42,20 @@ public:
 
     bool performAction() override;
     void addCommand(const std::string& command);
+    /*
+     * The number of seconds the commands are allowed to run before they are
+     * killed. Zero, the default, means no timeout.
+     */
+    int getTimeout() const;
+    void setTimeout(int timeout);
 
     void updateName() override;
-    void graphicalEdit(Gtk::Window& parent) override;
     std::vector<std::string> createConfigLines() const override;
+    std::shared_ptr<ModuleAction> clone() const override;
 
 private:
     std::vector<std::string> shellCommands;
+    int timeout = 0;
 };
 } /* namespace gdfm */
 
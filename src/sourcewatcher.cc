@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "sourcewatcher.h"
+
+#include <map>
+
+namespace gdfm {
+
+SourceWatcher::SourceWatcher()
+    : watcher(pool, FileWatcher::SOURCE_PATHS), pool(1)
+{
+}
+
+SourceWatcher::~SourceWatcher()
+{
+    stop();
+}
+
+void
+SourceWatcher::setReadyCallback(std::function<void()> callback)
+{
+    watcher.setReadyCallback(callback);
+}
+
+void
+SourceWatcher::setModules(std::shared_ptr<ModuleList> moduleList,
+    const std::string& sourceDirectory)
+{
+    if (moduleList != this->moduleList) {
+        if (this->moduleList)
+            this->moduleList->removeObserver(this);
+        moduleList->addObserver(this);
+        this->moduleList = moduleList;
+    }
+    this->sourceDirectory = sourceDirectory;
+    onModulesReset(ids.size());
+}
+
+bool
+SourceWatcher::finishSetup()
+{
+    return watcher.finishSetup();
+}
+
+void
+SourceWatcher::stop()
+{
+    if (moduleList)
+        moduleList->removeObserver(this);
+    moduleList.reset();
+    ids.clear();
+    /* Don't wait for the watches to be set up just to throw them away. */
+    watcher.stop();
+}
+
+bool
+SourceWatcher::isWatching() const
+{
+    return moduleList != nullptr;
+}
+
+int
+SourceWatcher::getFileDescriptor() const
+{
+    return watcher.getFileDescriptor();
+}
+
+bool
+SourceWatcher::readEvents()
+{
+    return watcher.readEvents();
+}
+
+bool
+SourceWatcher::hasChanges() const
+{
+    return watcher.hasChanges();
+}
+
+std::vector<Module>
+SourceWatcher::takeChangedModules()
+{
+    /* Keep the modules in order, each with its files in order. */
+    std::map<size_t, std::map<size_t, ModuleFile>> changedFiles;
+    for (const auto& changed : watcher.takeChangedFiles()) {
+        size_t index;
+        if (!moduleList || !moduleList->findModule(changed.module, index))
+            continue;
+        const std::vector<ModuleFile>& files =
+            moduleList->getModule(index).getFiles();
+        if (changed.file < files.size())
+            changedFiles[index].emplace(changed.file, files[changed.file]);
+    }
+    std::vector<Module> result;
+    for (const auto& changed : changedFiles) {
+        Module module(moduleList->getModule(changed.first).getName());
+        for (const auto& file : changed.second)
+            module.getFiles().push_back(file.second);
+        result.push_back(module);
+    }
+    return result;
+}
+
+void
+SourceWatcher::onModulesReset(size_t oldCount)
+{
+    ids.clear();
+    for (size_t i = 0; i < moduleList->getModuleCount(); i++)
+        ids.push_back(moduleList->getModuleId(i));
+    watcher.watchModules(moduleList->getModules(), ids, sourceDirectory);
+}
+
+void
+SourceWatcher::onModuleInserted(size_t module)
+{
+    ModuleId id = moduleList->getModuleId(module);
+    ids.insert(ids.begin() + module, id);
+    watcher.watchModule(id, moduleList->getModule(module));
+}
+
+void
+SourceWatcher::onModuleRemoved(size_t module)
+{
+    watcher.unwatchModule(ids[module]);
+    ids.erase(ids.begin() + module);
+}
+
+void
+SourceWatcher::onFileInserted(size_t module, size_t file)
+{
+    watcher.watchModule(ids[module], moduleList->getModule(module));
+}
+
+void
+SourceWatcher::onFileRemoved(size_t module, size_t file)
+{
+    watcher.watchModule(ids[module], moduleList->getModule(module));
+}
+
+void
+SourceWatcher::onModuleReplaced(size_t module, const Module& previous)
+{
+    const Module& current = moduleList->getModule(module);
+    if (!Module::isSameFiles(previous.getFiles(), current.getFiles()))
+        watcher.watchModule(ids[module], current);
+}
+} /* namespace gdfm */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SOURCE_WATCHER_H
+#define SOURCE_WATCHER_H
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "module.h"
+#include "modulelist.h"
+#include "modulewatcher.h"
+#include "threadpool.h"
+
+namespace gdfm {
+
+/*
+ * Watches the sources of the modules in a ModuleList for watch mode, so the
+ * files whose sources change can be updated.
+ *
+ * Watching every module, after setModules() or when the list is replaced,
+ * is done on a thread of its own, and the watches from before keep working
+ * until finishSetup(). Other changes to the list only touch the watches of
+ * the modules that changed. Either way, changes that weren't taken yet are
+ * kept.
+ *
+ * Everything but the callback is used from one thread.
+ */
+class SourceWatcher : public ModuleListObserver {
+public:
+    SourceWatcher();
+    ~SourceWatcher();
+    SourceWatcher(const SourceWatcher&) = delete;
+    SourceWatcher& operator=(const SourceWatcher&) = delete;
+
+    /*
+     * Called on another thread when the watches are ready for
+     * finishSetup().
+     */
+    void setReadyCallback(std::function<void()> callback);
+    /*
+     * Starts watching the sources of the modules in moduleList from
+     * sourceDirectory and following its changes. Every source is watched
+     * again on the other thread.
+     */
+    void setModules(std::shared_ptr<ModuleList> moduleList,
+        const std::string& sourceDirectory);
+    /*
+     * Starts using the watches from setModules() once they are ready.
+     *
+     * Returns true if it did, which changes the descriptor, false otherwise.
+     */
+    bool finishSetup();
+    /* Stops watching and following the list. */
+    void stop();
+    /* Returns true between setModules() and stop(). */
+    bool isWatching() const;
+    /*
+     * Returns a descriptor that is readable when there are events, or -1 if
+     * the sources couldn't be watched.
+     */
+    int getFileDescriptor() const;
+    /*
+     * Reads the events that are waiting without blocking.
+     *
+     * Returns true on success, false if reading failed.
+     */
+    bool readEvents();
+    bool hasChanges() const;
+    /*
+     * Returns each module with sources that changed, in the order of the
+     * list, with only the files that changed. The changes are forgotten.
+     */
+    std::vector<Module> takeChangedModules();
+
+    void onModulesReset(size_t oldCount) override;
+    void onModuleInserted(size_t module) override;
+    void onModuleRemoved(size_t module) override;
+    void onFileInserted(size_t module, size_t file) override;
+    void onFileRemoved(size_t module, size_t file) override;
+    void onModuleReplaced(size_t module, const Module& previous) override;
+
+private:
+    std::shared_ptr<ModuleList> moduleList;
+    std::string sourceDirectory;
+    /* The identifier of each module, parallel to the list. */
+    std::vector<ModuleId> ids;
+    /* Uses the pool, which is destroyed first, so it stops first. */
+    ModuleWatcher watcher;
+    ThreadPool pool;
+};
+} /* namespace gdfm */
+
+#endif /* SOURCE_WATCHER_H */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "threadpool.h"
+
+namespace gdfm {
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount < 1)
+        threadCount = 1;
+    for (unsigned int i = 0; i < threadCount; i++)
+        threads.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void
+ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+    taskAvailable.notify_one();
+}
+
+void
+ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasksFinished.wait(
+        lock, [this]() { return tasks.empty() && runningTasks == 0; });
+}
+
+unsigned int
+ThreadPool::getThreadCount() const
+{
+    return threads.size();
+}
+
+unsigned int
+ThreadPool::getDefaultThreadCount()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return (count > 0) ? count : 1;
+}
+
+void
+ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        taskAvailable.wait(
+            lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+            return;
+        std::function<void()> task = tasks.front();
+        tasks.pop_front();
+        runningTasks++;
+        lock.unlock();
+        task();
+        lock.lock();
+        runningTasks--;
+        if (tasks.empty() && runningTasks == 0)
+            tasksFinished.notify_all();
+    }
+}
+} /* namespace gdfm */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gdfm {
+
+/*
+ * A fixed number of worker threads that run tasks in the order they were
+ * submitted. The number of threads bounds how much work runs at once, no
+ * matter how many tasks are queued.
+ */
+class ThreadPool {
+public:
+    ThreadPool(unsigned int threadCount);
+    /* Finishes every task that was already submitted, then stops. */
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    /* Blocks until every submitted task has finished running. */
+    void wait();
+    unsigned int getThreadCount() const;
+
+    /*
+     * Returns the number of threads the hardware can run at once, or one if
+     * that can't be determined.
+     */
+    static unsigned int getDefaultThreadCount();
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable tasksFinished;
+    unsigned int runningTasks = 0;
+    bool stopping = false;
+
+    void workerLoop();
+};
+} /* namespace gdfm */
+
+#endif /* THREAD_POOL_H */
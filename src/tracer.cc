@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "tracer.h"
+
+#include <sys/syscall.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "util.h"
+
+namespace gdfm {
+
+namespace {
+struct TraceEvent {
+    const char* category;
+    const char* name;
+    std::string detail;
+    uint64_t startTime;
+    uint64_t duration;
+};
+
+/*
+ * The spans recorded by one thread. The mutex is only ever contended while
+ * the trace is being written out.
+ */
+struct ThreadBuffer {
+    long threadId;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+};
+
+std::mutex buffersMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer&
+getThreadBuffer()
+{
+    if (!threadBuffer) {
+        threadBuffer = std::make_shared<ThreadBuffer>();
+        threadBuffer->threadId = syscall(SYS_gettid);
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(threadBuffer);
+    }
+    return *threadBuffer;
+}
+} /* namespace */
+
+std::atomic<bool> Tracer::enabled(false);
+
+void
+Tracer::enable()
+{
+    enabled = true;
+}
+
+void
+Tracer::disable()
+{
+    enabled = false;
+}
+
+void
+Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
+
+uint64_t
+Tracer::getTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void
+Tracer::addSpan(const char* category, const char* name,
+    const std::string& detail, uint64_t startTime, uint64_t duration)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back(
+        TraceEvent{category, name, detail, startTime, duration});
+}
+
+void
+Tracer::writeTrace(std::ostream& stream)
+{
+    long processId = getpid();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    stream << "{\"traceEvents\": [";
+    bool first = true;
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        if (buffer->events.empty())
+            continue;
+        stream << ((first) ? "\n" : ",\n");
+        first = false;
+        const char* threadName =
+            (buffer->threadId == processId) ? "main" : "worker";
+        stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": "
+               << processId << ", \"tid\": " << buffer->threadId
+               << ", \"args\": {\"name\": \"" << threadName << "\"}}";
+        for (const auto& event : buffer->events) {
+            stream << ",\n{\"name\": \"" << escapeJsonString(event.name)
+                   << "\", \"cat\": \"" << event.category
+                   << "\", \"ph\": \"X\", \"ts\": " << event.startTime
+                   << ", \"dur\": " << event.duration
+                   << ", \"pid\": " << processId
+                   << ", \"tid\": " << buffer->threadId;
+            if (event.detail.length() > 0) {
+                stream << ", \"args\": {\"detail\": \""
+                       << escapeJsonString(event.detail) << "\"}";
+            }
+            stream << "}";
+        }
+    }
+    stream << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+bool
+Tracer::writeTrace(const std::string& path)
+{
+    std::ofstream writer(path);
+    if (!writer.is_open())
+        return false;
+    writeTrace(writer);
+    writer.close();
+    return !writer.fail();
+}
+
+TraceSpan::TraceSpan(const char* category, const char* name)
+    : active(Tracer::isEnabled()), category(category), name(name)
+{
+    if (active)
+        startTime = Tracer::getTimestamp();
+}
+
+TraceSpan::TraceSpan(
+    const char* category, const char* name, const std::string& detail)
+    : active(Tracer::isEnabled()), category(category), name(name)
+{
+    if (active) {
+        this->detail = detail;
+        startTime = Tracer::getTimestamp();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    finish();
+}
+
+void
+TraceSpan::finish()
+{
+    if (!active)
+        return;
+    active = false;
+    Tracer::addSpan(category, name, detail, startTime,
+        Tracer::getTimestamp() - startTime);
+}
+
+void
+TraceSpan::restart(const char* name)
+{
+    bool wasActive = active;
+    finish();
+    this->name = name;
+    detail.clear();
+    active = wasActive && Tracer::isEnabled();
+    if (active)
+        startTime = Tracer::getTimestamp();
+}
+} /* namespace gdfm */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2017 Jason Waataja
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+namespace gdfm {
+
+/*
+ * If this environment variable is set when the window starts, a trace is
+ * recorded and written to the file it names when the window closes.
+ */
+const char TRACE_ENVIRONMENT_VARIABLE[] = "GDFM_TRACE";
+
+/*
+ * Records timed spans and writes them in the Chrome trace event format, so a
+ * run can be loaded as a timeline in chrome://tracing or Perfetto. Each
+ * thread records into its own buffer, and a span costs a single relaxed load
+ * when tracing is off.
+ */
+class Tracer {
+public:
+    /* Starts recording spans. Spans that are already open are skipped. */
+    static void enable();
+    static void disable();
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    /* Throws away every span recorded so far. */
+    static void clear();
+
+    /* Returns the time used for spans, in microseconds. */
+    static uint64_t getTimestamp();
+    /*
+     * Adds a finished span on the calling thread. The category and name must
+     * be string literals, or at least live as long as the tracer does.
+     */
+    static void addSpan(const char* category, const char* name,
+        const std::string& detail, uint64_t startTime, uint64_t duration);
+
+    /*
+     * Writes every span recorded so far as a JSON object with a
+     * "traceEvents" array.
+     */
+    static void writeTrace(std::ostream& stream);
+    /*
+     * Same as above, but to the file at path.
+     *
+     * Returns true if the file was written, false otherwise.
+     */
+    static bool writeTrace(const std::string& path);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/*
+ * A span that starts when it is created and ends when it is destroyed or
+ * finished. The detail, such as a module name or a path, is shown as an
+ * argument of the span. Nothing is copied unless tracing is on.
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name);
+    TraceSpan(
+        const char* category, const char* name, const std::string& detail);
+    ~TraceSpan();
+
+    /* Ends the span early. Does nothing if it already ended. */
+    void finish();
+    /* Ends the span and starts a new one with the same category. */
+    void restart(const char* name);
+
+private:
+    bool active;
+    const char* category;
+    const char* name;
+    std::string detail;
+    uint64_t startTime = 0;
+};
+} /* namespace gdfm */
+
+#endif /* TRACER_H */
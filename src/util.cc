@@ -23,11 +23,21 @@
 #include "util.h"
 #include "config.h"
 
+#include <sys/ioctl.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_XATTR_H
+#include <sys/xattr.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
 
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <pwd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -36,10 +46,252 @@
 #include <wordexp.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 
+#include "batchio.h"
+#include "bufferpool.h"
+#include "runcontext.h"
+#include "runstatistics.h"
+#include "tracer.h"
+
 namespace gdfm {
 
+namespace {
+/*
+ * Copies the file open as source, which sourceInfo describes, to
+ * destinationPath, along with the given attributes.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+copyOpenFile(int source, const struct stat& sourceInfo,
+    const std::string& destinationPath, int attributes)
+{
+    if (!ensureParentDirectoriesExist(destinationPath))
+        return false;
+    int destination = open(destinationPath.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (destination == -1)
+        return false;
+    bool status =
+        copyDescriptorContents(source, destination, sourceInfo.st_size)
+        && copyFileAttributes(source, sourceInfo, destination, attributes);
+    if (close(destination) != 0)
+        status = false;
+    RunStatistics* statistics = RunStatistics::getCurrent();
+    if (status && statistics)
+        statistics->addCopiedFile(sourceInfo.st_size);
+    return status;
+}
+
+/*
+ * Gives the file at destinationPath the attributes of the one at sourcePath.
+ * Works on directories too.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+copyPathAttributes(const std::string& sourcePath,
+    const std::string& destinationPath, int attributes)
+{
+    int source = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+        return false;
+    int destination = open(destinationPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (destination == -1) {
+        close(source);
+        return false;
+    }
+    struct stat sourceInfo;
+    bool status = fstat(source, &sourceInfo) == 0
+        && copyFileAttributes(source, sourceInfo, destination, attributes);
+    close(source);
+    close(destination);
+    return status;
+}
+
+#ifdef HAVE_SYS_XATTR_H
+/*
+ * Copies every extended attribute of the file open as source to the one open
+ * as destination. File systems without them count as having none.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+copyExtendedAttributes(int source, int destination)
+{
+    ssize_t namesSize = flistxattr(source, nullptr, 0);
+    if (namesSize == -1)
+        return errno == ENOTSUP;
+    std::string names(namesSize, '\0');
+    namesSize = flistxattr(source, &names[0], names.size());
+    if (namesSize == -1)
+        return false;
+    names.resize(namesSize);
+    std::string value;
+    for (std::string::size_type begin = 0; begin < names.size();) {
+        std::string::size_type end = names.find('\0', begin);
+        if (end == std::string::npos)
+            end = names.size();
+        std::string name = names.substr(begin, end - begin);
+        begin = end + 1;
+        ssize_t valueSize = fgetxattr(source, name.c_str(), nullptr, 0);
+        if (valueSize == -1)
+            return false;
+        value.resize(valueSize);
+        valueSize = fgetxattr(source, name.c_str(), &value[0], value.size());
+        if (valueSize == -1
+            || fsetxattr(destination, name.c_str(), value.data(), valueSize, 0)
+                != 0)
+            return false;
+    }
+    return true;
+}
+#endif
+
+/*
+ * Copies the bytes from offset up to end in the file open as source to the
+ * same place in the one open as destination, going through a buffer of
+ * bufferSize bytes where the file system can't copy them itself. Leaves
+ * offset where the copy stopped, which is short of end if the source got
+ * shorter.
+ *
+ * Returns true on success, false on failure.
+ */
+bool
+copyDescriptorRange(int source, int destination, off_t& offset, off_t end,
+    size_t bufferSize)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    while (offset < end) {
+        off_t destinationOffset = offset;
+        ssize_t count = copy_file_range(
+            source, &offset, destination, &destinationOffset, end - offset, 0);
+        if (count == -1 && errno == EINTR)
+            continue;
+        /* Some file systems can't, so copy the rest by hand. */
+        if (count == -1
+            && (errno == EXDEV || errno == EINVAL || errno == ENOSYS
+                || errno == EOPNOTSUPP))
+            break;
+        if (count == -1)
+            return false;
+        if (count == 0)
+            return true;
+    }
+#endif
+    if (offset >= end)
+        return true;
+    BufferPool& pool = RunContext::getCurrentBufferPool();
+    bufferSize = std::min(bufferSize, pool.getLargestBufferSize());
+    BufferPool::Lease buffer =
+        pool.acquire(std::min(bufferSize, static_cast<size_t>(end - offset)));
+    while (offset < end) {
+        ssize_t count = pread(source, buffer.getData(),
+            std::min(buffer.getSize(), static_cast<size_t>(end - offset)),
+            offset);
+        if (count == -1 && errno == EINTR)
+            continue;
+        if (count == -1)
+            return false;
+        if (count == 0)
+            return true;
+        ssize_t written = 0;
+        while (written < count) {
+            ssize_t writeCount =
+                pwrite(destination, buffer.getData() + written,
+                    count - written, offset + written);
+            if (writeCount == -1 && errno == EINTR)
+                continue;
+            if (writeCount == -1)
+                return false;
+            written += writeCount;
+        }
+        offset += count;
+    }
+    return true;
+}
+
+bool
+copyRegularFileToAll(const std::string& sourcePath,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied)
+{
+    PhaseTimer timer(RunStatistics::COPY_PHASE);
+    TraceSpan span("io", "copyFileToAll", sourcePath);
+    int source = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+        return false;
+    struct stat sourceInfo;
+    if (fstat(source, &sourceInfo) != 0) {
+        close(source);
+        return false;
+    }
+    int attributes = RunContext::getCurrentCopyAttributes();
+    bool status = true;
+    for (size_t i = 0; i < destinationPaths.size(); i++) {
+        copied[i] =
+            copyOpenFile(source, sourceInfo, destinationPaths[i], attributes);
+        if (!copied[i])
+            status = false;
+    }
+    close(source);
+    return status;
+}
+
+bool
+copyDirectoryToAll(const std::string& sourcePath,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied)
+{
+    struct dirent** entries = nullptr;
+    int entryCount =
+        scandir(sourcePath.c_str(), &entries, returnOne, alphasort);
+    if (entryCount == -1)
+        return false;
+    for (size_t i = 0; i < destinationPaths.size(); i++)
+        copied[i] = ensureDirectoriesExist(destinationPaths[i]);
+    for (int i = 0; i < entryCount; i++) {
+        std::string entryName = entries[i]->d_name;
+        free(entries[i]);
+        if (entryName == "." || entryName == "..")
+            continue;
+        /* Destinations that already failed aren't worth writing to. */
+        std::vector<size_t> indices;
+        std::vector<std::string> entryDestinations;
+        for (size_t j = 0; j < destinationPaths.size(); j++) {
+            if (copied[j]) {
+                indices.push_back(j);
+                entryDestinations.push_back(
+                    destinationPaths[j] + "/" + entryName);
+            }
+        }
+        if (indices.empty())
+            continue;
+        std::vector<bool> entryCopied;
+        copyFileToAll(
+            sourcePath + "/" + entryName, entryDestinations, entryCopied);
+        for (size_t j = 0; j < indices.size(); j++)
+            copied[indices[j]] = entryCopied[j];
+    }
+    free(entries);
+    int attributes = RunContext::getCurrentCopyAttributes();
+    for (size_t i = 0; i < destinationPaths.size(); i++) {
+        if (copied[i]
+            && !copyPathAttributes(
+                sourcePath, destinationPaths[i], attributes))
+            copied[i] = false;
+    }
+    for (bool destinationCopied : copied) {
+        if (!destinationCopied)
+            return false;
+    }
+    return true;
+}
+} /* namespace */
+
 bool
 getYesOrNo()
 {
@@ -125,6 +377,23 @@ shellExpandPath(const std::string& path)
 #endif
 }
 
+std::string
+shellExpandPath(const std::string& path, const std::string& homeDirectory)
+{
+    if (!isInHomeDirectory(path))
+        return shellExpandPath(path);
+    if (path == "~")
+        return homeDirectory;
+    /* Only the rest is expanded, so spaces in homeDirectory are kept. */
+    return homeDirectory + shellExpandPath(path.substr(1));
+}
+
+bool
+isInHomeDirectory(const std::string& path)
+{
+    return path == "~" || path.compare(0, 2, "~/") == 0;
+}
+
 std::string
 getHomeDirectory()
 {
@@ -248,7 +517,11 @@ ensureDirectoriesExist(const std::string& path)
          * values passed to chmod in C, but I think 777 is guaranteed to be all
          * ones.
          */
-        return mkdir(path.c_str(), 0777) == 0;
+        if (mkdir(path.c_str(), 0777) == 0)
+            return true;
+        /* Something running at the same time may have just created it. */
+        if (errno != EEXIST || stat(path.c_str(), &pathInfo) != 0)
+            return false;
     }
     return S_ISDIR(pathInfo.st_mode);
 }
@@ -269,44 +542,17 @@ bool
 copyRegularFile(
     const std::string& sourcePath, const std::string& destinationPath)
 {
-    std::ifstream reader(sourcePath, std::ios::binary);
-    if (!reader.is_open())
-        return false;
-    reader.seekg(0, std::ios::end);
-    /*
-     * TBH I have no idea what type I'm supposed to be using here. The tellg()
-     * function returns an std::streampos and I'm not sure at all how that
-     * interacts with a streamsize, which is supposed to be the standard for
-     * representing IO stuff in C++ I think. This compiles so whatever.
-     */
-    std::streamsize sourceSize = reader.tellg();
-    reader.seekg(0, std::ios::beg);
-    if (!ensureParentDirectoriesExist(destinationPath))
+    PhaseTimer timer(RunStatistics::COPY_PHASE);
+    TraceSpan span("io", "copyRegularFile", sourcePath);
+    int source = open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source == -1)
         return false;
-    std::ofstream writer(destinationPath, std::ios::binary);
-    if (!writer.is_open()) {
-        reader.close();
-        return false;
-    }
-    char readBuffer[FILE_READ_SIZE];
-    std::streamsize remainingBytes = sourceSize;
-    /*
-     * Another thing I'm not sure of is error checking. There are members of
-     * the stream classes that give this stuff, but it's way different than C
-     * IO operations where they return an error code or the number of bytes
-     * read or written, and I don't want to research this.
-     */
-    while (remainingBytes > 0) {
-        std::streamsize bytesToRead = (remainingBytes < FILE_READ_SIZE)
-            ? remainingBytes
-            : FILE_READ_SIZE;
-        reader.read(readBuffer, bytesToRead);
-        writer.write(readBuffer, bytesToRead);
-        remainingBytes -= bytesToRead;
-    }
-    reader.close();
-    writer.close();
-    return true;
+    struct stat sourceInfo;
+    bool status = fstat(source, &sourceInfo) == 0
+        && copyOpenFile(source, sourceInfo, destinationPath,
+            RunContext::getCurrentCopyAttributes());
+    close(source);
+    return status;
 }
 
 bool
@@ -322,19 +568,37 @@ copyDirectory(
         free(entries);
         return false;
     }
+    /* Batches only copy the permissions. */
+    int attributes = RunContext::getCurrentCopyAttributes();
+    bool batching = attributes == COPY_MODE && isBatchIoAvailable();
+    std::vector<std::string> batchSourcePaths;
+    std::vector<std::string> batchDestinationPaths;
     for (int i = 0; i < entryCount; i++) {
         std::string entryName = entries[i]->d_name;
         if (entryName == "." || entryName == "..")
             continue;
         std::string sourceEntryPath = sourcePath + "/" + entryName;
         std::string destinationEntryPath = destinationPath + "/" + entryName;
+        if (batching && entries[i]->d_type == DT_REG) {
+            batchSourcePaths.push_back(sourceEntryPath);
+            batchDestinationPaths.push_back(destinationEntryPath);
+            continue;
+        }
         if (!copyFile(sourceEntryPath, destinationEntryPath)) {
             free(entries);
             return false;
         }
     }
     free(entries);
-    return true;
+    std::vector<bool> copied(batchSourcePaths.size(), false);
+    copyFilesInBatches(batchSourcePaths, batchDestinationPaths, copied);
+    for (size_t i = 0; i < copied.size(); i++) {
+        if (!copied[i]
+            && !copyRegularFile(batchSourcePaths[i], batchDestinationPaths[i]))
+            return false;
+    }
+    /* Last, so writing the entries doesn't change the times again. */
+    return copyPathAttributes(sourcePath, destinationPath, attributes);
 }
 
 bool
@@ -350,6 +614,221 @@ copyFile(const std::string& sourcePath, const std::string& destinationPath)
     return false;
 }
 
+bool
+copyFileToAll(const std::string& sourcePath,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied)
+{
+    copied.assign(destinationPaths.size(), false);
+    struct stat sourceInfo;
+    if (stat(sourcePath.c_str(), &sourceInfo) != 0)
+        return false;
+    if (S_ISREG(sourceInfo.st_mode))
+        return copyRegularFileToAll(sourcePath, destinationPaths, copied);
+    if (S_ISDIR(sourceInfo.st_mode))
+        return copyDirectoryToAll(sourcePath, destinationPaths, copied);
+    return false;
+}
+
+bool
+copyDescriptorContents(int source, int destination, uint64_t size)
+{
+#ifdef FICLONE
+    if (ioctl(destination, FICLONE, source) == 0)
+        return true;
+#endif
+    off_t end = size;
+    size_t bufferSize = COPY_BUFFER_SIZE;
+    if (size >= LARGE_FILE_SIZE) {
+        bufferSize = LARGE_COPY_BUFFER_SIZE;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(source, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    off_t offset = 0;
+#ifdef SEEK_DATA
+    /* Only a file taking up fewer blocks than its size can have holes. */
+    struct stat sourceInfo;
+    bool sparse = size > COPY_BUFFER_SIZE && fstat(source, &sourceInfo) == 0
+        && static_cast<uint64_t>(sourceInfo.st_blocks) * 512 < size;
+    if (sparse) {
+        while (offset < end) {
+            off_t dataOffset = lseek(source, offset, SEEK_DATA);
+            /* The rest of the file is a hole. */
+            if (dataOffset == -1 && errno == ENXIO)
+                break;
+            if (dataOffset == -1)
+                dataOffset = offset;
+            off_t holeOffset = lseek(source, dataOffset, SEEK_HOLE);
+            if (holeOffset == -1 || holeOffset > end)
+                holeOffset = end;
+            offset = std::min(dataOffset, end);
+            if (!copyDescriptorRange(
+                    source, destination, offset, holeOffset, bufferSize))
+                return false;
+            /* The source got shorter since its size was taken. */
+            if (offset < holeOffset)
+                return true;
+        }
+        /* A hole at the end is never written, so the size has to be set. */
+        return ftruncate(destination, end) == 0;
+    }
+#endif
+    return copyDescriptorRange(source, destination, offset, end, bufferSize);
+}
+
+bool
+copyFileAttributes(int source, const struct stat& sourceInfo, int destination,
+    int attributes)
+{
+    /* Changing the owner can clear the set-user-ID bits, so it goes first. */
+    if ((attributes & COPY_OWNER)
+        && fchown(destination, sourceInfo.st_uid, sourceInfo.st_gid) != 0)
+        return false;
+    if (fchmod(destination, sourceInfo.st_mode & 07777) != 0)
+        return false;
+#ifdef HAVE_SYS_XATTR_H
+    if ((attributes & COPY_EXTENDED_ATTRIBUTES)
+        && !copyExtendedAttributes(source, destination))
+        return false;
+#endif
+    if (attributes & COPY_TIMES) {
+        struct timespec times[2] = { sourceInfo.st_atim, sourceInfo.st_mtim };
+        if (futimens(destination, times) != 0)
+            return false;
+    }
+    return true;
+}
+
+bool
+writeAll(int descriptor, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = write(descriptor, data, size);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool
+readFileContents(const std::string& path, std::string& contents)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        contents.reserve(info.st_size);
+    contents.clear();
+    char readBuffer[FILE_READ_SIZE * 64];
+    for (;;) {
+        ssize_t bytesRead = read(fd, readBuffer, sizeof(readBuffer));
+        if (bytesRead == -1 && errno == EINTR)
+            continue;
+        if (bytesRead == -1) {
+            close(fd);
+            return false;
+        }
+        if (bytesRead == 0)
+            break;
+        contents.append(readBuffer, bytesRead);
+    }
+    close(fd);
+    return true;
+}
+
+bool
+writeFileAtomically(const std::string& path, const std::string& contents)
+{
+    TraceSpan span("io", "writeFileAtomically", path);
+    /*
+     * Write to what a symbolic link points to rather than replacing the link,
+     * since dotfiles are often links into a repository.
+     */
+    std::string targetPath = path;
+    char* realPath = realpath(path.c_str(), NULL);
+    if (realPath != NULL) {
+        targetPath = realPath;
+        free(realPath);
+    }
+    struct stat info;
+    bool exists = stat(targetPath.c_str(), &info) == 0;
+    /* Renaming over a file with other hard links would split it from them. */
+    if (exists && S_ISREG(info.st_mode) && info.st_nlink > 1) {
+        int fd = open(targetPath.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        bool success = fd != -1
+            && writeAll(fd, contents.data(), contents.length())
+            && fsync(fd) == 0;
+        if (fd != -1)
+            success = (close(fd) == 0) && success;
+        if (!success)
+            warn("Failed to write %s", path.c_str());
+        return success;
+    }
+
+    /*
+     * The rename is only atomic if both names are on the same filesystem.
+     * The temporary file is created with the usual permissions so new files
+     * get them from the umask, which can't be read without changing it.
+     */
+    static std::atomic<unsigned long> nextTemporary(0);
+    std::string temporaryPath;
+    int fd = -1;
+    for (int attempt = 0; fd == -1 && attempt < 100; attempt++) {
+        temporaryPath = targetPath + "." + std::to_string(getpid()) + "."
+            + std::to_string(nextTemporary++);
+        fd = open(temporaryPath.c_str(),
+            O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd == -1 && errno != EEXIST)
+            break;
+    }
+    if (fd == -1) {
+        warn("Failed to create temporary file for %s", path.c_str());
+        return false;
+    }
+    bool success = true;
+    if (exists) {
+        /*
+         * Only root can give the file away, but the owner may still be able
+         * to keep the group. Otherwise the file stays owned by whoever is
+         * writing it, so the mode is the only thing that has to be kept.
+         */
+        if (fchown(fd, info.st_uid, info.st_gid) != 0
+            && fchown(fd, -1, info.st_gid) != 0
+            && getuid() == info.st_uid)
+            warn("Failed to keep the group of %s", path.c_str());
+        success = fchmod(fd, info.st_mode & 07777) == 0;
+    }
+    success = success
+        && writeAll(fd, contents.data(), contents.length())
+        && fsync(fd) == 0;
+    success = (close(fd) == 0) && success;
+    success = success
+        && rename(temporaryPath.c_str(), targetPath.c_str()) == 0;
+    if (!success) {
+        warn("Failed to write %s", path.c_str());
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    /* Sync the directory too so the rename itself survives a crash. */
+    char* pathCopy = strdup(targetPath.c_str());
+    if (pathCopy == nullptr)
+        err(EXIT_FAILURE, nullptr);
+    int directoryFd = open(dirname(pathCopy), O_RDONLY | O_DIRECTORY);
+    free(pathCopy);
+    if (directoryFd != -1) {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+    return true;
+}
+
 int
 returnOne(const struct dirent* entry)
 {
@@ -366,4 +845,90 @@ getCanonicalPath(const std::string& path)
     free(realPath);
     return asString;
 }
+
+std::string
+formatByteCount(double bytes)
+{
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    const size_t unitCount = sizeof(units) / sizeof(units[0]);
+    size_t unit = 0;
+    while (bytes >= 1024 && unit + 1 < unitCount) {
+        bytes /= 1024;
+        unit++;
+    }
+    char buffer[32];
+    if (unit == 0)
+        snprintf(buffer, sizeof(buffer), "%.0f %s", bytes, units[unit]);
+    else
+        snprintf(buffer, sizeof(buffer), "%.1f %s", bytes, units[unit]);
+    return buffer;
+}
+
+bool
+parseByteCount(const std::string& text, uint64_t& bytes)
+{
+    if (text.empty() || text[0] < '0' || text[0] > '9')
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(text.c_str(), &end, 10);
+    if (errno != 0)
+        return false;
+    int shift = 0;
+    switch (*end) {
+    case '\0':
+        break;
+    case 'K':
+    case 'k':
+        shift = 10;
+        break;
+    case 'M':
+    case 'm':
+        shift = 20;
+        break;
+    case 'G':
+    case 'g':
+        shift = 30;
+        break;
+    default:
+        return false;
+    }
+    if (shift != 0 && *++end != '\0')
+        return false;
+    if (value > (UINT64_MAX >> shift))
+        return false;
+    bytes = static_cast<uint64_t>(value) << shift;
+    return true;
+}
+
+std::string
+escapeJsonString(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.length());
+    for (char character : value) {
+        switch (character) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", character);
+                escaped += buffer;
+            } else
+                escaped += character;
+        }
+    }
+    return escaped;
+}
 } /* namespace gdfm */
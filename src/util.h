@@ -20,11 +20,15 @@
  * IN THE SOFTWARE.
  */
 
+#include <sys/stat.h>
+
 #include <dirent.h>
 #include <ftw.h>
+#include <stdint.h>
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #ifndef UTIL_H
 #define UTIL_H
@@ -38,6 +42,25 @@ namespace gdfm {
 const int MAX_FILE_DESCRIPTORS = 30;
 /* The size of the buffer to use when reading from a binary file. */
 const std::streamsize FILE_READ_SIZE = 1024;
+/* The size of the buffer to use when copying between open files. */
+const size_t COPY_BUFFER_SIZE = 64 * 1024;
+/*
+ * Files at least this big are read with LARGE_COPY_BUFFER_SIZE instead, and
+ * the kernel is told they will be read in order.
+ */
+const uint64_t LARGE_FILE_SIZE = 1024 * 1024;
+const size_t LARGE_COPY_BUFFER_SIZE = 1024 * 1024;
+/* What is copied along with the contents of a file, as a mask. */
+enum CopyAttribute {
+    /* The permissions, which are always copied. */
+    COPY_MODE = 1,
+    /* The access and modification times. */
+    COPY_TIMES = 2,
+    /* Extended attributes, where the system has them. */
+    COPY_EXTENDED_ATTRIBUTES = 4,
+    /* The owner and group, which usually only works as root. */
+    COPY_OWNER = 8
+};
 /*
  * Waits for the user to input a yes or no input on the current line. Accepts
  * any string that starts with a "y" or "Y" as true and any string that starts
@@ -73,6 +96,14 @@ std::string getCurrentDirectory();
  * an errorr or if the string path expands to more than one word.
  */
 std::string shellExpandPath(const std::string& path);
+/*
+ * Same as shellExpandPath(path), except that a "~" at the start of path
+ * stands for homeDirectory instead of the user's home directory.
+ */
+std::string shellExpandPath(
+    const std::string& path, const std::string& homeDirectory);
+/* Returns true if path starts with "~" standing for the home directory. */
+bool isInHomeDirectory(const std::string& path);
 /*
  * Returns the current user's home directory. Throws a runtime error when
  * encountering an error.
@@ -149,9 +180,11 @@ bool ensureDirectoriesExist(const std::string& path);
  */
 bool ensureParentDirectoriesExist(const std::string& path);
 /*
- * Copies the given regular file byte for byte. Fails if the source path
- * doesn't exist, the destination path can't be accessed, or if the process
- * failed. Attempts to create parent directories if they don't exist.
+ * Copies the given regular file byte for byte, along with the attributes set
+ * for the current run, which are only its permissions by default. Fails if
+ * the source path doesn't exist, the destination path can't be accessed, or
+ * if the process failed. Attempts to create parent directories if they don't
+ * exist.
  *
  * Returns true on success, false on failure.
  */
@@ -175,6 +208,64 @@ bool copyDirectory(
  */
 bool copyFile(
     const std::string& sourcePath, const std::string& destinationPath);
+/*
+ * Copies the file at sourcePath to every one of destinationPaths, opening
+ * and reading each source file once however many destinations there are.
+ * Works on regular files and directories like copyFile(). A destination
+ * that fails doesn't stop the others. copied is set to whether each
+ * destination was copied completely.
+ *
+ * Returns true if every destination was copied, false otherwise.
+ */
+bool copyFileToAll(const std::string& sourcePath,
+    const std::vector<std::string>& destinationPaths,
+    std::vector<bool>& copied);
+/*
+ * Copies the first size bytes of the file open as source to the file open
+ * as destination, which should be empty. The file system is asked to share
+ * the blocks first, then to copy them itself, and the bytes only go through
+ * memory if neither works. Holes in source stay holes in destination. Reads
+ * never depend on the offset of source, so one source may be copied from
+ * again and again.
+ *
+ * Returns true on success, false on failure.
+ */
+bool copyDescriptorContents(int source, int destination, uint64_t size);
+/*
+ * Writes all size bytes of data to the file open as descriptor, however
+ * many writes it takes.
+ *
+ * Returns true on success, false on failure.
+ */
+bool writeAll(int descriptor, const char* data, size_t size);
+/*
+ * Gives the file open as destination the attributes of the one open as
+ * source, which sourceInfo describes. Attributes is a mask of CopyAttribute
+ * values, though the permissions are always copied.
+ *
+ * Returns true on success, false on failure.
+ */
+bool copyFileAttributes(int source, const struct stat& sourceInfo,
+    int destination, int attributes);
+/*
+ * Reads the whole file at path into contents, replacing what was there.
+ *
+ * Returns true on success, false on failure.
+ */
+bool readFileContents(const std::string& path, std::string& contents);
+/*
+ * Replaces the file at path with contents so that anything reading it sees
+ * either the old file or the new one, never part of a write. The contents go
+ * to a temporary file in the same directory, which is synced and renamed
+ * over path. The new file keeps the permissions, owner and group of the one
+ * it replaces where it can. If path is a symbolic link, the file it points to
+ * is replaced instead. A file with other hard links is written in place
+ * instead, since renaming over it would split it from them.
+ *
+ * Returns true on success. On failure path is left as it was and false is
+ * returned.
+ */
+bool writeFileAtomically(const std::string& path, const std::string& contents);
 /*
  * Function to be used with scandir as a filter that doesn't filter anything.
  *
@@ -189,6 +280,28 @@ int returnOne(const struct dirent* entry);
  * Returns a path pointing to the same file with extra slashes removed, etc.
  */
 std::string getCanonicalPath(const std::string& path);
+
+/*
+ * Formats a number of bytes for people to read, using the largest binary unit
+ * that keeps the number above one.
+ *
+ * Returns a string like "512 B" or "1.5 MiB".
+ */
+std::string formatByteCount(double bytes);
+/*
+ * Parses a number of bytes like "65536", "512K", "64M" or "1G", where the
+ * units are binary.
+ *
+ * Returns true on success, false if text isn't a number of bytes.
+ */
+bool parseByteCount(const std::string& text, uint64_t& bytes);
+/*
+ * Escapes quotes, backslashes, and control characters so the string can be
+ * put between quotes in JSON.
+ *
+ * Returns the escaped string, without surrounding quotes.
+ */
+std::string escapeJsonString(const std::string& value);
 } /* namespace gdfm */
 
 #endif /* UTIL_H */
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Usage: update-keeps-modes.sh GDFM_CLI
+#
+# Installs files whose modes aren't what the umask gives new files, then
+# updates them. The update must not copy anything, since the copies already
+# have the modes of their sources.
+
+set -e
+
+cli=$1
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+umask 022
+# Nothing may end up in the real home directory.
+HOME=$directory/home
+export HOME
+
+mkdir -p "$directory/source/private-directory" "$directory/home"
+printf '#!/bin/sh\necho hello\n' > "$directory/source/script"
+chmod 0755 "$directory/source/script"
+echo secret > "$directory/source/private-file"
+chmod 0600 "$directory/source/private-file"
+echo inside > "$directory/source/private-directory/file"
+chmod 0700 "$directory/source/private-directory"
+cat > "$directory/source/config.dfm" <<CONFIG
+modes:
+	script $HOME
+	private-file $HOME
+	private-directory $HOME
+CONFIG
+
+cd "$directory/source"
+"$cli" -i -a -s "$directory/install.json"
+"$cli" -c -a -s "$directory/update.json"
+
+if ! grep -q '"copied_files": 0' "$directory/update.json"; then
+	echo "The update copied files again:" >&2
+	grep '"copied_files"' "$directory/update.json" >&2
+	exit 1
+fi